@@ -55,6 +55,10 @@ extern char table_dump_hs[];
 pi_cli_status_t do_table_dump(char *subcmd);
 char *complete_table_dump(const char *text, int state);
 
+extern char table_usage_hs[];
+pi_cli_status_t do_table_usage(char *subcmd);
+char *complete_table_usage(const char *text, int state);
+
 extern char add_p4_hs[];
 pi_cli_status_t do_add_p4(char *subcmd);
 
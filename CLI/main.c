@@ -27,7 +27,9 @@
 #include <assert.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <readline/history.h>
@@ -46,12 +48,18 @@ pi_session_handle_t sess;
 static char *opt_config_path = NULL;
 static char *opt_rpc_addr = NULL;
 static char *opt_notifications_addr = NULL;
+static char *opt_cmd_file = NULL;
 static int opt_call_pi_destroy = 0;
 
 typedef pi_cli_status_t (*CLIFnPtr)(char *);
 typedef char *(*CLICompPtr)(const char *text, int state);
 
 #define PI_CLI_CMD_FLAGS_REQUIRES_DEVICE (1 << 0)
+// table / action profile updates, which can be grouped in a PI batch when
+// reading commands from a file
+#define PI_CLI_CMD_FLAGS_BATCHABLE (1 << 1)
+#define PI_CLI_CMD_FLAGS_TABLE_WRITE \
+  (PI_CLI_CMD_FLAGS_REQUIRES_DEVICE | PI_CLI_CMD_FLAGS_BATCHABLE)
 
 typedef struct {
   const char *name;
@@ -145,33 +153,35 @@ static void init_cmd_map() {
                NULL, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
 
   register_cmd("table_add", do_table_add, table_add_hs, complete_table_add,
-               PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_delete", do_table_delete, table_delete_hs,
-               complete_table_delete, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               complete_table_delete, PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_delete_wkey", do_table_delete_wkey, table_delete_wkey_hs,
-               complete_table_delete_wkey, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               complete_table_delete_wkey, PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_modify", do_table_modify, table_modify_hs,
-               complete_table_modify, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               complete_table_modify, PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_modify_wkey", do_table_modify_wkey, table_modify_wkey_hs,
-               complete_table_modify_wkey, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               complete_table_modify_wkey, PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_set_default", do_table_set_default, table_set_default_hs,
-               complete_table_set_default, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               complete_table_set_default, PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_reset_default", do_table_reset_default,
                table_reset_default_hs, complete_table_reset_default,
-               PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("table_dump", do_table_dump, table_dump_hs, complete_table_dump,
                PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+  register_cmd("table_usage", do_table_usage, table_usage_hs,
+               complete_table_usage, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
 
   register_cmd("act_prof_create_member", do_act_prof_create_member,
                act_prof_create_member_hs, complete_act_prof_create_member,
-               PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("act_prof_create_group", do_act_prof_create_group,
                act_prof_create_group_hs, complete_act_prof_create_group,
-               PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("act_prof_add_member_to_group", do_act_prof_add_member_to_group,
                act_prof_add_member_to_group_hs,
                complete_act_prof_add_member_to_group,
-               PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
+               PI_CLI_CMD_FLAGS_TABLE_WRITE);
   register_cmd("act_prof_dump", do_act_prof_dump, act_prof_dump_hs,
                complete_act_prof_dump, PI_CLI_CMD_FLAGS_REQUIRES_DEVICE);
 
@@ -210,7 +220,8 @@ static void cleanup() {
   if (opt_call_pi_destroy) pi_destroy();
 }
 
-static void dispatch_command(const char *first_word, char *subcmd) {
+static pi_cli_status_t dispatch_command(const char *first_word,
+                                        char *subcmd) {
   assert(first_word);
   const cmd_data_t *cmd_data = get_cmd_data(first_word);
   if (cmd_data) {
@@ -219,24 +230,23 @@ static void dispatch_command(const char *first_word, char *subcmd) {
       fprintf(stderr,
               "Cannot execute this command without selecting a device "
               "first with the 'select_device' command.\n");
-      return;
+      return PI_CLI_STATUS_ERROR;
     }
     pi_cli_status_t status = cmd_data->fn_ptr(subcmd);
     if (status != PI_CLI_STATUS_SUCCESS) {
       fprintf(stderr, "Command returned with the following error:\n");
       fprintf(stderr, "%s\n", error_code_to_string(status));
     }
+    return status;
   } else {
     fprintf(stderr, "Unknown command '%s'\n", first_word);
+    return PI_CLI_STATUS_ERROR;
   }
 }
 
-// returns 0 if wants loop to continue, <> 0 otherwise
-static int process_one_cmd(char *cmd) {
-  if (!cmd) return 1;
-  if (!strcmp("quit", cmd)) return 1;
-  if (cmd[0] == '\0') return 0;
-  add_history(cmd);
+// terminates the command name in place and returns the arguments, or NULL if
+// there are none
+static char *split_cmd(char *cmd) {
   char *token = NULL;
   for (token = cmd; (*token != '\0') && (*token != ' '); token++)
     ;
@@ -245,11 +255,135 @@ static int process_one_cmd(char *cmd) {
     subcmd = token + 1;
     *token = '\0';
   }
+  return subcmd;
+}
 
+// returns 0 if wants loop to continue, <> 0 otherwise
+static int process_one_cmd(char *cmd) {
+  if (!cmd) return 1;
+  if (!strcmp("quit", cmd)) return 1;
+  if (cmd[0] == '\0') return 0;
+  add_history(cmd);
+  char *subcmd = split_cmd(cmd);
   dispatch_command(cmd, subcmd);
   return 0;
 }
 
+static double elapsed_us(const struct timespec *start,
+                         const struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1e6 +
+         (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+// Starts a batch with the command at the given line. Returns 0 on success and 1
+// on failure, in which case the command is sent to the target on its own.
+static int begin_batch(const char *path, size_t line) {
+  pi_status_t status = pi_batch_begin(sess);
+  if (status == PI_STATUS_SUCCESS) return 0;
+  fprintf(stderr, "Error at %s:%zu: cannot start batch, status %d\n", path,
+          line, status);
+  return 1;
+}
+
+// Sends the ongoing batch to the target. Returns 0 on success and 1 on failure.
+// A failed batch is reported with the range of lines it covers, since any of
+// the commands in it may be responsible.
+static int end_batch(const char *path, size_t first_line, size_t last_line) {
+  pi_status_t status = pi_batch_end(sess, true);
+  if (status == PI_STATUS_SUCCESS) return 0;
+  fprintf(stderr, "Error at %s:%zu-%zu: batch failed with status %d\n", path,
+          first_line, last_line, status);
+  return 1;
+}
+
+// Runs every command in the file, without prompts or history. Consecutive table
+// and action profile updates are sent to the target as a single PI batch; any
+// other command (e.g. select_device or table_dump) closes the ongoing batch
+// first so that it observes the effect of the previous updates. Returns the
+// number of commands which failed, or -1 if the file cannot be read.
+static int process_cmd_file(const char *path) {
+  FILE *f = (!strcmp(path, "-")) ? stdin : fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open command file '%s'\n", path);
+    return -1;
+  }
+
+  char *line = NULL;
+  size_t line_cap = 0;
+  ssize_t line_len;
+  size_t line_num = 0;
+  int in_batch = 0;
+  size_t batch_first_line = 0;
+  size_t batch_last_line = 0;
+  size_t num_batches = 0;
+  size_t num_cmds_run = 0;
+  int num_errors = 0;
+  double total_cmd_us = 0.0;
+  double max_cmd_us = 0.0;
+  struct timespec start, end, cmd_start, cmd_end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while ((line_len = getline(&line, &line_cap, f)) != -1) {
+    line_num++;
+    while (line_len > 0 &&
+           (line[line_len - 1] == '\n' || line[line_len - 1] == '\r'))
+      line[--line_len] = '\0';
+    char *cmd = line;
+    while (*cmd == ' ' || *cmd == '\t') cmd++;
+    if (cmd[0] == '\0' || cmd[0] == '#') continue;
+
+    char *subcmd = split_cmd(cmd);
+    if (!strcmp("quit", cmd)) break;
+
+    const cmd_data_t *cmd_data = get_cmd_data(cmd);
+    int batchable =
+        cmd_data && (cmd_data->flags & PI_CLI_CMD_FLAGS_BATCHABLE) &&
+        is_device_selected;
+    if (in_batch && !batchable) {
+      num_errors += end_batch(path, batch_first_line, batch_last_line);
+      in_batch = 0;
+    }
+    if (!in_batch && batchable) {
+      if (begin_batch(path, line_num)) {
+        num_errors++;
+      } else {
+        in_batch = 1;
+        batch_first_line = line_num;
+        num_batches++;
+      }
+    }
+    if (in_batch) batch_last_line = line_num;
+
+    clock_gettime(CLOCK_MONOTONIC, &cmd_start);
+    pi_cli_status_t status = dispatch_command(cmd, subcmd);
+    clock_gettime(CLOCK_MONOTONIC, &cmd_end);
+
+    double cmd_us = elapsed_us(&cmd_start, &cmd_end);
+    total_cmd_us += cmd_us;
+    if (cmd_us > max_cmd_us) max_cmd_us = cmd_us;
+    num_cmds_run++;
+    if (status != PI_CLI_STATUS_SUCCESS) {
+      fprintf(stderr, "Error at %s:%zu\n", path, line_num);
+      num_errors++;
+    }
+  }
+  if (in_batch)
+    num_errors += end_batch(path, batch_first_line, batch_last_line);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  free(line);
+  if (f != stdin) fclose(f);
+
+  double total_us = elapsed_us(&start, &end);
+  printf("Processed %zu commands (%d errors) in %zu batches\n", num_cmds_run,
+         num_errors, num_batches);
+  printf("Total time: %.3f s, throughput: %.1f commands/s\n", total_us / 1e6,
+         (total_us > 0.0) ? num_cmds_run * 1e6 / total_us : 0.0);
+  printf("Command latency: avg %.1f us, max %.1f us\n",
+         num_cmds_run ? total_cmd_us / num_cmds_run : 0.0, max_cmd_us);
+  return num_errors;
+}
+
 char *command_generator(const char *text, int state) {
   static size_t index;
   static int len;
@@ -329,6 +463,8 @@ static void print_help(const char *name) {
           "PI CLI\n\n"
           "-c          path to P4 bmv2 JSON config\n"
           "-a          nanomsg address, for RPC mode\n"
+          "-f          run the commands in this file ('-' for stdin) instead\n"
+          "            of starting an interactive session, then exit\n"
           "-d          call pi_destroy when done\n",
           name);
 }
@@ -338,7 +474,7 @@ static int parse_opts(int argc, char *const argv[]) {
 
   opterr = 0;
 
-  while ((c = getopt(argc, argv, "c:a:n:dh")) != -1) {
+  while ((c = getopt(argc, argv, "c:a:n:f:dh")) != -1) {
     switch (c) {
       case 'c':
         opt_config_path = optarg;
@@ -349,6 +485,9 @@ static int parse_opts(int argc, char *const argv[]) {
       case 'n':
         opt_notifications_addr = optarg;
         break;
+      case 'f':
+        opt_cmd_file = optarg;
+        break;
       case 'd':
         opt_call_pi_destroy = 1;
         break;
@@ -356,7 +495,7 @@ static int parse_opts(int argc, char *const argv[]) {
         print_help(argv[0]);
         exit(0);
       case '?':
-        if (optopt == 'c' || optopt == 'a') {
+        if (optopt == 'c' || optopt == 'a' || optopt == 'f') {
           fprintf(stderr, "Option -%c requires an argument.\n\n", optopt);
           print_help(argv[0]);
         } else if (isprint(optopt)) {
@@ -412,6 +551,12 @@ int main_cli(int argc, char *argv[]) {
 
   init_cmd_map();
 
+  if (opt_cmd_file) {
+    int num_errors = process_cmd_file(opt_cmd_file);
+    cleanup();
+    return (num_errors == 0) ? 0 : 1;
+  }
+
   rl_attempted_completion_function = CLI_completion;
   // this effectively disables filename completion
   rl_completion_entry_function = dummy_completion;
@@ -110,11 +110,11 @@ static void print_action_entry(pi_table_entry_t *entry) {
   print_action_data(entry->entry.action_data);
 }
 
-static pi_cli_status_t dump_entries(pi_p4_id_t t_id,
-                                    pi_table_fetch_res_t *res) {
-  printf("==========\n");
-  printf("TABLE ENTRIES\n");
+// entries are retrieved from the target in chunks of at most this many entries,
+// so that dumping a large table does not require holding all of it in memory
+#define TABLE_DUMP_CHUNK_SIZE 1024
 
+static void dump_chunk(pi_p4_id_t t_id, pi_table_fetch_res_t *res) {
   size_t num_match_fields = pi_p4info_table_num_match_fields(p4info_curr, t_id);
 
   const int name_out_width = get_name_out_width(20, t_id);
@@ -143,8 +143,34 @@ static pi_cli_status_t dump_entries(pi_p4_id_t t_id,
 
     print_action_entry(&entry.entry);
   }
+}
+
+// expects the first chunk to have been retrieved already; the total number of
+// entries is only known upfront when the table fits in that chunk, otherwise it
+// is printed after the entries
+static pi_cli_status_t dump_entries(pi_p4_id_t t_id,
+                                    pi_table_fetch_res_t *res) {
+  bool print_total = !pi_table_entries_fetch_is_last_chunk(res);
+  if (!print_total) {
+    printf("Successfully retrieved %zu entrie(s).\n",
+           pi_table_entries_num(res));
+  }
+
+  printf("==========\n");
+  printf("TABLE ENTRIES\n");
+
+  size_t total = 0;
+  while (pi_table_entries_num(res) > 0) {
+    dump_chunk(t_id, res);
+    total += pi_table_entries_num(res);
+    if (pi_table_entries_fetch_next_chunk(sess, res) != PI_STATUS_SUCCESS) {
+      printf("Error when trying to retrieve entries.\n");
+      return PI_CLI_STATUS_TARGET_ERROR;
+    }
+  }
 
   printf("==========\n");
+  if (print_total) printf("Successfully retrieved %zu entrie(s).\n", total);
 
   return PI_CLI_STATUS_SUCCESS;
 }
@@ -177,18 +203,22 @@ pi_cli_status_t do_table_dump(char *subcmd) {
 
   pi_table_fetch_res_t *res;
   pi_status_t rc;
-  rc = pi_table_entries_fetch(sess, dev_tgt.dev_id, t_id, &res);
+  rc = pi_table_entries_fetch_begin(sess, dev_tgt.dev_id, t_id,
+                                    TABLE_DUMP_CHUNK_SIZE, &res);
+  if (rc != PI_STATUS_SUCCESS) {
+    printf("Error when trying to retrieve entries.\n");
+    return PI_CLI_STATUS_TARGET_ERROR;
+  }
+  rc = pi_table_entries_fetch_next_chunk(sess, res);
   if (rc == PI_STATUS_SUCCESS) {
-    printf("Successfully retrieved %zu entrie(s).\n",
-           pi_table_entries_num(res));
     status = dump_entries(t_id, res);
-    pi_table_entries_fetch_done(sess, res);
 
     if (status == PI_CLI_STATUS_SUCCESS) status = dump_default_entry(t_id);
   } else {
     printf("Error when trying to retrieve entries.\n");
     status = PI_CLI_STATUS_TARGET_ERROR;
   }
+  pi_table_entries_fetch_end(sess, res);
 
   return status;
 };
@@ -196,3 +226,32 @@ pi_cli_status_t do_table_dump(char *subcmd) {
 char *complete_table_dump(const char *text, int state) {
   return complete_table(text, state);
 }
+
+char table_usage_hs[] =
+    "Show the number of entries in a match table without retrieving them: "
+    "table_usage <table name>";
+
+pi_cli_status_t do_table_usage(char *subcmd) {
+  const char *args[1];
+  size_t num_args = sizeof(args) / sizeof(char *);
+  if (parse_fixed_args(subcmd, args, num_args) < num_args)
+    return PI_CLI_STATUS_TOO_FEW_ARGS;
+  const char *t_name = args[0];
+  pi_p4_id_t t_id = pi_p4info_table_id_from_name(p4info_curr, t_name);
+  if (t_id == PI_INVALID_ID) return PI_CLI_STATUS_INVALID_TABLE_NAME;
+
+  size_t num_entries, max_size;
+  pi_status_t rc = pi_table_get_usage(sess, dev_tgt.dev_id, t_id, &num_entries,
+                                      &max_size);
+  if (rc != PI_STATUS_SUCCESS) {
+    printf("Error when trying to retrieve table usage.\n");
+    return PI_CLI_STATUS_TARGET_ERROR;
+  }
+  printf("Table holds %zu entrie(s), max size is %zu.\n", num_entries,
+         max_size);
+  return PI_CLI_STATUS_SUCCESS;
+}
+
+char *complete_table_usage(const char *text, int state) {
+  return complete_table(text, state);
+}
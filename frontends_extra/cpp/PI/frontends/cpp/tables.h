@@ -23,9 +23,11 @@
 
 #include <PI/pi.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <cstddef>
 #include <cstdint>
 
 namespace pi {
@@ -33,6 +35,70 @@ namespace pi {
 // TODO(antonin): temporary
 typedef int error_code_t;
 
+// Simple bump-pointer allocator, which can be used to back the storage of
+// MatchKey and ActionData objects which are too large for their inline
+// buffer. Memory is only reclaimed by reset(), which keeps the blocks around
+// for reuse; all objects allocated from the arena must have been destroyed
+// before calling it. This class is not thread-safe.
+class Arena {
+ public:
+  explicit Arena(size_t block_size = 4096);
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t size);
+
+  void reset();
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks{};
+  size_t block_size;
+  size_t current_block{0};
+  size_t offset{0};
+};
+
+namespace detail {
+
+// Zero-initialized byte buffer used by MatchKey and ActionData. Small buffers
+// are stored inline, which means that the common case does not require any
+// dynamic memory allocation. Larger buffers are allocated from the arena if one
+// is provided, or from the heap otherwise. Copies never use the arena, since
+// they are typically meant to outlive it (e.g. a key stored in a map).
+class SmallBuffer {
+ public:
+  // enough room for the pi_match_key_t / pi_action_data_t header and 64 bytes
+  // of data
+  static constexpr size_t kInlineSize = 96;
+
+  SmallBuffer(size_t size, Arena *arena);
+
+  SmallBuffer(const SmallBuffer &other);
+  SmallBuffer(SmallBuffer &&other) noexcept;
+  SmallBuffer &operator=(SmallBuffer &&other) noexcept;
+  SmallBuffer &operator=(const SmallBuffer &other) = delete;
+
+  char *data() const { return ptr; }
+
+  size_t size() const { return _size; }
+
+ private:
+  void move_from(SmallBuffer &&other);
+
+  alignas(std::max_align_t) char inline_data[kInlineSize];
+  std::unique_ptr<char[]> heap_data{nullptr};
+  char *ptr;
+  size_t _size;
+};
+
+}  // namespace detail
+
 class MatchKeyReader {
  public:
   explicit MatchKeyReader(const pi_match_key_t *match_key);
@@ -63,7 +129,10 @@ class MatchKey {
   friend struct MatchKeyEq;
 
  public:
-  MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id);
+  // if provided, the arena is only used when the match key does not fit in the
+  // inline buffer
+  MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id,
+           Arena *arena = nullptr);
   explicit MatchKey(const pi_match_key_t *pi_match_key);  // performs a copy
   ~MatchKey();
 
@@ -115,10 +184,11 @@ class MatchKey {
   error_code_t set_valid(pi_p4_id_t f_id, bool key);
   error_code_t get_valid(pi_p4_id_t f_id, bool *key) const;
 
+  // the copy never uses the arena of other
   MatchKey(const MatchKey &other);
   MatchKey &operator=(const MatchKey &other);
-  MatchKey(MatchKey &&other) = default;
-  MatchKey &operator=(MatchKey &&other) = default;
+  MatchKey(MatchKey &&other) noexcept;
+  MatchKey &operator=(MatchKey &&other) noexcept;
 
  private:
   template <typename T>
@@ -134,7 +204,7 @@ class MatchKey {
   pi_p4_id_t table_id;
   size_t nset{0};
   size_t mk_size;
-  std::vector<char> _data;
+  detail::SmallBuffer _data;
   pi_match_key_t *match_key;
   MatchKeyReader reader;
 };
@@ -167,9 +237,17 @@ class ActionData {
   friend class MatchTable;
   friend class ActProf;
  public:
-  ActionData(const pi_p4info_t *p4info, pi_p4_id_t action_id);
+  // if provided, the arena is only used when the action data does not fit in
+  // the inline buffer
+  ActionData(const pi_p4info_t *p4info, pi_p4_id_t action_id,
+             Arena *arena = nullptr);
   ~ActionData();
 
+  ActionData(const ActionData &other) = delete;
+  ActionData &operator=(const ActionData &other) = delete;
+  ActionData(ActionData &&other) noexcept;
+  ActionData &operator=(ActionData &&other) noexcept;
+
   void reset();
 
   pi_p4_id_t get_action_id() const;
@@ -198,7 +276,7 @@ class ActionData {
   pi_p4_id_t action_id;
   size_t nset{0};
   size_t ad_size;
-  std::vector<char> _data;
+  detail::SmallBuffer _data;
   pi_action_data_t *action_data;
   ActionDataReader reader;
 };
@@ -227,9 +305,10 @@ class ActionEntry {
   ActionEntry(ActionEntry &&) = delete;
   ActionEntry &operator=(ActionEntry &&) = delete;
 
-  void init_action_data(const pi_p4info_t *p4info, pi_p4_id_t action_id) {
+  void init_action_data(const pi_p4info_t *p4info, pi_p4_id_t action_id,
+                        Arena *arena = nullptr) {
     assert(tag == Tag::NONE);
-    new(&_action_data) ActionData(p4info, action_id);
+    new(&_action_data) ActionData(p4info, action_id, arena);
     tag = Tag::ACTION_DATA;
   }
 
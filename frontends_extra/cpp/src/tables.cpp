@@ -26,7 +26,9 @@
 #include <PI/int/pi_int.h>
 #include <PI/int/serialize.h>
 
+#include <algorithm>  // for std::max
 #include <string>
+#include <utility>  // for std::move
 
 #include <cstring>
 
@@ -88,8 +90,98 @@ int64_t endianness(int64_t v) {
   return static_cast<int64_t>(endianness(static_cast<uint64_t>(v)));
 }
 
+constexpr size_t kArenaAlignment = alignof(std::max_align_t);
+
 }  // namespace
 
+static_assert(sizeof(pi_match_key_t) + 64 <= detail::SmallBuffer::kInlineSize,
+              "Inline buffer too small for 64-byte match keys");
+static_assert(sizeof(pi_action_data_t) + 64 <=
+              detail::SmallBuffer::kInlineSize,
+              "Inline buffer too small for 64-byte action data");
+
+Arena::Arena(size_t block_size)
+    : block_size(block_size) { }
+
+Arena::~Arena() = default;
+
+void *
+Arena::allocate(size_t size) {
+  size = (size + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+  for (; current_block < blocks.size(); current_block++, offset = 0) {
+    auto &block = blocks[current_block];
+    if (block.size - offset >= size) {
+      auto ptr = block.data.get() + offset;
+      offset += size;
+      return ptr;
+    }
+  }
+  auto new_block_size = std::max(block_size, size);
+  blocks.push_back(
+      {std::unique_ptr<char[]>(new char[new_block_size]), new_block_size});
+  current_block = blocks.size() - 1;
+  offset = size;
+  return blocks.back().data.get();
+}
+
+void
+Arena::reset() {
+  current_block = 0;
+  offset = 0;
+}
+
+namespace detail {
+
+constexpr size_t SmallBuffer::kInlineSize;
+
+SmallBuffer::SmallBuffer(size_t size, Arena *arena)
+    : _size(size) {
+  if (size <= kInlineSize)
+    ptr = inline_data;
+  else if (arena != nullptr)
+    ptr = static_cast<char *>(arena->allocate(size));
+  else
+    heap_data.reset(ptr = new char[size]);
+  std::memset(ptr, 0, size);
+}
+
+SmallBuffer::SmallBuffer(const SmallBuffer &other)
+    : _size(other._size) {
+  if (_size <= kInlineSize)
+    ptr = inline_data;
+  else
+    heap_data.reset(ptr = new char[_size]);
+  std::memcpy(ptr, other.ptr, _size);
+}
+
+SmallBuffer::SmallBuffer(SmallBuffer &&other) noexcept {
+  move_from(std::move(other));
+}
+
+SmallBuffer &
+SmallBuffer::operator=(SmallBuffer &&other) noexcept {
+  if (this != &other) move_from(std::move(other));
+  return *this;
+}
+
+void
+SmallBuffer::move_from(SmallBuffer &&other) {
+  _size = other._size;
+  if (other.ptr == other.inline_data) {
+    heap_data.reset();
+    ptr = inline_data;
+    std::memcpy(ptr, other.inline_data, _size);
+  } else {
+    // heap or arena storage: we can steal the pointer
+    heap_data = std::move(other.heap_data);
+    ptr = other.ptr;
+    other.ptr = other.inline_data;
+    other._size = 0;
+  }
+}
+
+}  // namespace detail
+
 MatchKeyReader::MatchKeyReader(const pi_match_key_t *match_key)
     : match_key(match_key) { }
 
@@ -160,14 +252,15 @@ MatchKeyReader::get_priority() const {
   return match_key->priority;
 }
 
-MatchKey::MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id)
+MatchKey::MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id,
+                   Arena *arena)
     : p4info(p4info), table_id(table_id),
       mk_size(pi_p4info_table_match_key_size(p4info, table_id)),
-      _data(sizeof(*match_key) + mk_size),
+      _data(sizeof(*match_key) + mk_size, arena),
       match_key(reinterpret_cast<decltype(match_key)>(_data.data())),
       reader(match_key) {
-  // std::allocator is using standard new, no alignment issue with the cast
-  // above
+  // SmallBuffer storage is aligned to std::max_align_t, no alignment issue
+  // with the cast above
   match_key->p4info = p4info;
   match_key->table_id = table_id;
   match_key->priority = 0;
@@ -178,7 +271,7 @@ MatchKey::MatchKey(const pi_p4info_t *p4info, pi_p4_id_t table_id)
 MatchKey::MatchKey(const pi_match_key_t *pi_match_key)
     : p4info(pi_match_key->p4info), table_id(pi_match_key->table_id),
       mk_size(pi_match_key->data_size),
-      _data(sizeof(*match_key) + mk_size),
+      _data(sizeof(*match_key) + mk_size, nullptr),
       match_key(reinterpret_cast<decltype(match_key)>(_data.data())),
       reader(match_key) {
   *match_key = *pi_match_key;
@@ -436,6 +529,18 @@ MatchKey::MatchKey(const MatchKey &other)
   match_key->data = _data.data() + sizeof(*match_key);
 }
 
+MatchKey::MatchKey(MatchKey &&other) noexcept
+    : p4info(other.p4info),
+      table_id(other.table_id),
+      nset(other.nset),
+      mk_size(other.mk_size),
+      _data(std::move(other._data)),
+      match_key(reinterpret_cast<decltype(match_key)>(_data.data())),
+      reader(match_key) {
+  // needed if the data was stored inline
+  match_key->data = _data.data() + sizeof(*match_key);
+}
+
 MatchKey &
 MatchKey::operator=(const MatchKey &other) {
   MatchKey tmp(other);  // re-use copy-constructor
@@ -443,6 +548,20 @@ MatchKey::operator=(const MatchKey &other) {
   return *this;
 }
 
+MatchKey &
+MatchKey::operator=(MatchKey &&other) noexcept {
+  if (this == &other) return *this;
+  p4info = other.p4info;
+  table_id = other.table_id;
+  nset = other.nset;
+  mk_size = other.mk_size;
+  _data = std::move(other._data);
+  match_key = reinterpret_cast<decltype(match_key)>(_data.data());
+  match_key->data = _data.data() + sizeof(*match_key);
+  reader = MatchKeyReader(match_key);
+  return *this;
+}
+
 size_t
 MatchKeyHash::operator()(const MatchKey &mk) const {
   // compute Jenkins hash
@@ -486,13 +605,15 @@ ActionDataReader::get_action_id() const {
   return action_data->action_id;
 }
 
-ActionData::ActionData(const pi_p4info_t *p4info, pi_p4_id_t action_id)
+ActionData::ActionData(const pi_p4info_t *p4info, pi_p4_id_t action_id,
+                       Arena *arena)
     : p4info(p4info), action_id(action_id),
       ad_size(pi_p4info_action_data_size(p4info, action_id)),
-      _data(sizeof(*action_data) + ad_size),
+      _data(sizeof(*action_data) + ad_size, arena),
       action_data(reinterpret_cast<decltype(action_data)>(_data.data())),
       reader(action_data) {
-  // using standard new, no alignment issue with cast above
+  // SmallBuffer storage is aligned to std::max_align_t, no alignment issue
+  // with the cast above
   action_data->p4info = p4info;
   action_data->action_id = action_id;
   action_data->data_size = ad_size;
@@ -501,6 +622,32 @@ ActionData::ActionData(const pi_p4info_t *p4info, pi_p4_id_t action_id)
 
 ActionData::~ActionData() { }
 
+ActionData::ActionData(ActionData &&other) noexcept
+    : p4info(other.p4info),
+      action_id(other.action_id),
+      nset(other.nset),
+      ad_size(other.ad_size),
+      _data(std::move(other._data)),
+      action_data(reinterpret_cast<decltype(action_data)>(_data.data())),
+      reader(action_data) {
+  // needed if the data was stored inline
+  action_data->data = _data.data() + sizeof(*action_data);
+}
+
+ActionData &
+ActionData::operator=(ActionData &&other) noexcept {
+  if (this == &other) return *this;
+  p4info = other.p4info;
+  action_id = other.action_id;
+  nset = other.nset;
+  ad_size = other.ad_size;
+  _data = std::move(other._data);
+  action_data = reinterpret_cast<decltype(action_data)>(_data.data());
+  action_data->data = _data.data() + sizeof(*action_data);
+  reader = ActionDataReader(action_data);
+  return *this;
+}
+
 void
 ActionData::reset() {
   nset = 0;
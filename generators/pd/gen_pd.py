@@ -362,6 +362,46 @@ def bits_to_bytes(bw):
     return (bw + 7) / 8
 
 
+def get_byte0_mask(bw):
+    nbits = bw % 8
+    if nbits == 0:
+        return "0xff"
+    return hex((1 << nbits) - 1)
+
+
+# Layout of the match key data, which needs to be the same as the one computed
+# by the PI core for the table (see get_match_key_size_one_field). Returns a
+# list of tuples (field_name, match_type, byte_width, offset, byte0_mask) and the
+# total size of the match key data.
+def gen_match_key_layout(key):
+    layout = []
+    offset = 0
+    for field, _, match_type, bitwidth in key:
+        bytes_needed = bits_to_bytes(bitwidth)
+        layout += [(field, match_type, bytes_needed, offset,
+                    get_byte0_mask(bitwidth))]
+        if match_type == MatchType.LPM:
+            offset += bytes_needed + 4
+        elif match_type in {MatchType.TERNARY, MatchType.RANGE}:
+            offset += 2 * bytes_needed
+        else:
+            offset += bytes_needed
+    return layout, offset
+
+
+# Same as above for action data; returns a list of tuples (name, byte_width,
+# offset, byte0_mask) and the total size of the action data.
+def gen_action_data_layout(runtime_data):
+    layout = []
+    offset = 0
+    for name, pid, bitwidth in runtime_data:
+        bytes_needed = bits_to_bytes(bitwidth)
+        layout += [("action_" + name, bytes_needed, offset,
+                    get_byte0_mask(bitwidth))]
+        offset += bytes_needed
+    return layout, offset
+
+
 def get_c_name(name):
     # TODO: improve
     n = name.replace(".", "_")
@@ -408,6 +448,8 @@ def generate_pd_source(json_dict, dest_dir, p4_prefix, templates_dir, target):
     render_dict["gen_match_params"] = gen_match_params
     render_dict["gen_action_params"] = gen_action_params
     render_dict["bits_to_bytes"] = bits_to_bytes
+    render_dict["gen_match_key_layout"] = gen_match_key_layout
+    render_dict["gen_action_data_layout"] = gen_action_data_layout
     render_dict["get_c_type"] = get_c_type
     render_dict["get_c_name"] = get_c_name
     render_dict["get_thrift_type"] = get_thrift_type
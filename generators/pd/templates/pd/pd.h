@@ -25,6 +25,8 @@
 #include "pd_counters.h"
 #include "pd_meters.h"
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +39,13 @@ p4_pd_status_t ${pd_prefix}assign_device(int dev_id,
 
 p4_pd_status_t ${pd_prefix}remove_device(int dev_id);
 
+/* Start a batch of operations for the session, see pi_batch_begin */
+p4_pd_status_t ${pd_prefix}batch_begin(p4_pd_sess_hdl_t sess_hdl);
+
+/* End the ongoing batch for the session; if hw_sync is true, block until all
+   the operations have been committed to hardware */
+p4_pd_status_t ${pd_prefix}batch_end(p4_pd_sess_hdl_t sess_hdl, bool hw_sync);
+
 #ifdef __cplusplus
 }
 #endif
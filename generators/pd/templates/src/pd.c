@@ -61,3 +61,11 @@ p4_pd_status_t ${pd_prefix}remove_device(int dev_id) {
   assert(pi_remove_device(dev_id) == PI_STATUS_SUCCESS);
   return 0;
 }
+
+p4_pd_status_t ${pd_prefix}batch_begin(p4_pd_sess_hdl_t sess_hdl) {
+  return pi_batch_begin(sess_hdl);
+}
+
+p4_pd_status_t ${pd_prefix}batch_end(p4_pd_sess_hdl_t sess_hdl, bool hw_sync) {
+  return pi_batch_end(sess_hdl, hw_sync);
+}
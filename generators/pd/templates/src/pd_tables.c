@@ -22,98 +22,110 @@
 #include "pd_utils.h"
 
 #include <PI/pi.h>
-#include <PI/frontends/generic/pi.h>
-// TODO(antonin): removed this dependency (comes from action param ids)
+// match key and action data objects are built directly by the generated code
 #include <PI/int/pi_int.h>
 
+#include <arpa/inet.h>
+#include <string.h>
+
 #define PD_DEBUG 1
 
 // default is disabled
 // #define HOST_BYTE_ORDER_CALLER
 
+// The layout of the match key / action data for each table / action is known
+// at generation time, so the data is written directly into stack buffers of the
+// right size, with field offsets, byte widths and first byte masks as
+// constants, instead of going through pi_netv_t objects and P4Info lookups.
 
 __attribute__ ((unused))
-static void get_f_1B(const pi_p4info_t *p4info, pi_p4_id_t parent_id,
-                     pi_p4_id_t fid, uint8_t f, int nbytes, pi_netv_t *netv) {
+static void dump_f_1B(char *dst, uint8_t f, int nbytes, char byte0_mask) {
   (void) nbytes;
-  pi_status_t rc = pi_getnetv_u8(p4info, parent_id, fid, f, netv);
-  assert(rc == PI_STATUS_SUCCESS);
+  dst[0] = (char) f & byte0_mask;
 }
 
 __attribute__ ((unused))
-static void get_f_2B(const pi_p4info_t *p4info, pi_p4_id_t parent_id,
-                     pi_p4_id_t fid, uint16_t f, int nbytes, pi_netv_t *netv) {
+static void dump_f_2B(char *dst, uint16_t f, int nbytes, char byte0_mask) {
   (void) nbytes;
-  pi_status_t rc = pi_getnetv_u16(p4info, parent_id, fid, f, netv);
-  assert(rc == PI_STATUS_SUCCESS);
+  f = htons(f);
+  memcpy(dst, &f, 2);
+  dst[0] &= byte0_mask;
 }
 
 __attribute__ ((unused))
-static void get_f_3B(const pi_p4info_t *p4info, pi_p4_id_t parent_id,
-                     pi_p4_id_t fid, uint32_t f, int nbytes, pi_netv_t *netv) {
-  (void) nbytes;
-  pi_status_t rc = pi_getnetv_u32(p4info, parent_id, fid, f, netv);
-  assert(rc == PI_STATUS_SUCCESS);
+static void dump_f_3B(char *dst, uint32_t f, int nbytes, char byte0_mask) {
+  f = htonl(f);
+  memcpy(dst, (char *) &f + (4 - nbytes), nbytes);
+  dst[0] &= byte0_mask;
 }
 
 __attribute__ ((unused))
-static void get_f_4B(const pi_p4info_t *p4info, pi_p4_id_t parent_id,
-                     pi_p4_id_t fid, uint32_t f, int nbytes, pi_netv_t *netv) {
-  (void) nbytes;
-  pi_status_t rc = pi_getnetv_u32(p4info, parent_id, fid, f, netv);
-  assert(rc == PI_STATUS_SUCCESS);
+static void dump_f_4B(char *dst, uint32_t f, int nbytes, char byte0_mask) {
+  f = htonl(f);
+  memcpy(dst, (char *) &f + (4 - nbytes), nbytes);
+  dst[0] &= byte0_mask;
 }
 
 __attribute__ ((unused))
-static void get_f_XB(const pi_p4info_t *p4info, pi_p4_id_t parent_id,
-                     pi_p4_id_t fid, uint8_t *f, int nbytes, pi_netv_t *netv) {
-  char *f_ = (char *) f;
-  pi_status_t rc = pi_getnetv_ptr(p4info, parent_id, fid, f_, nbytes, netv);
-  assert(rc == PI_STATUS_SUCCESS);
+static void dump_f_XB(char *dst, const uint8_t *f, int nbytes,
+                      char byte0_mask) {
+  memcpy(dst, f, nbytes);
+  dst[0] &= byte0_mask;
+}
+
+__attribute__ ((unused))
+static void dump_prefix_length(char *dst, uint16_t prefix_length) {
+  uint32_t pLen = prefix_length;
+  memcpy(dst, &pLen, sizeof(pLen));
+}
+
+__attribute__ ((unused))
+static void init_match_key(pi_match_key_t *mk, const pi_p4info_t *p4info,
+                           pi_p4_id_t table_id, char *data, size_t data_size) {
+  mk->p4info = p4info;
+  mk->table_id = table_id;
+  mk->priority = 0;
+  mk->data_size = data_size;
+  mk->data = data;
+}
+
+__attribute__ ((unused))
+static void init_action_data(pi_action_data_t *adata,
+                             const pi_p4info_t *p4info, pi_p4_id_t action_id,
+                             char *data, size_t data_size) {
+  adata->p4info = p4info;
+  adata->action_id = action_id;
+  adata->data_size = data_size;
+  adata->data = data;
 }
 
 //:: for t_name, t in tables.items():
 //::   if not t.key: continue
 //::   t_name = get_c_name(t_name)
+//::   key_layout, key_size = gen_match_key_layout(t.key)
+// match key data for table ${t_name} is ${key_size} bytes
 static void build_key_${t_name} (
-    const pi_p4info_t *p4info, pi_match_key_t *mk, ${pd_prefix}${t_name}_match_spec_t *match_spec
+    char *data, ${pd_prefix}${t_name}_match_spec_t *match_spec
 ) {
-  pi_match_key_init(mk);
-
-  pi_status_t rc; (void) rc;
-  pi_netv_t netv_1, netv_2; (void) netv_1; (void) netv_2;
-
-//::   for field_name, fid, field_match_type, field_bw in t.key:
+//::   for field_name, field_match_type, nbytes, offset, mask in key_layout:
 //::     field_name = get_c_name(field_name)
-//::     nbytes = (field_bw + 7) / 8
 //::     fnB = nbytes if nbytes <= 4 else 'X'
 //::     if field_match_type == MatchType.EXACT:
-  get_f_${fnB}B(p4info, ${t.id_}, ${fid}, match_spec->${field_name}, ${nbytes}, &netv_1);
-  rc = pi_match_key_exact_set(mk, &netv_1);
-  assert(rc == PI_STATUS_SUCCESS);
+  dump_f_${fnB}B(data + ${offset}, match_spec->${field_name}, ${nbytes}, ${mask});
 //::     elif field_match_type == MatchType.LPM:
-  get_f_${fnB}B(p4info, ${t.id_}, ${fid}, match_spec->${field_name}, ${nbytes}, &netv_1);
-  rc = pi_match_key_lpm_set(mk, &netv_1, match_spec->${field_name}_prefix_length);
-  assert(rc == PI_STATUS_SUCCESS);
+  dump_f_${fnB}B(data + ${offset}, match_spec->${field_name}, ${nbytes}, ${mask});
+  dump_prefix_length(data + ${offset + nbytes}, match_spec->${field_name}_prefix_length);
 //::     elif field_match_type == MatchType.TERNARY:
-  get_f_${fnB}B(p4info, ${t.id_}, ${fid}, match_spec->${field_name}, ${nbytes}, &netv_1);
-  get_f_${fnB}B(p4info, ${t.id_}, ${fid}, match_spec->${field_name}_mask, ${nbytes}, &netv_1);
-  rc = pi_match_key_ternary_set(mk, &netv_1, &netv_2);
-  assert(rc == PI_STATUS_SUCCESS);
+  dump_f_${fnB}B(data + ${offset}, match_spec->${field_name}, ${nbytes}, ${mask});
+  dump_f_${fnB}B(data + ${offset + nbytes}, match_spec->${field_name}_mask, ${nbytes}, ${mask});
 //::     elif field_match_type == MatchType.VALID:
-  rc = pi_getnetv_u8(p4info, ${t.id_}, ${fid}, (uint8_t) (match_spec->${field_name} != 0), &netv_1);
-  assert(rc == PI_STATUS_SUCCESS);
-  rc = pi_match_key_exact_set(mk, &netv_1);
-  assert(rc == PI_STATUS_SUCCESS);
+  data[${offset}] = (char) (match_spec->${field_name} != 0);
 //::     elif field_match_type == MatchType.RANGE:
-  get_f_${fnB}B(p4info, ${t.id_}, ${fid}, match_spec->${field_name}_start, ${nbytes}, &netv_1);
-  get_f_${fnB}B(p4info, ${t.id_}, ${fid}, match_spec->${field_name}_end, ${nbytes}, &netv_1);
-  rc = pi_match_key_range_set(mk, &netv_1, &netv_2);
-  assert(rc == PI_STATUS_SUCCESS);
+  dump_f_${fnB}B(data + ${offset}, match_spec->${field_name}_start, ${nbytes}, ${mask});
+  dump_f_${fnB}B(data + ${offset + nbytes}, match_spec->${field_name}_end, ${nbytes}, ${mask});
 //::     else:
 //::       assert(0)
 //::     #endif
-
 //::   #endfor
 }
 
@@ -123,21 +135,15 @@ static void build_key_${t_name} (
 //:: for a_name, a in actions.items():
 //::   if not a.runtime_data: continue
 //::   a_name = get_c_name(a_name)
-//::   action_params = gen_action_params(a.runtime_data)
+//::   ad_layout, ad_size = gen_action_data_layout(a.runtime_data)
+// action data for action ${a_name} is ${ad_size} bytes
 static void build_action_data_${a_name} (
-    const pi_p4info_t *p4info, pi_action_data_t *adata, ${pd_prefix}${a_name}_action_spec_t *action_spec
+    char *data, ${pd_prefix}${a_name}_action_spec_t *action_spec
 ) {
-  pi_action_data_init(adata);
-  pi_netv_t netv;
-  pi_status_t rc;
-//::   idx = 0
-//::   for name, pid, width in action_params:
+//::   for name, nbytes, offset, mask in ad_layout:
 //::     name = get_c_name(name)
-//::     fnB = width if width <= 4 else 'X'
-  get_f_${fnB}B(p4info, ${a.id_}, ${pid}, action_spec->${name}, ${width}, &netv);
-  rc = pi_action_data_arg_set(adata, &netv);
-  assert(rc == PI_STATUS_SUCCESS);
-//::     idx += 1
+//::     fnB = nbytes if nbytes <= 4 else 'X'
+  dump_f_${fnB}B(data + ${offset}, action_spec->${name}, ${nbytes}, ${mask});
 //::   #endfor
 }
 
@@ -191,18 +197,24 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.device_id);
-  pi_match_key_t *mk;
-  pi_match_key_allocate(p4info, ${t.id_}, &mk);
+  pi_match_key_t mk;
 //::     if has_match_spec:
-  build_key_${t_name}(p4info, mk, match_spec);
+  char mk_data[${gen_match_key_layout(t.key)[1]}];
+  init_match_key(&mk, p4info, ${t.id_}, mk_data, sizeof(mk_data));
+  build_key_${t_name}(mk_data, match_spec);
+//::     else:
+  init_match_key(&mk, p4info, ${t.id_}, NULL, 0);
 //::     #endif
 //::     if match_type in {MatchType.TERNARY, MatchType.RANGE}:
-  pi_match_key_set_priority(mk, priority);
+  mk.priority = priority;
 //::     #endif
-  pi_action_data_t *adata;
-  pi_action_data_allocate(p4info, ${a.id_}, &adata);
+  pi_action_data_t adata;
 //::     if has_action_spec:
-  build_action_data_${a_name}(p4info, adata, action_spec);
+  char ad_data[${gen_action_data_layout(a.runtime_data)[1]}];
+  init_action_data(&adata, p4info, ${a.id_}, ad_data, sizeof(ad_data));
+  build_action_data_${a_name}(ad_data, action_spec);
+//::     else:
+  init_action_data(&adata, p4info, ${a.id_}, NULL, 0);
 //::     #endif
 
   pi_entry_properties_t entry_properties;
@@ -210,7 +222,7 @@ ${name}
 
   pi_table_entry_t t_entry;
   t_entry.entry_type = PI_ACTION_ENTRY_TYPE_DATA;
-  t_entry.entry.action_data = adata;
+  t_entry.entry.action_data = &adata;
   t_entry.entry_properties = &entry_properties;
 //::     if t.direct_meters:
   pi_direct_res_config_one_t meter_config;
@@ -233,10 +245,8 @@ ${name}
   pi_status_t rc;
   pi_entry_handle_t handle = 0;
   rc = pi_table_entry_add(sess_hdl, convert_dev_tgt(dev_tgt),
-                          ${t.id_}, mk, &t_entry, 0, &handle);
+                          ${t.id_}, &mk, &t_entry, 0, &handle);
   if (rc == PI_STATUS_SUCCESS) *entry_hdl = handle;
-  pi_match_key_destroy(mk);
-  pi_action_data_destroy(adata);
   return rc;
 }
 
@@ -267,13 +277,16 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.device_id);
-  pi_match_key_t *mk;
-  pi_match_key_allocate(p4info, ${t.id_}, &mk);
+  pi_match_key_t mk;
 //::     if has_match_spec:
-  build_key_${t_name}(p4info, mk, match_spec);
+  char mk_data[${gen_match_key_layout(t.key)[1]}];
+  init_match_key(&mk, p4info, ${t.id_}, mk_data, sizeof(mk_data));
+  build_key_${t_name}(mk_data, match_spec);
+//::     else:
+  init_match_key(&mk, p4info, ${t.id_}, NULL, 0);
 //::     #endif
 //::     if match_type in {MatchType.TERNARY, MatchType.RANGE}:
-  pi_match_key_set_priority(mk, priority);
+  mk.priority = priority;
 //::     #endif
 
   pi_entry_properties_t entry_properties;
@@ -288,9 +301,8 @@ ${name}
   pi_status_t rc;
   pi_entry_handle_t handle = 0;
   rc = pi_table_entry_add(sess_hdl, convert_dev_tgt(dev_tgt),
-                          ${t.id_}, mk, &t_entry, 0, &handle);
+                          ${t.id_}, &mk, &t_entry, 0, &handle);
   if (rc == PI_STATUS_SUCCESS) *entry_hdl = handle;
-  pi_match_key_destroy(mk);
   return rc;
 }
 
@@ -304,13 +316,16 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.device_id);
-  pi_match_key_t *mk;
-  pi_match_key_allocate(p4info, ${t.id_}, &mk);
+  pi_match_key_t mk;
 //::     if has_match_spec:
-  build_key_${t_name}(p4info, mk, match_spec);
+  char mk_data[${gen_match_key_layout(t.key)[1]}];
+  init_match_key(&mk, p4info, ${t.id_}, mk_data, sizeof(mk_data));
+  build_key_${t_name}(mk_data, match_spec);
+//::     else:
+  init_match_key(&mk, p4info, ${t.id_}, NULL, 0);
 //::     #endif
 //::     if match_type in {MatchType.TERNARY, MatchType.RANGE}:
-  pi_match_key_set_priority(mk, priority);
+  mk.priority = priority;
 //::     #endif
 
   pi_entry_properties_t entry_properties;
@@ -325,9 +340,8 @@ ${name}
   pi_status_t rc;
   pi_entry_handle_t handle = 0;
   rc = pi_table_entry_add(sess_hdl, convert_dev_tgt(dev_tgt),
-                          ${t.id_}, mk, &t_entry, 0, &handle);
+                          ${t.id_}, &mk, &t_entry, 0, &handle);
   if (rc == PI_STATUS_SUCCESS) *entry_hdl = handle;
-  pi_match_key_destroy(mk);
   return rc;
 }
 
@@ -377,15 +391,18 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_id);
-  pi_action_data_t *adata;
-  pi_action_data_allocate(p4info, ${a.id_}, &adata);
+  pi_action_data_t adata;
 //::     if has_action_spec:
-  build_action_data_${a_name}(p4info, adata, action_spec);
+  char ad_data[${gen_action_data_layout(a.runtime_data)[1]}];
+  init_action_data(&adata, p4info, ${a.id_}, ad_data, sizeof(ad_data));
+  build_action_data_${a_name}(ad_data, action_spec);
+//::     else:
+  init_action_data(&adata, p4info, ${a.id_}, NULL, 0);
 //::     #endif
 
   pi_table_entry_t t_entry;
   t_entry.entry_type = PI_ACTION_ENTRY_TYPE_DATA;
-  t_entry.entry.action_data = adata;
+  t_entry.entry.action_data = &adata;
   t_entry.entry_properties = NULL;
 //::     if t.direct_meters:
   pi_direct_res_config_one_t meter_config;
@@ -407,7 +424,6 @@ ${name}
 
   pi_status_t rc;
   rc = pi_table_entry_modify(sess_hdl, dev_id, ${t.id_}, entry_hdl, &t_entry);
-  pi_action_data_destroy(adata);
   return rc;
 }
 
@@ -439,15 +455,18 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.device_id);
-  pi_action_data_t *adata;
-  pi_action_data_allocate(p4info, ${a.id_}, &adata);
+  pi_action_data_t adata;
 //::     if has_action_spec:
-  build_action_data_${a_name}(p4info, adata, action_spec);
+  char ad_data[${gen_action_data_layout(a.runtime_data)[1]}];
+  init_action_data(&adata, p4info, ${a.id_}, ad_data, sizeof(ad_data));
+  build_action_data_${a_name}(ad_data, action_spec);
+//::     else:
+  init_action_data(&adata, p4info, ${a.id_}, NULL, 0);
 //::     #endif
 
   pi_table_entry_t t_entry;
   t_entry.entry_type = PI_ACTION_ENTRY_TYPE_DATA;
-  t_entry.entry.action_data = adata;
+  t_entry.entry.action_data = &adata;
   t_entry.entry_properties = NULL;
 //::     if t.direct_meters:
   pi_direct_res_config_one_t meter_config;
@@ -470,7 +489,6 @@ ${name}
   pi_status_t rc;
   rc = pi_table_default_action_set(sess_hdl, convert_dev_tgt(dev_tgt),
                                    ${t.id_}, &t_entry);
-  pi_action_data_destroy(adata);
   return rc;
 }
 
@@ -530,17 +548,19 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.device_id);
-  pi_action_data_t *adata;
-  pi_action_data_allocate(p4info, ${a.id_}, &adata);
+  pi_action_data_t adata;
 //::     if has_action_spec:
-  build_action_data_${a_name}(p4info, adata, action_spec);
+  char ad_data[${gen_action_data_layout(a.runtime_data)[1]}];
+  init_action_data(&adata, p4info, ${a.id_}, ad_data, sizeof(ad_data));
+  build_action_data_${a_name}(ad_data, action_spec);
+//::     else:
+  init_action_data(&adata, p4info, ${a.id_}, NULL, 0);
 //::     #endif
   pi_status_t rc;
   pi_indirect_handle_t handle;
   rc = pi_act_prof_mbr_create(sess_hdl, convert_dev_tgt(dev_tgt),
-                              ${act_prof.id_}, adata, &handle);
+                              ${act_prof.id_}, &adata, &handle);
   if (rc == PI_STATUS_SUCCESS) *mbr_hdl = handle;
-  pi_action_data_destroy(adata);
   return rc;
 }
 
@@ -558,15 +578,17 @@ ${name}
  ${param_str}
 ) {
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_id);
-  pi_action_data_t *adata;
-  pi_action_data_allocate(p4info, ${a.id_}, &adata);
+  pi_action_data_t adata;
 //::     if has_action_spec:
-  build_action_data_${a_name}(p4info, adata, action_spec);
+  char ad_data[${gen_action_data_layout(a.runtime_data)[1]}];
+  init_action_data(&adata, p4info, ${a.id_}, ad_data, sizeof(ad_data));
+  build_action_data_${a_name}(ad_data, action_spec);
+//::     else:
+  init_action_data(&adata, p4info, ${a.id_}, NULL, 0);
 //::     #endif
   pi_status_t rc;
   rc = pi_act_prof_mbr_modify(sess_hdl, dev_id,
-                              ${act_prof.id_}, mbr_hdl, adata);
-  pi_action_data_destroy(adata);
+                              ${act_prof.id_}, mbr_hdl, &adata);
   return rc;
 }
 
@@ -82,6 +82,19 @@ void packets_meter_spec_pd_to_thrift(
 //::   return specs
 //:: #enddef
 
+//:: def get_direct_parameter_spec_lists(t, api_prefix):
+//::   specs = []
+//::   if t.direct_meters:
+//::     m = t.direct_meters
+//::     if m.unit == m.MeterUnit.PACKETS:
+//::       specs += ["const std::vector<" + api_prefix + "packets_meter_spec_t> &" + m.name + "_specs"]
+//::     else:
+//::       specs += ["const std::vector<" + api_prefix + "bytes_meter_spec_t> &" + m.name + "_specs"]
+//::     #endif
+//::   #endif
+//::   return specs
+//:: #enddef
+
 class ${p4_prefix}Handler : virtual public ${p4_prefix}If {
 private:
   class CbWrap {
@@ -219,6 +232,124 @@ public:
 //:: #endfor
 
 
+    // Bulk table entry add functions
+
+//:: for t_name, t in tables.items():
+//::   t_type = t.type_
+//::   if t_type != TableType.SIMPLE: continue
+//::   if not t.key: continue
+//::   t_name = get_c_name(t_name)
+//::   match_type = t.match_type
+//::   for a_name, a in t.actions.items():
+//::     a_name = get_c_name(a_name)
+//::     has_action_spec = len(a.runtime_data) > 0
+//::     params = ["const SessionHandle_t sess_hdl",
+//::               "const DevTarget_t &dev_tgt",
+//::               "const std::vector<" + api_prefix + t_name + "_match_spec_t> &match_specs"]
+//::     lists = []
+//::     if match_type in {MatchType.TERNARY, MatchType.RANGE}:
+//::       params += ["const std::vector<int32_t> &priorities"]
+//::       lists += ["priorities"]
+//::     #endif
+//::     if has_action_spec:
+//::       params += ["const std::vector<" + api_prefix + a_name + "_action_spec_t> &action_specs"]
+//::       lists += ["action_specs"]
+//::     #endif
+//::     if t.support_timeout:
+//::       params += ["const std::vector<int32_t> &ttls"]
+//::       lists += ["ttls"]
+//::     #endif
+//::     params += get_direct_parameter_spec_lists(t, api_prefix)
+//::     if t.direct_meters:
+//::       lists += [t.direct_meters.name + "_specs"]
+//::     #endif
+//::     param_str = ", ".join(params)
+//::     name = t_name + "_table_add_with_" + a_name + "_bulk"
+//::     pd_name = pd_prefix + t_name + "_table_add_with_" + a_name
+    void ${name}(std::vector<${api_prefix}entry_add_status_t> &_return, ${param_str}) {
+        std::cerr << "In ${name}\n";
+
+        const size_t num_entries = match_specs.size();
+//::     for l in lists:
+        if (${l}.size() != num_entries) {
+          InvalidTableOperation ito;
+          ito.what = "${l} and match_specs have different sizes";
+          throw ito;
+        }
+//::     #endfor
+
+        p4_pd_dev_target_t pd_dev_tgt;
+        pd_dev_tgt.device_id = dev_tgt.dev_id;
+        pd_dev_tgt.dev_pipe_id = dev_tgt.dev_pipe_id;
+
+        _return.resize(num_entries);
+
+        // if the batch cannot be started, the entries are added one at a time
+        const bool batched = (${pd_prefix}batch_begin(sess_hdl) == 0);
+        for (size_t i = 0; i < num_entries; i++) {
+          const auto &match_spec = match_specs[i];
+          ${pd_prefix}${t_name}_match_spec_t pd_match_spec;
+//::     match_params = gen_match_params(t.key)
+//::     for name, width in match_params:
+//::       name = get_c_name(name)
+//::       if width <= 4:
+          pd_match_spec.${name} = match_spec.${name};
+//::       else:
+          memcpy(pd_match_spec.${name}, match_spec.${name}.c_str(), ${width});
+//::       #endif
+//::     #endfor
+
+//::     if has_action_spec:
+          const auto &action_spec = action_specs[i];
+          ${pd_prefix}${a_name}_action_spec_t pd_action_spec;
+//::       action_params = gen_action_params(a.runtime_data)
+//::       for name, _, width in action_params:
+//::         name = get_c_name(name)
+//::         if width <= 4:
+          pd_action_spec.${name} = action_spec.${name};
+//::         else:
+          memcpy(pd_action_spec.${name}, action_spec.${name}.c_str(), ${width});
+//::         #endif
+//::       #endfor
+
+//::     #endif
+//::     pd_params = ["sess_hdl", "pd_dev_tgt", "&pd_match_spec"]
+//::     if match_type in {MatchType.TERNARY, MatchType.RANGE}:
+//::       pd_params += ["priorities[i]"]
+//::     #endif
+//::     if has_action_spec:
+//::       pd_params += ["&pd_action_spec"]
+//::     #endif
+//::     if t.support_timeout:
+//::       pd_params += ["(uint32_t)ttls[i]"]
+//::     #endif
+//::     if t.direct_meters:
+//::       m = t.direct_meters
+//::       unit_name = MeterUnit.to_str(m.unit)
+          p4_pd_${unit_name}_meter_spec_t pd_${m.name}_spec;
+          ${unit_name}_meter_spec_thrift_to_pd(${m.name}_specs[i], &pd_${m.name}_spec);
+//::       pd_params += ["&pd_" + m.name + "_spec"]
+//::     #endif
+          p4_pd_entry_hdl_t pd_entry = 0;
+//::     pd_params += ["&pd_entry"]
+//::     pd_param_str = ", ".join(pd_params)
+          _return[i].status = ${pd_name}(${pd_param_str});
+          _return[i].entry_hdl = pd_entry;
+        }
+        if (!batched) return;
+        // the entries which were accepted are only committed now, if the
+        // commit fails they are reported with its status
+        const auto commit_status = ${pd_prefix}batch_end(sess_hdl, true);
+        if (commit_status == 0) return;
+        for (auto &entry_status : _return) {
+          if (entry_status.status == 0) entry_status.status = commit_status;
+        }
+    }
+
+//::   #endfor
+//:: #endfor
+
+
     // Table entry modify functions
 
 //:: for t_name, t in tables.items():
@@ -54,6 +54,17 @@ struct ${api_prefix}bytes_meter_spec_t {
   5: required bool color_aware;  // ignored for now
 }
 
+struct ${api_prefix}entry_add_status_t {
+  1: required EntryHandle_t entry_hdl;
+  2: required i32 status;
+}
+
+# thrown by table RPCs called with invalid arguments, e.g. by the bulk add RPCs
+# when the lists do not all have the same size
+exception InvalidTableOperation {
+  1: string what;
+}
+
 # Match structs
 
 //:: for t_name, t in tables.items():
@@ -113,6 +124,19 @@ struct ${api_prefix}${a_name}_action_spec_t {
 //::   return specs
 //:: #enddef
 
+//:: def get_direct_parameter_spec_lists(t, api_prefix):
+//::   specs = []
+//::   if t.direct_meters:
+//::     m = t.direct_meters
+//::     if m.unit == m.MeterUnit.PACKETS:
+//::       specs += ["list<" + api_prefix + "packets_meter_spec_t> " + m.name + "_specs"]
+//::     else:
+//::       specs += ["list<" + api_prefix + "bytes_meter_spec_t> " + m.name + "_specs"]
+//::     #endif
+//::   #endif
+//::   return specs
+//:: #enddef
+
 service ${p4_prefix} {
 
     # Table entry add functions
@@ -145,6 +169,39 @@ service ${p4_prefix} {
 //::     name = t_name + "_table_add_with_" + a_name
     EntryHandle_t ${name}(${param_str});
 //::   #endfor
+//:: #endfor
+
+    # Bulk table entry add functions, which add all the entries in one batch;
+    # all the lists must have the same size (InvalidTableOperation is thrown
+    # otherwise) and one status is returned for each entry
+//:: for t_name, t in tables.items():
+//::   t_type = t.type_
+//::   if t_type != TableType.SIMPLE: continue
+//::   if not t.key: continue
+//::   t_name = get_c_name(t_name)
+//::   match_type = t.match_type
+//::   for a_name, a in t.actions.items():
+//::     a_name = get_c_name(a_name)
+//::     has_action_spec = len(a.runtime_data) > 0
+//::     params = ["res.SessionHandle_t sess_hdl",
+//::               "res.DevTarget_t dev_tgt",
+//::               "list<" + api_prefix + t_name + "_match_spec_t> match_specs"]
+//::     if match_type in {MatchType.TERNARY, MatchType.RANGE}:
+//::       params += ["list<i32> priorities"]
+//::     #endif
+//::     if has_action_spec:
+//::       params += ["list<" + api_prefix + a_name + "_action_spec_t> action_specs"]
+//::     #endif
+//::     if t.support_timeout:
+//::       params += ["list<i32> ttls"]
+//::     #endif
+//::     params += get_direct_parameter_spec_lists(t, api_prefix)
+//::     param_list = [str(count + 1) + ":" + p for count, p in enumerate(params)]
+//::     param_str = ", ".join(param_list)
+//::     name = t_name + "_table_add_with_" + a_name + "_bulk"
+    list<${api_prefix}entry_add_status_t> ${name}(${param_str})
+        throws (1:InvalidTableOperation ouch);
+//::   #endfor
 //:: #endfor
 
     # Table entry modify functions
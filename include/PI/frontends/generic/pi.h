@@ -26,17 +26,25 @@
 #include "PI/pi_base.h"
 #include "PI/pi_tables.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef uint16_t pi_prefix_length_t;
 
 ////////// MATCH KEY //////////
 
-//! Allocate a match jey object for a given table
+//! Allocate a match jey object for a given table. Objects released with
+//! pi_match_key_destroy are cached per table and handed out again by this
+//! function, so that in steady state it does not perform any memory allocation.
 pi_status_t pi_match_key_allocate(const pi_p4info_t *p4info,
                                   const pi_p4_id_t table_id,
                                   pi_match_key_t **key);
 
 //! Reset state of a match key. This function does not perform any memory
-//! allocation.
+//! allocation. It can be used to reuse the same match key for several calls
+//! (e.g. several pi_table_entry_add calls for the same table) instead of
+//! allocating a new one each time.
 pi_status_t pi_match_key_init(pi_match_key_t *key);
 
 void pi_match_key_set_priority(pi_match_key_t *key, pi_priority_t priority);
@@ -63,18 +71,23 @@ pi_status_t pi_match_key_range_set(pi_match_key_t *key, const pi_netv_t *start,
 pi_status_t pi_match_key_range_get(const pi_match_key_t *key, pi_p4_id_t fid,
                                    pi_netv_t *start, pi_netv_t *end);
 
-//! Destroy match key allocated with pi_match_key_allocate
+//! Destroy match key allocated with pi_match_key_allocate. The memory may be
+//! kept by the P4Info object for a future allocation, which is why the match
+//! key must be destroyed before the P4Info object it was allocated with (see
+//! pi_destroy_config).
 pi_status_t pi_match_key_destroy(pi_match_key_t *key);
 
 ////////// ACTION DATA //////////
 
-//! Allocate an action data object
+//! Allocate an action data object. Like for match keys, released objects are
+//! cached per action and reused.
 pi_status_t pi_action_data_allocate(const pi_p4info_t *p4info,
                                     const pi_p4_id_t action_id,
                                     pi_action_data_t **adata);
 
 //! Reset state of an action data. This function does not perform any memory
-//! allocation.
+//! allocation. It can be used to reuse the same action data object for several
+//! calls.
 pi_status_t pi_action_data_init(pi_action_data_t *adata);
 
 pi_p4_id_t pi_action_data_action_id_get(const pi_action_data_t *adata);
@@ -84,7 +97,13 @@ pi_status_t pi_action_data_arg_set(pi_action_data_t *adata,
 pi_status_t pi_action_data_arg_get(const pi_action_data_t *adata,
                                    pi_p4_id_t pid, pi_netv_t *argv);
 
-//! Destroy action data allocated with pi_action_data_allocate
+//! Destroy action data allocated with pi_action_data_allocate. Like for match
+//! keys, the memory may be kept by the P4Info object for a future allocation
+//! and the action data must be destroyed before that P4Info object.
 pi_status_t pi_action_data_destroy(pi_action_data_t *action_data);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif  // PI_INC_PI_FRONTENDS_GENERIC_PI_H_
@@ -109,6 +109,15 @@ struct pi_table_fetch_res_s {
   size_t data_size_per_entry;
   size_t num_direct_resources;
   size_t max_size_of_direct_resources;
+
+  // only used when fetching entries in chunks (pi_table_entries_fetch_begin);
+  // the meaning of cursor and cursor_state is up to the target, which sets done
+  // when it produces the last chunk
+  pi_dev_id_t dev_id;
+  size_t chunk_size;
+  size_t cursor;
+  void *cursor_state;
+  bool done;
 };
 
 struct pi_act_prof_fetch_res_s {
@@ -129,6 +138,21 @@ struct pi_act_prof_fetch_res_s {
   struct pi_action_data_s *action_datas;
 };
 
+// Free list of match key (resp. action data) objects for one table (resp. one
+// action), used by the generic frontend to avoid a malloc / free pair for every
+// object. Free objects are chained through their first word. The list is
+// attached to the P4Info object, which frees the cached objects when it is
+// destroyed. Callers are responsible for synchronization.
+typedef struct {
+  void *head;
+  size_t count;
+} pi_p4info_obj_pool_t;
+
+pi_p4info_obj_pool_t *pi_p4info_table_match_key_pool(const pi_p4info_t *p4info,
+                                                     pi_p4_id_t table_id);
+pi_p4info_obj_pool_t *pi_p4info_action_data_pool(const pi_p4info_t *p4info,
+                                                 pi_p4_id_t action_id);
+
 typedef struct {
   pi_dev_id_t dev_id;
   int backend_id;
@@ -78,6 +78,13 @@ typedef enum {
   // packet in/out
   PI_RPC_PACKETOUT_SEND,
 
+  // the ids are part of the wire protocol between pi_rpc_server and its
+  // clients, so new RPCs are appended here, never inserted above
+  PI_RPC_PACKETOUT_SEND_BATCH,
+  PI_RPC_TABLE_GET_NUM_ENTRIES,
+  PI_RPC_TABLE_ENTRIES_CLEAR,
+  PI_RPC_ACT_PROF_CLEAR,
+
   // rpc management
   // retrieve state for sync-up when rpc client is started
   PI_RPC_INT_GET_STATE = 256,
@@ -49,7 +49,9 @@ pi_status_t pi_add_config_from_file(const char *config_path,
                                     pi_config_type_t config_type,
                                     pi_p4info_t **p4info);
 
-//! Release the memory for a given \p p4info object.
+//! Release the memory for a given \p p4info object. All the match keys and
+//! action data objects allocated with it (see PI/frontends/generic/pi.h) must
+//! have been destroyed first.
 pi_status_t pi_destroy_config(pi_p4info_t *p4info);
 
 //! Serialize p4info in native PI JSON format. If \p fmt is 0, non-formatted,
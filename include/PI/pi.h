@@ -117,6 +117,12 @@ pi_status_t pi_packetin_deregister_default_cb();
 //! Inject a packet in the specified device.
 pi_status_t pi_packetout_send(pi_dev_id_t dev_id, const char *pkt, size_t size);
 
+//! Inject \p num_pkts packets in the specified device, in order. Packet i is
+//! pointed to by \p pkts[i] and its size is \p sizes[i]. Returns an error if
+//! any of the packets could not be sent.
+pi_status_t pi_packetout_send_batch(pi_dev_id_t dev_id, const char *const *pkts,
+                                    const size_t *sizes, size_t num_pkts);
+
 // TODO(antonin): move this to pi_tables?
 // When adding a table entry, the configuration for direct resources associated
 // with the entry can be provided. The config is then passed as a generic void *
@@ -70,6 +70,11 @@ pi_status_t pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
                                        pi_indirect_handle_t grp_handle,
                                        pi_indirect_handle_t mbr_handle);
 
+//! Delete all the groups and members in an action profile with a single
+//! operation. They must not be referenced by any table entry.
+pi_status_t pi_act_prof_clear(pi_session_handle_t session_handle,
+                              pi_dev_id_t dev_id, pi_p4_id_t act_prof_id);
+
 typedef struct pi_act_prof_fetch_res_s pi_act_prof_fetch_res_t;
 
 //! Retrieve all entries in an action profile as one big blob
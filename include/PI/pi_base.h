@@ -94,6 +94,9 @@ typedef enum {
 
   PI_STATUS_NOT_IMPLEMENTED_BY_TARGET,
 
+  PI_STATUS_COUNTER_NOT_SWEPT,
+  PI_STATUS_INVALID_COUNTER_SWEEP_CONFIG,
+
   //! everything above 1000 is reserved for targets
   PI_STATUS_TARGET_ERROR = 1000
 } pi_status_t;
@@ -45,6 +45,10 @@ typedef struct {
 #define PI_COUNTER_FLAGS_NONE 0
 // do a sync with the hw when reading a counter
 #define PI_COUNTER_FLAGS_HW_SYNC (1 << 0)
+// read the 64-bit software shadow maintained by the counter sweeper (see
+// pi_counter_sweep_start) instead of the target; the target is read if the
+// counter is not being swept
+#define PI_COUNTER_FLAGS_SW_SHADOW (1 << 1)
 
 //! Reads an indirect counter at the given \p index.
 pi_status_t pi_counter_read(pi_session_handle_t session_handle,
@@ -80,6 +84,36 @@ pi_status_t pi_counter_hw_sync(pi_session_handle_t session_handle,
                                pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                                PICounterHwSyncCb cb, void *cb_cookie);
 
+typedef struct {
+  //! time between 2 sweeps of the counter array, in milliseconds; cannot be 0
+  uint32_t interval_ms;
+  //! width in bits of the target's counter values, which wrap around at
+  //! 2^hw_width; 0 means 64
+  uint32_t hw_width;
+} pi_counter_sweep_config_t;
+
+//! Starts sweeping the indirect counter \p counter_id in the background: every
+//! \p config->interval_ms, all the counter array entries are synced with
+//! hardware (with pi_counter_hw_sync) and read, and the increments since the
+//! previous sweep are accumulated into a 64-bit software shadow. The shadow can
+//! then be read with pi_counter_read and PI_COUNTER_FLAGS_SW_SHADOW, and the
+//! increments over the last interval with pi_counter_read_delta, without going
+//! to the target. If the counter is already being swept, the configuration is
+//! updated. Sweeps are stopped automatically when the device is removed or
+//! updated.
+pi_status_t pi_counter_sweep_start(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                   const pi_counter_sweep_config_t *config);
+
+//! Stops sweeping the counter; waits for the completion of an in-progress
+//! sweep.
+pi_status_t pi_counter_sweep_stop(pi_dev_id_t dev_id, pi_p4_id_t counter_id);
+
+//! Reads the increment over the last sweep interval for the counter entry at
+//! the given \p index. Returns PI_STATUS_COUNTER_NOT_SWEPT if the counter is
+//! not being swept.
+pi_status_t pi_counter_read_delta(pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                                  size_t index, pi_counter_data_t *delta);
+
 #ifdef __cplusplus
 }
 #endif
@@ -167,6 +167,19 @@ pi_status_t pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                        const pi_match_key_t *match_key,
                                        const pi_table_entry_t *table_entry);
 
+//! Returns true if the handles returned by pi_table_entry_add for this device
+//! keep designating the same entry until that entry is deleted. Only then can a
+//! client store handles and use pi_table_entry_modify / pi_table_entry_delete
+//! instead of the _wkey functions. Some targets (e.g. combo) identify entries by
+//! their position in the table, and their handles change when an entry is
+//! deleted.
+bool pi_table_entry_handles_stable(pi_dev_id_t dev_id);
+
+//! Delete all the entries in a table with a single operation. The default
+//! entry is not affected.
+pi_status_t pi_table_entries_clear(pi_session_handle_t session_handle,
+                                   pi_dev_id_t dev_id, pi_p4_id_t table_id);
+
 typedef struct pi_table_fetch_res_s pi_table_fetch_res_t;
 
 //! Retrieve all entries in table as one big blob.
@@ -187,6 +200,38 @@ size_t pi_table_entries_next(pi_table_fetch_res_t *res,
                              pi_table_ma_entry_t *entry,
                              pi_entry_handle_t *entry_handle);
 
+//! Start retrieving the entries of a table in chunks of at most \p chunk_size
+//! entries, so that memory usage does not grow with the size of the table. Call
+//! pi_table_entries_fetch_next_chunk to get each chunk, then iterate through it
+//! with pi_table_entries_num and pi_table_entries_next.
+pi_status_t pi_table_entries_fetch_begin(pi_session_handle_t session_handle,
+                                         pi_dev_id_t dev_id,
+                                         pi_p4_id_t table_id,
+                                         size_t chunk_size,
+                                         pi_table_fetch_res_t **res);
+
+//! Retrieve the next chunk of entries, releasing the previous one. Once all
+//! entries have been retrieved, the chunk is empty (pi_table_entries_num
+//! returns 0).
+pi_status_t pi_table_entries_fetch_next_chunk(
+    pi_session_handle_t session_handle, pi_table_fetch_res_t *res);
+
+//! Returns true if the last chunk retrieved is the final one for the table.
+bool pi_table_entries_fetch_is_last_chunk(const pi_table_fetch_res_t *res);
+
+//! Need to be called after pi_table_entries_fetch_begin, once you wish the
+//! memory to be released. It is fine to call it before all chunks have been
+//! retrieved.
+pi_status_t pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                       pi_table_fetch_res_t *res);
+
+//! Retrieve the number of entries currently in a table, as well as its
+//! capacity (from P4Info), without fetching the entries themselves. Either of
+//! \p num_entries and \p max_size can be NULL.
+pi_status_t pi_table_get_usage(pi_session_handle_t session_handle,
+                               pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                               size_t *num_entries, size_t *max_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -58,6 +58,11 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
                                         pi_indirect_handle_t grp_handle,
                                         pi_indirect_handle_t mbr_handle);
 
+// Targets which return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET have their groups
+// and members fetched and deleted one by one instead.
+pi_status_t _pi_act_prof_clear(pi_session_handle_t session_handle,
+                               pi_dev_id_t dev_id, pi_p4_id_t act_prof_id);
+
 pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
                                        pi_dev_id_t dev_id,
                                        pi_p4_id_t act_prof_id,
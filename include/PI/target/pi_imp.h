@@ -54,6 +54,12 @@ pi_status_t _pi_destroy();
 pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
                                size_t size);
 
+// Targets which return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET have the packets sent
+// one by one with _pi_packetout_send instead.
+pi_status_t _pi_packetout_send_batch(pi_dev_id_t dev_id,
+                                     const char *const *pkts,
+                                     const size_t *sizes, size_t num_pkts);
+
 pi_status_t pi_packetin_receive(pi_dev_id_t dev_id, const char *pkt,
                                 size_t size);
 
@@ -68,6 +68,16 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                         const pi_match_key_t *match_key,
                                         const pi_table_entry_t *table_entry);
 
+// Sets *stable to true if entry handles stay valid until the entry is deleted.
+// Targets which return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET are assumed not to
+// have stable handles.
+pi_status_t _pi_table_entry_handles_stable(pi_dev_id_t dev_id, bool *stable);
+
+// Targets which return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET have their entries
+// fetched and deleted one by one instead.
+pi_status_t _pi_table_entries_clear(pi_session_handle_t session_handle,
+                                    pi_dev_id_t dev_id, pi_p4_id_t table_id);
+
 pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res);
@@ -75,6 +85,27 @@ pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
 pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
                                          pi_table_fetch_res_t *res);
 
+// Same format as _pi_table_entries_fetch, but for at most res->chunk_size
+// entries starting at res->cursor; the target advances res->cursor and sets
+// res->done with the last chunk. Each chunk is released with
+// _pi_table_entries_fetch_done. Targets which return
+// PI_STATUS_NOT_IMPLEMENTED_BY_TARGET get a single _pi_table_entries_fetch
+// call instead.
+pi_status_t _pi_table_entries_fetch_chunk(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          pi_table_fetch_res_t *res);
+
+// Called once at the end of a chunked fetch, to release res->cursor_state.
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                        pi_table_fetch_res_t *res);
+
+// Targets which return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET have their entries
+// fetched and counted instead.
+pi_status_t _pi_table_get_num_entries(pi_session_handle_t session_handle,
+                                      pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                      size_t *num_entries);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,14 +19,31 @@
  */
 
 #include <PI/frontends/proto/device_mgr.h>
+#include <PI/frontends/proto/logging.h>
 
 #include <PI/proto/pi_server.h>
 
 #include <iostream>
+#include <memory>
 
 #include <csignal>
 
+using pi::fe::proto::AsyncLogWriter;
 using pi::fe::proto::DeviceMgr;
+using pi::fe::proto::LoggerConfig;
+using pi::fe::proto::LogWriterIface;
+
+namespace {
+
+class StdoutLogWriter : public LogWriterIface {
+ public:
+  void write(Severity severity, const char *msg) override {
+    (void) severity;
+    std::cout << msg << "\n";
+  }
+};
+
+}  // namespace
 
 int main(int argc, char** argv) {
   const char *server_address = "0.0.0.0:50051";
@@ -41,6 +58,12 @@ int main(int argc, char** argv) {
 
   DeviceMgr::init(256);
 
+  // logging to stdout is done by a background thread, and we do not log the
+  // contents of RPC requests (TRACE) by default
+  LoggerConfig::set_writer(
+      std::make_shared<AsyncLogWriter>(std::make_shared<StdoutLogWriter>()));
+  LoggerConfig::set_min_severity(LogWriterIface::Severity::DEBUG);
+
   auto handler = [](int s) {
     std::cout << "Server shutting down\n";
     PIGrpcServerForceShutdown(1);  // 1 second deadline
@@ -21,11 +21,15 @@
 #ifndef PI_FRONTENDS_PROTO_DEVICE_MGR_H_
 #define PI_FRONTENDS_PROTO_DEVICE_MGR_H_
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <google/protobuf/arena.h>
+
 #include "google/rpc/status.pb.h"
 #include "p4/config/v1/p4info.pb.h"
 #include "p4/v1/p4runtime.pb.h"
@@ -49,6 +53,25 @@ class DeviceMgr {
   using PacketInCb =
       std::function<void(device_id_t, p4::v1::PacketIn *packet, void *cookie)>;
 
+  struct CounterCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  struct WriteDedupStats {
+    // MODIFY updates answered without writing to the target
+    uint64_t modify_suppressed;
+    // INSERT updates of an existing identical entry, answered without writing
+    // to the target
+    uint64_t insert_suppressed;
+  };
+
+  struct TableUsage {
+    uint64_t num_entries;
+    // capacity of the table, as per the P4Info
+    uint64_t max_size;
+  };
+
   explicit DeviceMgr(device_id_t device_id);
 
   ~DeviceMgr();
@@ -64,15 +87,89 @@ class DeviceMgr {
   // New write and read methods, meant to replace all the methods below
   Status write(const p4::v1::WriteRequest &request);
 
+  // Optional group commit for write: WriteRequests received concurrently
+  // within window of each other (up to max_requests of them, 0 meaning no
+  // limit) are applied in a single target batch, with a single HW sync at the
+  // end, instead of one batch per request. The status of each request is still
+  // independent from the other ones. A window of 0 (the default) disables
+  // group commit.
+  void write_group_commit_configure(std::chrono::microseconds window,
+                                    size_t max_requests);
+
+  // MODIFY updates which do not change the action of an entry (and do not
+  // include direct resource configs) are answered OK without going to the
+  // target; the controller metadata is still updated. Disabled by default.
+  // Optionally, an INSERT of an entry which already exists with the same action
+  // and controller metadata can be accepted the same way instead of returning
+  // ALREADY_EXISTS, which is useful for controllers replaying their state after
+  // a restart. Disabled by default.
+  void write_dedup_configure(bool suppress_noop_modify,
+                             bool accept_identical_insert);
+
+  WriteDedupStats write_dedup_get_stats(p4_id_t table_id) const;
+
   Status read(const p4::v1::ReadRequest &request,
               p4::v1::ReadResponse *response) const;
   Status read_one(const p4::v1::Entity &entity,
                   p4::v1::ReadResponse *response) const;
 
+  // Deletes all the entries of a table (of all tables if table_id is 0) with a
+  // single target operation per table, instead of one DELETE update per entry.
+  // Default entries are not affected.
+  Status table_clear(p4_id_t table_id);
+
+  // Deletes all the groups and members of an action profile (of all action
+  // profiles if act_prof_id is 0). They must not be used by any table entry, so
+  // indirect tables need to be cleared first.
+  Status action_profile_clear(p4_id_t act_prof_id);
+
+  // Returns the number of entries in a table without reading them, which is
+  // much cheaper than a wildcard TableEntry read for monitoring purposes.
+  Status table_get_usage(p4_id_t table_id, TableUsage *usage) const;
+
   Status packet_out_send(const p4::v1::PacketOut &packet) const;
 
+  // Sends all the packets with a single call to the target; this is meant to
+  // amortize the per-packet cost when packets are received in bursts. Returns
+  // an error if any of the packets could not be sent.
+  Status packet_out_send_batch(
+      const std::vector<const p4::v1::PacketOut *> &packets) const;
+
   void packet_in_register_cb(PacketInCb cb, void *cookie);
 
+  // Opt-in cache for counter reads (wildcard CounterEntry reads and
+  // DirectCounterEntry reads): the last snapshot read from the target is
+  // returned if it is at most max_staleness old. Reads still hold the device
+  // lock exclusively, so they see a consistent view with respect to writes.
+  // Setting max_staleness to 0 (the default) disables the cache.
+  void counter_cache_set_max_staleness(std::chrono::milliseconds max_staleness);
+
+  CounterCacheStats counter_cache_get_stats() const;
+
+  // Opt-in software shadow of table entries: DeviceMgr keeps a copy of every
+  // entry it writes (match key, action, direct meter config) and serves
+  // TableEntry reads from it, only reading direct counters from the target. If
+  // verify_interval is not 0, a background thread calls table_shadow_verify
+  // periodically. Disabled by default; should be enabled before any entry is
+  // written, as entries written while the shadow is disabled are always read
+  // from the target.
+  void table_shadow_configure(bool enable,
+                              std::chrono::milliseconds verify_interval);
+
+  // Compares the shadow with the entries fetched from the target, for all
+  // tables. Tables for which they differ are read from the target until their
+  // entries are written again, and INTERNAL is returned. Tables are verified
+  // one at a time, each under the exclusive lock, so that other RPCs can run
+  // in-between.
+  Status table_shadow_verify();
+
+  // Options for the arenas on which very large messages are allocated, e.g. the
+  // ReadResponse for a wildcard read, which can hold millions of sub-messages,
+  // or the forwarding state saved on RECONCILE_AND_COMMIT: large blocks mean
+  // the whole message is built with a handful of allocations and freed in one
+  // go.
+  static google::protobuf::ArenaOptions large_message_arena_options();
+
   static void init(size_t max_devices);
 
   static void destroy();
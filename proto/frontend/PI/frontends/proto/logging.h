@@ -21,6 +21,8 @@
 #ifndef PI_FRONTENDS_PROTO_LOGGING_H_
 #define PI_FRONTENDS_PROTO_LOGGING_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 namespace pi {
@@ -55,6 +57,42 @@ class LoggerConfig {
   LoggerConfig();
 };
 
+// Wraps another writer; messages are pushed to a bounded lock-free ring buffer
+// and written by a background thread, so that the caller never blocks on the
+// underlying writer. Messages are dropped when the ring buffer is full.
+class AsyncLogWriter : public LogWriterIface {
+ public:
+  explicit AsyncLogWriter(std::shared_ptr<LogWriterIface> writer,
+                          size_t capacity = 4096);
+
+  // all pending messages are written before the destructor returns
+  ~AsyncLogWriter();
+
+  void write(Severity severity, const char *msg) override;
+
+  // number of messages dropped because the ring buffer was full
+  uint64_t dropped() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> pimp;
+};
+
+// For components built on top of the frontend (e.g. the P4Runtime server),
+// which share the frontend logger configuration.
+class SharedLogger {
+ public:
+  using Severity = LogWriterIface::Severity;
+
+  // use this to avoid building messages which would be discarded anyway
+  static bool is_enabled(Severity severity);
+
+  static void write(Severity severity, const char *msg);
+
+ private:
+  SharedLogger();
+};
+
 }  // namespace proto
 
 }  // namespace fe
@@ -226,6 +226,21 @@ ActionProfMgr::group_delete(const p4v1::ActionProfileGroup &group,
   RETURN_OK_STATUS();
 }
 
+Status
+ActionProfMgr::clear(const SessionTemp &session) {
+  Lock lock(mutex);
+  auto pi_status = pi_act_prof_clear(
+      session.get(), device_tgt.dev_id, act_prof_id);
+  if (pi_status != PI_STATUS_SUCCESS) {
+    RETURN_ERROR_STATUS(Code::UNKNOWN,
+                        "Error when clearing action profile on target");
+  }
+  member_bimap = ActionProfBiMap();
+  group_bimap = ActionProfBiMap();
+  group_members.clear();
+  RETURN_OK_STATUS();
+}
+
 bool
 ActionProfMgr::check_p4_action_id(pi_p4_id_t p4_id) const {
   using pi::proto::util::resource_type_from_id;
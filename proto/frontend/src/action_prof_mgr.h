@@ -142,6 +142,9 @@ class ActionProfMgr {
   Status group_delete(const p4::v1::ActionProfileGroup &group,
                       const SessionTemp &session);
 
+  // deletes all the groups and members with a single target operation
+  Status clear(const SessionTemp &session);
+
   // returns nullptr if no matching id
   const pi_indirect_handle_t *retrieve_member_handle(const Id &member_id);
   const pi_indirect_handle_t *retrieve_group_handle(const Id &group_id);
@@ -0,0 +1,112 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "counter_cache.h"
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+void
+CounterCache::set_max_staleness(Clock::duration max_staleness) {
+  std::unique_lock<std::mutex> lock(mutex);
+  this->max_staleness = max_staleness;
+  if (max_staleness == Clock::duration::zero()) {
+    entries.clear();
+    generation++;
+  }
+}
+
+bool
+CounterCache::enabled() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return max_staleness > Clock::duration::zero();
+}
+
+pi_status_t
+CounterCache::get(pi_p4_id_t counter_id, pi_entry_handle_t handle,
+                  const FetchFn &fetch_fn, SnapshotPtr *snapshot) {
+  std::unique_lock<std::mutex> lock(mutex);
+  const Key key(counter_id, handle);
+  auto now = Clock::now();
+  auto it = entries.find(key);
+  if (it != entries.end() && now - it->second.timestamp <= max_staleness) {
+    stats.hits++;
+    *snapshot = it->second.snapshot;
+    return PI_STATUS_SUCCESS;
+  }
+
+  stats.misses++;
+  auto fetch_generation = generation;
+  lock.unlock();
+  auto fetched = std::make_shared<Snapshot>();
+  auto status = fetch_fn(fetched.get());
+  if (status != PI_STATUS_SUCCESS) return status;
+  lock.lock();
+
+  // the timestamp is the time at which the fetch started, which is
+  // conservative
+  if (generation == fetch_generation &&
+      max_staleness > Clock::duration::zero()) {
+    auto &entry = entries[key];
+    entry.snapshot = fetched;
+    entry.timestamp = now;
+  }
+  *snapshot = std::move(fetched);
+  return PI_STATUS_SUCCESS;
+}
+
+void
+CounterCache::invalidate(pi_p4_id_t counter_id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  generation++;
+  auto first = entries.lower_bound(Key(counter_id, 0));
+  auto last = first;
+  while (last != entries.end() && last->first.first == counter_id) ++last;
+  entries.erase(first, last);
+}
+
+void
+CounterCache::invalidate(pi_p4_id_t counter_id, pi_entry_handle_t handle) {
+  std::unique_lock<std::mutex> lock(mutex);
+  generation++;
+  entries.erase(Key(counter_id, handle));
+}
+
+void
+CounterCache::clear() {
+  std::unique_lock<std::mutex> lock(mutex);
+  generation++;
+  entries.clear();
+}
+
+CounterCache::Stats
+CounterCache::get_stats() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return stats;
+}
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
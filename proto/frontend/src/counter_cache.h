@@ -0,0 +1,111 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef SRC_COUNTER_CACHE_H_
+#define SRC_COUNTER_CACHE_H_
+
+#include <PI/pi.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>  // for std::pair
+#include <vector>
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+// Stores the last snapshot read from the target for a counter, along with the
+// time at which it was taken, so that repeated reads of the same counter can be
+// served without going to the target as long as the snapshot is recent
+// enough. A key is a (counter id, entry handle) pair: the handle is 0 for
+// indirect counters, in which case the snapshot includes all the cells of the
+// counter, and the handle of the table entry for direct counters. Reads are
+// serialized by the DeviceMgr (exclusive device lock), so concurrent fetches of
+// the same key are not coalesced.
+// The cache is disabled (max staleness of 0) by default.
+class CounterCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Snapshot = std::vector<pi_counter_data_t>;
+  using SnapshotPtr = std::shared_ptr<const Snapshot>;
+  // Fills the snapshot by reading from the target.
+  using FetchFn = std::function<pi_status_t(Snapshot *)>;
+
+  struct Stats {
+    // served from a cached snapshot
+    uint64_t hits{0};
+    // required a fetch from the target
+    uint64_t misses{0};
+  };
+
+  void set_max_staleness(Clock::duration max_staleness);
+
+  bool enabled() const;
+
+  // Returns a snapshot no older than the max staleness; calls fetch_fn if there
+  // is no such snapshot.
+  pi_status_t get(pi_p4_id_t counter_id, pi_entry_handle_t handle,
+                  const FetchFn &fetch_fn, SnapshotPtr *snapshot);
+
+  // Drops the snapshots for all the keys with this counter id; needs to be
+  // called when the counter is written to or when table entries are removed
+  // (entry handles can be reused).
+  void invalidate(pi_p4_id_t counter_id);
+
+  // Drops the snapshots for one key.
+  void invalidate(pi_p4_id_t counter_id, pi_entry_handle_t handle);
+
+  void clear();
+
+  Stats get_stats() const;
+
+ private:
+  using Key = std::pair<pi_p4_id_t, pi_entry_handle_t>;
+
+  struct Entry {
+    SnapshotPtr snapshot{nullptr};
+    Clock::time_point timestamp{};
+  };
+
+  mutable std::mutex mutex{};
+  // incremented by every invalidation; the result of a fetch is not cached if
+  // there was an invalidation while the fetch was in progress
+  uint64_t generation{0};
+  // std::map rather than std::unordered_map so that all the keys for a given
+  // counter id can be found with a range lookup
+  std::map<Key, Entry> entries{};
+  Clock::duration max_staleness{Clock::duration::zero()};
+  Stats stats{};
+};
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
+
+#endif  // SRC_COUNTER_CACHE_H_
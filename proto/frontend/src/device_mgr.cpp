@@ -31,21 +31,31 @@
 #include <PI/pi.h>
 #include <PI/proto/util.h>
 
-#include <algorithm>  // for std::all_of
+#include <algorithm>  // for std::all_of, std::sort
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>  // for std::pair
 #include <vector>
 
+#include <google/protobuf/arena.h>
+
 #include "google/rpc/code.pb.h"
 
 #include "action_helpers.h"
 #include "action_prof_mgr.h"
 #include "common.h"
+#include "counter_cache.h"
 #include "packet_io_mgr.h"
 #include "pre_mc_mgr.h"
 #include "report_error.h"
+#include "table_entry_decoder.h"
 #include "table_info_store.h"
 
 #include "p4/tmp/p4config.pb.h"
@@ -76,6 +86,11 @@ using common::make_invalid_p4_id_status;
 
 namespace {
 
+// Table entries are read from the target in chunks of at most this many
+// entries, which bounds the memory used by the PI library when reading large
+// tables.
+constexpr size_t kTableReadChunkSize = 1024;
+
 #ifdef USE_ABSL
 
 // The absl versions delete the default move constructor and default move
@@ -199,16 +214,20 @@ class DeviceMgrImp {
         packet_io(device_id) { }
 
   ~DeviceMgrImp() {
+    stop_table_shadow_verifier();
     pi_remove_device(device_id);
   }
 
   void p4_change(const p4configv1::P4Info &p4info_proto_new,
                  pi_p4info_t *p4info_new) {
     table_info_store.reset();
+    write_dedup_stats.clear();
     for (auto t_id = pi_p4info_table_begin(p4info_new);
          t_id != pi_p4info_table_end(p4info_new);
          t_id = pi_p4info_table_next(p4info_new, t_id)) {
       table_info_store.add_table(t_id);
+      write_dedup_stats.emplace(
+          t_id, std::unique_ptr<WriteDedupCounters>(new WriteDedupCounters()));
     }
 
     action_profs.clear();
@@ -222,6 +241,10 @@ class DeviceMgrImp {
 
     pre_mc_mgr.reset(new PreMcMgr(device_id));
 
+    counter_cache.clear();
+
+    table_use_entry_handles = pi_table_entry_handles_stable(device_id);
+
     packet_io.p4_change(p4info_proto_new);
 
     // we do this last, so that the ActProfMgr instances never point to an
@@ -268,7 +291,9 @@ class DeviceMgrImp {
     auto remove_device = [this]() {
       pi_remove_device(device_id);
       table_info_store.reset();
+      write_dedup_stats.clear();
       action_profs.clear();
+      counter_cache.clear();
       p4info.reset(nullptr);
     };
 
@@ -325,12 +350,17 @@ class DeviceMgrImp {
 
     // for reconcile, as per the P4Runtime spec, we need to preserve the
     // forwarding state if possible, which is why we do a read to store all
-    // existing state.
-    p4v1::ReadResponse forwarding_state;
+    // existing state. The saved state and the WriteRequest used to replay it
+    // are allocated on the same arena, which lets us move the entities from
+    // one to the other cheaply and release everything at once.
+    google::protobuf::Arena arena(DeviceMgr::large_message_arena_options());
+    p4v1::ReadResponse *forwarding_state = nullptr;
     if (
       a == p4v1::SetForwardingPipelineConfigRequest_Action_RECONCILE_AND_COMMIT
     ) {
-      auto status = save_forwarding_state(&forwarding_state);
+      forwarding_state =
+          google::protobuf::Arena::CreateMessage<p4v1::ReadResponse>(&arena);
+      auto status = save_forwarding_state(forwarding_state);
       if (IS_ERROR(status)) {
         pi_destroy_config(p4info_tmp);
         return status;
@@ -359,15 +389,17 @@ class DeviceMgrImp {
     if (
       a == p4v1::SetForwardingPipelineConfigRequest_Action_RECONCILE_AND_COMMIT
     ) {
-      p4v1::WriteRequest write_request;
-      for (auto &entity : *forwarding_state.mutable_entities()) {
-        auto *update = write_request.add_updates();
+      auto *write_request =
+          google::protobuf::Arena::CreateMessage<p4v1::WriteRequest>(&arena);
+      auto *entities = forwarding_state->mutable_entities();
+      write_request->mutable_updates()->Reserve(entities->size());
+      for (auto &entity : *entities) {
+        auto *update = write_request->add_updates();
         update->set_type(p4v1::Update_Type_INSERT);
-        update->set_allocated_entity(&entity);
+        // both messages are owned by the same arena, so this is a pointer swap
+        update->mutable_entity()->Swap(&entity);
       }
-      auto status = write_(write_request);
-      for (auto &update : *write_request.mutable_updates())
-        update.release_entity();
+      auto status = write_(*write_request);
       if (IS_ERROR(status))
         RETURN_ERROR_STATUS(Code::UNKNOWN, "Error when reconciling config")
     }
@@ -396,10 +428,32 @@ class DeviceMgrImp {
   }
 
   Status write(const p4v1::WriteRequest &request) {
+    if (write_group_enabled()) return write_grouped(request);
     auto lock = shared_lock();
     return write_(request);
   }
 
+  void write_group_commit_configure(std::chrono::microseconds window,
+                                    size_t max_requests) {
+    std::lock_guard<std::mutex> lock(write_group_mutex);
+    write_group_window = window;
+    write_group_max_requests = max_requests;
+  }
+
+  void write_dedup_configure(bool suppress_noop_modify,
+                             bool accept_identical_insert) {
+    write_suppress_noop_modify = suppress_noop_modify;
+    write_accept_identical_insert = accept_identical_insert;
+  }
+
+  DeviceMgr::WriteDedupStats write_dedup_get_stats(p4_id_t table_id) const {
+    auto lock = shared_lock();
+    auto it = write_dedup_stats.find(table_id);
+    if (it == write_dedup_stats.end()) return {0, 0};
+    return {it->second->modify_suppressed.load(),
+            it->second->insert_suppressed.load()};
+  }
+
   Status read(const p4v1::ReadRequest &request,
               p4v1::ReadResponse *response) const {
     auto lock = unique_lock();
@@ -412,23 +466,156 @@ class DeviceMgrImp {
     return read_one_(entity, response);
   }
 
+  // The whole device is locked, which is simpler than locking all the tables
+  // and fine for an operation meant for teardown and resync.
+  Status table_clear(p4_id_t table_id) {
+    auto lock = unique_lock();
+    if (p4info == nullptr) return make_invalid_p4_id_status();
+    SessionTemp session(false  /* = batch */);
+    if (table_id == 0) {  // clear all tables
+      for (auto t_id = pi_p4info_table_begin(p4info.get());
+           t_id != pi_p4info_table_end(p4info.get());
+           t_id = pi_p4info_table_next(p4info.get(), t_id)) {
+        auto status = table_clear_one(t_id, session);
+        if (IS_ERROR(status)) return status;
+      }
+      RETURN_OK_STATUS();
+    }
+    if (!check_p4_id(table_id, P4Ids::TABLE))
+      return make_invalid_p4_id_status();
+    return table_clear_one(table_id, session);
+  }
+
+  Status action_profile_clear(p4_id_t act_prof_id) {
+    auto lock = unique_lock();
+    if (p4info == nullptr) return make_invalid_p4_id_status();
+    SessionTemp session(false  /* = batch */);
+    if (act_prof_id == 0) {  // clear all action profiles
+      for (auto &p : action_profs) {
+        auto status = p.second->clear(session);
+        if (IS_ERROR(status)) return status;
+      }
+      RETURN_OK_STATUS();
+    }
+    if (!check_p4_id(act_prof_id, P4Ids::ACTION_PROFILE))
+      return make_invalid_p4_id_status();
+    auto action_prof_mgr = get_action_prof_mgr(act_prof_id);
+    if (action_prof_mgr == nullptr) {
+      RETURN_ERROR_STATUS(Code::INVALID_ARGUMENT,
+                          "Not a valid action profile id: {}", act_prof_id);
+    }
+    return action_prof_mgr->clear(session);
+  }
+
+  Status table_get_usage(p4_id_t table_id,
+                         DeviceMgr::TableUsage *usage) const {
+    auto lock = unique_lock();
+    if (p4info == nullptr || !check_p4_id(table_id, P4Ids::TABLE))
+      return make_invalid_p4_id_status();
+    SessionTemp session(false  /* = batch */);
+    size_t num_entries, max_size;
+    auto pi_status = pi_table_get_usage(
+        session.get(), device_id, table_id, &num_entries, &max_size);
+    if (pi_status != PI_STATUS_SUCCESS) {
+      RETURN_ERROR_STATUS(Code::UNKNOWN,
+                          "Error when querying table usage from target");
+    }
+    usage->num_entries = num_entries;
+    usage->max_size = max_size;
+    RETURN_OK_STATUS();
+  }
+
+  void counter_cache_set_max_staleness(
+      std::chrono::milliseconds max_staleness) {
+    counter_cache.set_max_staleness(max_staleness);
+  }
+
+  DeviceMgr::CounterCacheStats counter_cache_get_stats() const {
+    auto stats = counter_cache.get_stats();
+    return {stats.hits, stats.misses};
+  }
+
+  void table_shadow_configure(bool enable,
+                              std::chrono::milliseconds verify_interval) {
+    stop_table_shadow_verifier();
+    table_shadow_enabled = enable;
+    if (!enable || verify_interval <= std::chrono::milliseconds::zero())
+      return;
+    table_shadow_verifier_stop = false;
+    table_shadow_verifier = std::thread(
+        &DeviceMgrImp::table_shadow_verifier_loop, this, verify_interval);
+  }
+
+  // Compares the shadow of each table with the entries fetched from the
+  // target. If they differ, the shadow is dropped for the table, and reads are
+  // served by the target until the entries are written again. The exclusive
+  // lock is acquired for one table at a time, so that writes and reads are not
+  // stalled while all the tables are fetched.
+  Status table_shadow_verify() {
+    std::vector<p4_id_t> table_ids;
+    {
+      auto lock = shared_lock();
+      if (!table_shadow_enabled || p4info == nullptr) RETURN_OK_STATUS();
+      for (auto t_id = pi_p4info_table_begin(p4info.get());
+           t_id != pi_p4info_table_end(p4info.get());
+           t_id = pi_p4info_table_next(p4info.get(), t_id)) {
+        table_ids.push_back(t_id);
+      }
+    }
+    SessionTemp session(false  /* = batch */);
+    bool in_sync = true;
+    for (auto t_id : table_ids) {
+      auto lock = unique_lock();
+      // the shadow may have been disabled, or the P4 program changed, since we
+      // listed the tables
+      if (!table_shadow_enabled || p4info == nullptr) break;
+      if (!check_p4_id(t_id, P4Ids::TABLE) || !use_table_shadow(t_id))
+        continue;
+      bool table_in_sync;
+      auto status = table_shadow_verify_one(t_id, session, &table_in_sync);
+      if (IS_ERROR(status)) return status;
+      if (!table_in_sync) {
+        Logger::get()->error(
+            "Shadow of table {} out-of-sync with target, dropping it", t_id);
+        table_info_store.clear_shadow(t_id);
+        in_sync = false;
+      }
+    }
+    if (!in_sync) {
+      RETURN_ERROR_STATUS(Code::INTERNAL,
+                          "Table shadow out-of-sync with target");
+    }
+    RETURN_OK_STATUS();
+  }
+
   Status table_write(p4v1::Update_Type update,
                      const p4v1::TableEntry &table_entry,
-                     const SessionTemp &session) {
+                     const SessionTemp &session,
+                     pi::Arena *arena) {
     if (!check_p4_id(table_entry.table_id(), P4Ids::TABLE))
       return make_invalid_p4_id_status();
 
+    // a deleted entry's handle can be reused for a new entry and a modified
+    // entry may come with new counter data; in both cases we need to make sure
+    // that the direct counter cache does not return stale data
+    if ((update == p4v1::Update_Type_DELETE ||
+         table_entry.has_counter_data()) && counter_cache.enabled()) {
+      auto c_id = pi_get_table_direct_resource_p4_id(
+          table_entry.table_id(), P4Ids::DIRECT_COUNTER);
+      if (c_id != PI_INVALID_ID) counter_cache.invalidate(c_id);
+    }
+
     Status status;
     switch (update) {
       case p4v1::Update_Type_UNSPECIFIED:
         status.set_code(Code::INVALID_ARGUMENT);
         break;
       case p4v1::Update_Type_INSERT:
-        return table_insert(table_entry, session);
+        return table_insert(table_entry, session, arena);
       case p4v1::Update_Type_MODIFY:
-        return table_modify(table_entry, session);
+        return table_modify(table_entry, session, arena);
       case p4v1::Update_Type_DELETE:
-        return table_delete(table_entry, session);
+        return table_delete(table_entry, session, arena);
       default:
         status.set_code(Code::INVALID_ARGUMENT);
         break;
@@ -489,19 +676,27 @@ class DeviceMgrImp {
     RETURN_OK_STATUS();
   }
 
-  Status entry_handle_from_table_entry(const p4v1::TableEntry &table_entry,
-                                       pi_entry_handle_t *handle) const {
+  Status entry_data_from_table_entry(const p4v1::TableEntry &table_entry,
+                                     TableInfoStore::Data **entry_data) const {
     pi::MatchKey match_key(p4info.get(), table_entry.table_id());
     {
       auto status = construct_match_key(table_entry, &match_key);
       if (IS_ERROR(status)) return status;
     }
-    auto entry_data = table_info_store.get_entry(
+    *entry_data = table_info_store.get_entry(
         table_entry.table_id(), match_key);
-    if (entry_data == nullptr) {
+    if (*entry_data == nullptr) {
       RETURN_ERROR_STATUS(Code::INVALID_ARGUMENT,
                           "Cannot map table entry to handle");
     }
+    RETURN_OK_STATUS();
+  }
+
+  Status entry_handle_from_table_entry(const p4v1::TableEntry &table_entry,
+                                       pi_entry_handle_t *handle) const {
+    TableInfoStore::Data *entry_data;
+    auto status = entry_data_from_table_entry(table_entry, &entry_data);
+    if (IS_ERROR(status)) return status;
     *handle = entry_data->handle;
     RETURN_OK_STATUS();
   }
@@ -518,11 +713,12 @@ class DeviceMgrImp {
       return make_invalid_p4_id_status();
     auto table_lock = table_info_store.lock_table(table_entry.table_id());
 
-    pi_entry_handle_t entry_handle = 0;
+    TableInfoStore::Data *entry_data;
     {
-      auto status = entry_handle_from_table_entry(table_entry, &entry_handle);
+      auto status = entry_data_from_table_entry(table_entry, &entry_data);
       if (IS_ERROR(status)) return status;
     }
+    auto entry_handle = entry_data->handle;
 
     p4_id_t table_direct_meter_id = pi_get_table_direct_resource_p4_id(
         table_entry.table_id(), P4Ids::DIRECT_METER);
@@ -550,6 +746,12 @@ class DeviceMgrImp {
             RETURN_ERROR_STATUS(Code::UNKNOWN,
                                 "Error when writing direct meter spec");
           }
+          if (table_shadow_enabled && entry_data->shadow != nullptr) {
+            entry_data->shadow->mutable_meter_config()->CopyFrom(
+                meter_entry.config());
+          } else {
+            entry_data->shadow.reset();
+          }
         }
         break;
       case p4v1::Update_Type_DELETE:  // TODO(antonin): return error instead?
@@ -564,6 +766,10 @@ class DeviceMgrImp {
             RETURN_ERROR_STATUS(Code::UNKNOWN,
                                 "Error when writing direct meter spec");
           }
+          if (table_shadow_enabled && entry_data->shadow != nullptr)
+            entry_data->shadow->clear_meter_config();
+          else
+            entry_data->shadow.reset();
         }
         break;
       default:
@@ -679,94 +885,8 @@ class DeviceMgrImp {
     return direct_meter_read_one(table_entry, session, response);
   }
 
-  Code parse_match_key(p4_id_t table_id, const pi_match_key_t *match_key,
-                       p4v1::TableEntry *entry) const {
-    auto num_match_fields = pi_p4info_table_num_match_fields(
-        p4info.get(), table_id);
-    MatchKeyReader mk_reader(match_key);
-    auto priority = mk_reader.get_priority();
-    if (priority > 0) entry->set_priority(priority);
-    for (size_t j = 0; j < num_match_fields; j++) {
-      auto finfo = pi_p4info_table_match_field_info(p4info.get(), table_id, j);
-      auto mf = entry->add_match();
-      mf->set_field_id(finfo->mf_id);
-      switch (finfo->match_type) {
-        // For backward-compatibility with the old workflow (P4_14 program ---
-        // p4c-bm compiler ---> bmv2 JSON --- converter ---> P4Info), we still
-        // support PI_P4INFO_MATCH_TYPE_VALID. The P4_14 valid match type will
-        // show up as exact in the P4Info, which is why we set the exact field
-        // in the P4Runtime message (to '\x01' for valid and '\x00' for
-        // invalid).
-        case PI_P4INFO_MATCH_TYPE_VALID:
-          {
-            auto exact = mf->mutable_exact();
-            bool value;
-            mk_reader.get_valid(finfo->mf_id, &value);
-            exact->set_value(
-                value ? std::string("\x01", 1) : std::string("\x00", 1));
-          }
-          break;
-        case PI_P4INFO_MATCH_TYPE_EXACT:
-          {
-            auto exact = mf->mutable_exact();
-            mk_reader.get_exact(finfo->mf_id, exact->mutable_value());
-          }
-          break;
-        case PI_P4INFO_MATCH_TYPE_LPM:
-          {
-            auto lpm = mf->mutable_lpm();
-            int pLen;
-            mk_reader.get_lpm(finfo->mf_id, lpm->mutable_value(), &pLen);
-            lpm->set_prefix_len(pLen);
-            // if prefix length is 0, omit match field
-            if (pLen == 0)
-              entry->mutable_match()->RemoveLast();
-          }
-          break;
-        case PI_P4INFO_MATCH_TYPE_TERNARY:
-          {
-            auto ternary = mf->mutable_ternary();
-            mk_reader.get_ternary(finfo->mf_id, ternary->mutable_value(),
-                                  ternary->mutable_mask());
-            // if mask is 0, omit match field
-            if (ternary_match_is_dont_care(*ternary))
-              entry->mutable_match()->RemoveLast();
-          }
-          break;
-        case PI_P4INFO_MATCH_TYPE_RANGE:
-          {
-            auto range = mf->mutable_range();
-            mk_reader.get_range(finfo->mf_id, range->mutable_low(),
-                                range->mutable_high());
-            // if range includes all values, omit match field
-            if (range_match_is_dont_care(*range))
-              entry->mutable_match()->RemoveLast();
-          }
-          break;
-        default:
-          return Code::UNKNOWN;
-      }
-    }
-    return Code::OK;
-  }
-
-  Code parse_action_data(const pi_action_data_t *pi_action_data,
-                         p4v1::Action *action) const {
-    ActionDataReader reader(pi_action_data);
-    auto action_id = reader.get_action_id();
-    action->set_action_id(action_id);
-    size_t num_params;
-    auto param_ids = pi_p4info_action_get_params(
-        p4info.get(), action_id, &num_params);
-    for (size_t j = 0; j < num_params; j++) {
-      auto param = action->add_params();
-      param->set_param_id(param_ids[j]);
-      reader.get_arg(param_ids[j], param->mutable_value());
-    }
-    return Code::OK;
-  }
-
   Code parse_action_entry(p4_id_t table_id, const pi_table_entry_t *pi_entry,
+                          TableEntryDecoder *decoder,
                           p4v1::TableEntry *entry) const {
     if (pi_entry->entry_type == PI_ACTION_ENTRY_TYPE_NONE) return Code::OK;
 
@@ -789,8 +909,9 @@ class DeviceMgrImp {
       return Code::OK;
     }
 
-    return parse_action_data(pi_entry->entry.action_data,
-                             table_action->mutable_action());
+    decoder->decode_action_data(pi_entry->entry.action_data,
+                                table_action->mutable_action());
+    return Code::OK;
   }
 
   Status table_read_one(p4_id_t table_id,
@@ -803,93 +924,206 @@ class DeviceMgrImp {
       if (IS_ERROR(status)) return status;
     }
 
-    pi_table_fetch_res_t *res;
     auto table_lock = table_info_store.lock_table(table_id);
-    auto pi_status = pi_table_entries_fetch(session.get(), device_id,
-                                            table_id, &res);
+    if (use_table_shadow(table_id)) {
+      bool served;
+      auto status = table_read_one_shadow(table_id, requested_entry,
+                                          expected_match_key, session,
+                                          response, &served);
+      if (IS_ERROR(status) || served) return status;
+    }
+    return table_read_one_target(
+        table_id, requested_entry, expected_match_key, session, response);
+  }
+
+  bool use_table_shadow(p4_id_t table_id) const {
+    // entries of const tables may have been added out-of-band, in which case
+    // they are not in the table_info_store
+    return table_shadow_enabled &&
+        !pi_p4info_table_is_const(p4info.get(), table_id);
+  }
+
+  // Serves a table read from the software shadow. *served is set to false, and
+  // nothing is added to the response, if the shadow is missing for at least
+  // one of the entries, in which case the caller needs to fetch the entries
+  // from the target instead. Only direct counters are read from the target, and
+  // only for single-entry reads: a wildcard read which requests counter data is
+  // left to the chunked target fetch, which returns the counters in bulk. The
+  // table needs to be locked by the caller.
+  Status table_read_one_shadow(p4_id_t table_id,
+                               const p4v1::TableEntry &requested_entry,
+                               const pi::MatchKey &expected_match_key,
+                               const SessionTemp &session,
+                               p4v1::ReadResponse *response,
+                               bool *served) const {
+    *served = false;
+    p4_id_t counter_id = PI_INVALID_ID;
+    if (requested_entry.has_counter_data()) {
+      counter_id = pi_get_table_direct_resource_p4_id(
+          table_id, P4Ids::DIRECT_COUNTER);
+    }
+    if (counter_id != PI_INVALID_ID && requested_entry.match_size() == 0)
+      RETURN_OK_STATUS();
+
+    std::vector<const TableInfoStore::Data *> entries;
+    if (requested_entry.match_size() > 0) {
+      auto entry_data = table_info_store.get_entry(
+          table_id, expected_match_key);
+      if (entry_data != nullptr) {
+        if (entry_data->shadow == nullptr) RETURN_OK_STATUS();
+        entries.push_back(entry_data);
+      }
+    } else {
+      bool complete = true;
+      table_info_store.for_each_entry(
+          table_id,
+          [&entries, &complete](const pi::MatchKey &,
+                                const TableInfoStore::Data &data) {
+            if (data.shadow == nullptr)
+              complete = false;
+            else if (!data.shadow->is_default_action())
+              entries.push_back(&data);
+          });
+      if (!complete) RETURN_OK_STATUS();
+    }
+
+    // the target returns the meter config for every entry, even if it was
+    // never set, in which case it is the default (empty) config
+    bool with_meter_config = requested_entry.has_meter_config() &&
+        (pi_get_table_direct_resource_p4_id(table_id, P4Ids::DIRECT_METER) !=
+         PI_INVALID_ID);
+    for (const auto *entry_data : entries) {
+      auto *table_entry = response->add_entities()->mutable_table_entry();
+      table_entry->CopyFrom(*entry_data->shadow);
+      if (with_meter_config)
+        table_entry->mutable_meter_config();
+      else
+        table_entry->clear_meter_config();
+      table_entry->set_controller_metadata(entry_data->controller_metadata);
+      if (counter_id != PI_INVALID_ID) {
+        pi_counter_data_t counter_data;
+        auto pi_status = pi_counter_read_direct(
+            session.get(), device_tgt, counter_id, entry_data->handle,
+            PI_COUNTER_FLAGS_NONE, &counter_data);
+        if (pi_status != PI_STATUS_SUCCESS) {
+          RETURN_ERROR_STATUS(Code::UNKNOWN,
+                              "Error when reading counter from target");
+        }
+        counter_data_pi_to_proto(counter_data,
+                                 table_entry->mutable_counter_data());
+      }
+    }
+    *served = true;
+    RETURN_OK_STATUS();
+  }
+
+  // The table needs to be locked by the caller.
+  Status table_read_one_target(p4_id_t table_id,
+                               const p4v1::TableEntry &requested_entry,
+                               const pi::MatchKey &expected_match_key,
+                               const SessionTemp &session,
+                               p4v1::ReadResponse *response) const {
+    pi_table_fetch_res_t *res;
+    auto pi_status = pi_table_entries_fetch_begin(
+        session.get(), device_id, table_id, kTableReadChunkSize, &res);
     if (pi_status != PI_STATUS_SUCCESS) {
       RETURN_ERROR_STATUS(Code::UNKNOWN,
                           "Error when fetching entries from target");
     }
-    auto num_entries = pi_table_entries_num(res);
     pi_table_ma_entry_t entry;
     pi_entry_handle_t entry_handle;
     Code code = Code::OK;
     pi::MatchKey mk(p4info.get(), table_id);
-    for (size_t i = 0; i < num_entries; i++) {
-      pi_table_entries_next(res, &entry, &entry_handle);
-
-      // Very Very naive solution to filter on a specific match key: we iterate
-      // over ALL entries and compare the match key for each one.
-      // We require equality for every field, even priority, so this is reqlly
-      // just meant to be used as a very inefficient way to retrieve a single
-      // table entry...
-
-      // TODO(antonin): what I really want to do here is a heterogeneous lookup
-      // / comparison; instead I make a copy of the match key in the right
-      // format and I use this for the lookup. If this is a performance issue,
-      // we can find a better solution.
-      mk.from(entry.match_key);
-      if (requested_entry.match_size() > 0 &&
-          !pi::MatchKeyEq()(mk, expected_match_key)) {
-        continue;
+    // all p4info lookups required to decode the entries are done once here
+    TableEntryDecoder decoder(p4info.get(), table_id);
+    while (code == Code::OK) {
+      pi_status = pi_table_entries_fetch_next_chunk(session.get(), res);
+      if (pi_status != PI_STATUS_SUCCESS) {
+        pi_table_entries_fetch_end(session.get(), res);
+        RETURN_ERROR_STATUS(Code::UNKNOWN,
+                            "Error when fetching entries from target");
       }
+      auto num_entries = pi_table_entries_num(res);
+      if (num_entries == 0) break;
+      for (size_t i = 0; i < num_entries; i++) {
+        pi_table_entries_next(res, &entry, &entry_handle);
+
+        // Very Very naive solution to filter on a specific match key: we
+        // iterate over ALL entries and compare the match key for each one.
+        // We require equality for every field, even priority, so this is
+        // reqlly just meant to be used as a very inefficient way to retrieve a
+        // single table entry...
+
+        // TODO(antonin): what I really want to do here is a heterogeneous
+        // lookup / comparison; instead I make a copy of the match key in the
+        // right format and I use this for the lookup. If this is a performance
+        // issue, we can find a better solution.
+        mk.from(entry.match_key);
+        if (requested_entry.match_size() > 0 &&
+            !pi::MatchKeyEq()(mk, expected_match_key)) {
+          continue;
+        }
 
-      auto *table_entry = response->add_entities()->mutable_table_entry();
-      table_entry->set_table_id(table_id);
-      code = parse_match_key(table_id, entry.match_key, table_entry);
-      if (code != Code::OK) break;
-      code = parse_action_entry(table_id, &entry.entry, table_entry);
-      if (code != Code::OK) break;
-
-      // direct resources
-      auto *direct_configs = entry.entry.direct_res_config;
-      if (direct_configs != nullptr) {
-        for (size_t j = 0; j < direct_configs->num_configs; j++) {
-          const auto &config = direct_configs->configs[j];
-          if (pi_is_direct_counter_id(config.res_id)) {
-            // TODO(antonin): according to a p4runtime.proto comment, we are
-            // supposed to include counter data if the table has a direct
-            // counter, irrespective of whether or not the counter_data field
-            // was set. However, it breaks some existing unit tests, so we use
-            // this if statement for the moment.
-            if (requested_entry.has_counter_data()) {
-              counter_data_pi_to_proto(
-                  *static_cast<pi_counter_data_t *>(config.config),
-                  table_entry->mutable_counter_data());
-            }
-          } else if (pi_is_direct_meter_id(config.res_id)) {
-            if (requested_entry.has_meter_config()) {
-              meter_spec_pi_to_proto(
-                  *static_cast<pi_meter_spec_t *>(config.config),
-                  table_entry->mutable_meter_config());
+        auto *table_entry = response->add_entities()->mutable_table_entry();
+        table_entry->set_table_id(table_id);
+        code = decoder.decode_match_key(entry.match_key, table_entry);
+        if (code != Code::OK) break;
+        code = parse_action_entry(table_id, &entry.entry, &decoder,
+                                  table_entry);
+        if (code != Code::OK) break;
+
+        // direct resources
+        auto *direct_configs = entry.entry.direct_res_config;
+        if (direct_configs != nullptr) {
+          for (size_t j = 0; j < direct_configs->num_configs; j++) {
+            const auto &config = direct_configs->configs[j];
+            if (pi_is_direct_counter_id(config.res_id)) {
+              // TODO(antonin): according to a p4runtime.proto comment, we are
+              // supposed to include counter data if the table has a direct
+              // counter, irrespective of whether or not the counter_data field
+              // was set. However, it breaks some existing unit tests, so we use
+              // this if statement for the moment.
+              if (requested_entry.has_counter_data()) {
+                counter_data_pi_to_proto(
+                    *static_cast<pi_counter_data_t *>(config.config),
+                    table_entry->mutable_counter_data());
+              }
+            } else if (pi_is_direct_meter_id(config.res_id)) {
+              if (requested_entry.has_meter_config()) {
+                meter_spec_pi_to_proto(
+                    *static_cast<pi_meter_spec_t *>(config.config),
+                    table_entry->mutable_meter_config());
+              }
+            } else {
+              pi_table_entries_fetch_end(session.get(), res);
+              RETURN_ERROR_STATUS(Code::INTERNAL,
+                                  "Unknown direct resource type");
             }
-          } else {
-            RETURN_ERROR_STATUS(Code::INTERNAL, "Unknown direct resource type");
           }
         }
-      }
 
-      // If table is const (immutable P4 table), it is possible that the entries
-      // were added out-of-band, i.e. without the P4Runtime service. In this
-      // case, the entries would not be found in the table_info_store, and
-      // anyway there would be no point in looking since there can be no
-      // controller metadata for these immutable entries.
-      bool table_is_const = pi_p4info_table_is_const(p4info.get(), table_id);
-      if (!table_is_const) {
-        auto entry_data = table_info_store.get_entry(table_id, mk);
-        // this would point to a serious bug in the implementation, and shoudn't
-        // occur given that we keep the local state in sync with lower level
-        // state thanks to our per-table lock.
-        if (entry_data == nullptr) {
-          Logger::get()->critical("Table state out-of-sync with target");
-          assert(0 && "Invalid state");
+        // If table is const (immutable P4 table), it is possible that the
+        // entries were added out-of-band, i.e. without the P4Runtime service.
+        // In this case, the entries would not be found in the
+        // table_info_store, and anyway there would be no point in looking since
+        // there can be no controller metadata for these immutable entries.
+        bool table_is_const = pi_p4info_table_is_const(p4info.get(), table_id);
+        if (!table_is_const) {
+          auto entry_data = table_info_store.get_entry(table_id, mk);
+          // this would point to a serious bug in the implementation, and
+          // shoudn't occur given that we keep the local state in sync with
+          // lower level state thanks to our per-table lock.
+          if (entry_data == nullptr) {
+            Logger::get()->critical("Table state out-of-sync with target");
+            assert(0 && "Invalid state");
+          }
+          table_entry->set_controller_metadata(
+              entry_data->controller_metadata);
         }
-        table_entry->set_controller_metadata(entry_data->controller_metadata);
       }
     }
 
-    pi_table_entries_fetch_done(session.get(), res);
+    pi_table_entries_fetch_end(session.get(), res);
 
     RETURN_STATUS(code);
   }
@@ -990,6 +1224,13 @@ class DeviceMgrImp {
     }
 
     Code code = Code::OK;
+    ActionDataDecoder action_decoder(p4info.get());
+    {
+      size_t num_actions;
+      auto action_ids = pi_p4info_act_prof_get_actions(
+          p4info.get(), action_profile_id, &num_actions);
+      action_decoder.prepare(action_ids, num_actions);
+    }
     auto num_members = pi_act_prof_mbrs_num(res);
     for (size_t i = 0; i < num_members; i++) {
       pi_action_data_t *action_data;
@@ -998,8 +1239,7 @@ class DeviceMgrImp {
       if (member == nullptr) break;
       member->set_action_profile_id(action_profile_id);
       pi_act_prof_mbrs_next(res, &action_data, &member_h);
-      code = parse_action_data(action_data, member->mutable_action());
-      if (code != Code::OK) break;
+      action_decoder.decode(action_data, member->mutable_action());
       auto member_id = action_prof_mgr->retrieve_member_id(member_h);
       if (member_id == nullptr) {
         Logger::get()->critical("Cannot map member handle to member id");
@@ -1112,6 +1352,11 @@ class DeviceMgrImp {
     return packet_io.packet_out_send(packet);
   }
 
+  Status packet_out_send_batch(
+      const std::vector<const p4v1::PacketOut *> &packets) const {
+    return packet_io.packet_out_send_batch(packets);
+  }
+
   void packet_in_register_cb(PacketInCb cb, void *cookie) {
     packet_io.packet_in_register_cb(std::move(cb), cookie);
   }
@@ -1131,6 +1376,7 @@ class DeviceMgrImp {
                           "A negative number is not a valid index value");
     }
     auto index = static_cast<size_t>(counter_entry.index().index());
+    counter_cache.invalidate(counter_entry.counter_id());
     switch (update) {
       case p4v1::Update_Type_UNSPECIFIED:
         RETURN_ERROR_STATUS(Code::INVALID_ARGUMENT);
@@ -1191,6 +1437,7 @@ class DeviceMgrImp {
       RETURN_ERROR_STATUS(Code::INVALID_ARGUMENT,
                           "Table has no direct counters");
     }
+    counter_cache.invalidate(table_direct_counter_id, entry_handle);
     switch (update) {
       case p4v1::Update_Type_UNSPECIFIED:
         RETURN_ERROR_STATUS(Code::INVALID_ARGUMENT);
@@ -1248,6 +1495,35 @@ class DeviceMgrImp {
     }
     // default index, read all
     auto counter_size = pi_p4info_counter_get_size(p4info.get(), counter_id);
+    if (counter_cache.enabled()) {
+      auto fetch_fn = [this, &session, counter_id, counter_size](
+          CounterCache::Snapshot *snapshot) {
+        auto pi_status = pi_counter_hw_sync(
+            session.get(), device_tgt, counter_id, NULL, NULL);
+        if (pi_status != PI_STATUS_SUCCESS) return pi_status;
+        snapshot->resize(counter_size);
+        for (size_t index = 0; index < counter_size; index++) {
+          pi_status = pi_counter_read(session.get(), device_tgt, counter_id,
+                                      index, PI_COUNTER_FLAGS_NONE,
+                                      &(*snapshot)[index]);
+          if (pi_status != PI_STATUS_SUCCESS) return pi_status;
+        }
+        return PI_STATUS_SUCCESS;
+      };
+      CounterCache::SnapshotPtr snapshot;
+      auto pi_status = counter_cache.get(counter_id, 0, fetch_fn, &snapshot);
+      if (pi_status != PI_STATUS_SUCCESS) {
+        RETURN_ERROR_STATUS(Code::UNKNOWN,
+                            "Error when reading counter from target");
+      }
+      for (size_t index = 0; index < counter_size; index++) {
+        auto entry = response->add_entities()->mutable_counter_entry();
+        entry->set_counter_id(counter_id);
+        entry->mutable_index()->set_index(index);
+        counter_data_pi_to_proto((*snapshot)[index], entry->mutable_data());
+      }
+      RETURN_OK_STATUS();
+    }
     {  // sync the entire counter array with HW
       auto pi_status = pi_counter_hw_sync(
           session.get(), device_tgt, counter_id, NULL, NULL);
@@ -1311,9 +1587,24 @@ class DeviceMgrImp {
                             "Table has no direct counters");
       }
       pi_counter_data_t counter_data;
-      auto pi_status = pi_counter_read_direct(
-          session.get(), device_tgt, table_direct_counter_id, entry_handle,
-          PI_COUNTER_FLAGS_HW_SYNC, &counter_data);
+      pi_status_t pi_status;
+      if (counter_cache.enabled()) {
+        auto fetch_fn = [this, &session, table_direct_counter_id, entry_handle](
+            CounterCache::Snapshot *snapshot) {
+          snapshot->resize(1);
+          return pi_counter_read_direct(
+              session.get(), device_tgt, table_direct_counter_id, entry_handle,
+              PI_COUNTER_FLAGS_HW_SYNC, &(*snapshot)[0]);
+        };
+        CounterCache::SnapshotPtr snapshot;
+        pi_status = counter_cache.get(
+            table_direct_counter_id, entry_handle, fetch_fn, &snapshot);
+        if (pi_status == PI_STATUS_SUCCESS) counter_data = (*snapshot)[0];
+      } else {
+        pi_status = pi_counter_read_direct(
+            session.get(), device_tgt, table_direct_counter_id, entry_handle,
+            PI_COUNTER_FLAGS_HW_SYNC, &counter_data);
+      }
       if (pi_status != PI_STATUS_SUCCESS) {
         RETURN_ERROR_STATUS(Code::UNKNOWN,
                             "Error when reading counter from target");
@@ -1455,6 +1746,12 @@ class DeviceMgrImp {
 
   // internal version of write, which does not acquire a shared lock
   Status write_(const p4v1::WriteRequest &request) {
+    SessionTemp session(true  /* = batch */);
+    return write_(request, session);
+  }
+
+  Status write_(const p4v1::WriteRequest &request,
+                const SessionTemp &session) {
     if (request.atomicity() != p4v1::WriteRequest::CONTINUE_ON_ERROR) {
       RETURN_ERROR_STATUS(
           Code::UNIMPLEMENTED,
@@ -1462,8 +1759,14 @@ class DeviceMgrImp {
     }
     Status status;
     status.set_code(Code::OK);
-    SessionTemp session(true  /* = batch */);
     P4ErrorReporter error_reporter;
+    // Backs the temporary match keys and action data which do not fit in the
+    // inline storage of pi::MatchKey / pi::ActionData. There is one arena per
+    // thread (write_ can be called concurrently), reset for every WriteRequest
+    // so that its memory is reused and the write path does not need to
+    // allocate in steady state.
+    static thread_local pi::Arena arena;
+    arena.reset();
     for (const auto &update : request.updates()) {
       const auto &entity = update.entity();
       switch (entity.entity_case()) {
@@ -1472,7 +1775,8 @@ class DeviceMgrImp {
           status.set_code(Code::UNIMPLEMENTED);
           break;
         case p4v1::Entity::kTableEntry:
-          status = table_write(update.type(), entity.table_entry(), session);
+          status = table_write(update.type(), entity.table_entry(), session,
+                               &arena);
           break;
         case p4v1::Entity::kActionProfileMember:
           status = action_profile_member_write(
@@ -1800,7 +2104,8 @@ class DeviceMgrImp {
   }
 
   Status construct_action_data(uint32_t table_id, const p4v1::Action &action,
-                               pi::ActionEntry *action_entry) const {
+                               pi::ActionEntry *action_entry,
+                               pi::Arena *arena) const {
     auto action_id = action.action_id();
     if (!check_p4_id(action_id, P4Ids::ACTION))
       return make_invalid_p4_id_status();
@@ -1808,7 +2113,7 @@ class DeviceMgrImp {
       RETURN_ERROR_STATUS(Code::INVALID_ARGUMENT, "Invalid action for table");
     auto status = validate_action_data(p4info.get(), action);
     if (IS_ERROR(status)) return status;
-    action_entry->init_action_data(p4info.get(), action.action_id());
+    action_entry->init_action_data(p4info.get(), action.action_id(), arena);
     auto action_data = action_entry->mutable_action_data();
     for (const auto &p : action.params()) {
       action_data->set_arg(p.param_id(), p.value().data(), p.value().size());
@@ -1853,11 +2158,12 @@ class DeviceMgrImp {
   // the table_id is needed for indirect entries
   Status construct_action_entry(uint32_t table_id,
                                 const p4v1::TableAction &table_action,
-                                pi::ActionEntry *action_entry) {
+                                pi::ActionEntry *action_entry,
+                                pi::Arena *arena) {
     switch (table_action.type_case()) {
       case p4v1::TableAction::kAction:
         return construct_action_data(table_id, table_action.action(),
-                                     action_entry);
+                                     action_entry, arena);
       case p4v1::TableAction::kActionProfileMemberId:
       case p4v1::TableAction::kActionProfileGroupId:
         return construct_action_entry_indirect(table_id, table_action,
@@ -1901,10 +2207,119 @@ class DeviceMgrImp {
     RETURN_OK_STATUS();
   }
 
+  // Canonical encoding of the action: the action id and the parameter values in
+  // P4Info order (so that the order of the params in the request does not
+  // matter), or the member / group id for indirect tables. The action is
+  // assumed to have been validated already, so all the values have the expected
+  // width.
+  std::string action_bytes(const p4v1::TableAction &table_action) const {
+    std::string bytes;
+    auto append = [&bytes](const void *data, size_t size) {
+      bytes.append(static_cast<const char *>(data), size);
+    };
+    auto type = static_cast<uint32_t>(table_action.type_case());
+    append(&type, sizeof(type));
+    switch (table_action.type_case()) {
+      case p4v1::TableAction::kAction:
+        {
+          const auto &action = table_action.action();
+          auto action_id = action.action_id();
+          append(&action_id, sizeof(action_id));
+          size_t num_params;
+          auto param_ids = pi_p4info_action_get_params(
+              p4info.get(), action_id, &num_params);
+          for (size_t i = 0; i < num_params; i++) {
+            for (const auto &p : action.params()) {
+              if (p.param_id() != param_ids[i]) continue;
+              bytes.append(p.value());
+              break;
+            }
+          }
+        }
+        break;
+      case p4v1::TableAction::kActionProfileMemberId:
+        {
+          auto member_id = table_action.action_profile_member_id();
+          append(&member_id, sizeof(member_id));
+        }
+        break;
+      case p4v1::TableAction::kActionProfileGroupId:
+        {
+          auto group_id = table_action.action_profile_group_id();
+          append(&group_id, sizeof(group_id));
+        }
+        break;
+      default:
+        break;
+    }
+    return bytes;
+  }
+
+  static bool same_action(const TableInfoStore::Data &entry_data,
+                          const std::string &bytes) {
+    return entry_data.action_bytes == bytes;
+  }
+
+  // writing direct resource configs has side effects in the target, even when
+  // the action is unchanged
+  static bool has_direct_resources(const p4v1::TableEntry &table_entry) {
+    return table_entry.has_meter_config() || table_entry.has_counter_data();
+  }
+
+  // Builds the software copy of a table entry, in the same canonical form as
+  // the entries decoded from the target (match fields and action parameters in
+  // P4Info order, no counter data), so that reads return the same thing
+  // whether they are served from the shadow or not.
+  std::shared_ptr<p4v1::TableEntry> make_shadow_entry(
+      const p4v1::TableEntry &table_entry) const {
+    const auto table_id = table_entry.table_id();
+    std::shared_ptr<p4v1::TableEntry> shadow(new p4v1::TableEntry());
+    shadow->set_table_id(table_id);
+    shadow->set_priority(table_entry.priority());
+    shadow->set_is_default_action(table_entry.is_default_action());
+    size_t num_match_fields;
+    auto mf_ids = pi_p4info_table_get_match_fields(
+        p4info.get(), table_id, &num_match_fields);
+    for (size_t i = 0; i < num_match_fields; i++) {
+      auto mf = find_mf(table_entry, mf_ids[i]);
+      if (mf == nullptr) continue;
+      auto shadow_mf = shadow->add_match();
+      shadow_mf->CopyFrom(*mf);
+      auto mf_info = pi_p4info_table_match_field_info(
+          p4info.get(), table_id, i);
+      if (mf_info->match_type == PI_P4INFO_MATCH_TYPE_VALID) {
+        bool valid = mf->exact().value() != std::string("\x00", 1);
+        shadow_mf->mutable_exact()->set_value(valid ? "\x01" : "\x00", 1);
+      }
+    }
+    const auto &table_action = table_entry.action();
+    if (table_action.has_action()) {
+      const auto &action = table_action.action();
+      auto shadow_action = shadow->mutable_action()->mutable_action();
+      shadow_action->set_action_id(action.action_id());
+      size_t num_params;
+      auto param_ids = pi_p4info_action_get_params(
+          p4info.get(), action.action_id(), &num_params);
+      for (size_t i = 0; i < num_params; i++) {
+        for (const auto &p : action.params()) {
+          if (p.param_id() != param_ids[i]) continue;
+          shadow_action->add_params()->CopyFrom(p);
+          break;
+        }
+      }
+    } else {
+      shadow->mutable_action()->CopyFrom(table_action);
+    }
+    if (table_entry.has_meter_config())
+      shadow->mutable_meter_config()->CopyFrom(table_entry.meter_config());
+    return shadow;
+  }
+
   Status table_insert(const p4v1::TableEntry &table_entry,
-                      const SessionTemp &session) {
+                      const SessionTemp &session,
+                      pi::Arena *arena) {
     const auto table_id = table_entry.table_id();
-    pi::MatchKey match_key(p4info.get(), table_id);
+    pi::MatchKey match_key(p4info.get(), table_id, arena);
     {
       auto status = construct_match_key(table_entry, &match_key);
       if (IS_ERROR(status)) return status;
@@ -1915,7 +2330,7 @@ class DeviceMgrImp {
     pi_counter_data_t _counter_data_storage;
     {
       auto status = construct_action_entry(
-          table_id, table_entry.action(), &action_entry);
+          table_id, table_entry.action(), &action_entry, arena);
       if (IS_ERROR(status)) return status;
     }
     {
@@ -1925,12 +2340,22 @@ class DeviceMgrImp {
       if (IS_ERROR(status)) return status;
     }
 
+    auto action = action_bytes(table_entry.action());
+
     auto table_lock = table_info_store.lock_table(table_id);
 
     // TODO(antonin): should the default entry be treated like other match
     // entries and trigger an error when added twice?
-    if (table_info_store.get_entry(table_id, match_key) != nullptr &&
-        !table_entry.is_default_action()) {
+    auto existing_entry = table_info_store.get_entry(table_id, match_key);
+    if (existing_entry != nullptr && !table_entry.is_default_action()) {
+      if (write_accept_identical_insert &&
+          !has_direct_resources(table_entry) &&
+          same_action(*existing_entry, action) &&
+          existing_entry->controller_metadata ==
+          table_entry.controller_metadata()) {
+        write_dedup_stats.at(table_id)->insert_suppressed++;
+        RETURN_OK_STATUS();
+      }
       RETURN_ERROR_STATUS(
           Code::ALREADY_EXISTS,
           "Match entry exists, use MODIFY if you wish to change action");
@@ -1938,30 +2363,33 @@ class DeviceMgrImp {
 
     pi::MatchTable mt(session.get(), device_tgt, p4info.get(), table_id);
     pi_status_t pi_status;
-    pi_entry_handle_t handle;
+    pi_entry_handle_t handle = 0;
     if (table_entry.is_default_action()) {
       pi_status = mt.default_entry_set(action_entry);
     } else {
+      // the handle is kept in the TableInfoStore and used for subsequent
+      // MODIFY and DELETE operations on the entry
       pi_status = mt.entry_add(match_key, action_entry, false, &handle);
-      // handle is not used as this frontend do all operations using match key
-      (void) handle;
     }
     if (pi_status != PI_STATUS_SUCCESS) {
       RETURN_ERROR_STATUS(Code::UNKNOWN,
                           "Error when adding match entry to target");
     }
 
-    table_info_store.add_entry(
-        table_id, match_key,
-        TableInfoStore::Data(handle, table_entry.controller_metadata()));
+    TableInfoStore::Data entry_data(handle, table_entry.controller_metadata());
+    entry_data.action_bytes = std::move(action);
+    if (table_shadow_enabled)
+      entry_data.shadow = make_shadow_entry(table_entry);
+    table_info_store.add_entry(table_id, match_key, entry_data);
 
     RETURN_OK_STATUS();
   }
 
   Status table_modify(const p4v1::TableEntry &table_entry,
-                      const SessionTemp &session) {
+                      const SessionTemp &session,
+                      pi::Arena *arena) {
     const auto table_id = table_entry.table_id();
-    pi::MatchKey match_key(p4info.get(), table_id);
+    pi::MatchKey match_key(p4info.get(), table_id, arena);
     {
       auto status = construct_match_key(table_entry, &match_key);
       if (IS_ERROR(status)) return status;
@@ -1972,7 +2400,7 @@ class DeviceMgrImp {
     pi_counter_data_t _counter_data_storage;
     {
       auto status = construct_action_entry(
-          table_id, table_entry.action(), &action_entry);
+          table_id, table_entry.action(), &action_entry, arena);
       if (IS_ERROR(status)) return status;
     }
     {
@@ -1990,12 +2418,24 @@ class DeviceMgrImp {
     if (entry_data == nullptr)
       RETURN_ERROR_STATUS(Code::NOT_FOUND, "Cannot find match entry");
 
+    // the default entry is excluded because its data is not updated when it is
+    // inserted again
+    auto action = action_bytes(table_entry.action());
+    if (write_suppress_noop_modify && !table_entry.is_default_action() &&
+        !has_direct_resources(table_entry) &&
+        same_action(*entry_data, action)) {
+      entry_data->controller_metadata = table_entry.controller_metadata();
+      write_dedup_stats.at(table_id)->modify_suppressed++;
+      RETURN_OK_STATUS();
+    }
+
     pi::MatchTable mt(session.get(), device_tgt, p4info.get(), table_id);
     pi_status_t pi_status;
     if (table_entry.is_default_action()) {
       pi_status = mt.default_entry_set(action_entry);
     } else {
-      pi_status = mt.entry_modify_wkey(match_key, action_entry);
+      pi_status = table_entry_modify_target(
+          &mt, *entry_data, match_key, action_entry);
     }
     if (pi_status != PI_STATUS_SUCCESS) {
       RETURN_ERROR_STATUS(Code::UNKNOWN,
@@ -2003,14 +2443,50 @@ class DeviceMgrImp {
     }
 
     entry_data->controller_metadata = table_entry.controller_metadata();
+    entry_data->action_bytes = std::move(action);
+    if (table_shadow_enabled) {
+      auto shadow = make_shadow_entry(table_entry);
+      // the direct meter config is left unchanged by the target if it is not
+      // provided
+      if (!table_entry.has_meter_config() &&
+          pi_get_table_direct_resource_p4_id(
+              table_id, P4Ids::DIRECT_METER) != PI_INVALID_ID) {
+        if (entry_data->shadow == nullptr) {
+          shadow = nullptr;
+        } else if (entry_data->shadow->has_meter_config()) {
+          shadow->mutable_meter_config()->CopyFrom(
+              entry_data->shadow->meter_config());
+        }
+      }
+      entry_data->shadow = std::move(shadow);
+    } else {
+      entry_data->shadow.reset();
+    }
+
+    RETURN_OK_STATUS();
+  }
 
+  Status table_clear_one(p4_id_t table_id, const SessionTemp &session) {
+    auto pi_status = pi_table_entries_clear(session.get(), device_id, table_id);
+    if (pi_status != PI_STATUS_SUCCESS) {
+      RETURN_ERROR_STATUS(Code::UNKNOWN,
+                          "Error when clearing table entries in target");
+    }
+    table_info_store.clear_table(table_id);
+    // handles of the deleted entries can be reused for new entries
+    if (counter_cache.enabled()) {
+      auto c_id = pi_get_table_direct_resource_p4_id(
+          table_id, P4Ids::DIRECT_COUNTER);
+      if (c_id != PI_INVALID_ID) counter_cache.invalidate(c_id);
+    }
     RETURN_OK_STATUS();
   }
 
   Status table_delete(const p4v1::TableEntry &table_entry,
-                      const SessionTemp &session) {
+                      const SessionTemp &session,
+                      pi::Arena *arena) {
     const auto table_id = table_entry.table_id();
-    pi::MatchKey match_key(p4info.get(), table_id);
+    pi::MatchKey match_key(p4info.get(), table_id, arena);
     {
       auto status = construct_match_key(table_entry, &match_key);
       if (IS_ERROR(status)) return status;
@@ -2018,7 +2494,8 @@ class DeviceMgrImp {
 
     auto table_lock = table_info_store.lock_table(table_id);
 
-    if (table_info_store.get_entry(table_id, match_key) == nullptr)
+    auto entry_data = table_info_store.get_entry(table_id, match_key);
+    if (entry_data == nullptr)
       RETURN_ERROR_STATUS(Code::NOT_FOUND, "Cannot find match entry");
 
     pi::MatchTable mt(session.get(), device_tgt, p4info.get(), table_id);
@@ -2026,7 +2503,7 @@ class DeviceMgrImp {
     if (table_entry.is_default_action()) {
       pi_status = mt.default_entry_reset();
     } else {
-      pi_status = mt.entry_delete_wkey(match_key);
+      pi_status = table_entry_delete_target(&mt, *entry_data, match_key);
     }
     if (pi_status != PI_STATUS_SUCCESS) {
       RETURN_ERROR_STATUS(Code::UNKNOWN,
@@ -2038,6 +2515,26 @@ class DeviceMgrImp {
     RETURN_OK_STATUS();
   }
 
+  // Using the entry handle saves the target a key lookup, but it is only
+  // possible if the target guarantees that the handle returned when the entry
+  // was added still designates the same entry.
+  pi_status_t table_entry_modify_target(pi::MatchTable *mt,
+                                        const TableInfoStore::Data &entry_data,
+                                        const pi::MatchKey &match_key,
+                                        const pi::ActionEntry &action_entry) {
+    if (table_use_entry_handles)
+      return mt->entry_modify(entry_data.handle, action_entry);
+    return mt->entry_modify_wkey(match_key, action_entry);
+  }
+
+  pi_status_t table_entry_delete_target(pi::MatchTable *mt,
+                                        const TableInfoStore::Data &entry_data,
+                                        const pi::MatchKey &match_key) {
+    if (table_use_entry_handles)
+      return mt->entry_delete(entry_data.handle);
+    return mt->entry_delete_wkey(match_key);
+  }
+
   ActionProfMgr *get_action_prof_mgr(uint32_t id) const {
     auto it = action_profs.find(id);
     return (it == action_profs.end()) ? nullptr : it->second.get();
@@ -2140,6 +2637,121 @@ class DeviceMgrImp {
     RETURN_OK_STATUS();
   }
 
+  Status table_shadow_verify_one(p4_id_t table_id, const SessionTemp &session,
+                                 bool *in_sync) const {
+    *in_sync = true;
+    p4v1::TableEntry requested_entry;
+    requested_entry.set_table_id(table_id);
+    if (pi_get_table_direct_resource_p4_id(table_id, P4Ids::DIRECT_METER) !=
+        PI_INVALID_ID) {
+      requested_entry.mutable_meter_config();
+    }
+    pi::MatchKey expected_match_key(p4info.get(), table_id);
+    auto table_lock = table_info_store.lock_table(table_id);
+    p4v1::ReadResponse from_shadow;
+    bool served;
+    auto status = table_read_one_shadow(table_id, requested_entry,
+                                        expected_match_key, session,
+                                        &from_shadow, &served);
+    // nothing to verify if the shadow is incomplete
+    if (IS_ERROR(status) || !served) return status;
+    p4v1::ReadResponse from_target;
+    status = table_read_one_target(table_id, requested_entry,
+                                   expected_match_key, session, &from_target);
+    if (IS_ERROR(status)) return status;
+    // the order of the entries is not the same, so we compare the sorted
+    // serialized entries
+    auto serialize = [](const p4v1::ReadResponse &response) {
+      std::vector<std::string> entries;
+      for (const auto &entity : response.entities())
+        entries.push_back(entity.table_entry().SerializeAsString());
+      std::sort(entries.begin(), entries.end());
+      return entries;
+    };
+    *in_sync = (serialize(from_shadow) == serialize(from_target));
+    RETURN_OK_STATUS();
+  }
+
+  void stop_table_shadow_verifier() {
+    if (!table_shadow_verifier.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(table_shadow_mutex);
+      table_shadow_verifier_stop = true;
+    }
+    table_shadow_cv.notify_one();
+    table_shadow_verifier.join();
+  }
+
+  void table_shadow_verifier_loop(std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lock(table_shadow_mutex);
+    while (!table_shadow_cv.wait_for(lock, interval, [this] {
+          return table_shadow_verifier_stop; })) {
+      lock.unlock();
+      table_shadow_verify();
+      lock.lock();
+    }
+  }
+
+  bool write_group_enabled() {
+    std::lock_guard<std::mutex> lock(write_group_mutex);
+    return write_group_window > std::chrono::microseconds::zero() &&
+        write_group_max_requests != 1;
+  }
+
+  // Group commit: the first WriteRequest to arrive opens a group and becomes
+  // its leader. Requests arriving while the group is open (i.e. until the
+  // window expires or the group reaches max_requests) join it and wait. The
+  // leader then applies all the requests of the group in order, in a single
+  // target batch, and the batch is ended (with HW sync) only once. Each request
+  // still gets its own status.
+  struct WriteGroupMember {
+    const p4v1::WriteRequest *request;
+    Status status;
+    bool done;
+  };
+
+  struct WriteGroup {
+    std::vector<WriteGroupMember *> members;
+  };
+
+  Status write_grouped(const p4v1::WriteRequest &request) {
+    WriteGroupMember self{&request, Status(), false};
+    std::unique_lock<std::mutex> lock(write_group_mutex);
+    if (write_group_open != nullptr) {  // join the open group
+      auto *group = write_group_open;
+      group->members.push_back(&self);
+      if (write_group_max_requests > 0 &&
+          group->members.size() >= write_group_max_requests) {
+        write_group_open = nullptr;
+        write_group_cv.notify_all();
+      }
+      write_group_cv.wait(lock, [&self] { return self.done; });
+      return self.status;
+    }
+
+    WriteGroup group;
+    group.members.push_back(&self);
+    write_group_open = &group;
+    auto deadline = std::chrono::steady_clock::now() + write_group_window;
+    write_group_cv.wait_until(lock, deadline, [this, &group] {
+        return write_group_open != &group; });
+    if (write_group_open == &group) write_group_open = nullptr;
+    lock.unlock();
+
+    {
+      auto device_lock = shared_lock();
+      SessionTemp session(true  /* = batch */);
+      for (auto *member : group.members)
+        member->status = write_(*member->request, session);
+    }
+
+    lock.lock();
+    for (auto *member : group.members) member->done = true;
+    lock.unlock();
+    write_group_cv.notify_all();
+    return self.status;
+  }
+
   Status meter_read_one_index(const SessionTemp &session, uint32_t meter_id,
                               p4v1::MeterEntry *entry) const {
     // checked by caller
@@ -2228,6 +2840,38 @@ class DeviceMgrImp {
 
   TableInfoStore table_info_store;
 
+  mutable CounterCache counter_cache;
+
+  // set on every P4 change, based on whether the target has stable entry
+  // handles (see pi_table_entry_handles_stable)
+  bool table_use_entry_handles{false};
+
+  struct WriteDedupCounters {
+    std::atomic<uint64_t> modify_suppressed{0};
+    std::atomic<uint64_t> insert_suppressed{0};
+  };
+
+  std::atomic<bool> write_suppress_noop_modify{false};
+  std::atomic<bool> write_accept_identical_insert{false};
+  // one entry per table, only modified under the exclusive lock
+  std::unordered_map<p4_id_t, std::unique_ptr<WriteDedupCounters> >
+  write_dedup_stats{};
+
+  std::atomic<bool> table_shadow_enabled{false};
+  std::mutex table_shadow_mutex{};
+  std::condition_variable table_shadow_cv{};
+  bool table_shadow_verifier_stop{false};
+  std::thread table_shadow_verifier{};
+
+  std::mutex write_group_mutex{};
+  std::condition_variable write_group_cv{};
+  // group which new WriteRequests can join, if any
+  WriteGroup *write_group_open{nullptr};
+  // 0 disables group commit
+  std::chrono::microseconds write_group_window{0};
+  // 0 means no limit
+  size_t write_group_max_requests{0};
+
   mutable SharedMutex shared_mutex{};
 };
 
@@ -2256,6 +2900,17 @@ DeviceMgr::write(const p4v1::WriteRequest &request) {
   return pimp->write(request);
 }
 
+void
+DeviceMgr::write_dedup_configure(bool suppress_noop_modify,
+                                 bool accept_identical_insert) {
+  pimp->write_dedup_configure(suppress_noop_modify, accept_identical_insert);
+}
+
+DeviceMgr::WriteDedupStats
+DeviceMgr::write_dedup_get_stats(p4_id_t table_id) const {
+  return pimp->write_dedup_get_stats(table_id);
+}
+
 Status
 DeviceMgr::read(const p4v1::ReadRequest &request,
                 p4v1::ReadResponse *response) const {
@@ -2268,16 +2923,73 @@ DeviceMgr::read_one(const p4v1::Entity &entity,
   return pimp->read_one(entity, response);
 }
 
+Status
+DeviceMgr::table_clear(p4_id_t table_id) {
+  return pimp->table_clear(table_id);
+}
+
+Status
+DeviceMgr::action_profile_clear(p4_id_t act_prof_id) {
+  return pimp->action_profile_clear(act_prof_id);
+}
+
+Status
+DeviceMgr::table_get_usage(p4_id_t table_id, TableUsage *usage) const {
+  return pimp->table_get_usage(table_id, usage);
+}
+
+void
+DeviceMgr::write_group_commit_configure(std::chrono::microseconds window,
+                                        size_t max_requests) {
+  pimp->write_group_commit_configure(window, max_requests);
+}
+
+void
+DeviceMgr::counter_cache_set_max_staleness(
+    std::chrono::milliseconds max_staleness) {
+  pimp->counter_cache_set_max_staleness(max_staleness);
+}
+
+DeviceMgr::CounterCacheStats
+DeviceMgr::counter_cache_get_stats() const {
+  return pimp->counter_cache_get_stats();
+}
+
+void
+DeviceMgr::table_shadow_configure(bool enable,
+                                  std::chrono::milliseconds verify_interval) {
+  pimp->table_shadow_configure(enable, verify_interval);
+}
+
+Status
+DeviceMgr::table_shadow_verify() {
+  return pimp->table_shadow_verify();
+}
+
 Status
 DeviceMgr::packet_out_send(const p4v1::PacketOut &packet) const {
   return pimp->packet_out_send(packet);
 }
 
+Status
+DeviceMgr::packet_out_send_batch(
+    const std::vector<const p4v1::PacketOut *> &packets) const {
+  return pimp->packet_out_send_batch(packets);
+}
+
 void
 DeviceMgr::packet_in_register_cb(PacketInCb cb, void *cookie) {
   return pimp->packet_in_register_cb(cb, cookie);
 }
 
+google::protobuf::ArenaOptions
+DeviceMgr::large_message_arena_options() {
+  google::protobuf::ArenaOptions options;
+  options.start_block_size = 64 * 1024;
+  options.max_block_size = 8 * 1024 * 1024;
+  return options;
+}
+
 void
 DeviceMgr::init(size_t max_devices) {
   DeviceMgrImp::init(max_devices);
@@ -52,6 +52,10 @@ class Logger {
     this->min_severity = min_severity;
   }
 
+  bool is_enabled(Severity severity) const {
+    return severity >= min_severity;
+  }
+
   template <typename Arg1, typename... Args>
   void log(Severity severity, const char *fmt,
            const Arg1 &arg1, const Args &... args) {
@@ -20,6 +20,14 @@
 
 #include <PI/frontends/proto/logging.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "logger.h"
 
 namespace pi {
@@ -40,6 +48,137 @@ LoggerConfig::set_min_severity(Severity min_severity) {
   Logger::get()->set_min_severity(min_severity);
 }
 
+// The ring buffer is a bounded multi-producer queue (as described by Dmitry
+// Vyukov): each slot carries a sequence number which tells producers and the
+// consumer whether the slot is free or holds a message for the current lap.
+// There is a single consumer, the background thread.
+class AsyncLogWriter::Impl {
+ public:
+  Impl(std::shared_ptr<LogWriterIface> writer, size_t capacity)
+      : writer(writer), slots(round_up_pow2(capacity)),
+        mask(slots.size() - 1) {
+    for (size_t i = 0; i < slots.size(); i++)
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    consumer = std::thread(&Impl::consume, this);
+  }
+
+  ~Impl() {
+    stop.store(true, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      cv.notify_one();
+    }
+    consumer.join();
+  }
+
+  void push(Severity severity, const char *msg) {
+    auto pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots[pos & mask];
+      auto seq = slot->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    slot->severity = severity;
+    slot->msg.assign(msg);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    if (sleeping.load(std::memory_order_acquire)) cv.notify_one();
+  }
+
+  uint64_t dropped() const {
+    return dropped_count.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq{0};
+    Severity severity{Severity::TRACE};
+    std::string msg{};
+  };
+
+  static size_t round_up_pow2(size_t v) {
+    size_t p = 2;
+    while (p < v) p <<= 1;
+    return p;
+  }
+
+  // returns false if the ring buffer is empty
+  bool pop_one() {
+    auto &slot = slots[dequeue_pos & mask];
+    auto seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != dequeue_pos + 1) return false;
+    writer->write(slot.severity, slot.msg.c_str());
+    slot.seq.store(dequeue_pos + slots.size(), std::memory_order_release);
+    dequeue_pos++;
+    return true;
+  }
+
+  void consume() {
+    while (true) {
+      while (pop_one()) { }
+      if (stop.load(std::memory_order_acquire)) break;
+      // Producers only notify us when we are sleeping; in case we miss a
+      // notification, we never sleep for long.
+      std::unique_lock<std::mutex> lock(mutex);
+      sleeping.store(true, std::memory_order_release);
+      cv.wait_for(lock, std::chrono::milliseconds(10));
+      sleeping.store(false, std::memory_order_release);
+    }
+    while (pop_one()) { }
+  }
+
+  std::shared_ptr<LogWriterIface> writer;
+  std::vector<Slot> slots;
+  const size_t mask;
+  std::atomic<size_t> enqueue_pos{0};
+  size_t dequeue_pos{0};  // only accessed by the consumer
+  std::atomic<uint64_t> dropped_count{0};
+  std::atomic<bool> sleeping{false};
+  std::atomic<bool> stop{false};
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::thread consumer{};
+};
+
+AsyncLogWriter::AsyncLogWriter(std::shared_ptr<LogWriterIface> writer,
+                               size_t capacity)
+    : pimp(new Impl(writer, capacity)) { }
+
+AsyncLogWriter::~AsyncLogWriter() = default;
+
+void
+AsyncLogWriter::write(Severity severity, const char *msg) {
+  pimp->push(severity, msg);
+}
+
+uint64_t
+AsyncLogWriter::dropped() const {
+  return pimp->dropped();
+}
+
+SharedLogger::SharedLogger() = default;
+
+bool
+SharedLogger::is_enabled(Severity severity) {
+  return Logger::get()->is_enabled(severity);
+}
+
+void
+SharedLogger::write(Severity severity, const char *msg) {
+  Logger::get()->log(severity, msg);
+}
+
 }  // namespace proto
 
 }  // namespace fe
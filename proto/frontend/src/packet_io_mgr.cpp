@@ -289,6 +289,42 @@ PacketIOMgr::packet_out_send(const p4v1::PacketOut &packet) const {
     return status;
 }
 
+Status
+PacketIOMgr::packet_out_send_batch(
+    const std::vector<const p4v1::PacketOut *> &packets) const {
+  Status status;
+  // buffers are reused across calls to avoid reallocating them for each batch
+  thread_local std::vector<std::string> raw_packets;
+  thread_local std::vector<const char *> pkts;
+  thread_local std::vector<size_t> sizes;
+  pkts.clear();
+  sizes.clear();
+  if (packet_out_mutate && raw_packets.size() < packets.size())
+    raw_packets.resize(packets.size());
+  for (size_t i = 0; i < packets.size(); i++) {
+    if (packet_out_mutate) {
+      auto &raw_packet = raw_packets[i];
+      if (!(*packet_out_mutate)(*packets[i], &raw_packet)) {
+        status.set_code(Code::UNKNOWN);
+        return status;
+      }
+      pkts.push_back(raw_packet.data());
+      sizes.push_back(raw_packet.size());
+    } else {
+      const auto &payload = packets[i]->payload();
+      pkts.push_back(payload.data());
+      sizes.push_back(payload.size());
+    }
+  }
+  auto pi_status = pi_packetout_send_batch(device_id, pkts.data(),
+                                           sizes.data(), packets.size());
+  if (pi_status != PI_STATUS_SUCCESS)
+    status.set_code(Code::UNKNOWN);
+  else
+    status.set_code(Code::OK);
+  return status;
+}
+
 void
 PacketIOMgr::packet_in_register_cb(PacketInCb cb, void *cookie) {
   cb_ = std::move(cb);
@@ -26,6 +26,7 @@
 
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "google/rpc/status.pb.h"
 #include "p4/config/v1/p4info.pb.h"
@@ -53,6 +54,9 @@ class PacketIOMgr {
 
   Status packet_out_send(const p4::v1::PacketOut &packet) const;
 
+  Status packet_out_send_batch(
+      const std::vector<const p4::v1::PacketOut *> &packets) const;
+
   void packet_in_register_cb(PacketInCb cb, void *cookie);
 
  private:
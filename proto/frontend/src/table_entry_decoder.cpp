@@ -0,0 +1,197 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include <PI/int/pi_int.h>
+#include <PI/int/serialize.h>
+#include <PI/pi.h>
+
+#include <algorithm>  // for std::all_of
+#include <string>
+#include <vector>
+
+#include <cstring>  // for std::memcmp
+
+#include "common.h"
+#include "table_entry_decoder.h"
+
+namespace p4v1 = ::p4::v1;
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+ActionDataDecoder::ActionDataDecoder(const pi_p4info_t *p4info)
+    : p4info(p4info) { }
+
+void
+ActionDataDecoder::prepare(const pi_p4_id_t *action_ids, size_t num_actions) {
+  for (size_t i = 0; i < num_actions; i++) get_layout(action_ids[i]);
+}
+
+const std::vector<ActionDataDecoder::ParamLayout> &
+ActionDataDecoder::get_layout(pi_p4_id_t action_id) {
+  auto it = layouts.find(action_id);
+  if (it != layouts.end()) return it->second;
+  std::vector<ParamLayout> layout;
+  size_t num_params;
+  auto param_ids = pi_p4info_action_get_params(
+      p4info, action_id, &num_params);
+  layout.reserve(num_params);
+  for (size_t i = 0; i < num_params; i++) {
+    auto bitwidth = pi_p4info_action_param_bitwidth(
+        p4info, action_id, param_ids[i]);
+    layout.push_back(
+        {param_ids[i],
+         pi_p4info_action_param_offset(p4info, action_id, param_ids[i]),
+         (bitwidth + 7) / 8});
+  }
+  return layouts.emplace(action_id, std::move(layout)).first->second;
+}
+
+void
+ActionDataDecoder::decode(const pi_action_data_t *action_data,
+                          p4v1::Action *action) {
+  const auto action_id = action_data->action_id;
+  action->set_action_id(action_id);
+  const auto &layout = get_layout(action_id);
+  action->mutable_params()->Reserve(static_cast<int>(layout.size()));
+  for (const auto &p : layout) {
+    auto param = action->add_params();
+    param->set_param_id(p.param_id);
+    param->set_value(action_data->data + p.offset, p.nbytes);
+  }
+}
+
+namespace {
+
+bool is_zero(const char *data, size_t nbytes) {
+  return std::all_of(data, data + nbytes, [](char c) { return c == 0; });
+}
+
+}  // namespace
+
+TableEntryDecoder::TableEntryDecoder(const pi_p4info_t *p4info,
+                                     pi_p4_id_t table_id)
+    : action_decoder(p4info) {
+  size_t num_actions;
+  auto action_ids = pi_p4info_table_get_actions(
+      p4info, table_id, &num_actions);
+  action_decoder.prepare(action_ids, num_actions);
+
+  auto num_match_fields = pi_p4info_table_num_match_fields(p4info, table_id);
+  fields.reserve(num_match_fields);
+  for (size_t i = 0; i < num_match_fields; i++) {
+    auto finfo = pi_p4info_table_match_field_info(p4info, table_id, i);
+    FieldLayout field;
+    field.mf_id = finfo->mf_id;
+    field.match_type = finfo->match_type;
+    field.offset = pi_p4info_table_match_field_offset(
+        p4info, table_id, finfo->mf_id);
+    field.nbytes = (finfo->bitwidth + 7) / 8;
+    if (finfo->match_type == PI_P4INFO_MATCH_TYPE_RANGE) {
+      field.range_lo = common::range_default_lo(finfo->bitwidth);
+      field.range_hi = common::range_default_hi(finfo->bitwidth);
+    }
+    fields.push_back(std::move(field));
+  }
+}
+
+Code
+TableEntryDecoder::decode_match_key(const pi_match_key_t *match_key,
+                                    p4v1::TableEntry *entry) const {
+  auto priority = match_key->priority;
+  if (priority > 0) entry->set_priority(priority);
+  entry->mutable_match()->Reserve(static_cast<int>(fields.size()));
+  for (const auto &field : fields) {
+    const char *src = match_key->data + field.offset;
+    const auto nbytes = field.nbytes;
+    switch (field.match_type) {
+      // For backward-compatibility with the old workflow (P4_14 program ---
+      // p4c-bm compiler ---> bmv2 JSON --- converter ---> P4Info), we still
+      // support PI_P4INFO_MATCH_TYPE_VALID. The P4_14 valid match type will
+      // show up as exact in the P4Info, which is why we set the exact field
+      // in the P4Runtime message (to '\x01' for valid and '\x00' for
+      // invalid).
+      case PI_P4INFO_MATCH_TYPE_VALID:
+        {
+          auto mf = entry->add_match();
+          mf->set_field_id(field.mf_id);
+          mf->mutable_exact()->set_value((*src != 0) ? "\x01" : "\x00", 1);
+        }
+        break;
+      case PI_P4INFO_MATCH_TYPE_EXACT:
+        {
+          auto mf = entry->add_match();
+          mf->set_field_id(field.mf_id);
+          mf->mutable_exact()->set_value(src, nbytes);
+        }
+        break;
+      case PI_P4INFO_MATCH_TYPE_LPM:
+        {
+          uint32_t pLen;
+          retrieve_uint32(src + nbytes, &pLen);
+          // if prefix length is 0, omit match field
+          if (pLen == 0) break;
+          auto mf = entry->add_match();
+          mf->set_field_id(field.mf_id);
+          auto lpm = mf->mutable_lpm();
+          lpm->set_value(src, nbytes);
+          lpm->set_prefix_len(static_cast<int>(pLen));
+        }
+        break;
+      case PI_P4INFO_MATCH_TYPE_TERNARY:
+        {
+          // if mask is 0, omit match field
+          if (is_zero(src + nbytes, nbytes)) break;
+          auto mf = entry->add_match();
+          mf->set_field_id(field.mf_id);
+          auto ternary = mf->mutable_ternary();
+          ternary->set_value(src, nbytes);
+          ternary->set_mask(src + nbytes, nbytes);
+        }
+        break;
+      case PI_P4INFO_MATCH_TYPE_RANGE:
+        {
+          // if range includes all values, omit match field
+          if (!std::memcmp(src, field.range_lo.data(), nbytes) &&
+              !std::memcmp(src + nbytes, field.range_hi.data(), nbytes)) {
+            break;
+          }
+          auto mf = entry->add_match();
+          mf->set_field_id(field.mf_id);
+          auto range = mf->mutable_range();
+          range->set_low(src, nbytes);
+          range->set_high(src + nbytes, nbytes);
+        }
+        break;
+      default:
+        return Code::UNKNOWN;
+    }
+  }
+  return Code::OK;
+}
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
@@ -0,0 +1,107 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef SRC_TABLE_ENTRY_DECODER_H_
+#define SRC_TABLE_ENTRY_DECODER_H_
+
+#include <PI/pi.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "google/rpc/code.pb.h"
+#include "p4/v1/p4runtime.pb.h"
+
+namespace pi {
+
+namespace fe {
+
+namespace proto {
+
+using Code = ::google::rpc::Code;
+
+// Decodes action data returned by the PI library into P4Runtime Action
+// messages. The layout of each action (param ids, offsets and byte widths) is
+// looked up in the p4info at most once per decoder, and the parameter values
+// are copied straight from the PI buffer into the protobuf fields.
+class ActionDataDecoder {
+ public:
+  explicit ActionDataDecoder(const pi_p4info_t *p4info);
+
+  // pre-computes the layouts for the provided actions, other actions are
+  // looked-up lazily when decoding
+  void prepare(const pi_p4_id_t *action_ids, size_t num_actions);
+
+  void decode(const pi_action_data_t *action_data, p4::v1::Action *action);
+
+ private:
+  struct ParamLayout {
+    pi_p4_id_t param_id;
+    size_t offset;
+    size_t nbytes;
+  };
+
+  const std::vector<ParamLayout> &get_layout(pi_p4_id_t action_id);
+
+  const pi_p4info_t *p4info;
+  std::unordered_map<pi_p4_id_t, std::vector<ParamLayout> > layouts{};
+};
+
+// Decodes table entries returned by pi_table_entries_next into P4Runtime
+// TableEntry messages. Meant to be built once per table read: all the p4info
+// queries (match field offsets, bitwidths, match types) are done by the
+// constructor, and match key bytes are written directly from the fetched
+// buffer into the protobuf fields without intermediate std::string objects.
+class TableEntryDecoder {
+ public:
+  TableEntryDecoder(const pi_p4info_t *p4info, pi_p4_id_t table_id);
+
+  // omits 'don't care' match fields, as per the P4Runtime spec
+  Code decode_match_key(const pi_match_key_t *match_key,
+                        p4::v1::TableEntry *entry) const;
+
+  void decode_action_data(const pi_action_data_t *action_data,
+                          p4::v1::Action *action) {
+    action_decoder.decode(action_data, action);
+  }
+
+ private:
+  struct FieldLayout {
+    pi_p4_id_t mf_id;
+    pi_p4info_match_type_t match_type;
+    size_t offset;
+    size_t nbytes;
+    // only used for range match fields
+    std::string range_lo;
+    std::string range_hi;
+  };
+
+  std::vector<FieldLayout> fields{};
+  ActionDataDecoder action_decoder;
+};
+
+}  // namespace proto
+
+}  // namespace fe
+
+}  // namespace pi
+
+#endif  // SRC_TABLE_ENTRY_DECODER_H_
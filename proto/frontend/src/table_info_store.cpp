@@ -53,6 +53,18 @@ class TableInfoStoreOne {
     return (it == data_map.end()) ? nullptr : &it->second;
   }
 
+  void for_each_entry(const TableInfoStore::EntryFn &fn) const {
+    for (const auto &p : data_map) fn(p.first, p.second);
+  }
+
+  void clear_shadow() {
+    for (auto &p : data_map) p.second.shadow.reset();
+  }
+
+  void clear() {
+    data_map.clear();
+  }
+
   Lock lock() const { return Lock(mutex); }
 
  private:
@@ -95,6 +107,24 @@ TableInfoStore::get_entry(pi_p4_id_t t_id, const MatchKey &mk) const {
   return table->get_entry(mk);
 }
 
+void
+TableInfoStore::for_each_entry(pi_p4_id_t t_id, const EntryFn &fn) const {
+  auto &table = tables.at(t_id);
+  table->for_each_entry(fn);
+}
+
+void
+TableInfoStore::clear_shadow(pi_p4_id_t t_id) {
+  auto &table = tables.at(t_id);
+  table->clear_shadow();
+}
+
+void
+TableInfoStore::clear_table(pi_p4_id_t t_id) {
+  auto &table = tables.at(t_id);
+  table->clear();
+}
+
 void
 TableInfoStore::reset() {
   tables.clear();
@@ -24,10 +24,14 @@
 #include <PI/frontends/cpp/tables.h>
 #include <PI/pi.h>
 
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 
+#include "p4/v1/p4runtime.pb.h"
+
 namespace pi {
 
 namespace fe {
@@ -52,8 +56,18 @@ class TableInfoStore {
 
     const pi_entry_handle_t handle{0};
     uint64_t controller_metadata{0};
+    // canonical encoding of the action (action id and parameters, or member /
+    // group id), used to detect writes which would not change the entry
+    std::string action_bytes{};
+    // optional software copy of the entry (match fields, action, direct meter
+    // config), used to serve table reads without fetching the entries from the
+    // target; nullptr if the shadow is disabled or if it is not known to be
+    // up-to-date.
+    std::shared_ptr<p4::v1::TableEntry> shadow{nullptr};
   };
 
+  using EntryFn = std::function<void(const MatchKey &mk, const Data &data)>;
+
   using Mutex = std::mutex;
   using Lock = std::unique_lock<Mutex>;
 
@@ -74,6 +88,15 @@ class TableInfoStore {
 
   Data *get_entry(pi_p4_id_t t_id, const MatchKey &mk) const;
 
+  // the table needs to be locked by the caller
+  void for_each_entry(pi_p4_id_t t_id, const EntryFn &fn) const;
+
+  // drops the software copy of all the entries in the table
+  void clear_shadow(pi_p4_id_t t_id);
+
+  // removes all the entries in the table
+  void clear_table(pi_p4_id_t t_id);
+
   void reset();
 
  private:
@@ -26,21 +26,116 @@
 extern "C" {
 #endif
 
+// Threading model for the P4Runtime service. Write, Read and
+// {Set,Get}ForwardingPipelineConfig calls are served from one or more
+// completion queues, each polled by its own threads. StreamChannel calls
+// (packet I/O and arbitration) are served from a separate completion queue, so
+// that they cannot delay the other RPCs.
+typedef struct {
+  // number of completion queues for the non-stream RPCs (default 1)
+  int num_unary_cqs;
+  // number of polling threads per non-stream completion queue (default 4)
+  int num_threads_per_unary_cq;
+  // number of polling threads for the StreamChannel completion queue
+  // (default 1)
+  int num_stream_threads;
+  // maximum number of concurrent RPCs on a given client connection, 0 means
+  // no limit (default 0)
+  int max_concurrent_rpcs;
+  // maximum number of sessions to the sysrepo datastore kept open for gNMI
+  // RPCs, 0 means that each RPC opens its own session; only used when the
+  // server is built with sysrepo support (default 4)
+  int gnmi_session_pool_size;
+  // counter reads are served from a per-device cache if the cached values are
+  // at most this old (in milliseconds); 0 disables the cache (default 0)
+  int counter_cache_max_staleness_ms;
+  // concurrent Write RPCs for the same device which arrive within this window
+  // (in microseconds) are applied together in one target batch, with a single
+  // hardware sync; 0 disables grouping (default 0)
+  int write_group_commit_window_us;
+  // maximum number of Write RPCs in one group, 0 means no limit (default 0)
+  int write_group_commit_max_requests;
+  // if non-zero, table entries are read from a software copy maintained by the
+  // server instead of being fetched from the target (default 0)
+  int table_shadow;
+  // interval (in milliseconds) at which the software copy of the table entries
+  // is checked against the target, 0 means never (default 0)
+  int table_shadow_verify_interval_ms;
+  // if non-zero, table MODIFY updates which do not change the entry are not
+  // sent to the target (default 0)
+  int write_suppress_noop_modify;
+  // if non-zero, the INSERT of a table entry which already exists with the same
+  // action and controller metadata succeeds without being sent to the target,
+  // instead of failing with ALREADY_EXISTS (default 0)
+  int write_accept_identical_insert;
+} PIGrpcServerConfig;
+
+typedef struct {
+  // reads served from the cache
+  uint64_t hits;
+  // reads which required reading from the target
+  uint64_t misses;
+} PIGrpcServerCounterCacheStats;
+
+typedef struct {
+  // Read RPCs handled
+  uint64_t reads;
+  // memory allocated for the Read responses, which are built on arenas, in
+  // total and for the largest response
+  uint64_t arena_bytes;
+  uint64_t max_arena_bytes;
+} PIGrpcServerReadStats;
+
+typedef struct {
+  // MODIFY updates which were not sent to the target
+  uint64_t modify_suppressed;
+  // INSERT updates which were not sent to the target
+  uint64_t insert_suppressed;
+} PIGrpcServerWriteDedupStats;
+
+// Initialize config with the default values
+void PIGrpcServerConfigInit(PIGrpcServerConfig *config);
+
 // Start server and bind to default address (0.0.0.0:50051)
 void PIGrpcServerRun();
 // Start server and bind to given address (eg. localhost:1234,
 // 192.168.1.1:31416, [::1]:27182, etc.)
 void PIGrpcServerRunAddr(const char *server_address);
+// Same as PIGrpcServerRunAddr, with a non-default threading model
+void PIGrpcServerRunAddrWithConfig(const char *server_address,
+                                   const PIGrpcServerConfig *config);
 
 // Get port number bound to the server
 int PIGrpcServerGetPort();
 
+// Log the full text of only 1 out of every one_in_n Write / Read requests
+// (these are logged with TRACE severity); 0 disables these messages. The
+// default is to log all requests.
+void PIGrpcServerSetRequestLogSampling(uint32_t one_in_n);
+
 // Get number of PacketIn packets sent to client
 uint64_t PIGrpcServerGetPacketInCount(uint64_t device_id);
 
-// Get number of PacketOut packets sent to DevMgr
+// Get number of PacketOut packets successfully sent to the target; waits for
+// the packets already received from the client to be processed
 uint64_t PIGrpcServerGetPacketOutCount(uint64_t device_id);
 
+// Get the counter cache statistics for the device; all zeros if the device
+// does not exist
+void PIGrpcServerGetCounterCacheStats(uint64_t device_id,
+                                      PIGrpcServerCounterCacheStats *stats);
+
+// Get the Read RPC statistics for the device; all zeros if the device does not
+// exist
+void PIGrpcServerGetReadStats(uint64_t device_id,
+                              PIGrpcServerReadStats *stats);
+
+// Get the number of table writes which were not sent to the target because
+// they would not have changed anything, for one table of the device; all zeros
+// if the device or the table does not exist
+void PIGrpcServerGetWriteDedupStats(uint64_t device_id, uint32_t table_id,
+                                    PIGrpcServerWriteDedupStats *stats);
+
 // Wait for the server to shutdown. Note that some other thread must be
 // responsible for shutting down the server for this call to ever return.
 void PIGrpcServerWait();
@@ -21,6 +21,7 @@
 #ifndef PROTO_SERVER_GNMI_H_
 #define PROTO_SERVER_GNMI_H_
 
+#include <cstddef>
 #include <memory>
 
 #include "gnmi/gnmi.grpc.pb.h"
@@ -32,7 +33,10 @@ namespace server {
 std::unique_ptr<gnmi::gNMI::Service> make_gnmi_service_dummy();
 
 #ifdef WITH_SYSREPO
-std::unique_ptr<gnmi::gNMI::Service> make_gnmi_service_sysrepo();
+// session_pool_size is the maximum number of sysrepo sessions which are kept
+// open and reused across RPCs
+std::unique_ptr<gnmi::gNMI::Service> make_gnmi_service_sysrepo(
+    size_t session_pool_size = 4);
 #endif  // WITH_SYSREPO
 
 }  // namespace server
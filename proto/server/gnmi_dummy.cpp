@@ -39,24 +39,24 @@ class gNMIServiceImpl : public gnmi::gNMI::Service {
                       const gnmi::CapabilityRequest *request,
                       gnmi::CapabilityResponse *response) override {
     (void) context; (void) request; (void) response;
-    SIMPLELOG << "gNMI Capabilities\n";
-    SIMPLELOG << request->DebugString();
+    SERVER_LOG(DEBUG) << "gNMI Capabilities";
+    SERVER_LOG(TRACE) << request->DebugString();
     return Status(StatusCode::UNIMPLEMENTED, "not implemented");
   }
 
   Status Get(ServerContext *context, const gnmi::GetRequest *request,
              gnmi::GetResponse *response) override {
     (void) context; (void) request; (void) response;
-    SIMPLELOG << "gNMI Get\n";
-    SIMPLELOG << request->DebugString();
+    SERVER_LOG(DEBUG) << "gNMI Get";
+    SERVER_LOG(TRACE) << request->DebugString();
     return Status(StatusCode::UNIMPLEMENTED, "not implemented");
   }
 
   Status Set(ServerContext *context, const gnmi::SetRequest *request,
              gnmi::SetResponse *response) override {
     (void) context; (void) request; (void) response;
-    SIMPLELOG << "gNMI Set\n";
-    SIMPLELOG << request->DebugString();
+    SERVER_LOG(DEBUG) << "gNMI Set";
+    SERVER_LOG(TRACE) << request->DebugString();
     return Status(StatusCode::UNIMPLEMENTED, "not implemented");
   }
 
@@ -65,7 +65,7 @@ class gNMIServiceImpl : public gnmi::gNMI::Service {
       ServerReaderWriter<gnmi::SubscribeResponse,
                          gnmi::SubscribeRequest> *stream) override {
     (void) context;
-    SIMPLELOG << "gNMI Subscribe\n";
+    SERVER_LOG(DEBUG) << "gNMI Subscribe";
     gnmi::SubscribeRequest request;
     // keeping the channel open, but not doing anything
     // if we receive a Write, we will return an error status
@@ -244,6 +244,115 @@ struct SysrepoSession {
   sr_session_ctx_t *sess{nullptr};
 };
 
+// Keeps sessions to sysrepo open across gNMI RPCs, so that we do not need to
+// connect to the sysrepo daemon for each one of them. At most max_size
+// sessions are kept; if they are all in use, a new session is opened and is
+// closed as soon as the RPC no longer needs it. Sessions are refreshed when
+// they are taken from the pool, so that changes committed since they were last
+// used are visible.
+class SysrepoSessionPool {
+ public:
+  // Gives exclusive access to a session until destroyed
+  class Handle {
+   public:
+    Handle() = default;
+
+    Handle(SysrepoSessionPool *pool, std::unique_ptr<SysrepoSession> session,
+           bool pooled)
+        : pool(pool), session(std::move(session)), pooled(pooled) { }
+
+    Handle(Handle &&other) = default;
+    Handle &operator=(Handle &&other) {
+      release();
+      pool = other.pool;
+      session = std::move(other.session);
+      pooled = other.pooled;
+      has_changes = other.has_changes;
+      return *this;
+    }
+
+    ~Handle() { release(); }
+
+    explicit operator bool() const { return session != nullptr; }
+
+    const SysrepoSession &operator*() const { return *session; }
+    const SysrepoSession *operator->() const { return session.get(); }
+
+    // Must be set while the session may include uncommitted changes, which
+    // will be discarded before the session is reused.
+    void set_has_changes(bool v) { has_changes = v; }
+
+   private:
+    void release() {
+      if (session == nullptr) return;
+      if (pooled) pool->release(std::move(session), has_changes);
+      session.reset();
+    }
+
+    SysrepoSessionPool *pool{nullptr};
+    std::unique_ptr<SysrepoSession> session{nullptr};
+    bool pooled{false};
+    bool has_changes{false};
+  };
+
+  explicit SysrepoSessionPool(size_t max_size)
+      : max_size(max_size) { }
+
+  // The returned handle evaluates to false if no session could be opened
+  Handle acquire() {
+    std::unique_ptr<SysrepoSession> session;
+    bool pooled = false;
+    {
+      Lock lock(m);
+      if (!idle.empty()) {
+        session = std::move(idle.back());
+        idle.pop_back();
+        pooled = true;
+      } else if (num_pooled < max_size) {
+        num_pooled++;
+        pooled = true;
+      }
+    }
+    // a failure to refresh probably means that the connection to the daemon
+    // was lost, in which case we replace the session
+    if (session != nullptr && sr_session_refresh(session->sess) != SR_ERR_OK) {
+      SERVER_LOG(DEBUG) << "Replacing sysrepo session which cannot be "
+                        << "refreshed";
+      session.reset();
+    }
+    if (session == nullptr) {
+      session.reset(new SysrepoSession());
+      if (!session->open()) {
+        if (pooled) {
+          Lock lock(m);
+          num_pooled--;
+        }
+        return Handle();
+      }
+    }
+    return Handle(this, std::move(session), pooled);
+  }
+
+ private:
+  using Lock = std::lock_guard<std::mutex>;
+
+  void release(std::unique_ptr<SysrepoSession> session, bool has_changes) {
+    if (has_changes && sr_discard_changes(session->sess) != SR_ERR_OK) {
+      Lock lock(m);
+      num_pooled--;
+      return;
+    }
+    Lock lock(m);
+    idle.push_back(std::move(session));
+  }
+
+  size_t max_size;
+  mutable std::mutex m{};
+  std::vector<std::unique_ptr<SysrepoSession> > idle{};
+  // number of sessions owned by the pool, both idle and in use
+  size_t num_pooled{0};
+};
+
 // checks if str starts with substr
 bool starts_with(const std::string &str, const std::string &substr) {
   return str.substr(0, substr.size()) == substr;
@@ -396,10 +505,11 @@ class XPathBuilder {
         auto ns_it = namespace_mapping.find(node->name);
         if (ns_it == namespace_mapping.end()) {
           namespace_mapping.emplace(node->name, module_name);
-          SIMPLELOG << "Path '" << node->name << "' is in module "
-                    << module_name << "\n";
+          SERVER_LOG(DEBUG) << "Path '" << node->name << "' is in module "
+                            << module_name;
         } else {
-          SIMPLELOG << "Path '" << node->name << " 'is in multiple modules\n";
+          SERVER_LOG(DEBUG) << "Path '" << node->name
+                            << " 'is in multiple modules";
         }
       }
     }
@@ -490,7 +600,7 @@ class LeafTypeCache {
     if (LY_set->number != 1) return {};
     auto LY_node = LY_set->set.s[0];
     if (LY_node->nodetype != LYS_LEAF) {
-      SIMPLELOG << "Schema path " << schema_path << " is not a leaf\n";
+      SERVER_LOG(DEBUG) << "Schema path " << schema_path << " is not a leaf";
       return {};
     }
     auto *LY_leaf = reinterpret_cast<struct lys_node_leaf *>(LY_node);
@@ -529,10 +639,10 @@ class SubscriptionStreamMgr {
   using Stream =
       ServerReaderWriter<gnmi::SubscribeResponse, gnmi::SubscribeRequest>;
 
-  SubscriptionStreamMgr(Stream *stream, const XPathBuilder &xpath_builder)
-      : stream(stream), xpath_builder(xpath_builder) {
-    session.open();
-  }
+  SubscriptionStreamMgr(Stream *stream, const XPathBuilder &xpath_builder,
+                        SysrepoSessionPool *session_pool)
+      : stream(stream), xpath_builder(xpath_builder),
+        session_pool(session_pool) { }
 
   ~SubscriptionStreamMgr() {
     shutdown();
@@ -542,6 +652,14 @@ class SubscriptionStreamMgr {
     assert(sub_list.mode() == gnmi::SubscriptionList::STREAM);
     const auto &prefix = sub_list.prefix();
     Lock lock(m);
+    // the session is kept for the lifetime of the stream
+    if (!session) {
+      session = session_pool->acquire();
+      if (!session) {
+        return Status(StatusCode::UNKNOWN,
+                      "Error when connecting to yang datastore");
+      }
+    }
     for (const auto &subscription : sub_list.subscription()) {
       // sanity-check Subscription message
       if (subscription.mode() == gnmi::TARGET_DEFINED) {
@@ -577,7 +695,7 @@ class SubscriptionStreamMgr {
       }
       subscriptions.emplace_back(subscription, xpath);
       auto &new_sub = subscriptions.back();
-      if (!new_sub.process(session, stream, !sub_list.updates_only())) {
+      if (!new_sub.process(*session, stream, !sub_list.updates_only())) {
         return Status(StatusCode::UNKNOWN,
                       "Error while retrieving subscription items");
       }
@@ -626,12 +744,13 @@ class SubscriptionStreamMgr {
     while (!cv_stop.wait_until(lock, next_process, [this] { return stop; })) {
       auto now = Clock::now();
       if (now < next_process) continue;
+      next_process = now + refresh_int;
+      if (!session) continue;
       // important to refresh the session in case a Set request happened since
       // the last call to process()
-      sr_session_refresh(session.sess);
+      sr_session_refresh(session->sess);
       for (auto &subscription : subscriptions)
-        subscription.process(session, stream);
-      next_process = now + refresh_int;
+        subscription.process(*session, stream);
     }
   }
 
@@ -746,9 +865,10 @@ class SubscriptionStreamMgr {
 
   static constexpr std::chrono::nanoseconds refresh_int{50000000};  // 50 ms
 
-  SysrepoSession session{};
   ServerReaderWriter<gnmi::SubscribeResponse, gnmi::SubscribeRequest> *stream;
   const XPathBuilder &xpath_builder;
+  SysrepoSessionPool *session_pool;
+  SysrepoSessionPool::Handle session{};
   mutable Mutex m{};
   std::thread t{};
   std::vector<Subscription> subscriptions{};
@@ -761,6 +881,10 @@ constexpr std::chrono::nanoseconds SubscriptionStreamMgr::refresh_int;
 }  // namespace
 
 class gNMIServiceSysrepoImpl : public gnmi::gNMI::Service {
+ public:
+  explicit gNMIServiceSysrepoImpl(size_t session_pool_size)
+      : session_pool(session_pool_size) { }
+
  private:
   grpc::Status Capabilities(grpc::ServerContext *context,
                             const gnmi::CapabilityRequest *request,
@@ -796,7 +920,7 @@ class gNMIServiceSysrepoImpl : public gnmi::gNMI::Service {
       return Status(StatusCode::INVALID_ARGUMENT,
                     "Cannot convert gNMI path to XPath");
     }
-    SIMPLELOG << "Getting items for xpath: " << xpath << "\n";
+    SERVER_LOG(DEBUG) << "Getting items for xpath: " << xpath;
 
     sr_val_t *value = nullptr;
     sr_val_iter_t *iter = nullptr;
@@ -820,7 +944,7 @@ class gNMIServiceSysrepoImpl : public gnmi::gNMI::Service {
         continue;
       }
 
-      SIMPLELOG << "Update XPath: " << update_xpath << "\n";
+      SERVER_LOG(TRACE) << "Update XPath: " << update_xpath;
       // sr_print_val(value);
 
       auto update = notification->add_update();
@@ -837,10 +961,13 @@ class gNMIServiceSysrepoImpl : public gnmi::gNMI::Service {
   LYContext LY_ctx;
   XPathBuilder xpath_builder{&LY_ctx};
   LeafTypeCache leaf_type_cache{&LY_ctx};
+  SysrepoSessionPool session_pool;
 };
 
-std::unique_ptr<gnmi::gNMI::Service> make_gnmi_service_sysrepo() {
-  return std::unique_ptr<gnmi::gNMI::Service>(new gNMIServiceSysrepoImpl());
+std::unique_ptr<gnmi::gNMI::Service> make_gnmi_service_sysrepo(
+    size_t session_pool_size) {
+  return std::unique_ptr<gnmi::gNMI::Service>(
+      new gNMIServiceSysrepoImpl(session_pool_size));
 }
 
 Status
@@ -848,8 +975,8 @@ gNMIServiceSysrepoImpl::Capabilities(ServerContext *context,
                                      const gnmi::CapabilityRequest *request,
                                      gnmi::CapabilityResponse *response) {
   (void) context; (void) request; (void) response;
-  SIMPLELOG << "gNMI Capabilities\n";
-  SIMPLELOG << request->DebugString();
+  SERVER_LOG(DEBUG) << "gNMI Capabilities";
+  SERVER_LOG(TRACE) << request->DebugString();
   return Status(StatusCode::UNIMPLEMENTED, "not implemented yet");
 }
 
@@ -858,8 +985,8 @@ gNMIServiceSysrepoImpl::Get(ServerContext *context,
                             const gnmi::GetRequest *request,
                             gnmi::GetResponse *response) {
   (void) context;
-  SIMPLELOG << "gNMI Get\n";
-  SIMPLELOG << request->DebugString();
+  SERVER_LOG(DEBUG) << "gNMI Get";
+  SERVER_LOG(TRACE) << request->DebugString();
   const auto &prefix = request->prefix();
 
   if (request->type() != gnmi::GetRequest::ALL) {
@@ -867,8 +994,8 @@ gNMIServiceSysrepoImpl::Get(ServerContext *context,
                   "Only ALL data type supported for GetRequest");
   }
 
-  SysrepoSession session;
-  if (!session.open()) {
+  auto session = session_pool.acquire();
+  if (!session) {
     return Status(StatusCode::UNKNOWN,
                   "Error when connecting to yang datastore");
   }
@@ -882,7 +1009,7 @@ gNMIServiceSysrepoImpl::Get(ServerContext *context,
     // TODO(antonin): should we return an aggregated value (e.g. using
     // ygot-generated protobuf messages once we support them), or return leaf
     // updates like we do for Subscribe/ONCE.
-    set_notification_update_for_path(notification, session, prefix, path);
+    set_notification_update_for_path(notification, *session, prefix, path);
   }
 
   return Status::OK;
@@ -893,19 +1020,21 @@ gNMIServiceSysrepoImpl::Set(ServerContext *context,
                             const gnmi::SetRequest *request,
                             gnmi::SetResponse *response) {
   (void) context;
-  SIMPLELOG << "gNMI Set\n";
-  SIMPLELOG << request->DebugString();
+  SERVER_LOG(DEBUG) << "gNMI Set";
+  SERVER_LOG(TRACE) << request->DebugString();
   int rc = SR_ERR_OK;
   const auto &prefix = request->prefix();
 
   if (!request->replace().empty())
     return Status(StatusCode::UNIMPLEMENTED, "'replace' not implemented yet");
 
-  SysrepoSession session;
-  if (!session.open()) {
+  auto session = session_pool.acquire();
+  if (!session) {
     return Status(StatusCode::UNKNOWN,
                   "Error when connecting to yang datastore");
   }
+  // if we return before the changes are committed, they will be discarded
+  session.set_has_changes(true);
 
   auto make_xpath = [this, &prefix](const gnmi::Path &path,
                                     std::string *xpath) {
@@ -921,7 +1050,7 @@ gNMIServiceSysrepoImpl::Set(ServerContext *context,
       return Status(StatusCode::INVALID_ARGUMENT,
                     "Cannot convert gNMI path to XPath");
     }
-    rc = sr_delete_item(session.sess, xpath.c_str(), SR_EDIT_DEFAULT);
+    rc = sr_delete_item(session->sess, xpath.c_str(), SR_EDIT_DEFAULT);
     if (rc != SR_ERR_OK)
       return Status(StatusCode::UNKNOWN, "Error when deleting item");
   }
@@ -945,7 +1074,7 @@ gNMIServiceSysrepoImpl::Set(ServerContext *context,
                         "Leaflist entry must be a scalar");
         }
         auto value_str = convertLeafTypedValueToStr(typedV_e);
-        rc = sr_set_item_str(session.sess, xpath.c_str(), value_str.c_str(),
+        rc = sr_set_item_str(session->sess, xpath.c_str(), value_str.c_str(),
                              SR_EDIT_DEFAULT);
         if (rc != SR_ERR_OK)
           return Status(StatusCode::UNKNOWN,
@@ -953,18 +1082,19 @@ gNMIServiceSysrepoImpl::Set(ServerContext *context,
       }
     } else {
       auto value_str = convertLeafTypedValueToStr(typedV);
-      rc = sr_set_item_str(session.sess, xpath.c_str(), value_str.c_str(),
+      rc = sr_set_item_str(session->sess, xpath.c_str(), value_str.c_str(),
                            SR_EDIT_DEFAULT);
       if (rc != SR_ERR_OK)
         return Status(StatusCode::UNKNOWN, "Error when setting item");
     }
   }
 
-  rc = sr_commit(session.sess);
+  rc = sr_commit(session->sess);
   if (rc != SR_ERR_OK) {
     return Status(StatusCode::UNKNOWN, "Error when comitting changes");
     // TODO(antonin): call sr_get_last_errors
   }
+  session.set_has_changes(false);
 
   // TODO(antonin): other response fields
   response->set_timestamp(get_timestamp());
@@ -977,9 +1107,10 @@ gNMIServiceSysrepoImpl::Subscribe(
     ServerContext *context,
     ServerReaderWriter<gnmi::SubscribeResponse,
                        gnmi::SubscribeRequest> *stream) {
-  SIMPLELOG << "gNMI Subscribe\n";
+  SERVER_LOG(DEBUG) << "gNMI Subscribe";
   gnmi::SubscribeRequest request;
-  SubscriptionStreamMgr subscription_streams(stream, xpath_builder);
+  SubscriptionStreamMgr subscription_streams(
+      stream, xpath_builder, &session_pool);
   while (stream->Read(&request)) {
     if (!request.has_subscribe()) {
       return Status(StatusCode::UNIMPLEMENTED,
@@ -998,8 +1129,8 @@ gNMIServiceSysrepoImpl::Subscribe(
       auto *notification = response.mutable_update();
       notification->set_timestamp(get_timestamp());
 
-      SysrepoSession session;
-      if (!session.open()) {
+      auto session = session_pool.acquire();
+      if (!session) {
         return Status(StatusCode::UNKNOWN,
                       "Error when connecting to yang datastore");
       }
@@ -1007,7 +1138,7 @@ gNMIServiceSysrepoImpl::Subscribe(
       const auto &prefix = sub.prefix();
       for (const auto &subscription : sub.subscription()) {
         set_notification_update_for_path(
-            notification, session, prefix, subscription.path());
+            notification, *session, prefix, subscription.path());
       }
       // response.PrintDebugString();
       stream->Write(response);
@@ -21,16 +21,83 @@
 #ifndef PROTO_SERVER_LOG_H_
 #define PROTO_SERVER_LOG_H_
 
-#include <iostream>
+#include <PI/frontends/proto/logging.h>
 
-#define DEBUG
+#include <atomic>
+#include <cstdint>
+#include <sstream>
 
-#ifdef DEBUG
-#define ENABLE_SIMPLELOG true
+namespace pi {
+
+namespace server {
+
+using LogSeverity = ::pi::fe::proto::LogWriterIface::Severity;
+
+// Builds a message and hands it to the frontend logger when destroyed, so that
+// the server and the DeviceMgr share the same writer and minimum severity.
+class LogMessage {
+ public:
+  explicit LogMessage(LogSeverity severity)
+      : severity(severity) { }
+
+  ~LogMessage() {
+    ::pi::fe::proto::SharedLogger::write(severity, buffer.str().c_str());
+  }
+
+  std::ostream &stream() { return buffer; }
+
+ private:
+  LogSeverity severity;
+  std::ostringstream buffer;
+};
+
+// Selects 1 out of every N occurrences of an expensive log message (e.g. the
+// text dump of an RPC request). The rate is shared by all samplers, each of
+// which keeps its own count.
+class LogSampler {
+ public:
+  // 0 disables sampled messages altogether
+  static void set_rate(uint32_t one_in_n) {
+    rate().store(one_in_n, std::memory_order_relaxed);
+  }
+
+  bool sample() {
+    auto r = rate().load(std::memory_order_relaxed);
+    if (r == 0) return false;
+    return (count.fetch_add(1, std::memory_order_relaxed) % r) == 0;
+  }
+
+ private:
+  static std::atomic<uint32_t> &rate() {
+    static std::atomic<uint32_t> rate_{1};
+    return rate_;
+  }
+
+  std::atomic<uint64_t> count{0};
+};
+
+}  // namespace server
+
+}  // namespace pi
+
+// Define PI_SERVER_NO_LOGGING to compile out all server log statements.
+#ifdef PI_SERVER_NO_LOGGING
+#define SERVER_LOG_IS_ENABLED(severity) false
 #else
-#define ENABLE_SIMPLELOG false
+#define SERVER_LOG_IS_ENABLED(severity)                                 \
+  ::pi::fe::proto::SharedLogger::is_enabled(                            \
+      ::pi::server::LogSeverity::severity)
 #endif
 
-#define SIMPLELOG if (ENABLE_SIMPLELOG) std::cout
+// The streamed expression is only evaluated when the severity is enabled, e.g.
+// SERVER_LOG(DEBUG) << "P4Runtime Write";
+#define SERVER_LOG(severity)                                            \
+  if (!SERVER_LOG_IS_ENABLED(severity)) { } else                        \
+    ::pi::server::LogMessage(::pi::server::LogSeverity::severity).stream()
+
+// Same as SERVER_LOG, but only for the occurrences selected by sampler
+#define SERVER_LOG_SAMPLED(severity, sampler)                           \
+  if (!(SERVER_LOG_IS_ENABLED(severity) && (sampler).sample())) { } else \
+    ::pi::server::LogMessage(::pi::server::LogSeverity::severity).stream()
 
 #endif  // PROTO_SERVER_LOG_H_
@@ -20,14 +20,24 @@
 
 #include <PI/frontends/proto/device_mgr.h>
 
+#include <google/protobuf/arena.h>
 #include <grpc++/grpc++.h>
 // #include <grpc++/support/error_details.h>
 
+#include <algorithm>  // for std::max, std::min
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <iterator>  // for std::back_inserter
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "gnmi.h"
 #include "gnmi/gnmi.grpc.pb.h"
@@ -42,8 +52,6 @@
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
-using grpc::ServerWriter;
-using grpc::ServerReaderWriter;
 using grpc::Status;
 using grpc::StatusCode;
 
@@ -97,9 +105,39 @@ grpc::Status not_master_status() {
   return grpc::Status(grpc::StatusCode::PERMISSION_DENIED, "Not master");
 }
 
-using StreamChannelReaderWriter = grpc::ServerReaderWriter<
+using AsyncService = p4v1::P4Runtime::AsyncService;
+
+using StreamChannelReaderWriter = grpc::ServerAsyncReaderWriter<
   p4v1::StreamMessageResponse, p4v1::StreamMessageRequest>;
 
+// Every pending operation on a completion queue is identified by a Tag; the
+// polling thread calls proceed() when the operation completes.
+class Tag {
+ public:
+  virtual ~Tag() { }
+
+  virtual void proceed(bool ok) = 0;
+};
+
+// Forwards a completion to a member function, for objects which have several
+// operations pending at the same time.
+template <typename T>
+class MemberTag : public Tag {
+ public:
+  using Fn = void (T::*)(bool);
+
+  MemberTag(T *obj, Fn fn)
+      : obj(obj), fn(fn) { }
+
+  void proceed(bool ok) override { (obj->*fn)(ok); }
+
+ private:
+  T *obj;
+  Fn fn;
+};
+
+class StreamChannelCall;
+
 class ConnectionId {
  public:
   using Id = Uint128;
@@ -124,32 +162,149 @@ class ConnectionId {
 class Connection {
  public:
   static std::unique_ptr<Connection> make(const Uint128 &election_id,
-                                          StreamChannelReaderWriter *stream,
-                                          ServerContext *context) {
-    (void) context;
+                                          StreamChannelCall *call) {
     return std::unique_ptr<Connection>(
-        new Connection(ConnectionId::get(), election_id, stream));
+        new Connection(ConnectionId::get(), election_id, call));
   }
 
   const ConnectionId::Id &connection_id() const { return connection_id_; }
   const Uint128 &election_id() const { return election_id_; }
-  StreamChannelReaderWriter *stream() const { return stream_; }
 
   void set_election_id(const Uint128 &election_id) {
     election_id_ = election_id;
   }
 
+  // Queues the message on the stream, does not block. Droppable messages
+  // (packet-ins) are discarded if the client is not reading fast enough.
+  // Returns false if the message was discarded.
+  bool write(p4v1::StreamMessageResponse &&response, bool droppable) const;
+
  private:
   Connection(ConnectionId::Id connection_id, const Uint128 &election_id,
-             StreamChannelReaderWriter *stream)
+             StreamChannelCall *call)
       : connection_id_(connection_id), election_id_(election_id),
-        stream_(stream) { }
+        call_(call) { }
 
   ConnectionId::Id connection_id_{0};
   Uint128 election_id_{0};
-  StreamChannelReaderWriter *stream_{nullptr};
+  StreamChannelCall *call_{nullptr};
 };
 
+// applied to every DeviceMgr instance when it is created, from
+// PIGrpcServerConfig
+std::atomic<int> counter_cache_max_staleness_ms{0};
+std::atomic<int> write_group_commit_window_us{0};
+std::atomic<int> write_group_commit_max_requests{0};
+std::atomic<bool> table_shadow{false};
+std::atomic<int> table_shadow_verify_interval_ms{0};
+std::atomic<bool> write_suppress_noop_modify{false};
+std::atomic<bool> write_accept_identical_insert{false};
+
+// Packet-outs received on the StreamChannel are handed to a per-device thread,
+// which sends everything that accumulated since its last iteration with a
+// single call to the target. PacketOut messages are recycled to avoid
+// allocating a new one for each packet.
+class PacketOutBatcher {
+ public:
+  static constexpr size_t max_batch_size = 256;
+  // beyond this, push blocks until the thread catches up, which applies
+  // back-pressure to the StreamChannel reader
+  static constexpr size_t max_pending = 4096;
+
+  explicit PacketOutBatcher(DeviceMgr *device_mgr)
+      : device_mgr(device_mgr), sender(&PacketOutBatcher::run, this) { }
+
+  ~PacketOutBatcher() {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      stop = true;
+    }
+    cv.notify_one();
+    space_cv.notify_all();
+    sender.join();
+  }
+
+  // takes the contents of the packet; blocks while max_pending packets are
+  // waiting to be sent
+  void push(p4v1::PacketOut *packet) {
+    std::unique_lock<std::mutex> lock(m);
+    space_cv.wait(lock, [this] {
+        return stop || pending.size() < max_pending; });
+    if (stop) return;
+    std::unique_ptr<p4v1::PacketOut> buffer;
+    if (free_list.empty()) {
+      buffer.reset(new p4v1::PacketOut());
+    } else {
+      buffer = std::move(free_list.back());
+      free_list.pop_back();
+    }
+    buffer->Swap(packet);
+    pending.push_back(std::move(buffer));
+    auto was_empty = (pending.size() == 1);
+    lock.unlock();
+    if (was_empty) cv.notify_one();
+  }
+
+  // waits until all the packets pushed so far have been handed to the target,
+  // then returns the number of packets which were sent successfully
+  uint64_t get_sent_count() const {
+    std::unique_lock<std::mutex> lock(m);
+    idle_cv.wait(lock, [this] { return stop || (pending.empty() && !busy); });
+    return sent_count;
+  }
+
+ private:
+  void run() {
+    std::vector<std::unique_ptr<p4v1::PacketOut> > batch;
+    std::vector<const p4v1::PacketOut *> packets;
+    std::unique_lock<std::mutex> lock(m);
+    while (true) {
+      cv.wait(lock, [this] { return stop || !pending.empty(); });
+      if (stop) break;
+      auto n = std::min(pending.size(), max_batch_size);
+      std::move(pending.begin(), pending.begin() + n,
+                std::back_inserter(batch));
+      pending.erase(pending.begin(), pending.begin() + n);
+      busy = true;
+      lock.unlock();
+      space_cv.notify_all();
+      packets.clear();
+      for (const auto &packet : batch) packets.push_back(packet.get());
+      auto status = device_mgr->packet_out_send_batch(packets);
+      if (status.code() != ::google::rpc::Code::OK) {
+        SERVER_LOG(DEBUG) << "Error when sending batch of packet-outs";
+      }
+      lock.lock();
+      if (status.code() == ::google::rpc::Code::OK) sent_count += n;
+      busy = false;
+      for (auto &packet : batch) {
+        if (free_list.size() >= max_pending) break;
+        packet->Clear();
+        free_list.push_back(std::move(packet));
+      }
+      batch.clear();
+      if (pending.empty()) idle_cv.notify_all();
+    }
+    idle_cv.notify_all();
+  }
+
+  DeviceMgr *device_mgr;
+  mutable std::mutex m{};
+  std::condition_variable cv{};
+  std::condition_variable space_cv{};
+  mutable std::condition_variable idle_cv{};
+  std::deque<std::unique_ptr<p4v1::PacketOut> > pending{};
+  std::vector<std::unique_ptr<p4v1::PacketOut> > free_list{};
+  uint64_t sent_count{0};
+  // true while a batch is being sent to the target
+  bool busy{false};
+  bool stop{false};
+  std::thread sender;
+};
+
+constexpr size_t PacketOutBatcher::max_batch_size;
+constexpr size_t PacketOutBatcher::max_pending;
+
 class DeviceState {
  public:
   struct CompareConnections {
@@ -171,7 +326,20 @@ class DeviceState {
 
   DeviceMgr *get_or_add_p4_mgr() {
     std::lock_guard<std::mutex> lock(m);
-    if (device_mgr == nullptr) device_mgr.reset(new DeviceMgr(device_id));
+    if (device_mgr == nullptr) {
+      device_mgr.reset(new DeviceMgr(device_id));
+      device_mgr->counter_cache_set_max_staleness(
+          std::chrono::milliseconds(counter_cache_max_staleness_ms.load()));
+      device_mgr->write_group_commit_configure(
+          std::chrono::microseconds(write_group_commit_window_us.load()),
+          static_cast<size_t>(write_group_commit_max_requests.load()));
+      device_mgr->table_shadow_configure(
+          table_shadow.load(),
+          std::chrono::milliseconds(table_shadow_verify_interval_ms.load()));
+      device_mgr->write_dedup_configure(
+          write_suppress_noop_modify.load(),
+          write_accept_identical_insert.load());
+    }
     return device_mgr.get();
   }
 
@@ -179,12 +347,11 @@ class DeviceState {
     std::lock_guard<std::mutex> lock(m);
     auto master = get_master();
     if (master == nullptr) return;
-    auto stream = master->stream();
     p4v1::StreamMessageResponse response;
-    response.set_allocated_packet(packet);
-    stream->Write(response);
-    response.release_packet();
-    pkt_in_count++;
+    // the write is asynchronous, so we take the contents of the packet; the
+    // caller is done with it once we return
+    response.mutable_packet()->Swap(packet);
+    if (master->write(std::move(response), true)) pkt_in_count++;
   }
 
   uint64_t get_pkt_in_count() {
@@ -192,6 +359,20 @@ class DeviceState {
     return pkt_in_count;
   }
 
+  // arena_bytes is the memory allocated by the arena of the response
+  void record_read(uint64_t arena_bytes) {
+    std::lock_guard<std::mutex> lock(m);
+    read_stats.reads++;
+    read_stats.arena_bytes += arena_bytes;
+    read_stats.max_arena_bytes =
+        std::max(read_stats.max_arena_bytes, arena_bytes);
+  }
+
+  PIGrpcServerReadStats get_read_stats() const {
+    std::lock_guard<std::mutex> lock(m);
+    return read_stats;
+  }
+
   Status add_connection(Connection *connection) {
     std::lock_guard<std::mutex> lock(m);
     if (connections.size() >= max_connections)
@@ -201,7 +382,7 @@ class DeviceState {
       return Status(StatusCode::INVALID_ARGUMENT,
                     "Election id already exists");
     }
-    SIMPLELOG << "New connection\n";
+    SERVER_LOG(INFO) << "New connection";
     auto is_master = (p.first == connections.begin());
     if (is_master)
       notify_all();
@@ -239,23 +420,36 @@ class DeviceState {
     assert(connection_it != connections.end());
     auto was_master = (connection_it == connections.begin());
     connections.erase(connection_it);
-    SIMPLELOG << "Connection removed\n";
+    SERVER_LOG(INFO) << "Connection removed";
     if (was_master) notify_all();
   }
 
+  // takes the contents of the packet, which is sent asynchronously; may block
+  // the caller if too many packets are waiting to be sent
   void process_packet_out(Connection *connection,
-                          const p4v1::PacketOut &packet_out) {
-    std::lock_guard<std::mutex> lock(m);
-    SIMPLELOG << "PACKET OUT\n";
-    if (!is_master(connection)) return;
-    if (device_mgr == nullptr) return;
-    device_mgr->packet_out_send(packet_out);
-    pkt_out_count++;
+                          p4v1::PacketOut *packet_out) {
+    PacketOutBatcher *batcher;
+    {
+      std::lock_guard<std::mutex> lock(m);
+      SERVER_LOG(TRACE) << "PACKET OUT";
+      if (!is_master(connection)) return;
+      if (device_mgr == nullptr) return;
+      if (packet_out_batcher == nullptr)
+        packet_out_batcher.reset(new PacketOutBatcher(device_mgr.get()));
+      batcher = packet_out_batcher.get();
+    }
+    // the batcher lives as long as the DeviceState, we do not need to hold the
+    // mutex (which would block every other device operation) while waiting
+    batcher->push(packet_out);
   }
 
   uint64_t get_pkt_out_count() {
-    std::lock_guard<std::mutex> lock(m);
-    return pkt_out_count;
+    PacketOutBatcher *batcher;
+    {
+      std::lock_guard<std::mutex> lock(m);
+      batcher = packet_out_batcher.get();
+    }
+    return (batcher == nullptr) ? 0 : batcher->get_sent_count();
   }
 
   bool is_master(const Uint128 &election_id) const {
@@ -280,7 +474,6 @@ class DeviceState {
 
   void notify_one(const Connection *connection) const {
     auto is_master = (connection == *connections.begin());
-    auto stream = connection->stream();
     p4v1::StreamMessageResponse response;
     auto arbitration = response.mutable_arbitration();
     arbitration->set_device_id(device_id);
@@ -299,7 +492,7 @@ class DeviceState {
       status->set_code(::google::rpc::Code::ALREADY_EXISTS);
       status->set_message("Is slave");
     }
-    stream->Write(response);
+    connection->write(std::move(response), false);
   }
 
   void notify_all() const {
@@ -308,8 +501,10 @@ class DeviceState {
 
   mutable std::mutex m{};
   uint64_t pkt_in_count{0};
-  uint64_t pkt_out_count{0};
+  PIGrpcServerReadStats read_stats{0, 0, 0};
   std::unique_ptr<DeviceMgr> device_mgr{nullptr};
+  // declared after device_mgr so that it is destroyed first
+  std::unique_ptr<PacketOutBatcher> packet_out_batcher{nullptr};
   std::set<Connection *, CompareConnections> connections{};
   DeviceMgr::device_id_t device_id;
 };
@@ -348,170 +543,446 @@ class Devices {
 void packet_in_cb(DeviceMgr::device_id_t device_id, p4v1::PacketIn *packet,
                   void *cookie);
 
-class P4RuntimeServiceImpl : public p4v1::P4Runtime::Service {
+Uint128 convert_u128(const p4v1::Uint128 &from) {
+  return Uint128(from.high(), from.low());
+}
+
+// the text of Write and Read requests can be huge, so we only log a sample
+LogSampler write_log_sampler;
+LogSampler read_log_sampler;
+
+// Base class for the Write, Read and {Set,Get}ForwardingPipelineConfig RPCs,
+// which all consist of a single request followed by a single response. An
+// instance waits for one incoming call; when the call arrives, a new instance
+// is created to wait for the next one and the call is handled by the polling
+// thread which received it. The instance deletes itself once the response has
+// been sent.
+template <typename Derived, typename RequestT, typename ResponderT>
+class UnaryCall : public Tag {
+ public:
+  void proceed(bool ok) override {
+    // ok is false if the server is shutting down (no call was received) or if
+    // the response could not be sent
+    if (!ok || handled) {
+      delete this;
+      return;
+    }
+    Derived::create(service, cq);
+    handled = true;
+    static_cast<Derived *>(this)->handle();
+  }
+
+ protected:
+  UnaryCall(AsyncService *service, grpc::ServerCompletionQueue *cq)
+      : service(service), cq(cq), responder(&context) { }
+
+  AsyncService *service;
+  grpc::ServerCompletionQueue *cq;
+  ServerContext context{};
+  RequestT request{};
+  ResponderT responder;
+  bool handled{false};
+};
+
+class WriteCall : public UnaryCall<
+  WriteCall, p4v1::WriteRequest,
+  grpc::ServerAsyncResponseWriter<p4v1::WriteResponse> > {
+ public:
+  static void create(AsyncService *service, grpc::ServerCompletionQueue *cq) {
+    auto call = new WriteCall(service, cq);
+    service->RequestWrite(&call->context, &call->request, &call->responder,
+                          cq, cq, call);
+  }
+
+  void handle() {
+    SERVER_LOG(DEBUG) << "P4Runtime Write";
+    SERVER_LOG_SAMPLED(TRACE, write_log_sampler) << request.DebugString();
+    responder.Finish(response, process(), this);
+  }
+
  private:
-  Status Write(ServerContext *context,
-               const p4v1::WriteRequest *request,
-               p4v1::WriteResponse *rep) override {
-    SIMPLELOG << "P4Runtime Write\n";
-    SIMPLELOG << request->DebugString();
-    (void) rep;
-    auto device = Devices::get(request->device_id());
+  WriteCall(AsyncService *service, grpc::ServerCompletionQueue *cq)
+      : UnaryCall(service, cq) { }
+
+  Status process() {
+    auto device = Devices::get(request.device_id());
     // TODO(antonin): if there are no connections, we accept all Write requests
     // with no election_id. This is very convenient for debugging, testing and
     // using grpc_cli, but may need to be changed in production.
     auto num_connections = device->connections_size();
-    if (num_connections == 0 && request->has_election_id())
+    if (num_connections == 0 && request.has_election_id())
       return not_master_status();
-    auto election_id = convert_u128(request->election_id());
+    auto election_id = convert_u128(request.election_id());
     if (num_connections > 0 && !device->is_master(election_id))
       return not_master_status();
     auto device_mgr = device->get_p4_mgr();
     if (device_mgr == nullptr) return no_pipeline_config_status();
-    auto status = device_mgr->write(*request);
+    auto status = device_mgr->write(request);
     return to_grpc_status(status);
   }
 
-  Status Read(ServerContext *context,
-              const p4v1::ReadRequest *request,
-              ServerWriter<p4v1::ReadResponse> *writer) override {
-    SIMPLELOG << "P4Runtime Read\n";
-    SIMPLELOG << request->DebugString();
-    p4v1::ReadResponse response;
-    auto device_mgr = Devices::get(request->device_id())->get_p4_mgr();
-    if (device_mgr == nullptr) return no_pipeline_config_status();
-    auto status = device_mgr->read(*request, &response);
-    writer->Write(response);
-    return to_grpc_status(status);
+  p4v1::WriteResponse response{};
+};
+
+class ReadCall : public UnaryCall<
+  ReadCall, p4v1::ReadRequest, grpc::ServerAsyncWriter<p4v1::ReadResponse> > {
+ public:
+  static void create(AsyncService *service, grpc::ServerCompletionQueue *cq) {
+    auto call = new ReadCall(service, cq);
+    service->RequestRead(&call->context, &call->request, &call->responder,
+                         cq, cq, call);
+  }
+
+  void handle() {
+    SERVER_LOG(DEBUG) << "P4Runtime Read";
+    SERVER_LOG_SAMPLED(TRACE, read_log_sampler) << request.DebugString();
+    auto device = Devices::get(request.device_id());
+    auto device_mgr = device->get_p4_mgr();
+    if (device_mgr == nullptr) {
+      responder.Finish(no_pipeline_config_status(), this);
+      return;
+    }
+    // the response is owned by the call, as it needs to outlive the write
+    arena.reset(new google::protobuf::Arena(
+        DeviceMgr::large_message_arena_options()));
+    response =
+        google::protobuf::Arena::CreateMessage<p4v1::ReadResponse>(arena.get());
+    auto status = device_mgr->read(request, response);
+    auto arena_bytes = arena->SpaceAllocated();
+    device->record_read(arena_bytes);
+    SERVER_LOG(DEBUG) << "Read response arena: " << arena_bytes
+                      << " bytes allocated";
+    responder.WriteAndFinish(*response, grpc::WriteOptions(),
+                             to_grpc_status(status), this);
+  }
+
+ private:
+  ReadCall(AsyncService *service, grpc::ServerCompletionQueue *cq)
+      : UnaryCall(service, cq) { }
+
+  std::unique_ptr<google::protobuf::Arena> arena{nullptr};
+  p4v1::ReadResponse *response{nullptr};
+};
+
+class SetForwardingPipelineConfigCall : public UnaryCall<
+  SetForwardingPipelineConfigCall,
+  p4v1::SetForwardingPipelineConfigRequest,
+  grpc::ServerAsyncResponseWriter<p4v1::SetForwardingPipelineConfigResponse> > {
+ public:
+  static void create(AsyncService *service, grpc::ServerCompletionQueue *cq) {
+    auto call = new SetForwardingPipelineConfigCall(service, cq);
+    service->RequestSetForwardingPipelineConfig(
+        &call->context, &call->request, &call->responder, cq, cq, call);
+  }
+
+  void handle() {
+    SERVER_LOG(DEBUG) << "P4Runtime SetForwardingPipelineConfig";
+    responder.Finish(response, process(), this);
   }
 
-  Status SetForwardingPipelineConfig(
-      ServerContext *context,
-      const p4v1::SetForwardingPipelineConfigRequest *request,
-      p4v1::SetForwardingPipelineConfigResponse *rep) override {
-    SIMPLELOG << "P4Runtime SetForwardingPipelineConfig\n";
-    (void) rep;
-    auto device = Devices::get(request->device_id());
+ private:
+  SetForwardingPipelineConfigCall(AsyncService *service,
+                                  grpc::ServerCompletionQueue *cq)
+      : UnaryCall(service, cq) { }
+
+  Status process() {
+    auto device = Devices::get(request.device_id());
     // TODO(antonin): if there are no connections, we accept all requests with
     // no election_id. This is very convenient for debugging, testing and
     // using grpc_cli, but may need to be changed in production.
     auto num_connections = device->connections_size();
-    if (num_connections == 0 && request->has_election_id())
+    if (num_connections == 0 && request.has_election_id())
       return not_master_status();
-    auto election_id = convert_u128(request->election_id());
+    auto election_id = convert_u128(request.election_id());
     if (num_connections > 0 && !device->is_master(election_id))
       return not_master_status();
     auto device_mgr = device->get_or_add_p4_mgr();
     auto status = device_mgr->pipeline_config_set(
-        request->action(), request->config());
+        request.action(), request.config());
     device_mgr->packet_in_register_cb(packet_in_cb, NULL);
     // TODO(antonin): multi-device support
     return to_grpc_status(status);
   }
 
-  Status GetForwardingPipelineConfig(
-      ServerContext *context,
-      const p4v1::GetForwardingPipelineConfigRequest *request,
-      p4v1::GetForwardingPipelineConfigResponse *rep) override {
-    SIMPLELOG << "P4Runtime GetForwardingPipelineConfig\n";
-    auto device_mgr = Devices::get(request->device_id())->get_p4_mgr();
+  p4v1::SetForwardingPipelineConfigResponse response{};
+};
+
+class GetForwardingPipelineConfigCall : public UnaryCall<
+  GetForwardingPipelineConfigCall,
+  p4v1::GetForwardingPipelineConfigRequest,
+  grpc::ServerAsyncResponseWriter<p4v1::GetForwardingPipelineConfigResponse> > {
+ public:
+  static void create(AsyncService *service, grpc::ServerCompletionQueue *cq) {
+    auto call = new GetForwardingPipelineConfigCall(service, cq);
+    service->RequestGetForwardingPipelineConfig(
+        &call->context, &call->request, &call->responder, cq, cq, call);
+  }
+
+  void handle() {
+    SERVER_LOG(DEBUG) << "P4Runtime GetForwardingPipelineConfig";
+    responder.Finish(response, process(), this);
+  }
+
+ private:
+  GetForwardingPipelineConfigCall(AsyncService *service,
+                                  grpc::ServerCompletionQueue *cq)
+      : UnaryCall(service, cq) { }
+
+  Status process() {
+    auto device_mgr = Devices::get(request.device_id())->get_p4_mgr();
     if (device_mgr == nullptr) return no_pipeline_config_status();
-    auto status = device_mgr->pipeline_config_get(rep->mutable_config());
+    auto status = device_mgr->pipeline_config_get(response.mutable_config());
     return to_grpc_status(status);
   }
 
-  Status StreamChannel(ServerContext *context,
-                       StreamChannelReaderWriter *stream) override {
-    struct ConnectionStatus {
-      explicit ConnectionStatus(ServerContext *context)
-          : context(context)  { }
-      ~ConnectionStatus() {
-        if (connection != nullptr)
-          Devices::get(device_id)->cleanup_connection(connection.get());
+  p4v1::GetForwardingPipelineConfigResponse response{};
+};
+
+// StreamChannel calls are served from their own completion queue, so that
+// packet I/O cannot starve the other RPCs. Messages from the client are
+// processed one at a time by the polling thread. Messages to the client
+// (arbitration updates, packet-ins) can be sent from any thread; they are
+// queued and written one at a time, as only one write can be pending on the
+// stream at any given time.
+class StreamChannelCall {
+ public:
+  // packet-ins are dropped when that many messages are waiting to be written
+  // to a client which is not reading fast enough
+  static constexpr size_t max_pending_writes = 1024;
+
+  static void create(AsyncService *service, grpc::ServerCompletionQueue *cq) {
+    auto call = new StreamChannelCall(service, cq);
+    service->RequestStreamChannel(&call->context, &call->stream, cq, cq,
+                                  &call->accept_tag);
+  }
+
+  bool write(p4v1::StreamMessageResponse &&response, bool droppable) {
+    std::lock_guard<std::mutex> lock(m);
+    if (closing || write_failed) return false;
+    if (droppable && pending_writes.size() >= max_pending_writes) return false;
+    pending_writes.push_back(std::move(response));
+    if (!write_in_flight) {
+      write_in_flight = true;
+      stream.Write(pending_writes.front(), &write_tag);
+    }
+    return true;
+  }
+
+ private:
+  StreamChannelCall(AsyncService *service, grpc::ServerCompletionQueue *cq)
+      : service(service), cq(cq), stream(&context) { }
+
+  void on_accept(bool ok) {
+    // server is shutting down
+    if (!ok) {
+      delete this;
+      return;
+    }
+    create(service, cq);
+    stream.Read(&request, &read_tag);
+  }
+
+  void on_read(bool ok) {
+    // client closed its end of the stream, or the call was cancelled
+    if (!ok) {
+      finish(Status::OK);
+      return;
+    }
+    auto status = process_request();
+    if (!status.ok()) {
+      finish(status);
+      return;
+    }
+    stream.Read(&request, &read_tag);
+  }
+
+  void on_write(bool ok) {
+    bool finish_now = false;
+    {
+      std::lock_guard<std::mutex> lock(m);
+      pending_writes.pop_front();
+      if (!ok) {
+        // the stream is broken, the pending read will fail as well
+        write_failed = true;
+        pending_writes.clear();
       }
+      if (pending_writes.empty()) {
+        write_in_flight = false;
+        finish_now = closing;
+      } else {
+        stream.Write(pending_writes.front(), &write_tag);
+      }
+    }
+    // the call may be deleted as soon as Finish is issued, so we need to
+    // release the mutex first
+    if (finish_now) stream.Finish(finish_status, &finish_tag);
+  }
 
-      ServerContext *context;
-      std::unique_ptr<Connection> connection{nullptr};
-      DeviceMgr::device_id_t device_id{0};
-    };
-    ConnectionStatus connection_status(context);
-
-    p4v1::StreamMessageRequest request;
-    while (stream->Read(&request)) {
-      switch (request.update_case()) {
-        case p4v1::StreamMessageRequest::kArbitration:
-          {
-            auto device_id = request.arbitration().device_id();
-            auto election_id = convert_u128(
-                request.arbitration().election_id());
-            // TODO(antonin): a lot of existing code will break if 0 is not
-            // valid anymore
-            // if (election_id == 0) {
-            //   return Status(StatusCode::INVALID_ARGUMENT,
-            //                 "Invalid election id value");
-            // }
-            auto connection = connection_status.connection.get();
-            if (connection != nullptr &&
-                connection_status.device_id != device_id) {
-              return Status(StatusCode::FAILED_PRECONDITION,
-                            "Invalid device id");
-            }
-            if (connection == nullptr) {
-              connection_status.connection = Connection::make(
-                  election_id, stream, context);
-              auto status = Devices::get(device_id)->add_connection(
-                  connection_status.connection.get());
-              if (!status.ok()) {
-                connection_status.connection.release();
-                return status;
-              }
-              connection_status.device_id = device_id;
-            } else {
-              auto status = Devices::get(device_id)->update_connection(
-                  connection_status.connection.get(), election_id);
-              if (!status.ok()) return status;
-            }
+  void on_finish(bool ok) {
+    (void) ok;
+    delete this;
+  }
+
+  // Removes the connection from the device, then finishes the call once all
+  // queued messages have been written.
+  void finish(const Status &status) {
+    if (connection != nullptr)
+      Devices::get(device_id)->cleanup_connection(connection.get());
+    bool finish_now = false;
+    {
+      std::lock_guard<std::mutex> lock(m);
+      closing = true;
+      finish_status = status;
+      finish_now = !write_in_flight;
+    }
+    if (finish_now) stream.Finish(finish_status, &finish_tag);
+  }
+
+  Status process_request() {
+    switch (request.update_case()) {
+      case p4v1::StreamMessageRequest::kArbitration:
+        {
+          auto device_id = request.arbitration().device_id();
+          auto election_id = convert_u128(request.arbitration().election_id());
+          // TODO(antonin): a lot of existing code will break if 0 is not
+          // valid anymore
+          // if (election_id == 0) {
+          //   return Status(StatusCode::INVALID_ARGUMENT,
+          //                 "Invalid election id value");
+          // }
+          if (connection != nullptr && this->device_id != device_id) {
+            return Status(StatusCode::FAILED_PRECONDITION,
+                          "Invalid device id");
           }
-          break;
-        case p4v1::StreamMessageRequest::kPacket:
-          {
-            if (connection_status.connection == nullptr) break;
-            auto device_id = connection_status.device_id;
-            Devices::get(device_id)->process_packet_out(
-                connection_status.connection.get(), request.packet());
+          if (connection == nullptr) {
+            connection = Connection::make(election_id, this);
+            auto status = Devices::get(device_id)->add_connection(
+                connection.get());
+            if (!status.ok()) {
+              // connection was not added, so there is nothing to clean up
+              connection.reset();
+              return status;
+            }
+            this->device_id = device_id;
+          } else {
+            auto status = Devices::get(device_id)->update_connection(
+                connection.get(), election_id);
+            if (!status.ok()) return status;
           }
-          break;
-        case p4v1::StreamMessageRequest::kDigestAck:
-          // DigestAck not supported, and not expected either since we do not
-          // support generating DigestList notifications yet.
-          SIMPLELOG << "DigestAck not supported yet\n";
-          break;
-        default:
-          break;
-      }
+        }
+        break;
+      case p4v1::StreamMessageRequest::kPacket:
+        {
+          if (connection == nullptr) break;
+          Devices::get(device_id)->process_packet_out(
+              connection.get(), request.mutable_packet());
+        }
+        break;
+      case p4v1::StreamMessageRequest::kDigestAck:
+        // DigestAck not supported, and not expected either since we do not
+        // support generating DigestList notifications yet.
+        SERVER_LOG(WARN) << "DigestAck not supported yet";
+        break;
+      default:
+        break;
     }
     return Status::OK;
   }
 
-  static Uint128 convert_u128(const p4v1::Uint128 &from) {
-    return Uint128(from.high(), from.low());
-  }
+  AsyncService *service;
+  grpc::ServerCompletionQueue *cq;
+  ServerContext context{};
+  StreamChannelReaderWriter stream;
+  p4v1::StreamMessageRequest request{};
+  std::unique_ptr<Connection> connection{nullptr};
+  DeviceMgr::device_id_t device_id{0};
+
+  MemberTag<StreamChannelCall> accept_tag{this, &StreamChannelCall::on_accept};
+  MemberTag<StreamChannelCall> read_tag{this, &StreamChannelCall::on_read};
+  MemberTag<StreamChannelCall> write_tag{this, &StreamChannelCall::on_write};
+  MemberTag<StreamChannelCall> finish_tag{this, &StreamChannelCall::on_finish};
+
+  // protects the write queue, which is accessed by any thread sending a
+  // message to the client
+  std::mutex m{};
+  std::deque<p4v1::StreamMessageResponse> pending_writes{};
+  bool write_in_flight{false};
+  bool write_failed{false};
+  bool closing{false};
+  Status finish_status{};
 };
 
+constexpr size_t StreamChannelCall::max_pending_writes;
+
+bool
+Connection::write(p4v1::StreamMessageResponse &&response,
+                  bool droppable) const {
+  return call_->write(std::move(response), droppable);
+}
+
 void packet_in_cb(DeviceMgr::device_id_t device_id, p4v1::PacketIn *packet,
                   void *cookie) {
   (void) cookie;
-  SIMPLELOG << "PACKET IN\n";
+  SERVER_LOG(TRACE) << "PACKET IN";
   Devices::get(device_id)->send_packet_in(packet);
 }
 
+void poll_cq(grpc::ServerCompletionQueue *cq) {
+  void *tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) static_cast<Tag *>(tag)->proceed(ok);
+}
+
 struct ServerData {
+  ~ServerData() {
+    if (polling) {
+      server->Shutdown();
+      stop_polling();
+    }
+  }
+
+  // Posts the initial calls on each completion queue and starts the polling
+  // threads.
+  void start_polling(const PIGrpcServerConfig &config) {
+    auto num_unary_threads = std::max(config.num_threads_per_unary_cq, 1);
+    auto num_stream_threads = std::max(config.num_stream_threads, 1);
+    for (auto &cq : unary_cqs) {
+      for (int i = 0; i < num_unary_threads; i++) {
+        WriteCall::create(&pi_service, cq.get());
+        ReadCall::create(&pi_service, cq.get());
+        SetForwardingPipelineConfigCall::create(&pi_service, cq.get());
+        GetForwardingPipelineConfigCall::create(&pi_service, cq.get());
+        threads.emplace_back(poll_cq, cq.get());
+      }
+    }
+    for (int i = 0; i < num_stream_threads; i++) {
+      StreamChannelCall::create(&pi_service, stream_cq.get());
+      threads.emplace_back(poll_cq, stream_cq.get());
+    }
+    polling = true;
+  }
+
+  // Must be called after the server has been shutdown; pending calls are
+  // drained before the polling threads exit.
+  void stop_polling() {
+    for (auto &cq : unary_cqs) cq->Shutdown();
+    stream_cq->Shutdown();
+    for (auto &thread : threads) thread.join();
+    threads.clear();
+    polling = false;
+  }
+
   std::string server_address;
   int server_port;
-  P4RuntimeServiceImpl pi_service;
+  AsyncService pi_service;
   std::unique_ptr<gnmi::gNMI::Service> gnmi_service;
   ServerBuilder builder;
+  // the completion queues need to outlive the server
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue> > unary_cqs;
+  std::unique_ptr<grpc::ServerCompletionQueue> stream_cq;
   std::unique_ptr<Server> server;
+  std::vector<std::thread> threads;
+  bool polling{false};
 };
 
 }  // namespace
@@ -536,9 +1007,39 @@ pi::server::ServerData *server_data;
 
 }  // namespace
 
+namespace pi {
+
+namespace server {
+
+namespace testing {
+
+size_t num_polling_threads() { return server_data->threads.size(); }
+
+}  // namespace testing
+
+}  // namespace server
+
+}  // namespace pi
+
 extern "C" {
 
-void PIGrpcServerRunAddr(const char *server_address) {
+void PIGrpcServerConfigInit(PIGrpcServerConfig *config) {
+  config->num_unary_cqs = 1;
+  config->num_threads_per_unary_cq = 4;
+  config->num_stream_threads = 1;
+  config->max_concurrent_rpcs = 0;
+  config->gnmi_session_pool_size = 4;
+  config->counter_cache_max_staleness_ms = 0;
+  config->write_group_commit_window_us = 0;
+  config->write_group_commit_max_requests = 0;
+  config->table_shadow = 0;
+  config->table_shadow_verify_interval_ms = 0;
+  config->write_suppress_noop_modify = 0;
+  config->write_accept_identical_insert = 0;
+}
+
+void PIGrpcServerRunAddrWithConfig(const char *server_address,
+                                   const PIGrpcServerConfig *config) {
   server_data = new ::pi::server::ServerData();
   server_data->server_address = std::string(server_address);
   auto &builder = server_data->builder;
@@ -546,18 +1047,49 @@ void PIGrpcServerRunAddr(const char *server_address) {
     server_data->server_address, grpc::InsecureServerCredentials(),
     &server_data->server_port);
   builder.RegisterService(&server_data->pi_service);
+  ::pi::server::counter_cache_max_staleness_ms =
+      std::max(config->counter_cache_max_staleness_ms, 0);
+  ::pi::server::write_group_commit_window_us =
+      std::max(config->write_group_commit_window_us, 0);
+  ::pi::server::write_group_commit_max_requests =
+      std::max(config->write_group_commit_max_requests, 0);
+  ::pi::server::table_shadow = (config->table_shadow != 0);
+  ::pi::server::table_shadow_verify_interval_ms =
+      std::max(config->table_shadow_verify_interval_ms, 0);
+  ::pi::server::write_suppress_noop_modify =
+      (config->write_suppress_noop_modify != 0);
+  ::pi::server::write_accept_identical_insert =
+      (config->write_accept_identical_insert != 0);
 #ifdef WITH_SYSREPO
-  server_data->gnmi_service = ::pi::server::make_gnmi_service_sysrepo();
+  server_data->gnmi_service = ::pi::server::make_gnmi_service_sysrepo(
+      std::max(config->gnmi_session_pool_size, 0));
 #else
   server_data->gnmi_service = ::pi::server::make_gnmi_service_dummy();
 #endif  // WITH_SYSREPO
   builder.RegisterService(server_data->gnmi_service.get());
   builder.SetMaxReceiveMessageSize(256*1024*1024);  // 256MB
+  if (config->max_concurrent_rpcs > 0) {
+    builder.AddChannelArgument(GRPC_ARG_MAX_CONCURRENT_STREAMS,
+                               config->max_concurrent_rpcs);
+  }
+
+  auto num_unary_cqs = std::max(config->num_unary_cqs, 1);
+  for (int i = 0; i < num_unary_cqs; i++)
+    server_data->unary_cqs.push_back(builder.AddCompletionQueue());
+  server_data->stream_cq = builder.AddCompletionQueue();
 
   server_data->server = builder.BuildAndStart();
+  if (server_data->server != nullptr)
+    server_data->start_polling(*config);
   std::cout << "Server listening on " << server_data->server_address << "\n";
 }
 
+void PIGrpcServerRunAddr(const char *server_address) {
+  PIGrpcServerConfig config;
+  PIGrpcServerConfigInit(&config);
+  PIGrpcServerRunAddrWithConfig(server_address, &config);
+}
+
 void PIGrpcServerRun() {
   PIGrpcServerRunAddr("0.0.0.0:50051");
 }
@@ -566,6 +1098,10 @@ int PIGrpcServerGetPort() {
   return server_data->server_port;
 }
 
+void PIGrpcServerSetRequestLogSampling(uint32_t one_in_n) {
+  ::pi::server::LogSampler::set_rate(one_in_n);
+}
+
 uint64_t PIGrpcServerGetPacketInCount(uint64_t device_id) {
   if (::pi::server::Devices::has_device(device_id)) {
     return ::pi::server::Devices::get(device_id)->get_pkt_in_count();
@@ -580,18 +1116,49 @@ uint64_t PIGrpcServerGetPacketOutCount(uint64_t device_id) {
   return 0;
 }
 
+void PIGrpcServerGetCounterCacheStats(uint64_t device_id,
+                                      PIGrpcServerCounterCacheStats *stats) {
+  *stats = {0, 0};
+  if (!::pi::server::Devices::has_device(device_id)) return;
+  auto device_mgr = ::pi::server::Devices::get(device_id)->get_p4_mgr();
+  if (device_mgr == nullptr) return;
+  auto device_stats = device_mgr->counter_cache_get_stats();
+  stats->hits = device_stats.hits;
+  stats->misses = device_stats.misses;
+}
+
+void PIGrpcServerGetReadStats(uint64_t device_id,
+                              PIGrpcServerReadStats *stats) {
+  *stats = {0, 0, 0};
+  if (!::pi::server::Devices::has_device(device_id)) return;
+  *stats = ::pi::server::Devices::get(device_id)->get_read_stats();
+}
+
+void PIGrpcServerGetWriteDedupStats(uint64_t device_id, uint32_t table_id,
+                                    PIGrpcServerWriteDedupStats *stats) {
+  *stats = {0, 0};
+  if (!::pi::server::Devices::has_device(device_id)) return;
+  auto device_mgr = ::pi::server::Devices::get(device_id)->get_p4_mgr();
+  if (device_mgr == nullptr) return;
+  auto table_stats = device_mgr->write_dedup_get_stats(table_id);
+  stats->modify_suppressed = table_stats.modify_suppressed;
+  stats->insert_suppressed = table_stats.insert_suppressed;
+}
+
 void PIGrpcServerWait() {
   server_data->server->Wait();
 }
 
 void PIGrpcServerShutdown() {
   server_data->server->Shutdown();
+  server_data->stop_polling();
 }
 
 void PIGrpcServerForceShutdown(int deadline_seconds) {
   using clock = std::chrono::system_clock;
   auto deadline = clock::now() + std::chrono::seconds(deadline_seconds);
   server_data->server->Shutdown(deadline);
+  server_data->stop_polling();
 }
 
 void PIGrpcServerCleanup() {
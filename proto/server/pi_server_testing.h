@@ -44,6 +44,9 @@ void send_packet_in(::pi::fe::proto::DeviceMgr::device_id_t device_id,
 
 size_t max_connections();
 
+// number of threads polling the completion queues of the running server
+size_t num_polling_threads();
+
 }  // namespace testing
 
 }  // namespace server
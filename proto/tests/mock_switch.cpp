@@ -25,7 +25,8 @@
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
 
-#include <algorithm>  // std::copy
+#include <algorithm>  // std::copy, std::sort
+#include <atomic>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -47,6 +48,7 @@ namespace {
 
 using ::testing::_;
 using ::testing::Invoke;
+using ::testing::Return;
 
 class DummyMatchKey {
   friend struct DummyMatchKeyHash;
@@ -312,6 +314,31 @@ class DummyTable {
     return PI_STATUS_SUCCESS;
   }
 
+  pi_status_t entry_delete(pi_entry_handle_t entry_handle) {
+    if (entries.erase(entry_handle) == 0) return PI_STATUS_TARGET_ERROR;
+    for (auto it = key_to_handle.begin(); it != key_to_handle.end(); ++it) {
+      if (it->second == entry_handle) {
+        key_to_handle.erase(it);
+        break;
+      }
+    }
+    return PI_STATUS_SUCCESS;
+  }
+
+  pi_status_t entries_clear() {
+    entries.clear();
+    key_to_handle.clear();
+    return PI_STATUS_SUCCESS;
+  }
+
+  pi_status_t entry_modify(pi_entry_handle_t entry_handle,
+                           const pi_table_entry_t *table_entry) {
+    auto it = entries.find(entry_handle);
+    if (it == entries.end()) return PI_STATUS_TARGET_ERROR;
+    it->second.entry = DummyTableEntry(table_entry);
+    return PI_STATUS_SUCCESS;
+  }
+
   pi_status_t entries_fetch(pi_table_fetch_res_t *res) {
     res->num_entries = entries.size();
     // TODO(antonin): it does not make much sense to me anymore for it to be the
@@ -320,17 +347,50 @@ class DummyTable {
     char *buf = new char[16384];  // should be large enough for testing
     char *buf_ptr = buf;
     for (const auto &p : entries) {
-      buf_ptr += emit_entry_handle(buf_ptr, p.first);
       res->mkey_nbytes = p.second.mk.nbytes();
-      buf_ptr += p.second.mk.emit(buf_ptr);
-      buf_ptr += p.second.entry.emit(buf_ptr);
-      buf_ptr += emit_direct_configs(buf_ptr, p.first);
+      buf_ptr += emit_entry(buf_ptr, p.first, p.second);
     }
     res->entries = buf;
     res->entries_size = std::distance(buf, buf_ptr);
     return PI_STATUS_SUCCESS;
   }
 
+  // Entry handles are allocated in increasing order, so we use the next handle
+  // to emit as the cursor. A non-zero max_chunk_size lets tests force the
+  // target to produce smaller chunks than requested.
+  pi_status_t entries_fetch_chunk(pi_table_fetch_res_t *res,
+                                  size_t max_chunk_size) {
+    size_t chunk_size = res->chunk_size;
+    if (max_chunk_size > 0 && max_chunk_size < chunk_size)
+      chunk_size = max_chunk_size;
+    std::vector<pi_entry_handle_t> handles;
+    for (const auto &p : entries)
+      if (p.first >= res->cursor) handles.push_back(p.first);
+    std::sort(handles.begin(), handles.end());
+    if (handles.size() > chunk_size)
+      handles.resize(chunk_size);
+    else
+      res->done = true;
+
+    res->num_entries = handles.size();
+    res->mkey_nbytes = 0;
+    char *buf = new char[16384];  // should be large enough for testing
+    char *buf_ptr = buf;
+    for (auto h : handles) {
+      const auto &entry = entries.at(h);
+      res->mkey_nbytes = entry.mk.nbytes();
+      buf_ptr += emit_entry(buf_ptr, h, entry);
+    }
+    res->entries = buf;
+    res->entries_size = std::distance(buf, buf_ptr);
+    if (!handles.empty()) res->cursor = handles.back() + 1;
+    return PI_STATUS_SUCCESS;
+  }
+
+  size_t num_entries() const {
+    return entries.size();
+  }
+
  private:
   bool has_ternary_match() const {
     size_t num_mfs = pi_p4info_table_num_match_fields(p4info, table_id);
@@ -343,6 +403,15 @@ class DummyTable {
     return false;
   }
 
+  size_t emit_entry(char *dst, pi_entry_handle_t h, const Entry &entry) const {
+    size_t s = 0;
+    s += emit_entry_handle(dst, h);
+    s += entry.mk.emit(dst + s);
+    s += entry.entry.emit(dst + s);
+    s += emit_direct_configs(dst + s, h);
+    return s;
+  }
+
   template <typename T, typename It>
   size_t emit_direct_resources_one_type(char *dst, pi_entry_handle_t h,
                                         const It first, const It last) const {
@@ -432,6 +501,12 @@ class DummyActionProf {
     return (count == 0) ? PI_STATUS_TARGET_ERROR : PI_STATUS_SUCCESS;
   }
 
+  pi_status_t clear() {
+    members.clear();
+    groups.clear();
+    return PI_STATUS_SUCCESS;
+  }
+
   pi_status_t entries_fetch(pi_act_prof_fetch_res_t *res) {
     res->num_members = members.size();
     res->num_groups = groups.size();
@@ -602,11 +677,41 @@ class DummySwitch {
     return get_table(table_id).entry_modify_wkey(match_key, table_entry);
   }
 
+  pi_status_t table_entry_delete(pi_p4_id_t table_id,
+                                 pi_entry_handle_t entry_handle) {
+    return get_table(table_id).entry_delete(entry_handle);
+  }
+
+  pi_status_t table_entry_modify(pi_p4_id_t table_id,
+                                 pi_entry_handle_t entry_handle,
+                                 const pi_table_entry_t *table_entry) {
+    return get_table(table_id).entry_modify(entry_handle, table_entry);
+  }
+
+  pi_status_t table_entries_clear(pi_p4_id_t table_id) {
+    return get_table(table_id).entries_clear();
+  }
+
   pi_status_t table_entries_fetch(pi_p4_id_t table_id,
                                   pi_table_fetch_res_t *res) {
     return get_table(table_id).entries_fetch(res);
   }
 
+  pi_status_t table_entries_fetch_chunk(pi_p4_id_t table_id,
+                                        pi_table_fetch_res_t *res) {
+    return get_table(table_id).entries_fetch_chunk(res, max_fetch_chunk_size);
+  }
+
+  pi_status_t table_get_num_entries(pi_p4_id_t table_id,
+                                    size_t *num_entries) {
+    *num_entries = get_table(table_id).num_entries();
+    return PI_STATUS_SUCCESS;
+  }
+
+  void set_max_fetch_chunk_size(size_t max_chunk_size) {
+    max_fetch_chunk_size = max_chunk_size;
+  }
+
   pi_status_t action_prof_member_create(pi_p4_id_t act_prof_id,
                                         const pi_action_data_t *action_data,
                                         pi_indirect_handle_t *mbr_handle) {
@@ -654,6 +759,10 @@ class DummySwitch {
     return action_profs[act_prof_id].entries_fetch(res);
   }
 
+  pi_status_t action_prof_clear(pi_p4_id_t act_prof_id) {
+    return action_profs[act_prof_id].clear();
+  }
+
   pi_status_t meter_read(pi_p4_id_t meter_id, size_t index,
                          pi_meter_spec_t *meter_spec) {
     return meters[meter_id].read(index, meter_spec);
@@ -786,6 +895,7 @@ class DummySwitch {
   std::unordered_map<pi_p4_id_t, DummyCounter> counters{};
   DummyPRE pre{};
   device_id_t device_id;
+  size_t max_fetch_chunk_size{0};
 };
 
 DummySwitchMock::DummySwitchMock(device_id_t device_id)
@@ -809,8 +919,19 @@ DummySwitchMock::DummySwitchMock(device_id_t device_id)
       .WillByDefault(Invoke(sw_, &DummySwitch::table_entry_delete_wkey));
   ON_CALL(*this, table_entry_modify_wkey(_, _, _))
       .WillByDefault(Invoke(sw_, &DummySwitch::table_entry_modify_wkey));
+  ON_CALL(*this, table_entry_delete(_, _))
+      .WillByDefault(Invoke(sw_, &DummySwitch::table_entry_delete));
+  ON_CALL(*this, table_entry_modify(_, _, _))
+      .WillByDefault(Invoke(sw_, &DummySwitch::table_entry_modify));
   ON_CALL(*this, table_entries_fetch(_, _))
       .WillByDefault(Invoke(sw_, &DummySwitch::table_entries_fetch));
+  ON_CALL(*this, table_entries_fetch_chunk(_, _))
+      .WillByDefault(Invoke(sw_, &DummySwitch::table_entries_fetch_chunk));
+  ON_CALL(*this, table_entry_handles_stable()).WillByDefault(Return(true));
+  ON_CALL(*this, table_get_num_entries(_, _))
+      .WillByDefault(Invoke(sw_, &DummySwitch::table_get_num_entries));
+  ON_CALL(*this, table_entries_clear(_))
+      .WillByDefault(Invoke(sw_, &DummySwitch::table_entries_clear));
 
   // cannot use DoAll to combine 2 actions here (call to real object + handle
   // capture), because the handle needs to be captured after the delegated call,
@@ -834,6 +955,8 @@ DummySwitchMock::DummySwitchMock(device_id_t device_id)
           Invoke(sw_, &DummySwitch::action_prof_group_remove_member));
   ON_CALL(*this, action_prof_entries_fetch(_, _))
       .WillByDefault(Invoke(sw_, &DummySwitch::action_prof_entries_fetch));
+  ON_CALL(*this, action_prof_clear(_))
+      .WillByDefault(Invoke(sw_, &DummySwitch::action_prof_clear));
 
   ON_CALL(*this, meter_read(_, _, _))
       .WillByDefault(Invoke(sw_, &DummySwitch::meter_read));
@@ -957,6 +1080,21 @@ DummySwitchMock::reset() {
   sw->reset();
 }
 
+void
+DummySwitchMock::set_max_fetch_chunk_size(size_t max_chunk_size) {
+  sw->set_max_fetch_chunk_size(max_chunk_size);
+}
+
+namespace {
+
+std::atomic<size_t> batch_end_count{0};
+
+}  // namespace
+
+size_t get_batch_end_count() {
+  return batch_end_count;
+}
+
 namespace {
 
 // here we implement the _pi_* methods which are needed for our tests
@@ -1000,6 +1138,7 @@ pi_status_t _pi_batch_begin(pi_session_handle_t) {
 }
 
 pi_status_t _pi_batch_end(pi_session_handle_t, bool) {
+  batch_end_count++;
   return PI_STATUS_SUCCESS;
 }
 
@@ -1045,10 +1184,11 @@ pi_status_t _pi_table_default_action_done(pi_session_handle_t,
 }
 
 pi_status_t _pi_table_entry_delete(pi_session_handle_t,
-                                   pi_dev_id_t,
-                                   pi_p4_id_t,
-                                   pi_entry_handle_t) {
-  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+                                   pi_dev_id_t dev_id,
+                                   pi_p4_id_t table_id,
+                                   pi_entry_handle_t entry_handle) {
+  return DeviceResolver::get_switch(dev_id)->table_entry_delete(
+      table_id, entry_handle);
 }
 
 pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t,
@@ -1067,10 +1207,16 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t,
 }
 
 pi_status_t _pi_table_entry_modify(pi_session_handle_t,
-                                   pi_dev_id_t, pi_p4_id_t,
-                                   pi_entry_handle_t,
-                                   const pi_table_entry_t *) {
-  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+                                   pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                   pi_entry_handle_t entry_handle,
+                                   const pi_table_entry_t *table_entry) {
+  return DeviceResolver::get_switch(dev_id)->table_entry_modify(
+      table_id, entry_handle, table_entry);
+}
+
+pi_status_t _pi_table_entries_clear(pi_session_handle_t,
+                                    pi_dev_id_t dev_id, pi_p4_id_t table_id) {
+  return DeviceResolver::get_switch(dev_id)->table_entries_clear(table_id);
 }
 
 pi_status_t _pi_table_entries_fetch(pi_session_handle_t,
@@ -1086,6 +1232,31 @@ pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t,
   return PI_STATUS_SUCCESS;
 }
 
+pi_status_t _pi_table_entries_fetch_chunk(pi_session_handle_t,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          pi_table_fetch_res_t *res) {
+  return DeviceResolver::get_switch(dev_id)->table_entries_fetch_chunk(
+      table_id, res);
+}
+
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t,
+                                        pi_table_fetch_res_t *) {
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_table_entry_handles_stable(pi_dev_id_t dev_id, bool *stable) {
+  *stable = DeviceResolver::get_switch(dev_id)->table_entry_handles_stable();
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_table_get_num_entries(pi_session_handle_t,
+                                      pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                      size_t *num_entries) {
+  return DeviceResolver::get_switch(dev_id)->table_get_num_entries(
+      table_id, num_entries);
+}
+
 pi_status_t _pi_act_prof_mbr_create(pi_session_handle_t,
                                     pi_dev_tgt_t dev_tgt,
                                     pi_p4_id_t act_prof_id,
@@ -1142,6 +1313,11 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t,
       act_prof_id, grp_handle, mbr_handle);
 }
 
+pi_status_t _pi_act_prof_clear(pi_session_handle_t,
+                               pi_dev_id_t dev_id, pi_p4_id_t act_prof_id) {
+  return DeviceResolver::get_switch(dev_id)->action_prof_clear(act_prof_id);
+}
+
 pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t,
                                        pi_dev_id_t dev_id,
                                        pi_p4_id_t act_prof_id,
@@ -1236,6 +1412,17 @@ pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
   return DeviceResolver::get_switch(dev_id)->packetout_send(pkt, size);
 }
 
+pi_status_t _pi_packetout_send_batch(pi_dev_id_t dev_id,
+                                     const char *const *pkts,
+                                     const size_t *sizes, size_t num_pkts) {
+  auto sw = DeviceResolver::get_switch(dev_id);
+  for (size_t i = 0; i < num_pkts; i++) {
+    auto status = sw->packetout_send(pkts[i], sizes[i]);
+    if (status != PI_STATUS_SUCCESS) return status;
+  }
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t _pi_mc_session_init(pi_mc_session_handle_t *) {
   return PI_STATUS_SUCCESS;
 }
@@ -86,6 +86,10 @@ class DummySwitchMock {
 
   void reset();
 
+  // caps the number of entries returned per chunk when fetching table entries;
+  // 0 (default) means no cap
+  void set_max_fetch_chunk_size(size_t max_chunk_size);
+
   MOCK_METHOD4(table_entry_add,
                pi_status_t(pi_p4_id_t, const pi_match_key_t *,
                            const pi_table_entry_t *, pi_entry_handle_t *));
@@ -99,8 +103,20 @@ class DummySwitchMock {
   MOCK_METHOD3(table_entry_modify_wkey,
                pi_status_t(pi_p4_id_t, const pi_match_key_t *,
                            const pi_table_entry_t *));
+  MOCK_METHOD2(table_entry_delete,
+               pi_status_t(pi_p4_id_t, pi_entry_handle_t));
+  MOCK_METHOD3(table_entry_modify,
+               pi_status_t(pi_p4_id_t, pi_entry_handle_t,
+                           const pi_table_entry_t *));
+  // returns true by default; tests can make it return false to emulate a
+  // target whose entry handles change when other entries are deleted
+  MOCK_METHOD0(table_entry_handles_stable, bool());
   MOCK_METHOD2(table_entries_fetch,
                pi_status_t(pi_p4_id_t, pi_table_fetch_res_t *));
+  MOCK_METHOD2(table_entries_fetch_chunk,
+               pi_status_t(pi_p4_id_t, pi_table_fetch_res_t *));
+  MOCK_METHOD2(table_get_num_entries, pi_status_t(pi_p4_id_t, size_t *));
+  MOCK_METHOD1(table_entries_clear, pi_status_t(pi_p4_id_t));
 
   MOCK_METHOD3(action_prof_member_create,
                pi_status_t(pi_p4_id_t, const pi_action_data_t *,
@@ -122,6 +138,7 @@ class DummySwitchMock {
                            pi_indirect_handle_t));
   MOCK_METHOD2(action_prof_entries_fetch,
                pi_status_t(pi_p4_id_t, pi_act_prof_fetch_res_t *));
+  MOCK_METHOD1(action_prof_clear, pi_status_t(pi_p4_id_t));
 
   MOCK_METHOD3(meter_read,
                pi_status_t(pi_p4_id_t, size_t, pi_meter_spec_t *));
@@ -233,6 +250,10 @@ class DummySwitchWrapper {
   DummySwitchMock *_sw{nullptr};
 };
 
+// number of calls to _pi_batch_end since the start of the program; sessions
+// are not tied to a device, so this is not a per-switch count
+size_t get_batch_end_count();
+
 }  // namespace testing
 }  // namespace proto
 }  // namespace pi
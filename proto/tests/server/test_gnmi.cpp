@@ -24,6 +24,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>  // for std::sort
 #include <chrono>
 #include <condition_variable>
 #include <deque>
@@ -31,6 +32,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <numeric>  // for std::accumulate
 #include <ostream>
 #include <string>
 #include <thread>
@@ -843,6 +845,77 @@ TEST_F(TestGNMISysrepo, VerifyChangesFail) {
   EXPECT_TRUE(no_more_events());
 }
 
+// sysrepo sessions are reused across RPCs: the changes of a Set which failed
+// must not be committed by a subsequent Set
+TEST_F(TestGNMISysrepo, FailedSetIsDiscarded) {
+  {
+    auto req = create_iface_req("atm");
+    req.mutable_update(1)->mutable_val()->set_string_val("iana-if-type:atm");
+    gnmi::SetResponse rep;
+    ClientContext context;
+    EXPECT_FALSE(gnmi_stub->Set(&context, req, &rep).ok());
+  }
+
+  const std::string iface_name("eth0");
+  EXPECT_TRUE(create_iface(iface_name).ok());
+  check_create_iface_events(iface_name);
+  EXPECT_TRUE(no_more_events());
+}
+
+// Not a functional test: measures the latency of gNMI Get and Set RPCs, which
+// open sysrepo sessions. Run with --gtest_also_run_disabled_tests.
+TEST_F(TestGNMISysrepo, DISABLED_GetSetLatency) {
+  using Clock = std::chrono::steady_clock;
+  using std::chrono::microseconds;
+  const std::string iface_name("eth0");
+  ASSERT_TRUE(create_iface(iface_name).ok());
+  const int iterations = 500;
+
+  auto report = [](const char *rpc, std::vector<microseconds> *latencies) {
+    std::sort(latencies->begin(), latencies->end());
+    auto total = std::accumulate(latencies->begin(), latencies->end(),
+                                 microseconds(0));
+    std::cout << rpc << ": average " << total.count() / latencies->size()
+              << "us, median " << (*latencies)[latencies->size() / 2].count()
+              << "us, p99 "
+              << (*latencies)[latencies->size() * 99 / 100].count()
+              << "us\n";
+  };
+
+  std::vector<microseconds> latencies;
+  for (int i = 0; i < iterations; i++) {
+    gnmi::SetRequest req;
+    auto *update = req.add_update();
+    GNMIPathBuilder pb(update->mutable_path());
+    pb.append("interfaces").append("interface", {{"name", iface_name}})
+        .append("config").append("mtu");
+    update->mutable_val()->set_uint_val(1000 + i);
+    gnmi::SetResponse rep;
+    ClientContext context;
+    auto start = Clock::now();
+    ASSERT_TRUE(gnmi_stub->Set(&context, req, &rep).ok());
+    latencies.push_back(
+        std::chrono::duration_cast<microseconds>(Clock::now() - start));
+  }
+  report("Set", &latencies);
+
+  latencies.clear();
+  for (int i = 0; i < iterations; i++) {
+    gnmi::GetRequest req;
+    GNMIPathBuilder pb(req.add_path());
+    pb.append("interfaces").append("interface", {{"name", iface_name}})
+        .append("config").append("mtu");
+    req.set_type(gnmi::GetRequest::ALL);
+    gnmi::GetResponse rep;
+    ClientContext context;
+    auto start = Clock::now();
+    ASSERT_TRUE(gnmi_stub->Get(&context, req, &rep).ok());
+    latencies.push_back(
+        std::chrono::duration_cast<microseconds>(Clock::now() - start));
+  }
+  report("Get", &latencies);
+}
+
 // GTest fixture for stream subscriptions (ON_CHANGE & SAMPLE)
 // We use interfaces/interface/config/mtu as the subscription path.
 class TestGNMISysrepoSubscribeStream : public TestGNMISysrepo {
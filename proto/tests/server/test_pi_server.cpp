@@ -12,15 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <grpc++/grpc++.h>
 #include <gtest/gtest.h>
 #include <PI/proto/pi_server.h>
+
+#include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include "p4/v1/p4runtime.grpc.pb.h"
+#include "pi_server_testing.h"
 
 namespace pi {
 namespace proto {
 namespace testing {
 namespace {
 
+namespace p4v1 = ::p4::v1;
+
+using grpc::ClientContext;
+using grpc::Status;
+using grpc::StatusCode;
+
 const std::string grpc_server_addr = "0.0.0.0";
 
 void StartGrpcServer(int port) {
@@ -50,6 +64,68 @@ TEST(TestPIGrpcServer, RandomPort) {
   ShutdownGrpcServer();
 }
 
+// No pipeline config is pushed, so the unary RPCs fail right away with
+// FAILED_PRECONDITION, unless they cannot be sent because of the limit on
+// concurrent RPCs.
+Status get_pipeline_config(p4v1::P4Runtime::Stub *stub,
+                           std::chrono::milliseconds timeout) {
+  p4v1::GetForwardingPipelineConfigRequest request;
+  request.set_device_id(0);
+  ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() + timeout);
+  p4v1::GetForwardingPipelineConfigResponse rep;
+  return stub->GetForwardingPipelineConfig(&context, request, &rep);
+}
+
+TEST(TestPIGrpcServer, CustomThreadingModel) {
+  PIGrpcServerConfig config;
+  PIGrpcServerConfigInit(&config);
+  config.num_unary_cqs = 2;
+  config.num_threads_per_unary_cq = 2;
+  config.num_stream_threads = 3;
+  config.max_concurrent_rpcs = 2;
+  std::string bind_addr = grpc_server_addr + ":0";
+  PIGrpcServerRunAddrWithConfig(bind_addr.c_str(), &config);
+  ASSERT_NE(PIGrpcServerGetPort(), 0);
+  EXPECT_EQ(2u * 2u + 3u, ::pi::server::testing::num_polling_threads());
+
+  auto channel = grpc::CreateChannel(
+      grpc_server_addr + ":" + std::to_string(PIGrpcServerGetPort()),
+      grpc::InsecureChannelCredentials());
+  auto stub = p4v1::P4Runtime::NewStub(channel);
+  const std::chrono::milliseconds short_timeout(500);
+  const std::chrono::milliseconds long_timeout(5000);
+  // also makes sure that the client has received the limit from the server
+  EXPECT_EQ(StatusCode::FAILED_PRECONDITION,
+            get_pipeline_config(stub.get(), long_timeout).error_code());
+
+  // the StreamChannel RPCs stay open until the client closes them, and use up
+  // all the concurrent RPCs allowed on the connection
+  using ReaderWriter = ::grpc::ClientReaderWriter<p4v1::StreamMessageRequest,
+                                                  p4v1::StreamMessageResponse>;
+  std::vector<ClientContext> contexts(config.max_concurrent_rpcs);
+  std::vector<std::unique_ptr<ReaderWriter> > streams;
+  for (auto &context : contexts)
+    streams.push_back(stub->StreamChannel(&context));
+  EXPECT_EQ(StatusCode::DEADLINE_EXCEEDED,
+            get_pipeline_config(stub.get(), short_timeout).error_code());
+
+  auto stream_teardown = [](std::unique_ptr<ReaderWriter> stream) {
+    stream->WritesDone();
+    p4v1::StreamMessageResponse response;
+    while (stream->Read(&response)) { }
+    return stream->Finish();
+  };
+  EXPECT_TRUE(stream_teardown(std::move(streams.back())).ok());
+  streams.pop_back();
+  EXPECT_EQ(StatusCode::FAILED_PRECONDITION,
+            get_pipeline_config(stub.get(), long_timeout).error_code());
+  for (auto &stream : streams)
+    EXPECT_TRUE(stream_teardown(std::move(stream)).ok());
+
+  ShutdownGrpcServer();
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace proto
@@ -27,6 +27,7 @@
 #include <google/protobuf/util/message_differencer.h>
 
 #include <atomic>
+#include <chrono>
 #include <fstream>  // std::ifstream
 #include <iterator>  // std::distance
 #include <memory>
@@ -90,6 +91,7 @@ using ::testing::AnyNumber;
 using ::testing::Args;
 using ::testing::AtLeast;
 using ::testing::ElementsAre;
+using ::testing::Return;
 
 // Used to make sure that a google::rpc::Status object has the correct format
 // and contains a single p4v1::Error message with a matching canonical error
@@ -508,7 +510,7 @@ TEST_P(MatchTableTest, AddAndRead) {
     EXPECT_EQ(status, OneExpectedError(Code::ALREADY_EXISTS));
   }
 
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(2);
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(2);
   // 2 different reads: first one is wildcard read on the table, other filters
   // on the match key.
   {
@@ -543,8 +545,10 @@ TEST_P(MatchTableTest, AddAndDelete) {
   status = add_one(&entry);
   ASSERT_EQ(status.code(), Code::OK);
 
-  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, mk_matcher))
-      .Times(AtLeast(1));
+  // the handle returned by the target is used, no key lookup is required
+  auto entry_h = mock->get_table_entry_handle();
+  EXPECT_CALL(*mock, table_entry_delete(t_id, entry_h));
+  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, _)).Times(0);
   status = remove(&entry);
   EXPECT_EQ(status.code(), Code::OK);
   // second call is error because match key has been removed already
@@ -567,10 +571,26 @@ TEST_P(MatchTableTest, AddAndModify) {
   std::string new_adata(6, '\xaa');
   auto new_entry_matcher = CorrectTableEntryDirect(a_id, new_adata);
   auto new_entry = generic_make(
-      t_id, mk_input.get_proto(mf_id), adata, mk_input.get_priority());
-  EXPECT_CALL(*mock, table_entry_modify_wkey(t_id, mk_matcher, entry_matcher));
+      t_id, mk_input.get_proto(mf_id), new_adata, mk_input.get_priority());
+  auto entry_h = mock->get_table_entry_handle();
+  EXPECT_CALL(*mock,
+              table_entry_modify(t_id, entry_h, new_entry_matcher));
+  status = modify(&new_entry);
+  EXPECT_EQ(status.code(), Code::OK);
+
+  // by default, modifying the entry again with the same action still goes to
+  // the target
+  EXPECT_CALL(*mock, table_entry_modify(t_id, entry_h, new_entry_matcher));
+  status = modify(&new_entry);
+  EXPECT_EQ(status.code(), Code::OK);
+  EXPECT_EQ(mgr.write_dedup_get_stats(t_id).modify_suppressed, 0u);
+
+  // once enabled, it is a no-op for the target
+  mgr.write_dedup_configure(true, false);
+  EXPECT_CALL(*mock, table_entry_modify(t_id, _, _)).Times(0);
   status = modify(&new_entry);
   EXPECT_EQ(status.code(), Code::OK);
+  EXPECT_EQ(mgr.write_dedup_get_stats(t_id).modify_suppressed, 1u);
 }
 
 TEST_P(MatchTableTest, SetDefault) {
@@ -706,8 +726,7 @@ TEST_P(MatchTableTest, WriteBatchWithError) {
   auto mk_input = std::get<1>(GetParam());
   auto mk_matcher = CorrectMatchKey(t_id, mk_input.get_match_key());
   auto entry_matcher = CorrectTableEntryDirect(a_id, adata);
-  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, mk_matcher))
-      .Times(AnyNumber());
+  EXPECT_CALL(*mock, table_entry_delete(t_id, _)).Times(AnyNumber());
   EXPECT_CALL(*mock, table_entry_add(t_id, mk_matcher, entry_matcher, _))
       .Times(AtLeast(1));
   auto entry = generic_make(
@@ -1007,6 +1026,58 @@ TEST_F(ActionProfTest, Read) {
       member_1, entities.Get(0).action_profile_member()));
 }
 
+TEST_F(ActionProfTest, Clear) {
+  auto act_prof_id = pi_p4info_act_prof_id_from_name(p4info, "ActProfWS");
+  uint32_t group_id = 1000;
+  uint32_t member_id = 1;
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, action_prof_member_create(act_prof_id, _, _)).Times(2);
+  auto member = make_member(member_id, adata);
+  ASSERT_EQ(create_member(&member).code(), Code::OK);
+  auto group = make_group(group_id);
+  add_member_to_group(&group, member_id);
+  EXPECT_CALL(*mock, action_prof_group_create(act_prof_id, _, _)).Times(2);
+  EXPECT_CALL(*mock, action_prof_group_add_member(act_prof_id, _, _))
+      .Times(2);
+  ASSERT_EQ(create_group(&group).code(), Code::OK);
+
+  // a single target call, no per-object delete
+  EXPECT_CALL(*mock, action_prof_clear(act_prof_id));
+  EXPECT_CALL(*mock, action_prof_group_delete(_, _)).Times(0);
+  EXPECT_CALL(*mock, action_prof_member_delete(_, _)).Times(0);
+  ASSERT_EQ(mgr.action_profile_clear(act_prof_id).code(), Code::OK);
+
+  // the ids can be used again
+  EXPECT_EQ(create_member(&member).code(), Code::OK);
+  EXPECT_EQ(create_group(&group).code(), Code::OK);
+}
+
+TEST_F(ActionProfTest, ClearFallback) {
+  auto act_prof_id = pi_p4info_act_prof_id_from_name(p4info, "ActProfWS");
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, action_prof_member_create(act_prof_id, _, _));
+  auto member = make_member(1, adata);
+  ASSERT_EQ(create_member(&member).code(), Code::OK);
+  auto mbr_h = mock->get_action_prof_handle();
+  auto group = make_group(1000);
+  add_member_to_group(&group, 1);
+  EXPECT_CALL(*mock, action_prof_group_create(act_prof_id, _, _));
+  EXPECT_CALL(*mock, action_prof_group_add_member(act_prof_id, _, mbr_h));
+  ASSERT_EQ(create_group(&group).code(), Code::OK);
+  auto grp_h = mock->get_action_prof_handle();
+
+  // groups are deleted before members
+  EXPECT_CALL(*mock, action_prof_clear(act_prof_id))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  EXPECT_CALL(*mock, action_prof_entries_fetch(act_prof_id, _));
+  {
+    ::testing::InSequence seq;
+    EXPECT_CALL(*mock, action_prof_group_delete(act_prof_id, grp_h));
+    EXPECT_CALL(*mock, action_prof_member_delete(act_prof_id, mbr_h));
+  }
+  ASSERT_EQ(mgr.action_profile_clear(act_prof_id).code(), Code::OK);
+}
+
 TEST_F(ActionProfTest, CreateDupGroupId) {
   DeviceMgr::Status status;
   auto act_prof_id = pi_p4info_act_prof_id_from_name(p4info, "ActProfWS");
@@ -1236,7 +1307,7 @@ TEST_F(MatchTableIndirectTest, Member) {
   auto status = add_indirect_entry(&entry);
   ASSERT_EQ(status.code(), Code::OK);
 
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
   p4v1::ReadResponse response;
   p4v1::Entity entity;
   auto table_entry = entity.mutable_table_entry();
@@ -1264,7 +1335,7 @@ TEST_F(MatchTableIndirectTest, Group) {
   auto status = add_indirect_entry(&entry);
   ASSERT_EQ(status.code(), Code::OK);
 
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
   p4v1::ReadResponse response;
   p4v1::Entity entity;
   auto table_entry = entity.mutable_table_entry();
@@ -1323,6 +1394,395 @@ TEST_F(ExactOneTest, PriorityForNonTernaryMatch) {
   ASSERT_EQ(status, OneExpectedError(Code::INVALID_ARGUMENT));
 }
 
+TEST_F(ExactOneTest, WriteGroupCommit) {
+  constexpr size_t num_requests = 4;
+  // the window is long enough that the group is only closed once it is full
+  mgr.write_group_commit_configure(std::chrono::seconds(10), num_requests);
+  std::string adata(6, '\x00');
+  std::vector<p4v1::TableEntry> entries;
+  for (size_t i = 0; i < num_requests - 1; i++)
+    entries.push_back(make_entry(std::string(4, static_cast<char>(i)), adata));
+  // a duplicate entry, which should only cause its own request to fail
+  entries.push_back(entries.front());
+
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_requests - 1);
+  auto batch_end_count = get_batch_end_count();
+  std::vector<DeviceMgr::Status> statuses(num_requests);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_requests; i++) {
+    threads.emplace_back([this, &entries, &statuses, i] {
+        statuses[i] = add_entry(&entries[i]); });
+  }
+  for (auto &t : threads) t.join();
+  EXPECT_EQ(batch_end_count + 1, get_batch_end_count());
+
+  EXPECT_EQ(statuses[1].code(), Code::OK);
+  EXPECT_EQ(statuses[2].code(), Code::OK);
+  // we do not know in which order the requests were applied
+  if (statuses[0].code() == Code::OK)
+    EXPECT_EQ(statuses[3], OneExpectedError(Code::ALREADY_EXISTS));
+  else
+    EXPECT_EQ(statuses[0], OneExpectedError(Code::ALREADY_EXISTS));
+}
+
+TEST_F(ExactOneTest, AcceptIdenticalInsert) {
+  mgr.write_dedup_configure(true, true);
+  auto entry = make_entry(std::string(4, '\x01'), std::string(6, '\x00'));
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  EXPECT_EQ(mgr.write_dedup_get_stats(t_id).insert_suppressed, 1u);
+
+  // a different action still triggers an error
+  entry.mutable_action()->mutable_action()->mutable_params(0)->set_value(
+      std::string(6, '\x11'));
+  EXPECT_EQ(add_entry(&entry), OneExpectedError(Code::ALREADY_EXISTS));
+}
+
+// emulates a target which identifies entries by their position in the table
+// (e.g. combo), for which deleting an entry changes the handles of the
+// following entries: the match key must be used for MODIFY and DELETE
+class ExactOneUnstableHandlesTest : public ExactOneTest {
+ protected:
+  ExactOneUnstableHandlesTest() {
+    ON_CALL(*mock, table_entry_handles_stable()).WillByDefault(Return(false));
+  }
+
+  DeviceMgr::Status write_one(p4v1::Update_Type type,
+                              const p4v1::TableEntry &entry) {
+    p4v1::WriteRequest request;
+    auto update = request.add_updates();
+    update->set_type(type);
+    update->mutable_entity()->mutable_table_entry()->CopyFrom(entry);
+    return mgr.write(request);
+  }
+};
+
+TEST_F(ExactOneUnstableHandlesTest, DeleteMiddleThenModify) {
+  std::string adata(6, '\x00');
+  std::vector<std::string> mfs;
+  std::vector<p4v1::TableEntry> entries;
+  for (char v : {'\x01', '\x02', '\x03'}) {
+    mfs.emplace_back(4, v);
+    entries.push_back(make_entry(mfs.back(), adata));
+  }
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(entries.size());
+  for (auto &entry : entries)
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+
+  EXPECT_CALL(*mock, table_entry_delete(_, _)).Times(0);
+  EXPECT_CALL(*mock, table_entry_modify(_, _, _)).Times(0);
+
+  EXPECT_CALL(*mock,
+              table_entry_delete_wkey(t_id, CorrectMatchKey(t_id, mfs[1])));
+  EXPECT_EQ(write_one(p4v1::Update_Type_DELETE, entries[1]).code(), Code::OK);
+
+  std::string new_adata(6, '\x11');
+  entries[2].mutable_action()->mutable_action()->mutable_params(0)->set_value(
+      new_adata);
+  EXPECT_CALL(*mock, table_entry_modify_wkey(
+      t_id, CorrectMatchKey(t_id, mfs[2]),
+      CorrectTableEntryDirect(a_id, new_adata)));
+  EXPECT_EQ(write_one(p4v1::Update_Type_MODIFY, entries[2]).code(), Code::OK);
+
+  EXPECT_CALL(*mock,
+              table_entry_delete_wkey(t_id, CorrectMatchKey(t_id, mfs[2])));
+  EXPECT_EQ(write_one(p4v1::Update_Type_DELETE, entries[2]).code(), Code::OK);
+}
+
+TEST_F(ExactOneUnstableHandlesTest, ClearFallback) {
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(3);
+  for (char v : {'\x01', '\x02', '\x03'}) {
+    auto entry = make_entry(std::string(4, v), adata);
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  }
+
+  EXPECT_CALL(*mock, table_entries_clear(t_id))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  EXPECT_CALL(*mock, table_entry_delete(_, _)).Times(0);
+  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, _)).Times(3);
+  ASSERT_EQ(mgr.table_clear(t_id).code(), Code::OK);
+  DeviceMgr::TableUsage usage;
+  ASSERT_EQ(mgr.table_get_usage(t_id, &usage).code(), Code::OK);
+  EXPECT_EQ(0u, usage.num_entries);
+}
+
+TEST_F(ExactOneUnstableHandlesTest, ClearFallbackReverseHandles) {
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(3);
+  for (char v : {'\x01', '\x02', '\x03'}) {
+    auto entry = make_entry(std::string(4, v), adata);
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  }
+
+  // handles in the order in which the target returns the entries
+  std::vector<pi_entry_handle_t> handles;
+  {
+    pi_session_handle_t session;
+    ASSERT_EQ(PI_STATUS_SUCCESS, pi_session_init(&session));
+    pi_table_fetch_res_t *res;
+    ASSERT_EQ(PI_STATUS_SUCCESS, pi_table_entries_fetch(
+        session, device_id, t_id, &res));
+    for (size_t i = 0; i < pi_table_entries_num(res); i++) {
+      pi_table_ma_entry_t entry;
+      pi_entry_handle_t entry_handle;
+      pi_table_entries_next(res, &entry, &entry_handle);
+      handles.push_back(entry_handle);
+    }
+    pi_table_entries_fetch_done(session, res);
+    pi_session_cleanup(session);
+  }
+  ASSERT_EQ(3u, handles.size());
+
+  // without support for deleting by key, entries are deleted by handle, last
+  // one first, so that no deletion changes the handle of a remaining entry
+  EXPECT_CALL(*mock, table_entries_clear(t_id))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, _))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  {
+    ::testing::InSequence seq;
+    for (auto it = handles.rbegin(); it != handles.rend(); ++it)
+      EXPECT_CALL(*mock, table_entry_delete(t_id, *it));
+  }
+  ASSERT_EQ(mgr.table_clear(t_id).code(), Code::OK);
+  DeviceMgr::TableUsage usage;
+  ASSERT_EQ(mgr.table_get_usage(t_id, &usage).code(), Code::OK);
+  EXPECT_EQ(0u, usage.num_entries);
+}
+
+TEST_F(ExactOneTest, ReadInChunks) {
+  constexpr size_t num_entries = 5;
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_entries);
+  for (size_t i = 0; i < num_entries; i++) {
+    auto entry = make_entry(std::string(4, static_cast<char>(i)), adata);
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  }
+
+  // the target produces chunks of 2 entries, the last one being partial
+  mock->set_max_fetch_chunk_size(2);
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(3);
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(0);
+  p4v1::ReadResponse response;
+  p4v1::Entity entity;
+  entity.mutable_table_entry()->set_table_id(t_id);
+  ASSERT_EQ(mgr.read_one(entity, &response).code(), Code::OK);
+  const auto &entities = response.entities();
+  ASSERT_EQ(num_entries, static_cast<size_t>(entities.size()));
+  for (size_t i = 0; i < num_entries; i++) {
+    EXPECT_TRUE(MessageDifferencer::Equals(
+        make_entry(std::string(4, static_cast<char>(i)), adata),
+        entities.Get(i).table_entry()));
+  }
+}
+
+TEST_F(ExactOneTest, ReadChunkFallback) {
+  auto entry = make_entry(std::string(4, '\x01'), std::string(6, '\x00'));
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+
+  // a target without chunk support is read in one go
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  p4v1::ReadResponse response;
+  p4v1::Entity entity;
+  entity.mutable_table_entry()->set_table_id(t_id);
+  ASSERT_EQ(mgr.read_one(entity, &response).code(), Code::OK);
+  const auto &entities = response.entities();
+  ASSERT_EQ(1, entities.size());
+  EXPECT_TRUE(MessageDifferencer::Equals(entry, entities.Get(0).table_entry()));
+}
+
+TEST_F(ExactOneTest, GetUsage) {
+  constexpr size_t num_entries = 3;
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_entries);
+  for (size_t i = 0; i < num_entries; i++) {
+    auto entry = make_entry(std::string(4, static_cast<char>(i)), adata);
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  }
+
+  // entries are counted by the target, not fetched
+  EXPECT_CALL(*mock, table_get_num_entries(t_id, _));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(0);
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(0);
+  DeviceMgr::TableUsage usage;
+  ASSERT_EQ(mgr.table_get_usage(t_id, &usage).code(), Code::OK);
+  EXPECT_EQ(num_entries, usage.num_entries);
+  EXPECT_EQ(pi_p4info_table_max_size(p4info, t_id), usage.max_size);
+
+  EXPECT_EQ(mgr.table_get_usage(a_id, &usage).code(), Code::INVALID_ARGUMENT);
+}
+
+TEST_F(ExactOneTest, GetUsageFallback) {
+  auto entry = make_entry(std::string(4, '\x01'), std::string(6, '\x00'));
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+
+  // a target which cannot count entries has them fetched instead
+  EXPECT_CALL(*mock, table_get_num_entries(t_id, _))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  DeviceMgr::TableUsage usage;
+  ASSERT_EQ(mgr.table_get_usage(t_id, &usage).code(), Code::OK);
+  EXPECT_EQ(1u, usage.num_entries);
+}
+
+TEST_F(ExactOneTest, Clear) {
+  constexpr size_t num_entries = 3;
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_entries + 1);
+  for (size_t i = 0; i < num_entries; i++) {
+    auto entry = make_entry(std::string(4, static_cast<char>(i)), adata);
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  }
+
+  // a single target call, no per-entry delete
+  EXPECT_CALL(*mock, table_entries_clear(t_id));
+  EXPECT_CALL(*mock, table_entry_delete(_, _)).Times(0);
+  EXPECT_CALL(*mock, table_entry_delete_wkey(_, _)).Times(0);
+  ASSERT_EQ(mgr.table_clear(t_id).code(), Code::OK);
+
+  p4v1::ReadResponse response;
+  p4v1::Entity entity;
+  entity.mutable_table_entry()->set_table_id(t_id);
+  ASSERT_EQ(mgr.read_one(entity, &response).code(), Code::OK);
+  EXPECT_EQ(0, response.entities().size());
+
+  // the match key can be used again
+  auto entry = make_entry(std::string(4, '\x00'), adata);
+  EXPECT_EQ(add_entry(&entry).code(), Code::OK);
+
+  EXPECT_EQ(mgr.table_clear(a_id).code(), Code::INVALID_ARGUMENT);
+}
+
+TEST_F(ExactOneTest, ClearFallback) {
+  constexpr size_t num_entries = 2;
+  std::string adata(6, '\x00');
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(num_entries);
+  for (size_t i = 0; i < num_entries; i++) {
+    auto entry = make_entry(std::string(4, static_cast<char>(i)), adata);
+    ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+  }
+
+  EXPECT_CALL(*mock, table_entries_clear(t_id))
+      .WillOnce(Return(PI_STATUS_NOT_IMPLEMENTED_BY_TARGET));
+  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_CALL(*mock, table_entry_delete(t_id, _)).Times(num_entries);
+  ASSERT_EQ(mgr.table_clear(t_id).code(), Code::OK);
+  DeviceMgr::TableUsage usage;
+  ASSERT_EQ(mgr.table_get_usage(t_id, &usage).code(), Code::OK);
+  EXPECT_EQ(0u, usage.num_entries);
+}
+
+TEST_F(ExactOneTest, TableShadowRead) {
+  mgr.table_shadow_configure(true, std::chrono::milliseconds(0));
+  std::string adata(6, '\x00');
+  auto entry1 = make_entry(std::string(4, '\x01'), adata);
+  auto entry2 = make_entry(std::string(4, '\x02'), adata);
+  entry2.set_controller_metadata(0xab);
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(2);
+  ASSERT_EQ(add_entry(&entry1).code(), Code::OK);
+  ASSERT_EQ(add_entry(&entry2).code(), Code::OK);
+
+  entry1.mutable_action()->mutable_action()->mutable_params(0)->set_value(
+      std::string(6, '\x11'));
+  EXPECT_CALL(*mock, table_entry_modify(t_id, _, _));
+  {
+    p4v1::WriteRequest request;
+    auto update = request.add_updates();
+    update->set_type(p4v1::Update_Type_MODIFY);
+    update->mutable_entity()->mutable_table_entry()->CopyFrom(entry1);
+    ASSERT_EQ(mgr.write(request).code(), Code::OK);
+  }
+
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(_, _)).Times(0);
+  {
+    p4v1::ReadResponse response;
+    ASSERT_EQ(read_table_entries(t_id, &response).code(), Code::OK);
+    const auto &entities = response.entities();
+    ASSERT_EQ(2, entities.size());
+    for (const auto &entity : entities) {
+      const auto &read_entry = entity.table_entry();
+      const auto &mf_v = read_entry.match(0).exact().value();
+      const auto &expected_entry =
+          (mf_v == entry1.match(0).exact().value()) ? entry1 : entry2;
+      EXPECT_TRUE(MessageDifferencer::Equals(expected_entry, read_entry));
+    }
+  }
+  {
+    p4v1::ReadResponse response;
+    auto requested_entry = entry2;
+    ASSERT_EQ(read_table_entry(&requested_entry, &response).code(), Code::OK);
+    const auto &entities = response.entities();
+    ASSERT_EQ(1, entities.size());
+    EXPECT_TRUE(
+        MessageDifferencer::Equals(entry2, entities.Get(0).table_entry()));
+  }
+}
+
+TEST_F(ExactOneTest, TableShadowVerify) {
+  mgr.table_shadow_configure(true, std::chrono::milliseconds(0));
+  std::string mf(4, '\x01');
+  auto entry = make_entry(mf, std::string(6, '\x00'));
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  ASSERT_EQ(add_entry(&entry).code(), Code::OK);
+
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(_, _)).Times(AtLeast(1));
+  EXPECT_EQ(mgr.table_shadow_verify().code(), Code::OK);
+
+  // remove the entry from the target behind the DeviceMgr's back
+  {
+    pi_session_handle_t session;
+    ASSERT_EQ(PI_STATUS_SUCCESS, pi_session_init(&session));
+    pi_dev_tgt_t dev_tgt = {static_cast<pi_dev_id_t>(device_id), 0xffff};
+    pi::MatchTable mt(session, dev_tgt, p4info, t_id);
+    pi::MatchKey match_key(p4info, t_id);
+    match_key.set_exact(entry.match(0).field_id(), mf.data(), mf.size());
+    EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, _));
+    EXPECT_EQ(PI_STATUS_SUCCESS, mt.entry_delete_wkey(match_key));
+    pi_session_cleanup(session);
+  }
+  EXPECT_EQ(mgr.table_shadow_verify().code(), Code::INTERNAL);
+
+  // the shadow was dropped for the table, so the target is read
+  {
+    p4v1::ReadResponse response;
+    ASSERT_EQ(read_table_entries(t_id, &response).code(), Code::OK);
+    EXPECT_EQ(0, response.entities().size());
+  }
+}
+
+// each table is verified atomically with respect to writes, even though the
+// lock is released between tables
+TEST_F(ExactOneTest, TableShadowVerifyConcurrentWrites) {
+  mgr.table_shadow_configure(true, std::chrono::milliseconds(0));
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(AtLeast(1));
+  EXPECT_CALL(*mock, table_entry_delete(t_id, _)).Times(AtLeast(1));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(_, _)).Times(AtLeast(1));
+  std::atomic<bool> stop{false};
+  std::atomic<int> writes{0};
+  std::thread writer([this, &stop, &writes] {
+    auto entry = make_entry(std::string(4, '\x01'), std::string(6, '\x00'));
+    p4v1::WriteRequest delete_request;
+    auto update = delete_request.add_updates();
+    update->set_type(p4v1::Update_Type_DELETE);
+    update->mutable_entity()->mutable_table_entry()->CopyFrom(entry);
+    while (!stop) {
+      EXPECT_EQ(add_entry(&entry).code(), Code::OK);
+      EXPECT_EQ(mgr.write(delete_request).code(), Code::OK);
+      writes++;
+    }
+  });
+  for (int i = 0; i < 100 || writes < 100; i++)
+    EXPECT_EQ(mgr.table_shadow_verify().code(), Code::OK);
+  stop = true;
+  writer.join();
+}
+
 
 class DirectMeterTest : public ExactOneTest {
  protected:
@@ -1409,7 +1869,7 @@ TEST_F(DirectMeterTest, WriteAndRead) {
   }
 
   // read with TableEntry
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
   {
     p4v1::ReadResponse response;
     p4v1::Entity entity;
@@ -1623,7 +2083,7 @@ TEST_F(DirectCounterTest, WriteAndRead) {
   }
 
   // read with TableEntry
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
   {
     p4v1::ReadResponse response;
     p4v1::Entity entity;
@@ -1641,6 +2101,99 @@ TEST_F(DirectCounterTest, WriteAndRead) {
   }
 }
 
+TEST_F(DirectCounterTest, ReadCached) {
+  mgr.counter_cache_set_max_staleness(std::chrono::hours(1));
+  std::string mf("\xaa\xbb\xcc\xdd", 4);
+  std::string adata(6, '\x00');
+  auto entry = make_entry(mf, adata);
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _));
+  {
+    auto status = add_entry(&entry);
+    ASSERT_EQ(status.code(), Code::OK);
+  }
+  auto entry_h = mock->get_table_entry_handle();
+
+  auto counter_entry = make_counter_entry(&entry);
+  EXPECT_CALL(*mock, counter_read_direct(c_id, entry_h, _, _)).Times(1);
+  for (int i = 0; i < 2; i++) {
+    p4v1::ReadResponse response;
+    auto status = read_counter(&counter_entry, &response);
+    ASSERT_EQ(status.code(), Code::OK);
+    ASSERT_EQ(1, response.entities().size());
+  }
+  auto stats = mgr.counter_cache_get_stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+}
+
+// cached counter reads must not observe a WriteRequest half-applied: the reader
+// either sees no entry or sees the counter value written in the same batch as
+// the entry
+TEST_F(DirectCounterTest, ReadCachedConcurrentWrites) {
+  mgr.counter_cache_set_max_staleness(std::chrono::hours(1));
+  std::string mf("\xaa\xbb\xcc\xdd", 4);
+  std::string adata(6, '\x00');
+  auto entry = make_entry(mf, adata);
+  auto counter_entry = make_counter_entry(&entry);
+  counter_entry.mutable_data()->set_packet_count(3);
+
+  auto do_write = [this, &entry, &counter_entry](size_t iters) {
+    EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(iters);
+    EXPECT_CALL(*mock, counter_write_direct(c_id, _, _)).Times(iters);
+    EXPECT_CALL(*mock, table_entry_delete(t_id, _)).Times(iters);
+
+    std::vector<p4v1::WriteRequest> requests(2);
+    {
+      auto &request = requests.at(0);
+      auto *update = request.add_updates();
+      update->set_type(p4v1::Update_Type_INSERT);
+      update->mutable_entity()->mutable_table_entry()->CopyFrom(entry);
+      update = request.add_updates();
+      update->set_type(p4v1::Update_Type_MODIFY);
+      update->mutable_entity()->mutable_direct_counter_entry()->CopyFrom(
+          counter_entry);
+    }
+    {
+      auto &request = requests.at(1);
+      auto *update = request.add_updates();
+      update->set_type(p4v1::Update_Type_DELETE);
+      update->mutable_entity()->mutable_table_entry()->CopyFrom(entry);
+    }
+
+    for (size_t i = 0; i < iters; i++) {
+      for (const auto &request : requests) {
+        auto status = mgr.write(request);
+        EXPECT_EQ(status.code(), Code::OK);
+      }
+    }
+  };
+
+  std::atomic<bool> stop{false};
+
+  auto do_read = [this, &stop, &entry]() {
+    EXPECT_CALL(*mock, counter_read_direct(c_id, _, _, _)).Times(AnyNumber());
+    auto read_entry = make_counter_entry(&entry);
+    while (!stop) {
+      p4v1::ReadResponse response;
+      auto status = read_counter(&read_entry, &response);
+      if (status.code() != Code::OK) continue;  // entry not present
+      ASSERT_EQ(1, response.entities_size());
+      ASSERT_EQ(
+          response.entities(0).direct_counter_entry().data().packet_count(),
+          3);
+    }
+  };
+
+  size_t iterations = 10000u;
+
+  std::thread t2(do_read);
+  std::thread t1(do_write, iterations);
+
+  t1.join();
+  stop = true;
+  t2.join();
+}
+
 TEST_F(DirectCounterTest, InvalidTableEntry) {
   std::string mf("\xaa\xbb\xcc\xdd", 4);
   std::string adata(6, '\x00');
@@ -1683,6 +2236,45 @@ TEST_F(DirectCounterTest, ReadAllFromTable) {
   ASSERT_EQ(status.code(), Code::UNIMPLEMENTED);
 }
 
+TEST_F(DirectCounterTest, ShadowReadAllWithCounters) {
+  mgr.table_shadow_configure(true, std::chrono::milliseconds(0));
+  std::string adata(6, '\x00');
+  auto entry1 = make_entry(std::string(4, '\x01'), adata);
+  auto entry2 = make_entry(std::string(4, '\x02'), adata);
+  EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(2);
+  ASSERT_EQ(add_entry(&entry1).code(), Code::OK);
+  ASSERT_EQ(add_entry(&entry2).code(), Code::OK);
+
+  // a wildcard read with counter data uses a single target fetch instead of
+  // one direct counter read per entry
+  EXPECT_CALL(*mock, counter_read_direct(c_id, _, _, _)).Times(0);
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(AtLeast(1));
+  {
+    p4v1::ReadResponse response;
+    p4v1::Entity entity;
+    auto table_entry = entity.mutable_table_entry();
+    table_entry->set_table_id(t_id);
+    table_entry->mutable_counter_data();
+    ASSERT_EQ(mgr.read_one(entity, &response).code(), Code::OK);
+    ASSERT_EQ(2, response.entities().size());
+    for (const auto &read_entity : response.entities())
+      EXPECT_TRUE(read_entity.table_entry().has_counter_data());
+  }
+
+  // a read by key is still served from the shadow
+  EXPECT_CALL(*mock, counter_read_direct(c_id, _, _, _));
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(0);
+  {
+    p4v1::ReadResponse response;
+    p4v1::Entity entity;
+    auto table_entry = entity.mutable_table_entry();
+    table_entry->CopyFrom(entry1);
+    table_entry->mutable_counter_data();
+    ASSERT_EQ(mgr.read_one(entity, &response).code(), Code::OK);
+    ASSERT_EQ(1, response.entities().size());
+  }
+}
+
 TEST_F(DirectCounterTest, MissingTableEntry) {
   p4v1::ReadResponse response;
   p4v1::DirectCounterEntry counter_entry;
@@ -1805,6 +2397,60 @@ TEST_F(IndirectCounterTest, ReadAll) {
   }
 }
 
+TEST_F(IndirectCounterTest, ReadAllCached) {
+  mgr.counter_cache_set_max_staleness(std::chrono::hours(1));
+  p4v1::CounterEntry counter_entry;
+  counter_entry.set_counter_id(c_id);
+
+  // the second read is served from the cache
+  EXPECT_CALL(*mock, counter_read(c_id, _, _, _)).Times(c_size);
+  for (int i = 0; i < 2; i++) {
+    p4v1::ReadResponse response;
+    auto status = read_counter(&counter_entry, &response);
+    ASSERT_EQ(status.code(), Code::OK);
+    ASSERT_EQ(c_size, static_cast<size_t>(response.entities().size()));
+  }
+  auto stats = mgr.counter_cache_get_stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+
+  // writing to the counter invalidates the snapshot
+  p4v1::CounterEntry write_entry;
+  write_entry.set_counter_id(c_id);
+  set_index(&write_entry, 0);
+  write_entry.mutable_data()->set_packet_count(3);
+  EXPECT_CALL(*mock, counter_write(c_id, 0, _));
+  {
+    auto status = write_counter(&write_entry);
+    ASSERT_EQ(status.code(), Code::OK);
+  }
+  EXPECT_CALL(*mock, counter_read(c_id, _, _, _)).Times(c_size);
+  {
+    p4v1::ReadResponse response;
+    auto status = read_counter(&counter_entry, &response);
+    ASSERT_EQ(status.code(), Code::OK);
+    const auto &entry = response.entities().Get(0).counter_entry();
+    EXPECT_EQ(entry.data().packet_count(), 3);
+  }
+  stats = mgr.counter_cache_get_stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+}
+
+TEST_F(IndirectCounterTest, ReadAllCacheDisabled) {
+  p4v1::CounterEntry counter_entry;
+  counter_entry.set_counter_id(c_id);
+  EXPECT_CALL(*mock, counter_read(c_id, _, _, _)).Times(2 * c_size);
+  for (int i = 0; i < 2; i++) {
+    p4v1::ReadResponse response;
+    auto status = read_counter(&counter_entry, &response);
+    ASSERT_EQ(status.code(), Code::OK);
+  }
+  auto stats = mgr.counter_cache_get_stats();
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.misses, 0u);
+}
+
 
 // Only testing for exact match tables for now, there is not much code variation
 // between different table types.
@@ -1979,7 +2625,7 @@ TEST_F(TernaryOneTest, DontCare) {
 
     p4v1::ReadResponse response;
     {
-      EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+      EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
       auto status = read_table_entries(t_id, &response);
       ASSERT_EQ(status.code(), Code::OK);
     }
@@ -2084,7 +2730,7 @@ TEST_F(RangeOneTest, DontCare) {
 
     p4v1::ReadResponse response;
     {
-      EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+      EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
       auto status = read_table_entries(t_id, &response);
       ASSERT_EQ(status.code(), Code::OK);
     }
@@ -2186,7 +2832,7 @@ TEST_F(LpmOneTest, DontCare) {
 
     p4v1::ReadResponse response;
     {
-      EXPECT_CALL(*mock, table_entries_fetch(t_id, _));
+      EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _));
       auto status = read_table_entries(t_id, &response);
       ASSERT_EQ(status.code(), Code::OK);
     }
@@ -2456,7 +3102,7 @@ TEST_F(ReadConstTableTest, P4RuntimeEntries) {
     ASSERT_EQ(status.code(), Code::OK);
   }
 
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(AnyNumber());
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(AnyNumber());
   p4v1::ReadResponse response;
   auto status = read_table_entries(t_id, &response);
   EXPECT_EQ(status.code(), Code::OK);
@@ -2494,7 +3140,7 @@ TEST_F(ReadConstTableTest, OutOfBandEntries) {
               PI_STATUS_SUCCESS);
   }
 
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(AnyNumber());
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(AnyNumber());
   p4v1::ReadResponse response;
   auto status = read_table_entries(t_id, &response);
   EXPECT_EQ(status.code(), Code::OK);
@@ -2604,7 +3250,7 @@ TEST_F(ReadExclusiveAccess, ConcurrentReadAndWrites) {
     EXPECT_CALL(*mock, action_prof_member_create(act_prof_id, _, _))
         .Times(iters);
     EXPECT_CALL(*mock, table_entry_add(t_id, _, _, _)).Times(iters);
-    EXPECT_CALL(*mock, table_entry_delete_wkey(t_id, _)).Times(iters);
+    EXPECT_CALL(*mock, table_entry_delete(t_id, _)).Times(iters);
     EXPECT_CALL(*mock, action_prof_member_delete(act_prof_id, _)).Times(iters);
 
     uint32_t member_id = 123;
@@ -2654,7 +3300,7 @@ TEST_F(ReadExclusiveAccess, ConcurrentReadAndWrites) {
   std::atomic<bool> stop{false};
 
   auto do_read = [this, &stop]() {
-    EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(AtLeast(1));
+    EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(AtLeast(1));
     EXPECT_CALL(*mock, action_prof_entries_fetch(act_prof_id, _))
         .Times(AtLeast(1));
     p4v1::ReadRequest request;
@@ -2691,6 +3337,117 @@ TEST_F(ReadExclusiveAccess, ConcurrentReadAndWrites) {
   t2.join();
 }
 
+// Tests for the storage used by pi::MatchKey and pi::ActionData in the C++
+// frontend, which is used by DeviceMgr for every table write
+class SmallBufferTest : public ::testing::Test {
+ protected:
+  using SmallBuffer = pi::detail::SmallBuffer;
+
+  static bool is_inline(const SmallBuffer &buffer) {
+    auto begin = reinterpret_cast<const char *>(&buffer);
+    return buffer.data() >= begin && buffer.data() < begin + sizeof(buffer);
+  }
+
+  static bool is_zero(const SmallBuffer &buffer) {
+    for (size_t i = 0; i < buffer.size(); i++)
+      if (buffer.data()[i] != 0) return false;
+    return true;
+  }
+
+  pi::Arena arena{};
+};
+
+TEST_F(SmallBufferTest, InlineCapacity) {
+  SmallBuffer buffer(SmallBuffer::kInlineSize, &arena);
+  EXPECT_TRUE(is_inline(buffer));
+  EXPECT_EQ(SmallBuffer::kInlineSize, buffer.size());
+  EXPECT_TRUE(is_zero(buffer));
+  // the arena was not used for the inline buffer, so the first buffer which
+  // uses it is at the start of its first block
+  SmallBuffer large(SmallBuffer::kInlineSize + 1, &arena);
+  arena.reset();
+  EXPECT_EQ(large.data(), arena.allocate(1));
+}
+
+TEST_F(SmallBufferTest, GrowPastInline) {
+  const size_t size = SmallBuffer::kInlineSize + 1;
+  SmallBuffer from_arena(size, &arena);
+  EXPECT_FALSE(is_inline(from_arena));
+  EXPECT_EQ(size, from_arena.size());
+  EXPECT_TRUE(is_zero(from_arena));
+  SmallBuffer from_heap(size, nullptr);
+  EXPECT_FALSE(is_inline(from_heap));
+  EXPECT_TRUE(is_zero(from_heap));
+
+  // larger than the arena block size
+  pi::Arena small_arena(64);
+  SmallBuffer very_large(1024, &small_arena);
+  EXPECT_EQ(1024u, very_large.size());
+  EXPECT_TRUE(is_zero(very_large));
+  std::memset(very_large.data(), 0xab, very_large.size());
+}
+
+TEST_F(SmallBufferTest, ArenaReuseAfterReset) {
+  const size_t size = SmallBuffer::kInlineSize * 2;
+  char *first, *second;
+  {
+    SmallBuffer buffer_1(size, &arena);
+    SmallBuffer buffer_2(size, &arena);
+    first = buffer_1.data();
+    second = buffer_2.data();
+    EXPECT_NE(first, second);
+    std::memset(first, 0xab, size);
+    std::memset(second, 0xab, size);
+  }
+  arena.reset();
+  // the same memory is handed out again, and is zeroed
+  SmallBuffer buffer_1(size, &arena);
+  SmallBuffer buffer_2(size, &arena);
+  EXPECT_EQ(first, buffer_1.data());
+  EXPECT_EQ(second, buffer_2.data());
+  EXPECT_TRUE(is_zero(buffer_1));
+  EXPECT_TRUE(is_zero(buffer_2));
+}
+
+TEST_F(SmallBufferTest, CopyDoesNotUseArena) {
+  const size_t size = SmallBuffer::kInlineSize + 1;
+  std::unique_ptr<SmallBuffer> copy;
+  {
+    SmallBuffer buffer(size, &arena);
+    std::memset(buffer.data(), 0xab, size);
+    copy.reset(new SmallBuffer(buffer));
+  }
+  EXPECT_FALSE(is_inline(*copy));
+  // the arena memory is reused and overwritten, the copy is not affected
+  arena.reset();
+  SmallBuffer other(size, &arena);
+  std::memset(other.data(), 0xcd, size);
+  EXPECT_NE(other.data(), copy->data());
+  ASSERT_EQ(size, copy->size());
+  for (size_t i = 0; i < size; i++)
+    EXPECT_EQ('\xab', copy->data()[i]);
+}
+
+TEST_F(SmallBufferTest, Move) {
+  SmallBuffer small(8, &arena);
+  std::memset(small.data(), 0xab, small.size());
+  SmallBuffer moved_small(std::move(small));
+  EXPECT_TRUE(is_inline(moved_small));
+  ASSERT_EQ(8u, moved_small.size());
+  EXPECT_EQ(std::string(8, '\xab'),
+            std::string(moved_small.data(), moved_small.size()));
+
+  // heap and arena storage is stolen
+  SmallBuffer large(SmallBuffer::kInlineSize + 1, nullptr);
+  auto *data = large.data();
+  SmallBuffer moved_large(std::move(large));
+  EXPECT_EQ(data, moved_large.data());
+  SmallBuffer from_arena(SmallBuffer::kInlineSize + 1, &arena);
+  data = from_arena.data();
+  moved_large = std::move(from_arena);
+  EXPECT_EQ(data, moved_large.data());
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace proto
@@ -110,6 +110,20 @@ TEST_F(DeviceMgrPacketIORegTest, PacketOut) {
   EXPECT_EQ(status.code(), Code::OK);
 }
 
+TEST_F(DeviceMgrPacketIORegTest, PacketOutBatch) {
+  std::vector<p4v1::PacketOut> packets(4);
+  std::vector<const p4v1::PacketOut *> packet_ptrs;
+  ::testing::InSequence dummy;
+  for (size_t i = 0; i < packets.size(); i++) {
+    const auto &payload = std::string(10 + i, '\xab');
+    packets[i].set_payload(payload);
+    packet_ptrs.push_back(&packets[i]);
+    EXPECT_CALL(*mock, packetout_send(_, payload.size()));
+  }
+  auto status = mgr.packet_out_send_batch(packet_ptrs);
+  EXPECT_EQ(status.code(), Code::OK);
+}
+
 using ::testing::WithParamInterface;
 using ::testing::Combine;
 using ::testing::Range;
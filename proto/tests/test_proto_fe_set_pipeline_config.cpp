@@ -116,7 +116,7 @@ TEST_F(DeviceMgrSetPipelineConfigTest, Reconcile) {
   auto t_id = pi_p4info_table_id_from_name(p4info_1, "T1");
   auto a_id = pi_p4info_action_id_from_name(p4info_1, "actionA");
 
-  EXPECT_CALL(*mock, table_entries_fetch(t_id, _)).Times(AnyNumber());
+  EXPECT_CALL(*mock, table_entries_fetch_chunk(t_id, _)).Times(AnyNumber());
 
   {
     auto status = set_pipeline_config(
@@ -29,6 +29,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define MAX_IDS_IN_ANNOTATION 16
@@ -36,28 +37,44 @@
 static const int required_major_version = 2;
 static const int min_minor_version = 0;
 
+// All the ids assigned by the reader are of the form (type_id << 24) | id,
+// with id < 2^16 (user-provided ids are checked and generated ids are obtained
+// by masking a hash), so for each resource type the state of each id can be
+// kept in a flat array indexed by the 16 least significant bits.
+#define NUM_IDS_PER_TYPE (1 << 16)
+
+#define ID_RESERVED 0x1
+#define ID_ALLOCATED 0x2
+
 typedef struct {
-  // Judy1 array to keep track of which ids have already been allocated
-  Pvoid_t allocated_ids;
-  // Judy1 array to keep track of which ids have already been reserved
-  Pvoid_t reserved_ids;
+  // one array of NUM_IDS_PER_TYPE entries per resource type, allocated the
+  // first time an id of that type is reserved; each entry is a combination of
+  // ID_RESERVED and ID_ALLOCATED
+  uint8_t *ids_state[PI_RES_TYPE_MAX];
   // JudySL array to match field names to integer bitwidths; used when adding
   // match fields to tables in p4info
   Pvoid_t fields_bitwidth;
 } reader_state_t;
 
+// a JSON object along with its "name" attribute, which is looked up once
+typedef struct {
+  const char *name;
+  cJSON *object;
+  // position in the JSON input, used to keep objects with the same name in the
+  // input order when sorting, since qsort is not stable
+  size_t index;
+} named_object_t;
+
 static void init_reader_state(reader_state_t *state) {
-  state->allocated_ids = (Pvoid_t)NULL;
-  state->reserved_ids = (Pvoid_t)NULL;
+  memset(state->ids_state, 0, sizeof(state->ids_state));
   state->fields_bitwidth = (Pvoid_t)NULL;
 }
 
 static void destroy_reader_state(reader_state_t *state) {
+  for (size_t i = 0; i < PI_RES_TYPE_MAX; i++) free(state->ids_state[i]);
   Word_t Rc_word;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic warning "-Wsign-compare"
-  J1FA(Rc_word, state->allocated_ids);
-  J1FA(Rc_word, state->reserved_ids);
   JSLFA(Rc_word, state->fields_bitwidth);
 #pragma GCC diagnostic pop
   (void)Rc_word;
@@ -90,13 +107,11 @@ static void parse_ids(const char *str, const char *name, pi_p4_id_t *ids,
 
 // iterates over annotations looking for the right one ("id"); if does not
 // exist, return PI_INVALID_ID
-static void find_annotation_id(cJSON *object, pi_p4_id_t *ids,
-                               size_t *num_ids) {
+static void find_annotation_id(cJSON *object, const char *name,
+                               pi_p4_id_t *ids, size_t *num_ids) {
   *num_ids = 0;
   cJSON *pragmas = cJSON_GetObjectItem(object, "pragmas");
   if (!pragmas) return;
-  const cJSON *item = cJSON_GetObjectItem(object, "name");
-  const char *name = item->valuestring;
   cJSON *pragma;
   cJSON_ArrayForEach(pragma, pragmas) {
     if (!strncmp(pragma->valuestring, "id ", 3)) {
@@ -107,41 +122,46 @@ static void find_annotation_id(cJSON *object, pi_p4_id_t *ids,
   }
 }
 
-static bool is_id_reserved(reader_state_t *state, pi_p4_id_t id) {
-  int Rc_int;
-  J1T(Rc_int, state->reserved_ids, (Word_t)id);
-  return (Rc_int == 1);
+static uint8_t get_id_state(const reader_state_t *state, pi_p4_id_t id) {
+  assert((id & 0xffffff) < NUM_IDS_PER_TYPE);
+  const uint8_t *ids_state = state->ids_state[id >> 24];
+  return ids_state ? ids_state[id & 0xffff] : 0;
+}
+
+static void set_id_state(reader_state_t *state, pi_p4_id_t id, uint8_t flag) {
+  assert((id & 0xffffff) < NUM_IDS_PER_TYPE);
+  uint8_t **ids_state = &state->ids_state[id >> 24];
+  if (!*ids_state) *ids_state = calloc(NUM_IDS_PER_TYPE, 1);
+  assert(!((*ids_state)[id & 0xffff] & flag));
+  (*ids_state)[id & 0xffff] |= flag;
+}
+
+static bool is_id_reserved(const reader_state_t *state, pi_p4_id_t id) {
+  return get_id_state(state, id) & ID_RESERVED;
 }
 
 static void reserve_id(reader_state_t *state, pi_p4_id_t id) {
-  int Rc_int;
-  J1S(Rc_int, state->reserved_ids, (Word_t)id);
-  assert(Rc_int == 1);
+  set_id_state(state, id, ID_RESERVED);
 }
 
-static bool is_id_allocated(reader_state_t *state, pi_p4_id_t id) {
-  int Rc_int;
-  J1T(Rc_int, state->allocated_ids, (Word_t)id);
-  return (Rc_int == 1);
+static bool is_id_allocated(const reader_state_t *state, pi_p4_id_t id) {
+  return get_id_state(state, id) & ID_ALLOCATED;
 }
 
 static void allocate_id(reader_state_t *state, pi_p4_id_t id) {
-  int Rc_int;
-  J1S(Rc_int, state->allocated_ids, (Word_t)id);
-  assert(Rc_int == 1);
+  set_id_state(state, id, ID_ALLOCATED);
 }
 
 static void pre_reserve_ids(reader_state_t *state, pi_res_type_id_t type_id,
-                            cJSON *objects) {
+                            const named_object_t *objects,
+                            size_t num_objects) {
   pi_p4_id_t ids[MAX_IDS_IN_ANNOTATION];
   size_t num_ids = 0;
   bool found_id = false;
-  cJSON *object;
-  cJSON_ArrayForEach(object, objects) {
-    find_annotation_id(object, ids, &num_ids);
+  for (size_t idx = 0; idx < num_objects; idx++) {
+    const char *name = objects[idx].name;
+    find_annotation_id(objects[idx].object, name, ids, &num_ids);
     if (num_ids == 0) continue;
-    const cJSON *item = cJSON_GetObjectItem(object, "name");
-    const char *name = item->valuestring;
     for (size_t i = 0; i < num_ids; i++) {
       pi_p4_id_t id = ids[i];
       pi_p4_id_t full_id = (type_id << 24) | id;
@@ -182,10 +202,9 @@ static uint32_t hash_to_id(uint32_t hash, pi_res_type_id_t type_id) {
   return (type_id << 24) | (hash & 0xffff);
 }
 
-static pi_p4_id_t generate_id_from_name(reader_state_t *state, cJSON *object,
+static pi_p4_id_t generate_id_from_name(reader_state_t *state,
+                                        const char *name,
                                         pi_res_type_id_t type_id) {
-  const cJSON *item = cJSON_GetObjectItem(object, "name");
-  const char *name = item->valuestring;
   pi_p4_id_t hash =
       jenkins_one_at_a_time_hash((const uint8_t *)name, strlen(name));
   while (is_id_reserved(state, hash_to_id(hash, type_id))) hash++;
@@ -195,11 +214,12 @@ static pi_p4_id_t generate_id_from_name(reader_state_t *state, cJSON *object,
   return id;
 }
 
-static pi_p4_id_t request_id(reader_state_t *state, cJSON *object,
+static pi_p4_id_t request_id(reader_state_t *state,
+                             const named_object_t *object,
                              pi_res_type_id_t type_id) {
   pi_p4_id_t ids[MAX_IDS_IN_ANNOTATION];
   size_t num_ids = 0;
-  find_annotation_id(object, ids, &num_ids);
+  find_annotation_id(object->object, object->name, ids, &num_ids);
   pi_p4_id_t id;
   if (num_ids != 0) {
     for (size_t i = 0; i < num_ids; i++) {
@@ -211,7 +231,7 @@ static pi_p4_id_t request_id(reader_state_t *state, cJSON *object,
       }
     }
   }
-  return generate_id_from_name(state, object, type_id);
+  return generate_id_from_name(state, object->name, type_id);
 }
 
 static void import_pragmas(cJSON *object, pi_p4info_t *p4info, pi_p4_id_t id) {
@@ -223,35 +243,34 @@ static void import_pragmas(cJSON *object, pi_p4info_t *p4info, pi_p4_id_t id) {
   }
 }
 
-// a simple bubble sort to sort objects in a list based on alphabetical order of
-// their name attribute
-static void sort_json_array(cJSON *array) {
-  assert(array->type == cJSON_Array);
-  int size = cJSON_GetArraySize(array);
-  const cJSON *item = NULL;
-  for (int i = size - 1; i > 0; i--) {
-    cJSON *object = array->child;
-    cJSON *next_object = NULL;
-    cJSON **prev_ptr = &(array->child);
-    while (object->next) {
-      next_object = object->next;
-      item = cJSON_GetObjectItem(object, "name");
-      const char *name = item->valuestring;
-      item = cJSON_GetObjectItem(next_object, "name");
-      const char *next_name = item->valuestring;
-
-      if (strcmp(name, next_name) > 0) {  // do swap
-        *prev_ptr = next_object;
-        next_object->prev = *prev_ptr;
-        object->prev = next_object;
-        object->next = next_object->next;
-        next_object->next = object;
-      }
-      prev_ptr = &(object->next);
-      object = next_object;
-    }
-    array->child->prev = NULL;
+static int cmp_named_objects(const void *e1, const void *e2) {
+  const named_object_t *object_1 = (const named_object_t *)e1;
+  const named_object_t *object_2 = (const named_object_t *)e2;
+  int rc = strcmp(object_1->name, object_2->name);
+  if (rc != 0) return rc;
+  return (object_1->index > object_2->index) -
+         (object_1->index < object_2->index);
+}
+
+// appends the objects in the JSON array to the vector of named_object_t;
+// returns false if one of them does not have a name
+static bool collect_named_objects(cJSON *array, vector_t *objects) {
+  cJSON *object;
+  cJSON_ArrayForEach(object, array) {
+    const cJSON *item = cJSON_GetObjectItem(object, "name");
+    if (!item || !item->valuestring) return false;
+    named_object_t named_object = {item->valuestring, object,
+                                   vector_size(objects)};
+    vector_push_back(objects, &named_object);
   }
+  return true;
+}
+
+// sorts the objects in alphabetical order of their name attribute, objects with
+// the same name are kept in the order in which they were collected
+static void sort_named_objects(vector_t *objects) {
+  qsort(vector_data(objects), vector_size(objects), sizeof(named_object_t),
+        cmp_named_objects);
 }
 
 static pi_status_t read_actions(reader_state_t *state, cJSON *root,
@@ -259,21 +278,29 @@ static pi_status_t read_actions(reader_state_t *state, cJSON *root,
   assert(root);
   cJSON *actions = cJSON_GetObjectItem(root, "actions");
   if (!actions) return PI_STATUS_CONFIG_READER_ERROR;
-  pre_reserve_ids(state, PI_ACTION_ID, actions);
   size_t num_actions = cJSON_GetArraySize(actions);
+  vector_t *actions_vec = vector_create(sizeof(named_object_t), num_actions);
+  if (!collect_named_objects(actions, actions_vec)) {
+    vector_destroy(actions_vec);
+    return PI_STATUS_CONFIG_READER_ERROR;
+  }
+  const named_object_t *named_actions = vector_data(actions_vec);
+  pre_reserve_ids(state, PI_ACTION_ID, named_actions, num_actions);
   pi_p4info_action_init(p4info, num_actions);
 
-  cJSON *action;
-  sort_json_array(actions);
-  cJSON_ArrayForEach(action, actions) {
+  sort_named_objects(actions_vec);
+  pi_status_t status = PI_STATUS_SUCCESS;
+  for (size_t i = 0; i < num_actions; i++) {
+    cJSON *action = named_actions[i].object;
     const cJSON *item;
-    item = cJSON_GetObjectItem(action, "name");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    const char *name = item->valuestring;
-    pi_p4_id_t pi_id = request_id(state, action, PI_ACTION_ID);
+    const char *name = named_actions[i].name;
+    pi_p4_id_t pi_id = request_id(state, &named_actions[i], PI_ACTION_ID);
 
     cJSON *params = cJSON_GetObjectItem(action, "runtime_data");
-    if (!params) return PI_STATUS_CONFIG_READER_ERROR;
+    if (!params) {
+      status = PI_STATUS_CONFIG_READER_ERROR;
+      break;
+    }
     size_t num_params = cJSON_GetArraySize(params);
 
     PI_LOG_DEBUG("Adding action '%s'\n", name);
@@ -283,22 +310,28 @@ static pi_status_t read_actions(reader_state_t *state, cJSON *root,
     cJSON *param;
     cJSON_ArrayForEach(param, params) {
       item = cJSON_GetObjectItem(param, "name");
-      if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+      if (!item) break;
       const char *param_name = item->valuestring;
 
       item = cJSON_GetObjectItem(param, "bitwidth");
-      if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+      if (!item) break;
       int param_bitwidth = item->valueint;
 
       pi_p4_id_t param_id = param_index++;
       pi_p4info_action_add_param(p4info, pi_id, param_id, param_name,
                                  param_bitwidth);
     }
+    // one of the params is missing a required attribute
+    if (param) {
+      status = PI_STATUS_CONFIG_READER_ERROR;
+      break;
+    }
 
     import_pragmas(action, p4info, pi_id);
   }
 
-  return PI_STATUS_SUCCESS;
+  vector_destroy(actions_vec);
+  return status;
 }
 
 // rules to exclude fields
@@ -414,39 +447,30 @@ static pi_p4info_match_type_t match_type_from_str(const char *type) {
   return PI_P4INFO_MATCH_TYPE_END;
 }
 
-static int cmp_json_object_generic(const void *e1, const void *e2) {
-  cJSON *object_1 = *(cJSON * const *)e1;
-  cJSON *object_2 = *(cJSON * const *)e2;
-  const cJSON *item_1, *item_2;
-  item_1 = cJSON_GetObjectItem(object_1, "name");
-  item_2 = cJSON_GetObjectItem(object_2, "name");
-  return strcmp(item_1->valuestring, item_2->valuestring);
-}
-
-// common code for action profiles and tables, returns NULL in case of incorrect
-// JSON input
+// common code for action profiles and tables, returns a vector of
+// named_object_t sorted by name, or NULL in case of incorrect JSON input
 static vector_t *extract_from_pipelines(reader_state_t *state, cJSON *root,
                                         const char *res_name,
                                         pi_res_type_id_t res_type) {
   cJSON *pipelines = cJSON_GetObjectItem(root, "pipelines");
   if (!pipelines) return NULL;
 
-  // cannot use sort_json_array as we have to sort them across multiple
-  // pipelines so instead we create a temporary vector which we sort with qsort
+  // objects are sorted across all pipelines
   const size_t init_capacity = 16;
-  vector_t *res_vec = vector_create(sizeof(cJSON *), init_capacity);
-  cJSON *entry;
+  vector_t *res_vec = vector_create(sizeof(named_object_t), init_capacity);
   cJSON *pipe;
   cJSON_ArrayForEach(pipe, pipelines) {
     cJSON *entries = cJSON_GetObjectItem(pipe, res_name);
-    if (!entries) return NULL;
-    pre_reserve_ids(state, res_type, entries);
-    cJSON_ArrayForEach(entry, entries) {
-      vector_push_back(res_vec, (void *)&entry);
+    size_t first = vector_size(res_vec);
+    if (!entries || !collect_named_objects(entries, res_vec)) {
+      vector_destroy(res_vec);
+      return NULL;
     }
+    const named_object_t *objects = vector_data(res_vec);
+    pre_reserve_ids(state, res_type, objects + first,
+                    vector_size(res_vec) - first);
   }
-  qsort(vector_data(res_vec), vector_size(res_vec), sizeof(cJSON *),
-        cmp_json_object_generic);
+  sort_named_objects(res_vec);
   return res_vec;
 }
 
@@ -460,12 +484,11 @@ static pi_status_t read_act_profs(reader_state_t *state, cJSON *root,
   pi_p4info_act_prof_init(p4info, num_act_profs);
 
   for (size_t i = 0; i < num_act_profs; i++) {
-    cJSON *act_prof = *(cJSON **)vector_at(act_profs_vec, i);
+    const named_object_t *named_act_prof = vector_at(act_profs_vec, i);
+    cJSON *act_prof = named_act_prof->object;
     const cJSON *item;
-    item = cJSON_GetObjectItem(act_prof, "name");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    const char *name = item->valuestring;
-    pi_p4_id_t pi_id = request_id(state, act_prof, PI_ACT_PROF_ID);
+    const char *name = named_act_prof->name;
+    pi_p4_id_t pi_id = request_id(state, named_act_prof, PI_ACT_PROF_ID);
     bool with_selector = cJSON_HasObjectItem(act_prof, "selector");
     item = cJSON_GetObjectItem(act_prof, "max_size");
     if (!item) return PI_STATUS_CONFIG_READER_ERROR;
@@ -489,12 +512,11 @@ static pi_status_t read_tables(reader_state_t *state, cJSON *root,
   pi_p4info_table_init(p4info, num_tables);
 
   for (size_t i = 0; i < num_tables; i++) {
-    cJSON *table = *(cJSON **)vector_at(tables_vec, i);
+    const named_object_t *named_table = vector_at(tables_vec, i);
+    cJSON *table = named_table->object;
     const cJSON *item;
-    item = cJSON_GetObjectItem(table, "name");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    const char *name = item->valuestring;
-    pi_p4_id_t pi_id = request_id(state, table, PI_TABLE_ID);
+    const char *name = named_table->name;
+    pi_p4_id_t pi_id = request_id(state, named_table, PI_TABLE_ID);
 
     cJSON *json_match_key = cJSON_GetObjectItem(table, "key");
     if (!json_match_key) return PI_STATUS_CONFIG_READER_ERROR;
@@ -582,77 +604,100 @@ static pi_status_t read_tables(reader_state_t *state, cJSON *root,
   return PI_STATUS_SUCCESS;
 }
 
+static pi_status_t read_one_counter(reader_state_t *state,
+                                    const named_object_t *named_counter,
+                                    pi_p4info_t *p4info) {
+  cJSON *counter = named_counter->object;
+  const cJSON *item;
+  const char *name = named_counter->name;
+
+  item = cJSON_GetObjectItem(counter, "is_direct");
+  if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+  bool is_direct = item->valueint;
+
+  item = cJSON_GetObjectItem(counter, "size");
+  if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+  size_t size = item->valueint;
+
+  pi_p4_id_t pi_id;
+  if (is_direct) {
+    pi_id = request_id(state, named_counter, PI_DIRECT_COUNTER_ID);
+    PI_LOG_DEBUG("Adding direct counter '%s'\n", name);
+    item = cJSON_GetObjectItem(counter, "binding");
+    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+    const char *direct_tname = item->valuestring;
+    pi_p4_id_t direct_tid = pi_p4info_table_id_from_name(p4info, direct_tname);
+    if (direct_tid == PI_INVALID_ID) return PI_STATUS_CONFIG_READER_ERROR;
+    pi_p4info_direct_counter_add(
+        p4info, pi_id, name, PI_P4INFO_COUNTER_UNIT_BOTH, size, direct_tid);
+    pi_p4info_table_add_direct_resource(p4info, direct_tid, pi_id);
+  } else {
+    pi_id = request_id(state, named_counter, PI_COUNTER_ID);
+    PI_LOG_DEBUG("Adding counter '%s'\n", name);
+    pi_p4info_counter_add(p4info, pi_id, name, PI_P4INFO_COUNTER_UNIT_BOTH,
+                          size);
+  }
+
+  import_pragmas(counter, p4info, pi_id);
+
+  return PI_STATUS_SUCCESS;
+}
+
 static pi_status_t read_counters(reader_state_t *state, cJSON *root,
                                  pi_p4info_t *p4info) {
   assert(root);
   cJSON *counters = cJSON_GetObjectItem(root, "counter_arrays");
   if (!counters) return PI_STATUS_CONFIG_READER_ERROR;
-  cJSON *counter;
+  size_t num_all_counters = cJSON_GetArraySize(counters);
+  vector_t *counters_vec =
+      vector_create(sizeof(named_object_t), num_all_counters);
+  if (!collect_named_objects(counters, counters_vec)) {
+    vector_destroy(counters_vec);
+    return PI_STATUS_CONFIG_READER_ERROR;
+  }
+  const named_object_t *named_counters = vector_data(counters_vec);
 
   // first pass needed because PI treats indirect & direct counters differently:
   // we need to count and pre-reserve ids for counters of each type before we
   // actually add them to p4info.
-  cJSON *counters_ = cJSON_CreateArray();
-  cJSON *direct_counters_ = cJSON_CreateArray();
-  size_t num_counters = 0, num_direct_counters = 0;
-  cJSON_ArrayForEach(counter, counters) {
-    const cJSON *item = cJSON_GetObjectItem(counter, "is_direct");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    bool is_direct = item->valueint;
-    if (is_direct) {
-      num_direct_counters++;
-      cJSON_AddItemReferenceToArray(direct_counters_, counter);
-    } else {
-      num_counters++;
-      cJSON_AddItemReferenceToArray(counters_, counter);
+  vector_t *indirect_vec =
+      vector_create(sizeof(named_object_t), num_all_counters);
+  vector_t *direct_vec =
+      vector_create(sizeof(named_object_t), num_all_counters);
+  pi_status_t status = PI_STATUS_SUCCESS;
+  for (size_t i = 0; i < num_all_counters; i++) {
+    const cJSON *item =
+        cJSON_GetObjectItem(named_counters[i].object, "is_direct");
+    if (!item) {
+      status = PI_STATUS_CONFIG_READER_ERROR;
+      break;
     }
+    vector_push_back(item->valueint ? direct_vec : indirect_vec,
+                     (void *)&named_counters[i]);
   }
-  pre_reserve_ids(state, PI_COUNTER_ID, counters_);
-  cJSON_Delete(counters_);
-  pi_p4info_counter_init(p4info, num_counters);
-  pre_reserve_ids(state, PI_DIRECT_COUNTER_ID, direct_counters_);
-  cJSON_Delete(direct_counters_);
-  pi_p4info_direct_counter_init(p4info, num_direct_counters);
-
-  sort_json_array(counters);
-  cJSON_ArrayForEach(counter, counters) {
-    const cJSON *item;
-    item = cJSON_GetObjectItem(counter, "name");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    const char *name = item->valuestring;
-
-    item = cJSON_GetObjectItem(counter, "is_direct");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    bool is_direct = item->valueint;
-
-    item = cJSON_GetObjectItem(counter, "size");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    size_t size = item->valueint;
-
-    pi_p4_id_t pi_id;
-    if (is_direct) {
-      pi_id = request_id(state, counter, PI_DIRECT_COUNTER_ID);
-      PI_LOG_DEBUG("Adding direct counter '%s'\n", name);
-      item = cJSON_GetObjectItem(counter, "binding");
-      if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-      const char *direct_tname = item->valuestring;
-      pi_p4_id_t direct_tid =
-          pi_p4info_table_id_from_name(p4info, direct_tname);
-      if (direct_tid == PI_INVALID_ID) return PI_STATUS_CONFIG_READER_ERROR;
-      pi_p4info_direct_counter_add(
-          p4info, pi_id, name, PI_P4INFO_COUNTER_UNIT_BOTH, size, direct_tid);
-      pi_p4info_table_add_direct_resource(p4info, direct_tid, pi_id);
-    } else {
-      pi_id = request_id(state, counter, PI_COUNTER_ID);
-      PI_LOG_DEBUG("Adding counter '%s'\n", name);
-      pi_p4info_counter_add(p4info, pi_id, name, PI_P4INFO_COUNTER_UNIT_BOTH,
-                            size);
+  size_t num_counters = vector_size(indirect_vec);
+  size_t num_direct_counters = vector_size(direct_vec);
+  if (status == PI_STATUS_SUCCESS) {
+    pre_reserve_ids(state, PI_COUNTER_ID, vector_data(indirect_vec),
+                    num_counters);
+    pi_p4info_counter_init(p4info, num_counters);
+    pre_reserve_ids(state, PI_DIRECT_COUNTER_ID, vector_data(direct_vec),
+                    num_direct_counters);
+    pi_p4info_direct_counter_init(p4info, num_direct_counters);
+  }
+  vector_destroy(indirect_vec);
+  vector_destroy(direct_vec);
+
+  if (status == PI_STATUS_SUCCESS) {
+    sort_named_objects(counters_vec);
+    for (size_t i = 0; i < num_all_counters; i++) {
+      status = read_one_counter(state, &named_counters[i], p4info);
+      if (status != PI_STATUS_SUCCESS) break;
     }
-
-    import_pragmas(counter, p4info, pi_id);
   }
 
-  return PI_STATUS_SUCCESS;
+  vector_destroy(counters_vec);
+  return status;
 }
 
 static pi_p4info_meter_unit_t meter_unit_from_str(const char *unit) {
@@ -664,85 +709,106 @@ static pi_p4info_meter_unit_t meter_unit_from_str(const char *unit) {
   return PI_P4INFO_METER_UNIT_PACKETS;
 }
 
+static pi_status_t read_one_meter(reader_state_t *state,
+                                  const named_object_t *named_meter,
+                                  pi_p4info_t *p4info) {
+  cJSON *meter = named_meter->object;
+  const cJSON *item;
+  const char *name = named_meter->name;
+
+  item = cJSON_GetObjectItem(meter, "is_direct");
+  if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+  bool is_direct = item->valueint;
+
+  item = cJSON_GetObjectItem(meter, "size");
+  if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+  size_t size = item->valueint;
+
+  item = cJSON_GetObjectItem(meter, "type");
+  if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+  const char *meter_unit_str = item->valuestring;
+  pi_p4info_meter_unit_t meter_unit = meter_unit_from_str(meter_unit_str);
+
+  pi_p4_id_t pi_id;
+  if (is_direct) {
+    pi_id = request_id(state, named_meter, PI_DIRECT_METER_ID);
+    PI_LOG_DEBUG("Adding direct meter '%s'\n", name);
+    item = cJSON_GetObjectItem(meter, "binding");
+    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
+    const char *direct_tname = item->valuestring;
+    pi_p4_id_t direct_tid = pi_p4info_table_id_from_name(p4info, direct_tname);
+    if (direct_tid == PI_INVALID_ID) return PI_STATUS_CONFIG_READER_ERROR;
+    // color unaware by default
+    pi_p4info_direct_meter_add(p4info, pi_id, name, meter_unit,
+                               PI_P4INFO_METER_TYPE_COLOR_UNAWARE, size,
+                               direct_tid);
+    pi_p4info_table_add_direct_resource(p4info, direct_tid, pi_id);
+  } else {
+    pi_id = request_id(state, named_meter, PI_METER_ID);
+    PI_LOG_DEBUG("Adding meter '%s'\n", name);
+    // color unaware by default
+    pi_p4info_meter_add(p4info, pi_id, name, meter_unit,
+                        PI_P4INFO_METER_TYPE_COLOR_UNAWARE, size);
+  }
+
+  import_pragmas(meter, p4info, pi_id);
+
+  return PI_STATUS_SUCCESS;
+}
+
 static pi_status_t read_meters(reader_state_t *state, cJSON *root,
                                pi_p4info_t *p4info) {
   assert(root);
   cJSON *meters = cJSON_GetObjectItem(root, "meter_arrays");
   if (!meters) return PI_STATUS_CONFIG_READER_ERROR;
-  cJSON *meter;
+  size_t num_all_meters = cJSON_GetArraySize(meters);
+  vector_t *meters_vec = vector_create(sizeof(named_object_t), num_all_meters);
+  if (!collect_named_objects(meters, meters_vec)) {
+    vector_destroy(meters_vec);
+    return PI_STATUS_CONFIG_READER_ERROR;
+  }
+  const named_object_t *named_meters = vector_data(meters_vec);
 
   // first pass needed because PI treats indirect & direct meters differently:
   // we need to count and pre-reserve ids for meters of each type before we
   // actually add them to p4info.
-  cJSON *meters_ = cJSON_CreateArray();
-  cJSON *direct_meters_ = cJSON_CreateArray();
-  size_t num_meters = 0, num_direct_meters = 0;
-  cJSON_ArrayForEach(meter, meters) {
-    const cJSON *item = cJSON_GetObjectItem(meter, "is_direct");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    bool is_direct = item->valueint;
-    if (is_direct) {
-      num_direct_meters++;
-      cJSON_AddItemReferenceToArray(direct_meters_, meter);
-    } else {
-      num_meters++;
-      cJSON_AddItemReferenceToArray(meters_, meter);
+  vector_t *indirect_vec =
+      vector_create(sizeof(named_object_t), num_all_meters);
+  vector_t *direct_vec = vector_create(sizeof(named_object_t), num_all_meters);
+  pi_status_t status = PI_STATUS_SUCCESS;
+  for (size_t i = 0; i < num_all_meters; i++) {
+    const cJSON *item =
+        cJSON_GetObjectItem(named_meters[i].object, "is_direct");
+    if (!item) {
+      status = PI_STATUS_CONFIG_READER_ERROR;
+      break;
     }
+    vector_push_back(item->valueint ? direct_vec : indirect_vec,
+                     (void *)&named_meters[i]);
   }
-  pre_reserve_ids(state, PI_METER_ID, meters_);
-  cJSON_Delete(meters_);
-  pi_p4info_meter_init(p4info, num_meters);
-  pre_reserve_ids(state, PI_DIRECT_METER_ID, direct_meters_);
-  cJSON_Delete(direct_meters_);
-  pi_p4info_direct_meter_init(p4info, num_direct_meters);
-
-  sort_json_array(meters);
-  cJSON_ArrayForEach(meter, meters) {
-    const cJSON *item;
-    item = cJSON_GetObjectItem(meter, "name");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    const char *name = item->valuestring;
-
-    item = cJSON_GetObjectItem(meter, "is_direct");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    bool is_direct = item->valueint;
-
-    item = cJSON_GetObjectItem(meter, "size");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    size_t size = item->valueint;
-
-    item = cJSON_GetObjectItem(meter, "type");
-    if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-    const char *meter_unit_str = item->valuestring;
-    pi_p4info_meter_unit_t meter_unit = meter_unit_from_str(meter_unit_str);
-
-    pi_p4_id_t pi_id;
-    if (is_direct) {
-      pi_id = request_id(state, meter, PI_DIRECT_METER_ID);
-      PI_LOG_DEBUG("Adding direct meter '%s'\n", name);
-      item = cJSON_GetObjectItem(meter, "binding");
-      if (!item) return PI_STATUS_CONFIG_READER_ERROR;
-      const char *direct_tname = item->valuestring;
-      pi_p4_id_t direct_tid =
-          pi_p4info_table_id_from_name(p4info, direct_tname);
-      if (direct_tid == PI_INVALID_ID) return PI_STATUS_CONFIG_READER_ERROR;
-      // color unaware by default
-      pi_p4info_direct_meter_add(p4info, pi_id, name, meter_unit,
-                                 PI_P4INFO_METER_TYPE_COLOR_UNAWARE, size,
-                                 direct_tid);
-      pi_p4info_table_add_direct_resource(p4info, direct_tid, pi_id);
-    } else {
-      pi_id = request_id(state, meter, PI_METER_ID);
-      PI_LOG_DEBUG("Adding meter '%s'\n", name);
-      // color unaware by default
-      pi_p4info_meter_add(p4info, pi_id, name, meter_unit,
-                          PI_P4INFO_METER_TYPE_COLOR_UNAWARE, size);
+  size_t num_meters = vector_size(indirect_vec);
+  size_t num_direct_meters = vector_size(direct_vec);
+  if (status == PI_STATUS_SUCCESS) {
+    pre_reserve_ids(state, PI_METER_ID, vector_data(indirect_vec),
+                    num_meters);
+    pi_p4info_meter_init(p4info, num_meters);
+    pre_reserve_ids(state, PI_DIRECT_METER_ID, vector_data(direct_vec),
+                    num_direct_meters);
+    pi_p4info_direct_meter_init(p4info, num_direct_meters);
+  }
+  vector_destroy(indirect_vec);
+  vector_destroy(direct_vec);
+
+  if (status == PI_STATUS_SUCCESS) {
+    sort_named_objects(meters_vec);
+    for (size_t i = 0; i < num_all_meters; i++) {
+      status = read_one_meter(state, &named_meters[i], p4info);
+      if (status != PI_STATUS_SUCCESS) break;
     }
-
-    import_pragmas(meter, p4info, pi_id);
   }
 
-  return PI_STATUS_SUCCESS;
+  vector_destroy(meters_vec);
+  return status;
 }
 
 static bool check_json_version(cJSON *root) {
@@ -23,6 +23,7 @@
 #include "PI/int/serialize.h"
 #include "PI/p4info.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,6 +33,44 @@
 
 #define SAFEGUARD ((int)0xabababab)
 
+// maximum number of destroyed objects kept for reuse, per table / action
+#define POOL_MAX_SIZE 16
+
+// destroyed match keys and action data objects are not freed but cached in a
+// per-table / per-action pool stored in the P4Info, with their layout (offsets
+// of each member) already computed, so that in steady state allocate / destroy
+// do not need to call malloc / free
+
+// the pools are shared by all P4Info objects, critical sections are very short
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// the objects are chained through the first word of their prefix; since the
+// pools live in the P4Info, objects must be destroyed before their P4Info is
+static void *pool_get(pi_p4info_obj_pool_t *pool) {
+  pthread_mutex_lock(&pool_mutex);
+  void *obj = pool->head;
+  if (obj) {
+    pool->head = *(void **)obj;
+    pool->count--;
+  }
+  pthread_mutex_unlock(&pool_mutex);
+  return obj;
+}
+
+// returns 0 if the pool is full, in which case the caller has to free obj
+static int pool_put(pi_p4info_obj_pool_t *pool, void *obj) {
+  int cached = 0;
+  pthread_mutex_lock(&pool_mutex);
+  if (pool->count < POOL_MAX_SIZE) {
+    *(void **)obj = pool->head;
+    pool->head = obj;
+    pool->count++;
+    cached = 1;
+  }
+  pthread_mutex_unlock(&pool_mutex);
+  return cached;
+}
+
 // possibility to unify more the match keys and action data code, but I don't
 // know if they are going to diverge in the future
 
@@ -43,6 +82,7 @@ typedef struct {
 } _fegen_mbr_info_t;
 
 typedef struct {
+  void *pool_next;  // must be first, see pool_get / pool_put
   int safeguard;
   pi_p4_id_t table_id;
   uint32_t nset;
@@ -60,36 +100,48 @@ static size_t get_mk_prefix_space(size_t num_match_fields) {
   return s;
 }
 
+static _fegen_mk_prefix_t *get_mk_prefix(pi_match_key_t *key) {
+  char *back_ptr = ((char *)key) - ALIGN;
+  return *(_fegen_mk_prefix_t **)back_ptr;
+}
+
+static void check_mk_prefix(const _fegen_mk_prefix_t *prefix) {
+  _PI_UNUSED(prefix);
+  assert(prefix->safeguard == SAFEGUARD);
+}
+
 pi_status_t pi_match_key_allocate(const pi_p4info_t *p4info,
                                   const pi_p4_id_t table_id,
                                   pi_match_key_t **key) {
-  size_t s = 0;
+  pi_p4info_obj_pool_t *pool = pi_p4info_table_match_key_pool(p4info, table_id);
+  _fegen_mk_prefix_t *prefix = pool_get(pool);
+  if (prefix) {
+    check_mk_prefix(prefix);
+    *key = (pi_match_key_t *)((char *)prefix +
+                              get_mk_prefix_space(prefix->num_fields));
+    return pi_match_key_init(*key);
+  }
 
   size_t num_match_fields = pi_p4info_table_num_match_fields(p4info, table_id);
-
-  _fegen_mbr_info_t *offsets =
-      malloc(sizeof(_fegen_mbr_info_t) * num_match_fields);
-
-  for (size_t i = 0; i < num_match_fields; i++) {
-    offsets[i].is_set = 0;
-    offsets[i].offset = s;
-    const pi_p4info_match_field_info_t *finfo =
-        pi_p4info_table_match_field_info(p4info, table_id, i);
-    s += get_match_key_size_one_field(finfo->match_type, finfo->bitwidth);
-  }
-  size_t mk_size = s;
+  // the offsets of the fields are precomputed in the P4Info
+  size_t mk_size = pi_p4info_table_match_key_size(p4info, table_id);
 
   size_t prefix_space = get_mk_prefix_space(num_match_fields);
-  s += prefix_space;
-  s += sizeof(pi_match_key_t);
+  size_t s = prefix_space + sizeof(pi_match_key_t) + mk_size;
   char *key_w_prefix = malloc(s);
-  _fegen_mk_prefix_t *prefix = (_fegen_mk_prefix_t *)key_w_prefix;
+  prefix = (_fegen_mk_prefix_t *)key_w_prefix;
+  prefix->pool_next = NULL;
   prefix->safeguard = SAFEGUARD;
   prefix->nset = 0;
   prefix->num_fields = num_match_fields;
   prefix->table_id = table_id;
-  memcpy(prefix->f_info, offsets, sizeof(prefix->f_info[0]) * num_match_fields);
-  free(offsets);
+  for (size_t i = 0; i < num_match_fields; i++) {
+    const pi_p4info_match_field_info_t *finfo =
+        pi_p4info_table_match_field_info(p4info, table_id, i);
+    prefix->f_info[i].is_set = 0;
+    prefix->f_info[i].offset =
+        pi_p4info_table_match_field_offset(p4info, table_id, finfo->mf_id);
+  }
 
   *key = (pi_match_key_t *)(key_w_prefix + prefix_space);
   (*key)->p4info = p4info;
@@ -104,16 +156,6 @@ pi_status_t pi_match_key_allocate(const pi_p4info_t *p4info,
   return PI_STATUS_SUCCESS;
 }
 
-static _fegen_mk_prefix_t *get_mk_prefix(pi_match_key_t *key) {
-  char *back_ptr = ((char *)key) - ALIGN;
-  return *(_fegen_mk_prefix_t **)back_ptr;
-}
-
-static void check_mk_prefix(const _fegen_mk_prefix_t *prefix) {
-  _PI_UNUSED(prefix);
-  assert(prefix->safeguard == SAFEGUARD);
-}
-
 pi_status_t pi_match_key_init(pi_match_key_t *key) {
   key->priority = 0;
   _fegen_mk_prefix_t *prefix = get_mk_prefix(key);
@@ -246,13 +288,16 @@ pi_status_t pi_match_key_range_get(const pi_match_key_t *key, pi_p4_id_t fid,
 pi_status_t pi_match_key_destroy(pi_match_key_t *key) {
   _fegen_mk_prefix_t *prefix = get_mk_prefix(key);
   check_mk_prefix(prefix);
-  free(prefix);
+  pi_p4info_obj_pool_t *pool =
+      pi_p4info_table_match_key_pool(key->p4info, prefix->table_id);
+  if (!pool_put(pool, prefix)) free(prefix);
   return PI_STATUS_SUCCESS;
 }
 
 // ACTION DATA
 
 typedef struct {
+  void *pool_next;  // must be first, see pool_get / pool_put
   int safeguard;
   pi_p4_id_t action_id;
   uint32_t nset;
@@ -270,37 +315,48 @@ static size_t get_ad_prefix_space(size_t num_params) {
   return s;
 }
 
+static _fegen_ad_prefix_t *get_ad_prefix(pi_action_data_t *adata) {
+  char *back_ptr = ((char *)adata) - ALIGN;
+  return *(_fegen_ad_prefix_t **)back_ptr;
+}
+
+static void check_ad_prefix(const _fegen_ad_prefix_t *prefix) {
+  _PI_UNUSED(prefix);
+  assert(prefix->safeguard == SAFEGUARD);
+}
+
 pi_status_t pi_action_data_allocate(const pi_p4info_t *p4info,
                                     const pi_p4_id_t action_id,
                                     pi_action_data_t **adata) {
-  size_t s = 0;
+  pi_p4info_obj_pool_t *pool = pi_p4info_action_data_pool(p4info, action_id);
+  _fegen_ad_prefix_t *prefix = pool_get(pool);
+  if (prefix) {
+    check_ad_prefix(prefix);
+    *adata = (pi_action_data_t *)((char *)prefix +
+                                  get_ad_prefix_space(prefix->num_params));
+    return pi_action_data_init(*adata);
+  }
 
   size_t num_params;
   const pi_p4_id_t *params =
       pi_p4info_action_get_params(p4info, action_id, &num_params);
-
-  _fegen_mbr_info_t *offsets = malloc(sizeof(_fegen_mbr_info_t) * num_params);
-
-  for (size_t i = 0; i < num_params; i++) {
-    size_t bitwidth =
-        pi_p4info_action_param_bitwidth(p4info, action_id, params[i]);
-    offsets[i].is_set = 0;
-    offsets[i].offset = s;
-    s += (bitwidth + 7) / 8;
-  }
-  size_t ad_size = s;
+  // the offsets of the parameters are precomputed in the P4Info
+  size_t ad_size = pi_p4info_action_data_size(p4info, action_id);
 
   size_t prefix_space = get_ad_prefix_space(num_params);
-  s += prefix_space;
-  s += sizeof(pi_action_data_t);
+  size_t s = prefix_space + sizeof(pi_action_data_t) + ad_size;
   char *adata_w_prefix = malloc(s);
-  _fegen_ad_prefix_t *prefix = (_fegen_ad_prefix_t *)adata_w_prefix;
+  prefix = (_fegen_ad_prefix_t *)adata_w_prefix;
+  prefix->pool_next = NULL;
   prefix->safeguard = SAFEGUARD;
   prefix->nset = 0;
   prefix->num_params = num_params;
   prefix->action_id = action_id;
-  memcpy(prefix->p_info, offsets, sizeof(prefix->p_info[0]) * num_params);
-  free(offsets);
+  for (size_t i = 0; i < num_params; i++) {
+    prefix->p_info[i].is_set = 0;
+    prefix->p_info[i].offset =
+        pi_p4info_action_param_offset(p4info, action_id, params[i]);
+  }
 
   *adata = (pi_action_data_t *)(adata_w_prefix + prefix_space);
   (*adata)->p4info = p4info;
@@ -314,16 +370,6 @@ pi_status_t pi_action_data_allocate(const pi_p4info_t *p4info,
   return PI_STATUS_SUCCESS;
 }
 
-static _fegen_ad_prefix_t *get_ad_prefix(pi_action_data_t *adata) {
-  char *back_ptr = ((char *)adata) - ALIGN;
-  return *(_fegen_ad_prefix_t **)back_ptr;
-}
-
-static void check_ad_prefix(const _fegen_ad_prefix_t *prefix) {
-  _PI_UNUSED(prefix);
-  assert(prefix->safeguard == SAFEGUARD);
-}
-
 pi_status_t pi_action_data_init(pi_action_data_t *adata) {
   _fegen_ad_prefix_t *prefix = get_ad_prefix(adata);
   check_ad_prefix(prefix);
@@ -370,6 +416,8 @@ pi_status_t pi_action_data_arg_get(const pi_action_data_t *adata,
 pi_status_t pi_action_data_destroy(pi_action_data_t *action_data) {
   _fegen_ad_prefix_t *prefix = get_ad_prefix(action_data);
   check_ad_prefix(prefix);
-  free(prefix);
+  pi_p4info_obj_pool_t *pool =
+      pi_p4info_action_data_pool(action_data->p4info, prefix->action_id);
+  if (!pool_put(pool, prefix)) free(prefix);
   return PI_STATUS_SUCCESS;
 }
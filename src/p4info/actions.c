@@ -54,6 +54,8 @@ typedef struct _action_data_s {
   } param_data;
   size_t action_data_size;
   size_t params_added;
+  // action data objects cached by the generic frontend
+  pi_p4info_obj_pool_t action_data_pool;
 } _action_data_t;
 
 static _action_data_t *get_action(const pi_p4info_t *p4info,
@@ -115,6 +117,7 @@ static void free_action_data(void *data) {
     free(action->param_ids.indirect);
     free(action->param_data.indirect);
   }
+  p4info_obj_pool_destroy(&action->action_data_pool);
   p4info_common_destroy(&action->common);
 }
 
@@ -164,6 +167,7 @@ void pi_p4info_action_add(pi_p4info_t *p4info, pi_p4_id_t action_id,
   }
   action->action_data_size = 0;
   action->params_added = 0;
+  p4info_obj_pool_init(&action->action_data_pool);
 }
 
 static char get_byte0_mask(size_t bitwidth) {
@@ -286,6 +290,12 @@ size_t pi_p4info_action_data_size(const pi_p4info_t *p4info,
     return action->action_data_size;
 }
 
+pi_p4info_obj_pool_t *pi_p4info_action_data_pool(const pi_p4info_t *p4info,
+                                                 pi_p4_id_t action_id) {
+  _action_data_t *action = get_action(p4info, action_id);
+  return &action->action_data_pool;
+}
+
 pi_p4_id_t pi_p4info_action_begin(const pi_p4info_t *p4info) {
   return pi_p4info_any_begin(p4info, PI_ACTION_ID);
 }
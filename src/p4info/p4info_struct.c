@@ -24,6 +24,8 @@
 
 #include <PI/p4info.h>
 
+#include <stdlib.h>
+
 void p4info_init_res(pi_p4info_t *p4info, pi_res_type_id_t res_type, size_t num,
                      size_t e_size, P4InfoRetrieveNameFn retrieve_name_fn,
                      P4InfoFreeOneFn free_fn, P4InfoSerializeFn serialize_fn) {
@@ -55,6 +57,21 @@ void p4info_struct_destroy(pi_p4info_t *p4info) {
   }
 }
 
+void p4info_obj_pool_init(pi_p4info_obj_pool_t *pool) {
+  pool->head = NULL;
+  pool->count = 0;
+}
+
+void p4info_obj_pool_destroy(pi_p4info_obj_pool_t *pool) {
+  void *obj = pool->head;
+  while (obj) {
+    void *next = *(void **)obj;
+    free(obj);
+    obj = next;
+  }
+  p4info_obj_pool_init(pool);
+}
+
 // C1x §6.7.2.1.13: "A pointer to a structure object, suitably converted, points
 // to its initial member ... and vice versa. There may be unnamed padding within
 // as structure object, but not at its beginning."
@@ -86,6 +86,11 @@ void p4info_init_res(pi_p4info_t *p4info, pi_res_type_id_t res_type, size_t num,
 
 void p4info_struct_destroy(pi_p4info_t *p4info);
 
+void p4info_obj_pool_init(pi_p4info_obj_pool_t *pool);
+
+// frees all the objects remaining in the pool
+void p4info_obj_pool_destroy(pi_p4info_obj_pool_t *pool);
+
 void *p4info_add_res(pi_p4info_t *p4info, pi_p4_id_t id, const char *name);
 
 #endif  // PI_SRC_P4INFO_P4INFO_STRUCT_H_
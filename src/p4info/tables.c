@@ -69,6 +69,8 @@ typedef struct _table_data_s {
   size_t max_size;
   size_t match_key_size;
   bool is_const;  // immutable table with program-provided entries
+  // match key objects cached by the generic frontend
+  pi_p4info_obj_pool_t match_key_pool;
 } _table_data_t;
 
 static _table_data_t *get_table(const pi_p4info_t *p4info,
@@ -142,6 +144,7 @@ static void free_table_data(void *data) {
     free(table->action_ids.indirect);
   }
   ID_VECTOR_DESTROY(table->direct_resources);
+  p4info_obj_pool_destroy(&table->match_key_pool);
   p4info_common_destroy(&table->common);
 }
 
@@ -233,6 +236,7 @@ void pi_p4info_table_add(pi_p4info_t *p4info, pi_p4_id_t table_id,
   table->max_size = max_size;
   table->match_key_size = 0;
   table->is_const = is_const;
+  p4info_obj_pool_init(&table->match_key_pool);
 }
 
 static char get_byte0_mask(size_t bitwidth) {
@@ -394,6 +398,12 @@ size_t pi_p4info_table_match_key_size(const pi_p4info_t *p4info,
   return table->match_key_size;
 }
 
+pi_p4info_obj_pool_t *pi_p4info_table_match_key_pool(const pi_p4info_t *p4info,
+                                                     pi_p4_id_t table_id) {
+  _table_data_t *table = get_table(p4info, table_id);
+  return &table->match_key_pool;
+}
+
 const pi_p4info_match_field_info_t *pi_p4info_table_match_field_info(
     const pi_p4info_t *p4info, pi_p4_id_t table_id, size_t index) {
   _table_data_t *table = get_table(p4info, table_id);
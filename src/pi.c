@@ -24,6 +24,7 @@
 #include "PI/target/pi_imp.h"
 #include "_assert.h"
 #include "device_map.h"
+#include "pi_counter_sweeper.h"
 #include "utils/logging.h"
 #include "vector.h"
 
@@ -154,7 +155,12 @@ pi_status_t pi_update_device_start(pi_dev_id_t dev_id,
                                    size_t device_data_size) {
   pi_status_t status =
       _pi_update_device_start(dev_id, p4info, device_data, device_data_size);
-  if (status == PI_STATUS_SUCCESS) pi_update_device_config(dev_id, p4info);
+  if (status == PI_STATUS_SUCCESS) {
+    // counter ids may refer to different counters in the new P4 program; if
+    // the update failed, the old program is still in place and so are sweeps
+    pi_counter_sweeper_remove_device(dev_id);
+    pi_update_device_config(dev_id, p4info);
+  }
 
   return status;
 }
@@ -182,6 +188,7 @@ pi_status_t pi_remove_device(pi_dev_id_t dev_id) {
   pi_device_info_t *info = pi_get_device_info(dev_id);
   if (!info) return PI_STATUS_DEV_NOT_ASSIGNED;
 
+  pi_counter_sweeper_remove_device(dev_id);
   pi_status_t status = _pi_remove_device(dev_id);
 
   vector_remove_e(device_arr, (void *)info);
@@ -211,6 +218,7 @@ pi_status_t pi_batch_end(pi_session_handle_t session_handle, bool hw_sync) {
 }
 
 pi_status_t pi_destroy() {
+  pi_counter_sweeper_destroy();
   vector_destroy(device_arr);
   device_map_destroy(&device_map);
   device_map_destroy(&device_packetin_cb_data);
@@ -303,6 +311,19 @@ pi_status_t pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
   return _pi_packetout_send(dev_id, pkt, size);
 }
 
+pi_status_t pi_packetout_send_batch(pi_dev_id_t dev_id, const char *const *pkts,
+                                    const size_t *sizes, size_t num_pkts) {
+  if (num_pkts == 0) return PI_STATUS_SUCCESS;
+  pi_status_t status = _pi_packetout_send_batch(dev_id, pkts, sizes, num_pkts);
+  if (status != PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) return status;
+
+  for (size_t i = 0; i < num_pkts; i++) {
+    status = _pi_packetout_send(dev_id, pkts[i], sizes[i]);
+    if (status != PI_STATUS_SUCCESS) return status;
+  }
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t pi_packetin_receive(pi_dev_id_t dev_id, const char *pkt,
                                 size_t size) {
   packetin_cb_data_t *packetin_cb_data =
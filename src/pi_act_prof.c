@@ -80,6 +80,46 @@ pi_status_t pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
                                      grp_handle, mbr_handle);
 }
 
+// groups are deleted first, since members cannot be deleted while they belong
+// to a group on some targets
+static pi_status_t act_prof_delete_all(pi_session_handle_t session_handle,
+                                       pi_dev_id_t dev_id,
+                                       pi_p4_id_t act_prof_id) {
+  pi_act_prof_fetch_res_t *res;
+  pi_status_t status =
+      pi_act_prof_entries_fetch(session_handle, dev_id, act_prof_id, &res);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  size_t num_grps = pi_act_prof_grps_num(res);
+  for (size_t i = 0; i < num_grps && status == PI_STATUS_SUCCESS; i++) {
+    pi_indirect_handle_t *mbrs;
+    size_t num_mbrs;
+    pi_indirect_handle_t grp_handle;
+    pi_act_prof_grps_next(res, &mbrs, &num_mbrs, &grp_handle);
+    status = _pi_act_prof_grp_delete(session_handle, dev_id, act_prof_id,
+                                     grp_handle);
+  }
+  size_t num_mbrs = pi_act_prof_mbrs_num(res);
+  for (size_t i = 0; i < num_mbrs && status == PI_STATUS_SUCCESS; i++) {
+    pi_action_data_t *action_data;
+    pi_indirect_handle_t mbr_handle;
+    pi_act_prof_mbrs_next(res, &action_data, &mbr_handle);
+    status = _pi_act_prof_mbr_delete(session_handle, dev_id, act_prof_id,
+                                     mbr_handle);
+  }
+
+  pi_status_t done_status = pi_act_prof_entries_fetch_done(session_handle, res);
+  return (status != PI_STATUS_SUCCESS) ? status : done_status;
+}
+
+pi_status_t pi_act_prof_clear(pi_session_handle_t session_handle,
+                              pi_dev_id_t dev_id, pi_p4_id_t act_prof_id) {
+  if (!pi_get_device_p4info(dev_id)) return PI_STATUS_DEV_NOT_ASSIGNED;
+  pi_status_t status = _pi_act_prof_clear(session_handle, dev_id, act_prof_id);
+  if (status != PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) return status;
+  return act_prof_delete_all(session_handle, dev_id, act_prof_id);
+}
+
 pi_status_t pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
                                       pi_dev_id_t dev_id,
                                       pi_p4_id_t act_prof_id,
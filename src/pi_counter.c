@@ -22,6 +22,8 @@
 #include <PI/pi_counter.h>
 #include <PI/target/pi_counter_imp.h>
 
+#include "pi_counter_sweeper.h"
+
 static bool is_direct_counter(const pi_p4info_t *p4info,
                               pi_p4_id_t counter_id) {
   return (pi_p4info_counter_get_direct(p4info, counter_id) != PI_INVALID_ID);
@@ -34,6 +36,12 @@ pi_status_t pi_counter_read(pi_session_handle_t session_handle,
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
   if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
   if (is_direct_counter(p4info, counter_id)) return PI_STATUS_COUNTER_IS_DIRECT;
+  if (flags & PI_COUNTER_FLAGS_SW_SHADOW) {
+    pi_status_t status = pi_counter_sweeper_read(dev_tgt.dev_id, counter_id,
+                                                 index, counter_data);
+    if (status != PI_STATUS_COUNTER_NOT_SWEPT) return status;
+    flags &= ~PI_COUNTER_FLAGS_SW_SHADOW;
+  }
   return _pi_counter_read(session_handle, dev_tgt, counter_id, index, flags,
                           counter_data);
 }
@@ -45,8 +53,12 @@ pi_status_t pi_counter_write(pi_session_handle_t session_handle,
   const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
   if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
   if (is_direct_counter(p4info, counter_id)) return PI_STATUS_COUNTER_IS_DIRECT;
-  return _pi_counter_write(session_handle, dev_tgt, counter_id, index,
-                           counter_data);
+  pi_status_t status = _pi_counter_write(session_handle, dev_tgt, counter_id,
+                                         index, counter_data);
+  if (status == PI_STATUS_SUCCESS)
+    pi_counter_sweeper_on_write(dev_tgt.dev_id, counter_id, index,
+                                counter_data);
+  return status;
 }
 
 pi_status_t pi_counter_read_direct(pi_session_handle_t session_handle,
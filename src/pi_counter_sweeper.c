@@ -0,0 +1,440 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include <PI/int/pi_int.h>
+#include <PI/pi.h>
+#include <PI/pi_counter.h>
+#include <PI/target/pi_counter_imp.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pi_counter_sweeper.h"
+#include "vector.h"
+
+// There is one sweeper thread for all devices. It goes through the swept
+// counters in a loop and starts a HW sync for each counter whose next sweep is
+// due. Once the target has synced the counter (i.e. when the HW sync callback
+// is called), all the entries are read from the target and the increments
+// since the previous sweep are accumulated into the 64-bit software shadow. A
+// given counter is never swept more than once at a time; the sweeper thread
+// goes on with the other counters while a sweep is in progress.
+
+typedef struct {
+  pi_dev_tgt_t dev_tgt;
+  pi_p4_id_t counter_id;
+  uint32_t interval_ms;
+  uint64_t wrap_mask;
+  size_t size;
+  // values read from the target by the last sweep
+  pi_counter_data_t *hw_last;
+  // accumulated values
+  pi_counter_data_t *shadow;
+  // increments over the last sweep interval
+  pi_counter_data_t *delta;
+  // values read from the target by the in-progress sweep
+  pi_counter_data_t *scratch;
+  struct timespec next_sweep;
+  // incremented by pi_counter_write; the results of a sweep are discarded if a
+  // write happened while the sweep was in progress
+  uint64_t writes;
+  uint64_t writes_at_sweep_start;
+  bool in_progress;
+  // false until the first sweep completes
+  bool primed;
+} sweep_entry_t;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  // signaled when the sweeper thread needs to re-evaluate the next due sweep
+  pthread_cond_t cond;
+  // signaled every time a sweep completes
+  pthread_cond_t done_cond;
+  pthread_t thread;
+  bool running;
+  bool stop;
+  pi_session_handle_t session;
+  // vector of sweep_entry_t *
+  vector_t *entries;
+} sweeper_t;
+
+static sweeper_t sweeper = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static void time_now(struct timespec *ts) {
+  clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+static void time_add_ms(struct timespec *ts, uint32_t ms) {
+  ts->tv_sec += ms / 1000;
+  ts->tv_nsec += (long)(ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+static int time_cmp(const struct timespec *ts1, const struct timespec *ts2) {
+  if (ts1->tv_sec != ts2->tv_sec) return (ts1->tv_sec < ts2->tv_sec) ? -1 : 1;
+  if (ts1->tv_nsec != ts2->tv_nsec)
+    return (ts1->tv_nsec < ts2->tv_nsec) ? -1 : 1;
+  return 0;
+}
+
+static uint64_t make_wrap_mask(uint32_t hw_width) {
+  return (hw_width == 0 || hw_width >= 64) ? UINT64_MAX
+                                           : ((uint64_t)1 << hw_width) - 1;
+}
+
+// mutex must be held
+static sweep_entry_t *find_entry(pi_dev_id_t dev_id, pi_p4_id_t counter_id,
+                                 size_t *idx) {
+  if (sweeper.entries == NULL) return NULL;
+  sweep_entry_t **entries = vector_data(sweeper.entries);
+  size_t num_entries = vector_size(sweeper.entries);
+  for (size_t i = 0; i < num_entries; i++) {
+    if (entries[i]->dev_tgt.dev_id == dev_id &&
+        entries[i]->counter_id == counter_id) {
+      if (idx) *idx = i;
+      return entries[i];
+    }
+  }
+  return NULL;
+}
+
+static sweep_entry_t *entry_create(pi_dev_tgt_t dev_tgt,
+                                   pi_p4_id_t counter_id, size_t size,
+                                   const pi_counter_sweep_config_t *config) {
+  sweep_entry_t *e = calloc(1, sizeof(*e));
+  e->dev_tgt = dev_tgt;
+  e->counter_id = counter_id;
+  e->interval_ms = config->interval_ms;
+  e->wrap_mask = make_wrap_mask(config->hw_width);
+  e->size = size;
+  e->hw_last = calloc(size, sizeof(pi_counter_data_t));
+  e->shadow = calloc(size, sizeof(pi_counter_data_t));
+  e->delta = calloc(size, sizeof(pi_counter_data_t));
+  e->scratch = calloc(size, sizeof(pi_counter_data_t));
+  // first sweep is done right away
+  time_now(&e->next_sweep);
+  return e;
+}
+
+static void entry_destroy(sweep_entry_t *e) {
+  free(e->hw_last);
+  free(e->shadow);
+  free(e->delta);
+  free(e->scratch);
+  free(e);
+}
+
+// mutex must be held; the entry is removed from the vector right away, so that
+// it cannot be found anymore, but we need to wait for an in-progress sweep to
+// complete before releasing the memory
+static void entry_remove(size_t idx) {
+  sweep_entry_t *e = *(sweep_entry_t **)vector_at(sweeper.entries, idx);
+  vector_remove(sweeper.entries, idx);
+  while (e->in_progress)
+    pthread_cond_wait(&sweeper.done_cond, &sweeper.mutex);
+  entry_destroy(e);
+}
+
+// mutex must be held
+static void accumulate(sweep_entry_t *e) {
+  uint64_t mask = e->wrap_mask;
+  for (size_t i = 0; i < e->size; i++) {
+    const pi_counter_data_t *current = &e->scratch[i];
+    pi_counter_data_t *delta = &e->delta[i];
+    pi_counter_data_t *shadow = &e->shadow[i];
+    if (e->primed) {
+      delta->packets = (current->packets - e->hw_last[i].packets) & mask;
+      delta->bytes = (current->bytes - e->hw_last[i].bytes) & mask;
+      shadow->packets += delta->packets;
+      shadow->bytes += delta->bytes;
+    } else {
+      delta->packets = 0;
+      delta->bytes = 0;
+      shadow->packets = current->packets;
+      shadow->bytes = current->bytes;
+    }
+    delta->valid = current->valid;
+    shadow->valid = current->valid;
+    e->hw_last[i] = *current;
+  }
+  e->primed = true;
+}
+
+static void sweep_done(sweep_entry_t *e, pi_status_t status) {
+  pthread_mutex_lock(&sweeper.mutex);
+  if (status == PI_STATUS_SUCCESS && e->writes == e->writes_at_sweep_start)
+    accumulate(e);
+  e->in_progress = false;
+  pthread_cond_broadcast(&sweeper.done_cond);
+  pthread_cond_signal(&sweeper.cond);
+  pthread_mutex_unlock(&sweeper.mutex);
+}
+
+// the in_progress flag guarantees that the entry cannot be released while we
+// are reading into scratch, which is only accessed by the in-progress sweep
+static pi_status_t read_entries(sweep_entry_t *e) {
+  memset(e->scratch, 0, e->size * sizeof(*e->scratch));
+  for (size_t i = 0; i < e->size; i++) {
+    pi_status_t status =
+        _pi_counter_read(sweeper.session, e->dev_tgt, e->counter_id, i,
+                         PI_COUNTER_FLAGS_NONE, &e->scratch[i]);
+    if (status != PI_STATUS_SUCCESS) return status;
+  }
+  return PI_STATUS_SUCCESS;
+}
+
+static void hw_sync_cb(pi_dev_id_t dev_id, pi_p4_id_t counter_id,
+                       void *cb_cookie) {
+  (void)dev_id;
+  (void)counter_id;
+  sweep_entry_t *e = (sweep_entry_t *)cb_cookie;
+  sweep_done(e, read_entries(e));
+}
+
+static bool is_not_implemented(pi_status_t status) {
+  return status == PI_STATUS_NOT_IMPLEMENTED_BY_TARGET ||
+         status == PI_STATUS_RPC_NOT_IMPLEMENTED;
+}
+
+// called without holding the mutex
+static void sweep_start(sweep_entry_t *e) {
+  pi_status_t status = _pi_counter_hw_sync(sweeper.session, e->dev_tgt,
+                                           e->counter_id, hw_sync_cb, e);
+  if (status == PI_STATUS_SUCCESS) return;  // hw_sync_cb will be called
+  // fall back to a blocking HW sync for targets which do not support the
+  // callback, and to reading the counter directly for targets which do not
+  // support HW sync at all
+  if (is_not_implemented(status)) {
+    status = _pi_counter_hw_sync(sweeper.session, e->dev_tgt, e->counter_id,
+                                 NULL, NULL);
+    if (status == PI_STATUS_SUCCESS || is_not_implemented(status))
+      status = read_entries(e);
+  }
+  sweep_done(e, status);
+}
+
+static void *sweeper_loop(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&sweeper.mutex);
+  while (!sweeper.stop) {
+    struct timespec now;
+    time_now(&now);
+    sweep_entry_t *due = NULL;
+    struct timespec next_deadline;
+    bool has_deadline = false;
+    sweep_entry_t **entries = vector_data(sweeper.entries);
+    size_t num_entries = vector_size(sweeper.entries);
+    for (size_t i = 0; i < num_entries; i++) {
+      sweep_entry_t *e = entries[i];
+      if (e->in_progress) continue;
+      if (time_cmp(&e->next_sweep, &now) <= 0) {
+        due = e;
+        break;
+      }
+      if (!has_deadline || time_cmp(&e->next_sweep, &next_deadline) < 0) {
+        next_deadline = e->next_sweep;
+        has_deadline = true;
+      }
+    }
+    if (due) {
+      due->in_progress = true;
+      due->writes_at_sweep_start = due->writes;
+      due->next_sweep = now;
+      time_add_ms(&due->next_sweep, due->interval_ms);
+      pthread_mutex_unlock(&sweeper.mutex);
+      sweep_start(due);
+      pthread_mutex_lock(&sweeper.mutex);
+    } else if (has_deadline) {
+      pthread_cond_timedwait(&sweeper.cond, &sweeper.mutex, &next_deadline);
+    } else {
+      pthread_cond_wait(&sweeper.cond, &sweeper.mutex);
+    }
+  }
+  pthread_mutex_unlock(&sweeper.mutex);
+  return NULL;
+}
+
+// mutex must be held
+static pi_status_t sweeper_start_thread() {
+  if (sweeper.running) return PI_STATUS_SUCCESS;
+  pi_status_t status = pi_session_init(&sweeper.session);
+  if (status != PI_STATUS_SUCCESS) return status;
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&sweeper.cond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&sweeper.done_cond, NULL);
+  sweeper.entries = vector_create(sizeof(sweep_entry_t *), 16);
+  sweeper.stop = false;
+  if (pthread_create(&sweeper.thread, NULL, sweeper_loop, NULL) != 0) {
+    vector_destroy(sweeper.entries);
+    sweeper.entries = NULL;
+    pthread_cond_destroy(&sweeper.cond);
+    pthread_cond_destroy(&sweeper.done_cond);
+    pi_session_cleanup(sweeper.session);
+    return PI_STATUS_ALLOC_ERROR;
+  }
+  sweeper.running = true;
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t pi_counter_sweep_start(pi_dev_tgt_t dev_tgt,
+                                   pi_p4_id_t counter_id,
+                                   const pi_counter_sweep_config_t *config) {
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_tgt.dev_id);
+  if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
+  if (pi_p4info_counter_get_direct(p4info, counter_id) != PI_INVALID_ID)
+    return PI_STATUS_COUNTER_IS_DIRECT;
+  if (config->interval_ms == 0) return PI_STATUS_INVALID_COUNTER_SWEEP_CONFIG;
+  size_t size = pi_p4info_counter_get_size(p4info, counter_id);
+
+  pthread_mutex_lock(&sweeper.mutex);
+  pi_status_t status = sweeper_start_thread();
+  if (status != PI_STATUS_SUCCESS) {
+    pthread_mutex_unlock(&sweeper.mutex);
+    return status;
+  }
+  sweep_entry_t *e = find_entry(dev_tgt.dev_id, counter_id, NULL);
+  if (e) {
+    // only takes effect after the next sweep
+    e->interval_ms = config->interval_ms;
+    e->wrap_mask = make_wrap_mask(config->hw_width);
+  } else {
+    e = entry_create(dev_tgt, counter_id, size, config);
+    vector_push_back(sweeper.entries, &e);
+  }
+  pthread_cond_signal(&sweeper.cond);
+  pthread_mutex_unlock(&sweeper.mutex);
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t pi_counter_sweep_stop(pi_dev_id_t dev_id, pi_p4_id_t counter_id) {
+  pthread_mutex_lock(&sweeper.mutex);
+  size_t idx;
+  sweep_entry_t *e = find_entry(dev_id, counter_id, &idx);
+  if (e) entry_remove(idx);
+  pthread_mutex_unlock(&sweeper.mutex);
+  return e ? PI_STATUS_SUCCESS : PI_STATUS_COUNTER_NOT_SWEPT;
+}
+
+pi_status_t pi_counter_read_delta(pi_dev_tgt_t dev_tgt,
+                                  pi_p4_id_t counter_id, size_t index,
+                                  pi_counter_data_t *delta) {
+  pi_status_t status = PI_STATUS_SUCCESS;
+  pthread_mutex_lock(&sweeper.mutex);
+  sweep_entry_t *e = find_entry(dev_tgt.dev_id, counter_id, NULL);
+  if (!e)
+    status = PI_STATUS_COUNTER_NOT_SWEPT;
+  else if (index >= e->size)
+    status = PI_STATUS_OUT_OF_BOUND_IDX;
+  else if (!e->primed)
+    memset(delta, 0, sizeof(*delta));
+  else
+    *delta = e->delta[index];
+  pthread_mutex_unlock(&sweeper.mutex);
+  return status;
+}
+
+pi_status_t pi_counter_sweeper_read(pi_dev_id_t dev_id, pi_p4_id_t counter_id,
+                                    size_t index,
+                                    pi_counter_data_t *counter_data) {
+  pi_status_t status = PI_STATUS_SUCCESS;
+  pthread_mutex_lock(&sweeper.mutex);
+  sweep_entry_t *e = find_entry(dev_id, counter_id, NULL);
+  // until the first sweep completes, reads go to the target
+  if (!e || !e->primed)
+    status = PI_STATUS_COUNTER_NOT_SWEPT;
+  else if (index >= e->size)
+    status = PI_STATUS_OUT_OF_BOUND_IDX;
+  else
+    *counter_data = e->shadow[index];
+  pthread_mutex_unlock(&sweeper.mutex);
+  return status;
+}
+
+void pi_counter_sweeper_on_write(pi_dev_id_t dev_id, pi_p4_id_t counter_id,
+                                 size_t index,
+                                 const pi_counter_data_t *counter_data) {
+  pthread_mutex_lock(&sweeper.mutex);
+  sweep_entry_t *e = find_entry(dev_id, counter_id, NULL);
+  if (e && index < e->size) {
+    e->writes++;
+    pi_counter_data_t *shadow = &e->shadow[index];
+    pi_counter_data_t *hw_last = &e->hw_last[index];
+    if (counter_data->valid & PI_COUNTER_UNIT_PACKETS) {
+      shadow->packets = counter_data->packets;
+      hw_last->packets = counter_data->packets & e->wrap_mask;
+    }
+    if (counter_data->valid & PI_COUNTER_UNIT_BYTES) {
+      shadow->bytes = counter_data->bytes;
+      hw_last->bytes = counter_data->bytes & e->wrap_mask;
+    }
+  }
+  pthread_mutex_unlock(&sweeper.mutex);
+}
+
+void pi_counter_sweeper_remove_device(pi_dev_id_t dev_id) {
+  pthread_mutex_lock(&sweeper.mutex);
+  if (sweeper.entries != NULL) {
+    size_t i = 0;
+    while (i < vector_size(sweeper.entries)) {
+      sweep_entry_t *e = *(sweep_entry_t **)vector_at(sweeper.entries, i);
+      if (e->dev_tgt.dev_id == dev_id) {
+        entry_remove(i);
+        // entry_remove may release the mutex, so we start over
+        i = 0;
+      } else {
+        i++;
+      }
+    }
+  }
+  pthread_mutex_unlock(&sweeper.mutex);
+}
+
+void pi_counter_sweeper_destroy() {
+  pthread_mutex_lock(&sweeper.mutex);
+  if (!sweeper.running) {
+    pthread_mutex_unlock(&sweeper.mutex);
+    return;
+  }
+  while (vector_size(sweeper.entries) > 0) entry_remove(0);
+  sweeper.stop = true;
+  pthread_cond_signal(&sweeper.cond);
+  pthread_mutex_unlock(&sweeper.mutex);
+  pthread_join(sweeper.thread, NULL);
+
+  pthread_mutex_lock(&sweeper.mutex);
+  vector_destroy(sweeper.entries);
+  sweeper.entries = NULL;
+  pthread_cond_destroy(&sweeper.cond);
+  pthread_cond_destroy(&sweeper.done_cond);
+  pi_session_cleanup(sweeper.session);
+  sweeper.running = false;
+  pthread_mutex_unlock(&sweeper.mutex);
+}
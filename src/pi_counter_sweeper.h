@@ -0,0 +1,47 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_SRC_PI_COUNTER_SWEEPER_H_
+#define PI_SRC_PI_COUNTER_SWEEPER_H_
+
+#include <PI/pi_counter.h>
+
+// Internal hooks for the counter sweeper; the public API is in pi_counter.h.
+
+// Copies the software shadow for the counter entry to counter_data; returns
+// PI_STATUS_COUNTER_NOT_SWEPT if the counter is not being swept or if the first
+// sweep has not completed yet.
+pi_status_t pi_counter_sweeper_read(pi_dev_id_t dev_id, pi_p4_id_t counter_id,
+                                    size_t index,
+                                    pi_counter_data_t *counter_data);
+
+// Called after a successful pi_counter_write, so that the shadow reflects the
+// new value.
+void pi_counter_sweeper_on_write(pi_dev_id_t dev_id, pi_p4_id_t counter_id,
+                                 size_t index,
+                                 const pi_counter_data_t *counter_data);
+
+// Stops all the sweeps for the device.
+void pi_counter_sweeper_remove_device(pi_dev_id_t dev_id);
+
+// Stops all the sweeps and the sweeper thread.
+void pi_counter_sweeper_destroy();
+
+#endif  // PI_SRC_PI_COUNTER_SWEEPER_H_
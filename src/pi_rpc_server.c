@@ -579,6 +579,20 @@ static void __pi_table_entry_modify_wkey(char *req) {
   __pi_table_entry_modify_common(req, true);
 }
 
+static void __pi_table_entries_clear(char *req) {
+  printf("RPC: _pi_table_entries_clear\n");
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_id_t dev_id;
+  req += retrieve_dev_id(req, &dev_id);
+  pi_p4_id_t table_id;
+  req += retrieve_p4_id(req, &table_id);
+
+  pi_status_t status = _pi_table_entries_clear(sess, dev_id, table_id);
+  send_status(status);
+}
+
 static void __pi_table_entries_fetch(char *req) {
   printf("RPC: _pi_table_entries_fetch\n");
 
@@ -624,6 +638,34 @@ static void __pi_table_entries_fetch(char *req) {
   assert((size_t)bytes == s);
 }
 
+static void __pi_table_get_num_entries(char *req) {
+  printf("RPC: _pi_table_get_num_entries\n");
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_id_t dev_id;
+  req += retrieve_dev_id(req, &dev_id);
+  pi_p4_id_t table_id;
+  req += retrieve_p4_id(req, &table_id);
+
+  size_t num_entries = 0;
+  pi_status_t status =
+      _pi_table_get_num_entries(sess, dev_id, table_id, &num_entries);
+
+  typedef struct __attribute__((packed)) {
+    rep_hdr_t hdr;
+    uint64_t num_entries;
+  } rep_t;
+  rep_t rep;
+  char *rep_ = (char *)&rep;
+  rep_ += emit_rep_hdr(rep_, status);
+  rep_ += emit_uint64(rep_, num_entries);
+
+  int bytes = nn_send(state.s, &rep, sizeof(rep), 0);
+  _PI_UNUSED(bytes);
+  assert(bytes == sizeof(rep));
+}
+
 static void send_indirect_handle(pi_status_t status, pi_indirect_handle_t h) {
   typedef struct __attribute__((packed)) {
     rep_hdr_t hdr;
@@ -773,6 +815,20 @@ static void __pi_act_prof_grp_remove_mbr(char *req) {
   grp_add_remove_mbr(req, PI_RPC_ACT_PROF_GRP_REMOVE_MBR);
 }
 
+static void __pi_act_prof_clear(char *req) {
+  printf("RPC: _pi_act_prof_clear\n");
+
+  pi_session_handle_t sess;
+  req += retrieve_session_handle(req, &sess);
+  pi_dev_id_t dev_id;
+  req += retrieve_dev_id(req, &dev_id);
+  pi_p4_id_t act_prof_id;
+  req += retrieve_p4_id(req, &act_prof_id);
+
+  pi_status_t status = _pi_act_prof_clear(sess, dev_id, act_prof_id);
+  send_status(status);
+}
+
 static void __pi_act_prof_entries_fetch(char *req) {
   printf("RPC: _pi_act_prof_entries_fetch\n");
 
@@ -1035,6 +1091,36 @@ static void __pi_packetout_send(char *req) {
   send_status(status);
 }
 
+static void __pi_packetout_send_batch(char *req) {
+  printf("RPC: _pi_packetout_send_batch\n");
+  pi_dev_id_t dev_id;
+  req += retrieve_dev_id(req, &dev_id);
+  uint32_t num_pkts;
+  req += retrieve_uint32(req, &num_pkts);
+
+  const char **pkts = malloc(num_pkts * sizeof(*pkts));
+  size_t *sizes = malloc(num_pkts * sizeof(*sizes));
+  if (num_pkts > 0 && (pkts == NULL || sizes == NULL)) {
+    free(pkts);
+    free(sizes);
+    send_status(PI_STATUS_ALLOC_ERROR);
+    return;
+  }
+  for (uint32_t i = 0; i < num_pkts; i++) {
+    uint32_t msg_size;
+    req += retrieve_uint32(req, &msg_size);
+    pkts[i] = req;
+    sizes[i] = msg_size;
+    req += msg_size;
+  }
+
+  pi_status_t status =
+      _pi_packetout_send_batch(dev_id, pkts, sizes, num_pkts);
+  free(pkts);
+  free(sizes);
+  send_status(status);
+}
+
 static void learn_cb(pi_learn_msg_t *msg, void *cb_cookie) {
   (void)cb_cookie;
   pi_notifications_pub_learn(msg);
@@ -1135,6 +1221,12 @@ pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr) {
       case PI_RPC_TABLE_ENTRIES_FETCH:
         __pi_table_entries_fetch(req_);
         break;
+      case PI_RPC_TABLE_GET_NUM_ENTRIES:
+        __pi_table_get_num_entries(req_);
+        break;
+      case PI_RPC_TABLE_ENTRIES_CLEAR:
+        __pi_table_entries_clear(req_);
+        break;
 
       case PI_RPC_ACT_PROF_MBR_CREATE:
         __pi_act_prof_mbr_create(req_);
@@ -1160,6 +1252,9 @@ pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr) {
       case PI_RPC_ACT_PROF_ENTRIES_FETCH:
         __pi_act_prof_entries_fetch(req_);
         break;
+      case PI_RPC_ACT_PROF_CLEAR:
+        __pi_act_prof_clear(req_);
+        break;
 
       case PI_RPC_COUNTER_READ:
         __pi_counter_read(req_);
@@ -1194,6 +1289,9 @@ pi_status_t pi_rpc_server_run(const pi_remote_addr_t *remote_addr) {
       case PI_RPC_PACKETOUT_SEND:
         __pi_packetout_send(req_);
         break;
+      case PI_RPC_PACKETOUT_SEND_BATCH:
+        __pi_packetout_send_batch(req_);
+        break;
 
       default:
         assert(0);
@@ -167,24 +167,19 @@ pi_status_t pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                      match_key, table_entry);
 }
 
+bool pi_table_entry_handles_stable(pi_dev_id_t dev_id) {
+  bool stable = false;
+  pi_status_t status = _pi_table_entry_handles_stable(dev_id, &stable);
+  return status == PI_STATUS_SUCCESS && stable;
+}
+
 #define ALIGN 16
 #define ALIGN_SIZE(s) (((s) + (ALIGN - 1)) & (~(ALIGN - 1)))
 
-pi_status_t pi_table_entries_fetch(pi_session_handle_t session_handle,
-                                   pi_dev_id_t dev_id, pi_p4_id_t table_id,
-                                   pi_table_fetch_res_t **res) {
-  pi_table_fetch_res_t *res_ = malloc(sizeof(pi_table_fetch_res_t));
-  pi_status_t status =
-      _pi_table_entries_fetch(session_handle, dev_id, table_id, res_);
-  res_->p4info = pi_get_device_p4info(dev_id);
-  res_->table_id = table_id;
-  res_->idx = 0;
-  res_->curr = 0;
-
-  // we allocate one big memory block for all the structures owned by
-  // pi_table_fetch_res_t; we use contiguous memory for all the data relative to
-  // a specific table entry.
-
+// we allocate one big memory block for all the structures owned by
+// pi_table_fetch_res_t; we use contiguous memory for all the data relative to a
+// specific table entry. This computes the size needed for one entry.
+static void init_fetch_res_data_layout(pi_table_fetch_res_t *res) {
   size_t size_per_entry = 0;
   size_per_entry += sizeof(pi_match_key_t);
   size_per_entry = ALIGN_SIZE(size_per_entry);
@@ -195,33 +190,129 @@ pi_status_t pi_table_entries_fetch(pi_session_handle_t session_handle,
 
   // direct resources
   const pi_p4_id_t *res_ids = pi_p4info_table_get_direct_resources(
-      res_->p4info, table_id, &res_->num_direct_resources);
-  res_->max_size_of_direct_resources = 0;
-  for (size_t i = 0; i < res_->num_direct_resources; i++) {
+      res->p4info, res->table_id, &res->num_direct_resources);
+  res->max_size_of_direct_resources = 0;
+  for (size_t i = 0; i < res->num_direct_resources; i++) {
     size_t size_of;
     pi_direct_res_get_fns(PI_GET_TYPE_ID(res_ids[i]), NULL, NULL, &size_of,
                           NULL);
     size_of = ALIGN_SIZE(size_of);
-    if (size_of > res_->max_size_of_direct_resources)
-      res_->max_size_of_direct_resources = size_of;
+    if (size_of > res->max_size_of_direct_resources)
+      res->max_size_of_direct_resources = size_of;
   }
-  if (res_->num_direct_resources > 0) {
+  if (res->num_direct_resources > 0) {
     size_per_entry += sizeof(pi_direct_res_config_t);
     size_per_entry = ALIGN_SIZE(size_per_entry);
     size_per_entry +=
-        res_->num_direct_resources * sizeof(pi_direct_res_config_one_t);
+        res->num_direct_resources * sizeof(pi_direct_res_config_one_t);
     size_per_entry = ALIGN_SIZE(size_per_entry);
     size_per_entry +=
-        res_->num_direct_resources * res_->max_size_of_direct_resources;
+        res->num_direct_resources * res->max_size_of_direct_resources;
   }
 
-  res_->data_size_per_entry = size_per_entry;
-  res_->data = malloc(res_->num_entries * size_per_entry);
+  res->data_size_per_entry = size_per_entry;
+}
+
+pi_status_t pi_table_entries_fetch(pi_session_handle_t session_handle,
+                                   pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                   pi_table_fetch_res_t **res) {
+  pi_table_fetch_res_t *res_ = malloc(sizeof(pi_table_fetch_res_t));
+  pi_status_t status =
+      _pi_table_entries_fetch(session_handle, dev_id, table_id, res_);
+  res_->p4info = pi_get_device_p4info(dev_id);
+  res_->table_id = table_id;
+  res_->idx = 0;
+  res_->curr = 0;
+
+  init_fetch_res_data_layout(res_);
+  res_->data = malloc(res_->num_entries * res_->data_size_per_entry);
 
   *res = res_;
   return status;
 }
 
+pi_status_t pi_table_entries_fetch_begin(pi_session_handle_t session_handle,
+                                         pi_dev_id_t dev_id,
+                                         pi_p4_id_t table_id,
+                                         size_t chunk_size,
+                                         pi_table_fetch_res_t **res) {
+  (void)session_handle;
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_id);
+  if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
+  if (chunk_size == 0) return PI_STATUS_BUFFER_ERROR;
+
+  pi_table_fetch_res_t *res_ = calloc(1, sizeof(pi_table_fetch_res_t));
+  if (!res_) return PI_STATUS_ALLOC_ERROR;
+  res_->p4info = p4info;
+  res_->table_id = table_id;
+  res_->dev_id = dev_id;
+  res_->chunk_size = chunk_size;
+
+  // the decode buffer is sized for one chunk and reused for all of them
+  init_fetch_res_data_layout(res_);
+  res_->data = malloc(chunk_size * res_->data_size_per_entry);
+  if (!res_->data) {
+    free(res_);
+    return PI_STATUS_ALLOC_ERROR;
+  }
+
+  *res = res_;
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t pi_table_entries_fetch_next_chunk(
+    pi_session_handle_t session_handle, pi_table_fetch_res_t *res) {
+  if (res->entries) {
+    pi_status_t status = _pi_table_entries_fetch_done(session_handle, res);
+    if (status != PI_STATUS_SUCCESS) return status;
+    res->entries = NULL;
+  }
+  res->num_entries = 0;
+  res->entries_size = 0;
+  res->idx = 0;
+  res->curr = 0;
+  if (res->done) return PI_STATUS_SUCCESS;
+
+  pi_status_t status = _pi_table_entries_fetch_chunk(
+      session_handle, res->dev_id, res->table_id, res);
+  if (status == PI_STATUS_NOT_IMPLEMENTED_BY_TARGET && res->cursor == 0) {
+    // the target can only retrieve the whole table, which becomes the one and
+    // only chunk
+    status = _pi_table_entries_fetch(session_handle, res->dev_id,
+                                     res->table_id, res);
+    res->done = true;
+    if (status != PI_STATUS_SUCCESS) return status;
+    res->p4info = pi_get_device_p4info(res->dev_id);
+    init_fetch_res_data_layout(res);
+    if (res->num_entries > res->chunk_size) {
+      free(res->data);
+      res->chunk_size = res->num_entries;
+      res->data = malloc(res->chunk_size * res->data_size_per_entry);
+      if (!res->data) return PI_STATUS_ALLOC_ERROR;
+    }
+  }
+  if (status != PI_STATUS_SUCCESS) return status;
+  assert(res->num_entries <= res->chunk_size);
+  return PI_STATUS_SUCCESS;
+}
+
+bool pi_table_entries_fetch_is_last_chunk(const pi_table_fetch_res_t *res) {
+  return res->done;
+}
+
+pi_status_t pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                       pi_table_fetch_res_t *res) {
+  pi_status_t status = PI_STATUS_SUCCESS;
+  if (res->entries) status = _pi_table_entries_fetch_done(session_handle, res);
+  if (status != PI_STATUS_SUCCESS) return status;
+  status = _pi_table_entries_fetch_end(session_handle, res);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  free(res->data);
+  free(res);
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t pi_table_entries_fetch_done(pi_session_handle_t session_handle,
                                         pi_table_fetch_res_t *res) {
   pi_status_t status = _pi_table_entries_fetch_done(session_handle, res);
@@ -232,6 +323,95 @@ pi_status_t pi_table_entries_fetch_done(pi_session_handle_t session_handle,
   return PI_STATUS_SUCCESS;
 }
 
+pi_status_t pi_table_get_usage(pi_session_handle_t session_handle,
+                               pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                               size_t *num_entries, size_t *max_size) {
+  const pi_p4info_t *p4info = pi_get_device_p4info(dev_id);
+  if (!p4info) return PI_STATUS_DEV_NOT_ASSIGNED;
+  if (max_size) *max_size = pi_p4info_table_max_size(p4info, table_id);
+  if (!num_entries) return PI_STATUS_SUCCESS;
+
+  pi_status_t status = _pi_table_get_num_entries(session_handle, dev_id,
+                                                 table_id, num_entries);
+  if (status != PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) return status;
+
+  pi_table_fetch_res_t res;
+  memset(&res, 0, sizeof(res));
+  status = _pi_table_entries_fetch(session_handle, dev_id, table_id, &res);
+  if (status != PI_STATUS_SUCCESS) return status;
+  *num_entries = res.num_entries;
+  return _pi_table_entries_fetch_done(session_handle, &res);
+}
+
+// Entries are deleted by handle only if the target guarantees that handles are
+// stable; otherwise deleting one entry may change the handles of the entries
+// which follow it (e.g. when handles are positions in the table), so entries
+// are deleted by key, or by handle in reverse fetch order if the target does
+// not support deleting by key.
+static pi_status_t table_entries_delete_all(pi_session_handle_t session_handle,
+                                            pi_dev_id_t dev_id,
+                                            pi_p4_id_t table_id) {
+  pi_table_fetch_res_t *res;
+  pi_status_t status =
+      pi_table_entries_fetch(session_handle, dev_id, table_id, &res);
+  if (status != PI_STATUS_SUCCESS) return status;
+
+  size_t num_entries = pi_table_entries_num(res);
+  pi_entry_handle_t *handles = NULL;
+  const pi_match_key_t **match_keys = NULL;
+  if (num_entries > 0) {
+    handles = malloc(num_entries * sizeof(*handles));
+    match_keys = malloc(num_entries * sizeof(*match_keys));
+  }
+  // match keys point into res, and remain valid until the fetch is done
+  for (size_t i = 0; i < num_entries; i++) {
+    pi_table_ma_entry_t entry;
+    pi_table_entries_next(res, &entry, &handles[i]);
+    match_keys[i] = entry.match_key;
+  }
+
+  if (pi_table_entry_handles_stable(dev_id)) {
+    for (size_t i = 0; i < num_entries && status == PI_STATUS_SUCCESS; i++) {
+      status = _pi_table_entry_delete(session_handle, dev_id, table_id,
+                                      handles[i]);
+      if (status == PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) {
+        status = _pi_table_entry_delete_wkey(session_handle, dev_id, table_id,
+                                             match_keys[i]);
+      }
+    }
+  } else {
+    size_t num_deleted = 0;
+    for (; num_deleted < num_entries && status == PI_STATUS_SUCCESS;
+         num_deleted++) {
+      status = _pi_table_entry_delete_wkey(session_handle, dev_id, table_id,
+                                           match_keys[num_deleted]);
+      if (status == PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) break;
+    }
+    if (status == PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) {
+      status = PI_STATUS_SUCCESS;
+      for (size_t i = num_entries; i > num_deleted; i--) {
+        status = _pi_table_entry_delete(session_handle, dev_id, table_id,
+                                        handles[i - 1]);
+        if (status != PI_STATUS_SUCCESS) break;
+      }
+    }
+  }
+
+  free(handles);
+  free(match_keys);
+  pi_status_t done_status = pi_table_entries_fetch_done(session_handle, res);
+  return (status != PI_STATUS_SUCCESS) ? status : done_status;
+}
+
+pi_status_t pi_table_entries_clear(pi_session_handle_t session_handle,
+                                   pi_dev_id_t dev_id, pi_p4_id_t table_id) {
+  if (!pi_get_device_p4info(dev_id)) return PI_STATUS_DEV_NOT_ASSIGNED;
+  pi_status_t status =
+      _pi_table_entries_clear(session_handle, dev_id, table_id);
+  if (status != PI_STATUS_NOT_IMPLEMENTED_BY_TARGET) return status;
+  return table_entries_delete_all(session_handle, dev_id, table_id);
+}
+
 size_t pi_table_entries_num(pi_table_fetch_res_t *res) {
   return res->num_entries;
 }
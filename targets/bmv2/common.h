@@ -25,6 +25,7 @@
 #include <PI/p4info.h>
 #include <PI/pi.h>
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -32,9 +33,13 @@ namespace pibmv2 {
 
 using dev_id_t = uint64_t;
 
+class P4InfoCache;
+
 struct device_info_t {
   int assigned{0};
   const pi_p4info_t *p4info{NULL};
+  // built from p4info, see p4info_cache.h
+  std::shared_ptr<const P4InfoCache> p4info_cache{nullptr};
 };
 
 class DeviceInfo {
@@ -73,22 +78,6 @@ struct ADataSize {
       : id(id), s(s) { }
   pi_p4_id_t id;
   size_t s;
-
-  static std::unordered_map<std::string, ADataSize> compute_action_sizes(
-      const pi_p4info_t *p4info, const pi_p4_id_t *action_ids,
-      size_t num_actions) {
-    std::unordered_map<std::string, ADataSize> action_map;
-    action_map.reserve(num_actions);
-
-    for (size_t i = 0; i < num_actions; i++) {
-      action_map.emplace(
-          std::string(pi_p4info_action_name_from_id(p4info, action_ids[i])),
-          ADataSize(action_ids[i],
-                    pi_p4info_action_data_size(p4info, action_ids[i])));
-    }
-
-    return action_map;
-  }
 };
 
 }  // namespace pibmv2
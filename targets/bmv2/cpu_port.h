@@ -0,0 +1,67 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_BMV2_CPU_PORT_H_
+#define PI_BMV2_CPU_PORT_H_
+
+#include <PI/pi.h>
+
+#include <memory>
+#include <string>
+
+namespace pibmv2 {
+
+// I/O backend for the CPU interface of one device.
+class CpuPort {
+ public:
+  virtual ~CpuPort() { }
+
+  // file descriptor which becomes readable when packets are available
+  virtual int fd() const = 0;
+
+  // Called by the receive thread when fd() is readable. Delivers all the
+  // packets which are available to pi_packetin_receive.
+  virtual void receive(pi_dev_id_t dev_id) = 0;
+
+  // returns 0 on success
+  virtual int send(const char *pkt, size_t size) = 0;
+
+  // returns 0 if all packets were sent
+  virtual int send_batch(const char *const *pkts, const size_t *sizes,
+                         size_t num_pkts) {
+    for (size_t i = 0; i < num_pkts; i++) {
+      if (send(pkts[i], sizes[i]) != 0) return -1;
+    }
+    return 0;
+  }
+};
+
+// libpcap backend, one packet per readiness event
+std::unique_ptr<CpuPort> make_pcap_cpu_port(const std::string &cpu_iface);
+
+#ifdef WITH_AF_PACKET
+// AF_PACKET backend, with a TPACKET_V3 (block-based) mmap'd receive ring and
+// sendmmsg for batched transmission
+std::unique_ptr<CpuPort> make_af_packet_cpu_port(const std::string &cpu_iface);
+#endif  // WITH_AF_PACKET
+
+}  // namespace pibmv2
+
+#endif  // PI_BMV2_CPU_PORT_H_
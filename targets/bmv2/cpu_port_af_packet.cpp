@@ -0,0 +1,211 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include <PI/pi.h>
+#include <PI/target/pi_imp.h>
+
+#include <arpa/inet.h>  // for htons
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>  // for if_nametoindex
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>  // for std::min
+#include <memory>
+#include <string>
+
+#include <cerrno>
+#include <cstring>  // for memset
+
+#include "cpu_port.h"
+
+namespace pibmv2 {
+
+namespace {
+
+// The receive ring is made of fixed-size blocks, each of which can hold many
+// packets. The kernel hands a block over to us once it is full, or once
+// block_timeout_ms has elapsed since the first packet was written to it, which
+// bounds the latency for low packet rates.
+constexpr unsigned int block_size = 1 << 18;  // 256KB
+constexpr unsigned int block_nr = 16;
+constexpr unsigned int frame_size = 2048;  // only used to size the ring
+constexpr unsigned int block_timeout_ms = 1;
+
+// maximum number of packets sent with a single sendmmsg call
+constexpr size_t max_send_batch = 64;
+
+class AfPacketCpuPort : public CpuPort {
+ public:
+  AfPacketCpuPort(int fd, char *ring)
+      : fd_(fd), ring(ring) { }
+
+  ~AfPacketCpuPort() {
+    munmap(ring, block_size * block_nr);
+    close(fd_);
+  }
+
+  int fd() const override { return fd_; }
+
+  void receive(pi_dev_id_t dev_id) override {
+    while (true) {
+      auto *block = reinterpret_cast<struct tpacket_block_desc *>(
+          ring + current_block * block_size);
+      auto &bh = block->hdr.bh1;
+      if (!(__atomic_load_n(&bh.block_status, __ATOMIC_ACQUIRE) &
+            TP_STATUS_USER)) {
+        break;
+      }
+      receive_block(dev_id, block);
+      // give the block back to the kernel
+      __atomic_store_n(&bh.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+      current_block = (current_block + 1) % block_nr;
+    }
+  }
+
+  int send(const char *pkt, size_t size) override {
+    auto rc = ::send(fd_, pkt, size, 0);
+    return (rc == static_cast<ssize_t>(size)) ? 0 : -1;
+  }
+
+  int send_batch(const char *const *pkts, const size_t *sizes,
+                 size_t num_pkts) override {
+    struct mmsghdr msgs[max_send_batch];
+    struct iovec iovs[max_send_batch];
+    size_t sent = 0;
+    while (sent < num_pkts) {
+      auto batch_size = std::min(num_pkts - sent, max_send_batch);
+      for (size_t i = 0; i < batch_size; i++) {
+        iovs[i].iov_base = const_cast<char *>(pkts[sent + i]);
+        iovs[i].iov_len = sizes[sent + i];
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      auto rc = sendmmsg(fd_, msgs, batch_size, 0);
+      if (rc < 0) {
+        if (errno == EINTR) continue;
+        return -1;
+      }
+      // sendmmsg stops at the first packet which cannot be sent
+      if (rc == 0) return -1;
+      sent += static_cast<size_t>(rc);
+    }
+    return 0;
+  }
+
+ private:
+  void receive_block(pi_dev_id_t dev_id, struct tpacket_block_desc *block) {
+    auto &bh = block->hdr.bh1;
+    auto *base = reinterpret_cast<char *>(block);
+    auto *hdr = reinterpret_cast<struct tpacket3_hdr *>(
+        base + bh.offset_to_first_pkt);
+    for (unsigned int i = 0; i < bh.num_pkts; i++) {
+      auto *ll = reinterpret_cast<struct sockaddr_ll *>(
+          reinterpret_cast<char *>(hdr) +
+          TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+      // skip the packets we sent ourselves, and the truncated ones
+      if (ll->sll_pkttype != PACKET_OUTGOING &&
+          hdr->tp_snaplen == hdr->tp_len) {
+        const char *data = reinterpret_cast<char *>(hdr) + hdr->tp_mac;
+        pi_status_t pi_status = pi_packetin_receive(
+            dev_id, data, static_cast<size_t>(hdr->tp_snaplen));
+        (void)pi_status;
+      }
+      hdr = reinterpret_cast<struct tpacket3_hdr *>(
+          reinterpret_cast<char *>(hdr) + hdr->tp_next_offset);
+    }
+  }
+
+  int fd_;
+  char *ring;
+  // only accessed by the receive thread
+  unsigned int current_block{0};
+};
+
+}  // namespace
+
+std::unique_ptr<CpuPort>
+make_af_packet_cpu_port(const std::string &cpu_iface) {
+  auto ifindex = if_nametoindex(cpu_iface.c_str());
+  if (ifindex == 0) return nullptr;
+
+  // protocol 0: the socket does not receive anything until it is bound to the
+  // CPU interface (with ETH_P_ALL) below, otherwise packets from all the
+  // interfaces could end up in the ring
+  int fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (fd < 0) return nullptr;
+
+  auto fail = [fd]() -> std::unique_ptr<CpuPort> {
+    close(fd);
+    return nullptr;
+  };
+
+  int version = TPACKET_V3;
+  if (setsockopt(fd, SOL_PACKET, PACKET_VERSION,
+                 &version, sizeof(version)) != 0) {
+    return fail();
+  }
+
+#ifdef PACKET_IGNORE_OUTGOING
+  // not supported before Linux 4.20, in which case we filter outgoing packets
+  // when reading the ring
+  int ignore_outgoing = 1;
+  setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING,
+             &ignore_outgoing, sizeof(ignore_outgoing));
+#endif
+
+  struct tpacket_req3 req;
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = block_size;
+  req.tp_block_nr = block_nr;
+  req.tp_frame_size = frame_size;
+  req.tp_frame_nr = (block_size * block_nr) / frame_size;
+  req.tp_retire_blk_tov = block_timeout_ms;
+  if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0)
+    return fail();
+
+  auto *ring = mmap(nullptr, block_size * block_nr, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  if (ring == MAP_FAILED) return fail();
+
+  struct sockaddr_ll addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sll_family = AF_PACKET;
+  addr.sll_protocol = htons(ETH_P_ALL);
+  addr.sll_ifindex = static_cast<int>(ifindex);
+  struct packet_mreq mreq;
+  memset(&mreq, 0, sizeof(mreq));
+  mreq.mr_ifindex = static_cast<int>(ifindex);
+  mreq.mr_type = PACKET_MR_PROMISC;
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+                 &mreq, sizeof(mreq)) != 0) {
+    munmap(ring, block_size * block_nr);
+    return fail();
+  }
+
+  return std::unique_ptr<CpuPort>(
+      new AfPacketCpuPort(fd, static_cast<char *>(ring)));
+}
+
+}  // namespace pibmv2
@@ -0,0 +1,119 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include <PI/pi.h>
+#include <PI/target/pi_imp.h>
+
+#include <pcap/pcap.h>
+
+#include <memory>
+#include <string>
+
+#include "cpu_port.h"
+
+namespace pibmv2 {
+
+namespace {
+
+class PcapCpuPort : public CpuPort {
+ public:
+  PcapCpuPort(pcap_t *pcap, int fd)
+      : pcap(pcap), fd_(fd) { }
+
+  ~PcapCpuPort() {
+    pcap_close(pcap);
+  }
+
+  int fd() const override { return fd_; }
+
+  void receive(pi_dev_id_t dev_id) override {
+    struct pcap_pkthdr *pkt_header;
+    const unsigned char *pkt_data;
+
+    if (pcap_next_ex(pcap, &pkt_header, &pkt_data) != 1) {
+      return;
+    }
+
+    if (pkt_header->caplen != pkt_header->len) {
+      return;
+    }
+
+    size_t size = static_cast<size_t>(pkt_header->len);
+    const char *data = reinterpret_cast<const char *>(pkt_data);
+    pi_status_t pi_status = pi_packetin_receive(dev_id, data, size);
+    (void)pi_status;
+  }
+
+  int send(const char *pkt, size_t size) override {
+    return pcap_sendpacket(pcap, reinterpret_cast<const unsigned char *>(pkt),
+                           static_cast<int>(size));
+  }
+
+ private:
+  pcap_t *pcap;
+  int fd_;
+};
+
+}  // namespace
+
+std::unique_ptr<CpuPort>
+make_pcap_cpu_port(const std::string &cpu_iface) {
+  char errbuf[PCAP_ERRBUF_SIZE];
+  auto pcap = pcap_create(cpu_iface.c_str(), errbuf);
+
+  if (!pcap) return nullptr;
+
+  if (pcap_set_promisc(pcap, 1) != 0) {
+    pcap_close(pcap);
+    return nullptr;
+  }
+
+#ifdef WITH_PCAP_FIX
+  if (pcap_set_timeout(pcap, 1) != 0) {
+    pcap_close(pcap);
+    return nullptr;
+  }
+
+  if (pcap_set_immediate_mode(pcap, 1) != 0) {
+    pcap_close(pcap);
+    return nullptr;
+  }
+#endif
+
+  if (pcap_activate(pcap) != 0) {
+    pcap_close(pcap);
+    return nullptr;
+  }
+
+  auto fd = pcap_get_selectable_fd(pcap);
+  if (fd < 0) {
+    pcap_close(pcap);
+    return nullptr;
+  }
+
+  // if (pcap_setnonblock(pcap, 1, errbuf) < 0) {
+  //   pcap_close(pcap);
+  //   return nullptr;
+  // }
+
+  return std::unique_ptr<CpuPort>(new PcapCpuPort(pcap, fd));
+}
+
+}  // namespace pibmv2
@@ -21,28 +21,67 @@
 #include "cpu_send_recv.h"
 
 #include <PI/pi.h>
-#include <PI/target/pi_imp.h>
 
-#include <pcap/pcap.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 
 #include <cassert>
+#include <cerrno>
+
+#include "cpu_port.h"
 
 namespace pibmv2 {
 
+namespace {
+
+// epoll cookie for the stop eventfd; registration ids start at 1
+constexpr uint64_t stop_cookie = 0;
+
+}  // namespace
+
+bool
+CpuSendRecv::backend_from_name(const std::string &name, Backend *backend) {
+  if (name == "pcap") {
+    *backend = Backend::PCAP;
+    return true;
+  }
+#ifdef WITH_AF_PACKET
+  if (name == "af_packet") {
+    *backend = Backend::PACKET_MMAP;
+    return true;
+  }
+#endif  // WITH_AF_PACKET
+  return false;
+}
+
 CpuSendRecv::CpuSendRecv() {
-  FD_ZERO(&fds);
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  assert(epoll_fd >= 0);
+  stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  assert(stop_fd >= 0);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = stop_cookie;
+  auto rc = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+  assert(rc == 0);
+  (void)rc;
 }
 
 CpuSendRecv::~CpuSendRecv() {
-  {
-    std::unique_lock<std::mutex> lock(mutex);
-    stop_recv_thread = true;
+  if (recv_thread.joinable()) {
+    uint64_t one = 1;
+    auto rc = write(stop_fd, &one, sizeof(one));
+    (void)rc;
+    recv_thread.join();
   }
-  recv_thread.join();
+  close(stop_fd);
+  close(epoll_fd);
 }
 
 void
@@ -51,51 +90,28 @@ CpuSendRecv::start() {
 }
 
 int
-CpuSendRecv::add_device(const std::string &cpu_iface, pi_dev_id_t dev_id) {
-  OneDevice device = {cpu_iface, dev_id, nullptr, -1};
-
-  char errbuf[PCAP_ERRBUF_SIZE];
-  device.pcap = pcap_create(cpu_iface.c_str(), errbuf);
-
-  if (!device.pcap) return -1;
-
-  if (pcap_set_promisc(device.pcap, 1) != 0) {
-    pcap_close(device.pcap);
-    return -1;
-  }
-
-#ifdef WITH_PCAP_FIX
-  if (pcap_set_timeout(device.pcap, 1) != 0) {
-    pcap_close(device.pcap);
-    return -1;
-  }
-
-  if (pcap_set_immediate_mode(device.pcap, 1) != 0) {
-    pcap_close(device.pcap);
-    return -1;
-  }
-#endif
-
-  if (pcap_activate(device.pcap) != 0) {
-    pcap_close(device.pcap);
-    return -1;
-  }
-
-  device.fd = pcap_get_selectable_fd(device.pcap);
-  if (device.fd < 0) {
-    pcap_close(device.pcap);
-    return -1;
+CpuSendRecv::add_device(const std::string &cpu_iface, pi_dev_id_t dev_id,
+                        Backend backend) {
+  std::shared_ptr<CpuPort> port;
+  switch (backend) {
+    case Backend::PCAP:
+      port = make_pcap_cpu_port(cpu_iface);
+      break;
+    case Backend::PACKET_MMAP:
+#ifdef WITH_AF_PACKET
+      port = make_af_packet_cpu_port(cpu_iface);
+#endif  // WITH_AF_PACKET
+      break;
   }
-
-  // if (pcap_setnonblock(device.pcap, 1, errbuf) < 0) {
-  //   pcap_close(device.pcap);
-  //   return -1;
-  // }
+  if (port == nullptr) return -1;
 
   std::unique_lock<std::mutex> lock(mutex);
-  devices.push_back(std::move(device));
-  if (device.fd > max_fd) max_fd = device.fd;
-  FD_SET(device.fd, &fds);
+  auto registration_id = next_registration_id++;
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = registration_id;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, port->fd(), &event) != 0) return -1;
+  devices.emplace(registration_id, OneDevice{dev_id, std::move(port)});
   return 0;
 }
 
@@ -104,80 +120,64 @@ CpuSendRecv::remove_device(pi_dev_id_t dev_id) {
   std::unique_lock<std::mutex> lock(mutex);
   auto it = devices.begin();
   for (; it != devices.end(); it++) {
-    if (it->dev_id == dev_id) break;
+    if (it->second.dev_id == dev_id) break;
   }
   if (it == devices.end()) return -1;
-  FD_CLR(it->fd, &fds);
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.port->fd(), nullptr);
+  // the receive thread may still be using the port, in which case it will be
+  // released when the thread is done with it
   devices.erase(it);
   return 0;
 }
 
 void
 CpuSendRecv::recv_loop() {
-  int n;
-  fd_set current_fds;
-  int current_max_fd;
+  constexpr int max_events = 16;
+  struct epoll_event events[max_events];
 
-  struct timeval timeout;
   while (1) {
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 100000;
-
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      current_fds = fds;
-      current_max_fd = max_fd;
-    }
-
-    n = select(current_max_fd + 1, &current_fds, NULL, NULL, &timeout);
+    int n = epoll_wait(epoll_fd, events, max_events, -1);
     assert(n >= 0 || errno == EINTR);
 
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      if (stop_recv_thread) return;
-
-      if (n <= 0) continue;
-
-      for (const auto &device : devices) {
-        if (n == 0) break;
-        if (FD_ISSET(device.fd, &current_fds)) {
-          --n;
-          recv_one(device);
-        }
+    for (int i = 0; i < n; i++) {
+      auto cookie = events[i].data.u64;
+      if (cookie == stop_cookie) return;
+      OneDevice device;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = devices.find(cookie);
+        if (it == devices.end()) continue;
+        device = it->second;
       }
+      // packets are delivered without holding the mutex, so that packet-outs
+      // (which may be sent from the packet-in callback) are never blocked
+      device.port->receive(device.dev_id);
     }
   }
 }
 
-void
-CpuSendRecv::recv_one(const OneDevice &device) {
-  struct pcap_pkthdr *pkt_header;
-  const unsigned char *pkt_data;
-
-  if (pcap_next_ex(device.pcap, &pkt_header, &pkt_data) != 1) {
-    return;
-  }
-
-  if (pkt_header->caplen != pkt_header->len) {
-    return;
+std::shared_ptr<CpuPort>
+CpuSendRecv::get_port(pi_dev_id_t dev_id) const {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (const auto &p : devices) {
+    if (p.second.dev_id == dev_id) return p.second.port;
   }
-
-  size_t size = static_cast<size_t>(pkt_header->len);
-  const char *data = reinterpret_cast<const char *>(pkt_data);
-  pi_status_t pi_status = pi_packetin_receive(device.dev_id, data, size);
-  (void)pi_status;
+  return nullptr;
 }
 
 int
 CpuSendRecv::send_pkt(pi_dev_id_t dev_id, const char *pkt, size_t size) {
-  for (const auto &device : devices) {
-    if (device.dev_id == dev_id) {
-      return pcap_sendpacket(device.pcap,
-                             reinterpret_cast<const unsigned char *>(pkt),
-                             static_cast<int>(size));
-    }
-  }
-  return -2;
+  auto port = get_port(dev_id);
+  if (port == nullptr) return -2;
+  return port->send(pkt, size);
+}
+
+int
+CpuSendRecv::send_pkt_batch(pi_dev_id_t dev_id, const char *const *pkts,
+                            const size_t *sizes, size_t num_pkts) {
+  auto port = get_port(dev_id);
+  if (port == nullptr) return -2;
+  return port->send_batch(pkts, sizes, num_pkts);
 }
 
 }  // namespace pibmv2
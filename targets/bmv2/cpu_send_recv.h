@@ -18,48 +18,66 @@
  *
  */
 
-#include <PI/pi.h>
+#ifndef PI_BMV2_CPU_SEND_RECV_H_
+#define PI_BMV2_CPU_SEND_RECV_H_
 
-#include <sys/select.h>
+#include <PI/pi.h>
 
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
-#include <vector>
-
-typedef struct pcap pcap_t;
+#include <unordered_map>
 
 namespace pibmv2 {
 
+class CpuPort;
+
 class CpuSendRecv {
  public:
+  enum class Backend {
+    PCAP,
+    PACKET_MMAP  // AF_PACKET socket with mmap'd TPACKET_V3 ring
+  };
+
+  // accepted names are "pcap" and "af_packet"
+  static bool backend_from_name(const std::string &name, Backend *backend);
+
   CpuSendRecv();
 
   ~CpuSendRecv();
 
   void start();
-  int add_device(const std::string &cpu_iface, pi_dev_id_t dev_id);
+  int add_device(const std::string &cpu_iface, pi_dev_id_t dev_id,
+                 Backend backend = Backend::PCAP);
   int remove_device(pi_dev_id_t dev_id);
 
   int send_pkt(pi_dev_id_t dev_id, const char *pkt, size_t size);
+  int send_pkt_batch(pi_dev_id_t dev_id, const char *const *pkts,
+                     const size_t *sizes, size_t num_pkts);
 
  private:
   struct OneDevice {
-    std::string cpu_iface;
     pi_dev_id_t dev_id;
-    pcap_t *pcap;
-    int fd;
+    std::shared_ptr<CpuPort> port;
   };
 
   void recv_loop();
-  void recv_one(const OneDevice &device);
+  std::shared_ptr<CpuPort> get_port(pi_dev_id_t dev_id) const;
 
-  fd_set fds;
-  int max_fd{0};
-  std::vector<OneDevice> devices{};
+  int epoll_fd{-1};
+  // eventfd used to wake up the receive thread when stopping
+  int stop_fd{-1};
+  // Keyed by a registration id which is used as the epoll cookie, and is never
+  // reused. An event for a device which was removed in the meantime will not
+  // find its registration.
+  std::unordered_map<uint64_t, OneDevice> devices{};
+  uint64_t next_registration_id{1};
   std::thread recv_thread{};
-  bool stop_recv_thread{false};
   mutable std::mutex mutex{};
 };
 
 }  // namespace pibmv2
+
+#endif  // PI_BMV2_CPU_SEND_RECV_H_
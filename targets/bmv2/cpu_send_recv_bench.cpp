@@ -0,0 +1,225 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Measures the packet rate of the CPU port backends, in both directions, over
+// a veth pair:
+//   ip link add veth0 type veth peer name veth1
+//   ip link set dev veth0 up && ip link set dev veth1 up
+//   ./cpu_send_recv_bench veth0 veth1 af_packet 1000000
+// The backend is attached to the first interface, while the second one is used
+// to generate and count traffic. Requires CAP_NET_RAW.
+
+#include <PI/pi.h>
+#include <PI/target/pi_imp.h>
+
+#include <arpa/inet.h>  // for htons
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>  // for if_nametoindex
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>  // for std::min
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstring>  // for memset
+
+#include "cpu_send_recv.h"
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// IEEE 802 local experimental ethertype, to ignore unrelated traffic
+constexpr uint16_t bench_ethertype = 0x88b5;
+constexpr size_t pkt_size = 64;
+constexpr pi_dev_id_t dev_id = 0;
+
+std::atomic<size_t> packet_in_count{0};
+
+bool is_bench_packet(const char *pkt, size_t size) {
+  if (size < sizeof(struct ethhdr)) return false;
+  uint16_t ethertype;
+  std::memcpy(&ethertype, pkt + 12, sizeof(ethertype));
+  return ethertype == htons(bench_ethertype);
+}
+
+std::vector<char> make_packet() {
+  std::vector<char> pkt(pkt_size, 0);
+  std::memset(pkt.data(), 0xff, 6);  // broadcast
+  uint16_t ethertype = htons(bench_ethertype);
+  std::memcpy(pkt.data() + 12, &ethertype, sizeof(ethertype));
+  return pkt;
+}
+
+int open_peer_socket(const std::string &iface) {
+  int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+  if (fd < 0) return -1;
+  struct sockaddr_ll addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sll_family = AF_PACKET;
+  addr.sll_protocol = htons(ETH_P_ALL);
+  addr.sll_ifindex = static_cast<int>(if_nametoindex(iface.c_str()));
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  struct timeval timeout = {0, 100000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  int rcvbuf = 64 * 1024 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  return fd;
+}
+
+// waits until count reaches target, or until it stops increasing for 1s;
+// returns the time at which the last increase was observed
+clock::time_point wait_for_count(const std::atomic<size_t> &count,
+                                 size_t target) {
+  auto last_change = clock::now();
+  size_t last_count = count.load();
+  while (last_count < target) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto c = count.load();
+    if (c != last_count) {
+      last_count = c;
+      last_change = clock::now();
+    } else if (clock::now() - last_change > std::chrono::seconds(1)) {
+      break;
+    }
+  }
+  return last_change;
+}
+
+void report(const char *direction, size_t sent, size_t received,
+            clock::time_point start, clock::time_point end) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+      end - start).count();
+  if (us == 0) us = 1;
+  std::cout << direction << ": " << received << " / " << sent
+            << " packets in " << us << " us, "
+            << (received * 1000000 / us) << " pps\n";
+}
+
+// packets are sent one at a time if batch_size is 1
+void bench_packet_out(pibmv2::CpuSendRecv *cpu, int peer_fd, size_t num_pkts,
+                      size_t batch_size) {
+  std::atomic<size_t> received{0};
+  std::atomic<bool> stop{false};
+  std::thread counter([peer_fd, &received, &stop]() {
+    char buffer[2048];
+    while (!stop) {
+      auto rc = recv(peer_fd, buffer, sizeof(buffer), 0);
+      if (rc > 0 && is_bench_packet(buffer, static_cast<size_t>(rc)))
+        received++;
+    }
+  });
+  auto pkt = make_packet();
+  std::vector<const char *> pkts(batch_size, pkt.data());
+  std::vector<size_t> sizes(batch_size, pkt.size());
+  auto start = clock::now();
+  size_t sent = 0;
+  for (size_t i = 0; i < num_pkts; i += batch_size) {
+    auto n = std::min(batch_size, num_pkts - i);
+    if (n == 1) {
+      if (cpu->send_pkt(dev_id, pkt.data(), pkt.size()) == 0) sent++;
+    } else if (cpu->send_pkt_batch(
+        dev_id, pkts.data(), sizes.data(), n) == 0) {
+      sent += n;
+    }
+  }
+  auto end = wait_for_count(received, sent);
+  stop = true;
+  counter.join();
+  auto direction = std::string("packet-out (batch size ") +
+      std::to_string(batch_size) + ")";
+  report(direction.c_str(), num_pkts, received, start, end);
+}
+
+void bench_packet_in(int peer_fd, size_t num_pkts) {
+  packet_in_count = 0;
+  auto pkt = make_packet();
+  auto start = clock::now();
+  for (size_t i = 0; i < num_pkts; i++) {
+    if (send(peer_fd, pkt.data(), pkt.size(), 0) < 0) {
+      // the veth queue is full, give the receiver some time
+      std::this_thread::yield();
+      i--;
+    }
+  }
+  auto end = wait_for_count(packet_in_count, num_pkts);
+  report("packet-in", num_pkts, packet_in_count, start, end);
+}
+
+}  // namespace
+
+// the benchmark is not linked with the PI library, so we count the packets here
+extern "C" {
+
+pi_status_t pi_packetin_receive(pi_dev_id_t dev_id, const char *pkt,
+                                size_t size) {
+  (void)dev_id;
+  if (is_bench_packet(pkt, size)) packet_in_count++;
+  return PI_STATUS_SUCCESS;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || argc > 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " <cpu iface> <peer iface> [pcap|af_packet] [num packets]\n";
+    return 1;
+  }
+  std::string cpu_iface(argv[1]);
+  std::string peer_iface(argv[2]);
+  auto backend = pibmv2::CpuSendRecv::Backend::PCAP;
+  if (argc > 3 &&
+      !pibmv2::CpuSendRecv::backend_from_name(argv[3], &backend)) {
+    std::cerr << "Unsupported backend '" << argv[3] << "'\n";
+    return 1;
+  }
+  size_t num_pkts = (argc > 4) ? std::stoul(argv[4]) : 100000;
+
+  int peer_fd = open_peer_socket(peer_iface);
+  if (peer_fd < 0) {
+    std::cerr << "Cannot open raw socket on " << peer_iface << "\n";
+    return 1;
+  }
+
+  pibmv2::CpuSendRecv cpu;
+  cpu.start();
+  if (cpu.add_device(cpu_iface, dev_id, backend) != 0) {
+    std::cerr << "Cannot open CPU port on " << cpu_iface << "\n";
+    return 1;
+  }
+
+  bench_packet_out(&cpu, peer_fd, num_pkts, 1);
+  bench_packet_out(&cpu, peer_fd, num_pkts, 32);
+  bench_packet_in(peer_fd, num_pkts);
+
+  cpu.remove_device(dev_id);
+  close(peer_fd);
+  return 0;
+}
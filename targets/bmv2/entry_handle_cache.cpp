@@ -0,0 +1,104 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "entry_handle_cache.h"
+
+#include <PI/int/pi_int.h>
+
+namespace pibmv2 {
+
+EntryHandleCache *entry_handle_cache = nullptr;
+
+std::string
+EntryHandleCache::make_key(const pi_match_key_t *match_key) {
+  // the priority is included because it is part of the key for ternary and
+  // range tables
+  std::string key(reinterpret_cast<const char *>(&match_key->priority),
+                  sizeof(match_key->priority));
+  key.append(match_key->data, match_key->data_size);
+  return key;
+}
+
+bool
+EntryHandleCache::get(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                      const pi_match_key_t *match_key,
+                      pi_entry_handle_t *entry_handle) const {
+  auto key = make_key(match_key);
+  std::unique_lock<std::mutex> lock(mutex);
+  auto table_it = tables.find(Key(dev_id, table_id));
+  if (table_it == tables.end()) return false;
+  const auto &key_to_handle = table_it->second.key_to_handle;
+  auto it = key_to_handle.find(key);
+  if (it == key_to_handle.end()) return false;
+  *entry_handle = it->second;
+  return true;
+}
+
+void
+EntryHandleCache::add(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                      const pi_match_key_t *match_key,
+                      pi_entry_handle_t entry_handle) {
+  auto key = make_key(match_key);
+  std::unique_lock<std::mutex> lock(mutex);
+  auto &table = tables[Key(dev_id, table_id)];
+  // drop any stale mapping for this key or this handle
+  auto key_it = table.key_to_handle.find(key);
+  if (key_it != table.key_to_handle.end()) {
+    table.handle_to_key.erase(key_it->second);
+    table.key_to_handle.erase(key_it);
+  }
+  auto handle_it = table.handle_to_key.find(entry_handle);
+  if (handle_it != table.handle_to_key.end()) {
+    table.key_to_handle.erase(*handle_it->second);
+    table.handle_to_key.erase(handle_it);
+  }
+  auto it = table.key_to_handle.emplace(std::move(key), entry_handle).first;
+  table.handle_to_key[entry_handle] = &it->first;
+}
+
+void
+EntryHandleCache::remove(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                         pi_entry_handle_t entry_handle) {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto table_it = tables.find(Key(dev_id, table_id));
+  if (table_it == tables.end()) return;
+  auto &table = table_it->second;
+  auto handle_it = table.handle_to_key.find(entry_handle);
+  if (handle_it == table.handle_to_key.end()) return;
+  table.key_to_handle.erase(*handle_it->second);
+  table.handle_to_key.erase(handle_it);
+}
+
+void
+EntryHandleCache::clear(pi_dev_id_t dev_id, pi_p4_id_t table_id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  tables.erase(Key(dev_id, table_id));
+}
+
+void
+EntryHandleCache::clear(pi_dev_id_t dev_id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto first = tables.lower_bound(Key(dev_id, 0));
+  auto last = first;
+  while (last != tables.end() && last->first.first == dev_id) ++last;
+  tables.erase(first, last);
+}
+
+}  // namespace pibmv2
@@ -0,0 +1,82 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_BMV2_ENTRY_HANDLE_CACHE_H_
+#define PI_BMV2_ENTRY_HANDLE_CACHE_H_
+
+#include <PI/pi.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace pibmv2 {
+
+// Maps match keys to bmv2 entry handles, for each device and table, so that
+// the _wkey table operations do not need a bm_mt_get_entry_from_key RPC to
+// find the handle. The cache is filled when entries are added (or looked up)
+// through PI and is only a hint: entries can also be changed with the bmv2 CLI,
+// so callers need to evict a handle which is rejected by bmv2 and fall back to
+// the RPC. bmv2 handles carry a version number, so a stale handle cannot refer
+// to a different entry.
+class EntryHandleCache {
+ public:
+  bool get(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+           const pi_match_key_t *match_key,
+           pi_entry_handle_t *entry_handle) const;
+
+  void add(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+           const pi_match_key_t *match_key, pi_entry_handle_t entry_handle);
+
+  void remove(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+              pi_entry_handle_t entry_handle);
+
+  // drops all the handles for one table, e.g. when all its entries are deleted
+  void clear(pi_dev_id_t dev_id, pi_p4_id_t table_id);
+
+  // needs to be called when the device is (re)assigned or its P4 program
+  // changes, as all the handles become invalid
+  void clear(pi_dev_id_t dev_id);
+
+ private:
+  using Key = std::pair<pi_dev_id_t, pi_p4_id_t>;
+
+  // each key is stored once, in key_to_handle; handle_to_key points to it,
+  // which is safe because references to the elements of an unordered_map stay
+  // valid until the element is erased, even when the map is rehashed
+  struct TableCache {
+    std::unordered_map<std::string, pi_entry_handle_t> key_to_handle{};
+    std::unordered_map<pi_entry_handle_t, const std::string *> handle_to_key{};
+  };
+
+  static std::string make_key(const pi_match_key_t *match_key);
+
+  mutable std::mutex mutex{};
+  std::map<Key, TableCache> tables{};
+};
+
+// used by the table functions, created by _pi_init
+extern EntryHandleCache *entry_handle_cache;
+
+}  // namespace pibmv2
+
+#endif  // PI_BMV2_ENTRY_HANDLE_CACHE_H_
@@ -0,0 +1,130 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "hw_sync_pool.h"
+
+#include <algorithm>  // for std::max
+#include <utility>  // for std::move
+
+namespace pibmv2 {
+
+HwSyncPool *hw_sync_pool = nullptr;
+
+namespace {
+
+// the pool whose worker_loop is running in this thread, if any
+thread_local const HwSyncPool *current_pool = nullptr;
+
+}  // namespace
+
+HwSyncPool::HwSyncPool(size_t num_workers, size_t max_pending, SyncFn sync_fn)
+    : max_pending(std::max(max_pending, static_cast<size_t>(1))),
+      sync_fn(std::move(sync_fn)) {
+  num_workers = std::max(num_workers, static_cast<size_t>(1));
+  for (size_t i = 0; i < num_workers; i++)
+    workers.emplace_back(&HwSyncPool::worker_loop, this);
+}
+
+HwSyncPool::~HwSyncPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop = true;
+  }
+  cv_not_empty.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+void
+HwSyncPool::submit(pi_dev_id_t dev_id, pi_p4_id_t counter_id, DoneFn done) {
+  Key key(dev_id, counter_id);
+  Request request{std::move(done), Clock::now()};
+  std::unique_lock<std::mutex> lock(mutex);
+  stats.requests++;
+  auto it = queued.find(key);
+  if (it != queued.end()) {
+    stats.merged++;
+    it->second->requests.push_back(std::move(request));
+    return;
+  }
+  // if all the workers were blocked here, no one would ever dequeue a job
+  if (current_pool != this) {
+    cv_not_full.wait(lock, [this] { return queue.size() < max_pending; });
+    // a sync for the same counter may have been queued while we were waiting
+    it = queued.find(key);
+    if (it != queued.end()) {
+      stats.merged++;
+      it->second->requests.push_back(std::move(request));
+      return;
+    }
+  }
+  std::unique_ptr<Job> job(new Job{key, {}});
+  job->requests.push_back(std::move(request));
+  queued.emplace(key, job.get());
+  queue.push_back(std::move(job));
+  stats.queue_depth = queue.size();
+  stats.max_queue_depth = std::max(stats.max_queue_depth, queue.size());
+  lock.unlock();
+  cv_not_empty.notify_one();
+}
+
+void
+HwSyncPool::worker_loop() {
+  current_pool = this;
+  while (true) {
+    std::unique_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv_not_empty.wait(lock, [this] { return stop || !queue.empty(); });
+      if (queue.empty()) return;  // stop requested and nothing left to do
+      job = std::move(queue.front());
+      queue.pop_front();
+      // from now on, new requests for this counter need a new sync
+      queued.erase(job->key);
+      stats.queue_depth = queue.size();
+    }
+    cv_not_full.notify_one();
+
+    // every request merged into this sync gets its status
+    auto status = sync_fn(job->key.first, job->key.second);
+    std::chrono::microseconds total_latency(0);
+    std::chrono::microseconds max_latency(0);
+    for (const auto &request : job->requests) {
+      request.done(status);
+      auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+          Clock::now() - request.submitted);
+      total_latency += latency;
+      max_latency = std::max(max_latency, latency);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    stats.syncs++;
+    if (status != PI_STATUS_SUCCESS) stats.failed_syncs++;
+    stats.total_latency += total_latency;
+    stats.max_latency = std::max(stats.max_latency, max_latency);
+  }
+}
+
+HwSyncPool::Stats
+HwSyncPool::get_stats() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return stats;
+}
+
+}  // namespace pibmv2
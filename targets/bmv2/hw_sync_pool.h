@@ -0,0 +1,115 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_BMV2_HW_SYNC_POOL_H_
+#define PI_BMV2_HW_SYNC_POOL_H_
+
+#include <PI/pi.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pibmv2 {
+
+// Runs asynchronous counter HW syncs (pi_counter_hw_sync with a callback) on a
+// fixed number of worker threads. At most max_pending syncs can be queued, a
+// caller submitting a new sync when the queue is full blocks until a worker
+// dequeues one. A request for a counter which already has a queued sync (not
+// yet picked up by a worker) is merged with it: the target sync is done once
+// and all the callbacks are called, with the status of that sync. This class
+// only depends on the PI headers and can be used by other targets as is.
+class HwSyncPool {
+ public:
+  using Clock = std::chrono::steady_clock;
+  // does the actual sync with the target; called from a worker thread
+  using SyncFn = std::function<pi_status_t(pi_dev_id_t, pi_p4_id_t)>;
+  // called from a worker thread once the sync is done, with its status
+  using DoneFn = std::function<void(pi_status_t)>;
+
+  struct Stats {
+    // syncs waiting for a worker
+    size_t queue_depth;
+    size_t max_queue_depth;
+    // number of calls to submit
+    uint64_t requests;
+    // requests merged with an already queued sync
+    uint64_t merged;
+    // number of target syncs done, and how many of them failed
+    uint64_t syncs;
+    uint64_t failed_syncs;
+    // time between submit and the callback being called, over all requests
+    std::chrono::microseconds total_latency;
+    std::chrono::microseconds max_latency;
+  };
+
+  HwSyncPool(size_t num_workers, size_t max_pending, SyncFn sync_fn);
+
+  // the queued syncs are completed before the workers exit
+  ~HwSyncPool();
+
+  // When called from a callback (i.e. from a worker thread), submit never
+  // blocks, even if the queue is full, as it could otherwise wait for itself.
+  void submit(pi_dev_id_t dev_id, pi_p4_id_t counter_id, DoneFn done);
+
+  Stats get_stats() const;
+
+ private:
+  using Key = std::pair<pi_dev_id_t, pi_p4_id_t>;
+
+  struct Request {
+    DoneFn done;
+    Clock::time_point submitted;
+  };
+
+  struct Job {
+    Key key;
+    std::vector<Request> requests;
+  };
+
+  void worker_loop();
+
+  const size_t max_pending;
+  SyncFn sync_fn;
+  mutable std::mutex mutex{};
+  std::condition_variable cv_not_empty{};
+  std::condition_variable cv_not_full{};
+  std::deque<std::unique_ptr<Job> > queue{};
+  // the queued jobs, for merging
+  std::map<Key, Job *> queued{};
+  bool stop{false};
+  Stats stats{};
+  std::vector<std::thread> workers{};
+};
+
+// used by _pi_counter_hw_sync, created by _pi_init
+extern HwSyncPool *hw_sync_pool;
+
+}  // namespace pibmv2
+
+#endif  // PI_BMV2_HW_SYNC_POOL_H_
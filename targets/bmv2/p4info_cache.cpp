@@ -0,0 +1,120 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#include "p4info_cache.h"
+
+#include <PI/int/pi_int.h>
+
+#include <string>
+
+namespace pibmv2 {
+
+namespace {
+
+BmMatchParam make_param_template(pi_p4info_match_type_t match_type) {
+  BmMatchParam param;
+  switch (match_type) {
+    case PI_P4INFO_MATCH_TYPE_VALID:
+      param.type = BmMatchParamType::type::VALID;
+      param.__set_valid(BmMatchParamValid());
+      break;
+    case PI_P4INFO_MATCH_TYPE_EXACT:
+      param.type = BmMatchParamType::type::EXACT;
+      param.__set_exact(BmMatchParamExact());
+      break;
+    case PI_P4INFO_MATCH_TYPE_LPM:
+      param.type = BmMatchParamType::type::LPM;
+      param.__set_lpm(BmMatchParamLPM());
+      break;
+    case PI_P4INFO_MATCH_TYPE_TERNARY:
+      param.type = BmMatchParamType::type::TERNARY;
+      param.__set_ternary(BmMatchParamTernary());
+      break;
+    case PI_P4INFO_MATCH_TYPE_RANGE:
+      param.type = BmMatchParamType::type::RANGE;
+      param.__set_range(BmMatchParamRange());
+      break;
+    default:
+      assert(0);
+  }
+  return param;
+}
+
+}  // namespace
+
+P4InfoCache::P4InfoCache(const pi_p4info_t *p4info) {
+  for (auto t_id = pi_p4info_table_begin(p4info);
+       t_id != pi_p4info_table_end(p4info);
+       t_id = pi_p4info_table_next(p4info, t_id)) {
+    auto &table = tables[t_id];
+    table.name = pi_p4info_table_name_from_id(p4info, t_id);
+    table.requires_priority = false;
+    size_t num_match_fields = pi_p4info_table_num_match_fields(p4info, t_id);
+    table.key_template.reserve(num_match_fields);
+    table.field_nbytes.reserve(num_match_fields);
+    for (size_t i = 0; i < num_match_fields; i++) {
+      auto finfo = pi_p4info_table_match_field_info(p4info, t_id, i);
+      table.key_template.push_back(make_param_template(finfo->match_type));
+      table.field_nbytes.push_back((finfo->bitwidth + 7) / 8);
+      if (finfo->match_type == PI_P4INFO_MATCH_TYPE_TERNARY ||
+          finfo->match_type == PI_P4INFO_MATCH_TYPE_RANGE) {
+        table.requires_priority = true;
+      }
+    }
+    table.indirect =
+        (pi_p4info_table_get_implementation(p4info, t_id) != PI_INVALID_ID);
+  }
+
+  for (auto a_id = pi_p4info_action_begin(p4info);
+       a_id != pi_p4info_action_end(p4info);
+       a_id = pi_p4info_action_next(p4info, a_id)) {
+    std::string a_name(pi_p4info_action_name_from_id(p4info, a_id));
+    actions_by_name.emplace(
+        a_name, ADataSize(a_id, pi_p4info_action_data_size(p4info, a_id)));
+    names.emplace(a_id, std::move(a_name));
+  }
+
+  for (auto type : {PI_COUNTER_ID, PI_METER_ID, PI_ACT_PROF_ID}) {
+    for (auto id = pi_p4info_any_begin(p4info, type);
+         id != pi_p4info_any_end(p4info, type);
+         id = pi_p4info_any_next(p4info, id)) {
+      names.emplace(id, pi_p4info_any_name_from_id(p4info, id));
+    }
+  }
+
+  for (auto c_id = pi_p4info_direct_counter_begin(p4info);
+       c_id != pi_p4info_direct_counter_end(p4info);
+       c_id = pi_p4info_direct_counter_next(p4info, c_id)) {
+    pi_p4_id_t t_id = pi_p4info_counter_get_direct(p4info, c_id);
+    // guaranteed by PI common code
+    assert(t_id != PI_INVALID_ID);
+    names.emplace(c_id, tables.at(t_id).name);
+  }
+
+  for (auto m_id = pi_p4info_direct_meter_begin(p4info);
+       m_id != pi_p4info_direct_meter_end(p4info);
+       m_id = pi_p4info_direct_meter_next(p4info, m_id)) {
+    pi_p4_id_t t_id = pi_p4info_meter_get_direct(p4info, m_id);
+    assert(t_id != PI_INVALID_ID);
+    names.emplace(m_id, tables.at(t_id).name);
+  }
+}
+
+}  // namespace pibmv2
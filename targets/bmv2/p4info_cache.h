@@ -0,0 +1,81 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+#ifndef PI_BMV2_P4INFO_CACHE_H_
+#define PI_BMV2_P4INFO_CACHE_H_
+
+#include <PI/p4info.h>
+#include <PI/pi.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "conn_mgr.h"
+
+namespace pibmv2 {
+
+// Everything the bmv2 target needs to translate PI ids into Thrift calls,
+// computed once from the P4Info when a device is assigned or updated, so that
+// the target functions do not need to query the P4Info and build new strings
+// for each call. Instances are immutable once constructed. P4 ids are not
+// dense, so the resources are indexed with hash maps.
+class P4InfoCache {
+ public:
+  struct Table {
+    std::string name;
+    // one param per match field, with the type (and the union member) already
+    // set; only the values need to be filled in
+    BmMatchParams key_template;
+    // size in bytes of each match field in the PI match key
+    std::vector<size_t> field_nbytes;
+    bool requires_priority;
+    // true for tables with an action profile
+    bool indirect;
+  };
+
+  explicit P4InfoCache(const pi_p4info_t *p4info);
+
+  const Table &table(pi_p4_id_t table_id) const {
+    return tables.at(table_id);
+  }
+
+  // name of any action, counter, meter or action profile; for direct counters
+  // and direct meters, this is the name of the table they are attached to, as
+  // expected by bmv2
+  const std::string &name(pi_p4_id_t id) const {
+    return names.at(id);
+  }
+
+  // bmv2 refers to actions by name when returning table entries and members
+  const ADataSize &action_from_name(const std::string &name) const {
+    return actions_by_name.at(name);
+  }
+
+ private:
+  std::unordered_map<pi_p4_id_t, Table> tables{};
+  std::unordered_map<pi_p4_id_t, std::string> names{};
+  std::unordered_map<std::string, ADataSize> actions_by_name{};
+};
+
+}  // namespace pibmv2
+
+#endif  // PI_BMV2_P4INFO_CACHE_H_
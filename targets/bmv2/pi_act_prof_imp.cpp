@@ -30,6 +30,7 @@
 #include "action_helpers.h"
 #include "common.h"
 #include "conn_mgr.h"
+#include "p4info_cache.h"
 
 namespace pibmv2 {
 
@@ -50,9 +51,8 @@ pi_status_t _pi_act_prof_mbr_create(pi_session_handle_t session_handle,
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
   auto adata = pibmv2::build_action_data(action_data, p4info);
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
-  std::string a_name(pi_p4info_action_name_from_id(p4info,
-                                                   action_data->action_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
+  const auto &a_name = d_info->p4info_cache->name(action_data->action_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
 
@@ -78,8 +78,7 @@ pi_status_t _pi_act_prof_mbr_delete(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
 
@@ -108,9 +107,8 @@ pi_status_t _pi_act_prof_mbr_modify(pi_session_handle_t session_handle,
   const pi_p4info_t *p4info = d_info->p4info;
 
   auto adata = pibmv2::build_action_data(action_data, p4info);
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
-  std::string a_name(pi_p4info_action_name_from_id(p4info,
-                                                   action_data->action_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
+  const auto &a_name = d_info->p4info_cache->name(action_data->action_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
 
@@ -138,8 +136,7 @@ pi_status_t _pi_act_prof_grp_create(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
 
@@ -166,8 +163,7 @@ pi_status_t _pi_act_prof_grp_delete(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
 
   grp_handle = pibmv2::IndirectHMgr::clear_grp_h(grp_handle);
 
@@ -195,8 +191,7 @@ pi_status_t _pi_act_prof_grp_add_mbr(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
 
   grp_handle = pibmv2::IndirectHMgr::clear_grp_h(grp_handle);
 
@@ -225,8 +220,7 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
 
   grp_handle = pibmv2::IndirectHMgr::clear_grp_h(grp_handle);
 
@@ -246,6 +240,16 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
   return PI_STATUS_SUCCESS;
 }
 
+// the bmv2 Thrift API has no call to reset an action profile, so PI deletes the
+// groups and members one by one
+pi_status_t _pi_act_prof_clear(pi_session_handle_t session_handle,
+                               pi_dev_id_t dev_id, pi_p4_id_t act_prof_id) {
+  (void) session_handle;
+  (void) dev_id;
+  (void) act_prof_id;
+  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
 pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
                                        pi_dev_id_t dev_id,
                                        pi_p4_id_t act_prof_id,
@@ -255,7 +259,7 @@ pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
-  std::string ap_name(pi_p4info_act_prof_name_from_id(p4info, act_prof_id));
+  const auto &ap_name = d_info->p4info_cache->name(act_prof_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
 
@@ -280,13 +284,9 @@ pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
     data_size += members.size() * sizeof(s_pi_indirect_handle_t);
     // action id and action data nbytes
     data_size += members.size() * (sizeof(s_pi_p4_id_t) + sizeof(uint32_t));
-    size_t num_actions;
-    auto action_ids = pi_p4info_act_prof_get_actions(p4info, act_prof_id,
-                                                     &num_actions);
-    auto action_map = pibmv2::ADataSize::compute_action_sizes(
-        p4info, action_ids, num_actions);
+    const auto &p4info_cache = *d_info->p4info_cache;
     for (const auto &mbr : members)
-      data_size += action_map.at(mbr.action_name).s;
+      data_size += p4info_cache.action_from_name(mbr.action_name).s;
 
     char *data = new char[data_size];
     res->entries_members_size = data_size;
@@ -294,7 +294,7 @@ pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
 
     for (const auto &mbr : members) {
       data += emit_indirect_handle(data, mbr.mbr_handle);
-      const auto &adata_size = action_map.at(mbr.action_name);
+      const auto &adata_size = p4info_cache.action_from_name(mbr.action_name);
       data += emit_p4_id(data, adata_size.id);
       data += emit_uint32(data, adata_size.s);
       data = pibmv2::dump_action_data(p4info, data, adata_size.id,
@@ -24,11 +24,12 @@
 
 #include <iostream>
 #include <string>
-#include <thread>
 
 #include "common.h"
 #include "conn_mgr.h"
 #include "direct_res_spec.h"
+#include "hw_sync_pool.h"
+#include "p4info_cache.h"
 
 namespace pibmv2 {
 
@@ -65,13 +66,6 @@ void merge_current_value(pi_counter_data_t *desired_data,
   }
 }
 
-std::string get_direct_t_name(const pi_p4info_t *p4info, pi_p4_id_t c_id) {
-  pi_p4_id_t t_id = pi_p4info_counter_get_direct(p4info, c_id);
-  // guaranteed by PI common code
-  assert(t_id != PI_INVALID_ID);
-  return std::string(pi_p4info_table_name_from_id(p4info, t_id));
-}
-
 }  // namespace
 
 extern "C" {
@@ -85,8 +79,7 @@ pi_status_t _pi_counter_read(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string c_name(pi_p4info_counter_name_from_id(p4info, counter_id));
+  const auto &c_name = d_info->p4info_cache->name(counter_id);
 
   BmCounterValue value;
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
@@ -113,8 +106,7 @@ pi_status_t _pi_counter_write(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string c_name(pi_p4info_counter_name_from_id(p4info, counter_id));
+  const auto &c_name = d_info->p4info_cache->name(counter_id);
 
   // very poor man solution: bmv2 does not (yet) let us set only one of bytes /
   // packets, so we first retrieve the current data and use it
@@ -151,8 +143,7 @@ pi_status_t _pi_counter_read_direct(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string t_name = get_direct_t_name(p4info, counter_id);
+  const auto &t_name = d_info->p4info_cache->name(counter_id);
 
   BmCounterValue value;
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
@@ -180,8 +171,7 @@ pi_status_t _pi_counter_write_direct(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string t_name = get_direct_t_name(p4info, counter_id);
+  const auto &t_name = d_info->p4info_cache->name(counter_id);
 
   // very poor man solution: bmv2 does not (yet) let us set only one of bytes /
   // packets, so we first retrieve the current data and use it
@@ -215,8 +205,18 @@ pi_status_t _pi_counter_hw_sync(pi_session_handle_t session_handle,
                                 PICounterHwSyncCb cb, void *cb_cookie) {
   (void)session_handle;
   if (!cb) return PI_STATUS_SUCCESS;
-  std::thread cb_thread(cb, dev_tgt.dev_id, counter_id, cb_cookie);
-  cb_thread.detach();
+  auto dev_id = dev_tgt.dev_id;
+  // the PI callback has no way of reporting an error, so a failed sync is
+  // logged before the callback is called
+  pibmv2::hw_sync_pool->submit(
+      dev_id, counter_id, [dev_id, counter_id, cb, cb_cookie](
+          pi_status_t status) {
+        if (status != PI_STATUS_SUCCESS) {
+          std::cout << "HW sync of counter " << counter_id << " on device "
+                    << dev_id << " failed with status " << status << "\n";
+        }
+        cb(dev_id, counter_id, cb_cookie);
+      });
   return PI_STATUS_SUCCESS;
 }
 
@@ -22,6 +22,7 @@
 #include <PI/target/pi_imp.h>
 
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include <cstring>  // for memset
@@ -29,6 +30,9 @@
 #include "common.h"
 #include "conn_mgr.h"
 #include "cpu_send_recv.h"
+#include "entry_handle_cache.h"
+#include "hw_sync_pool.h"
+#include "p4info_cache.h"
 
 namespace pibmv2 {
 
@@ -53,6 +57,12 @@ pi_status_t _pi_init(void *extra) {
   pibmv2::conn_mgr_state = pibmv2::conn_mgr_create();
   cpu_send_recv = new pibmv2::CpuSendRecv();
   cpu_send_recv->start();
+  // bmv2 counters are always in sync with the data plane, there is nothing to
+  // do besides calling the callbacks
+  pibmv2::hw_sync_pool = new pibmv2::HwSyncPool(
+      4  /* num_workers */, 1024  /* max_pending */,
+      [](pi_dev_id_t, pi_p4_id_t) { return PI_STATUS_SUCCESS; });
+  pibmv2::entry_handle_cache = new pibmv2::EntryHandleCache();
   return PI_STATUS_SUCCESS;
 }
 
@@ -62,6 +72,8 @@ pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info,
   assert(!d_info->assigned);
   int rpc_port_num = -1;
   std::string bm_notifications_addr("");
+  std::string cpu_iface("");
+  auto cpu_iface_backend = pibmv2::CpuSendRecv::Backend::PCAP;
   for (; !extra->end_of_extras; extra++) {
     std::string key(extra->key);
     if (key == "port" && extra->v) {
@@ -74,18 +86,34 @@ pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info,
     } else if (key == "notifications" && extra->v) {
       bm_notifications_addr = std::string(extra->v);
     } else if (key == "cpu_iface" && extra->v) {
-      int rc = cpu_send_recv->add_device(std::string(extra->v), dev_id);
-      if (rc < 0) return PI_STATUS_INVALID_INIT_EXTRA_PARAM;
+      cpu_iface = std::string(extra->v);
+    } else if (key == "cpu_iface_backend" && extra->v) {
+      if (!pibmv2::CpuSendRecv::backend_from_name(std::string(extra->v),
+                                                  &cpu_iface_backend)) {
+        return PI_STATUS_INVALID_INIT_EXTRA_PARAM;
+      }
     }
   }
   if (rpc_port_num == -1) return PI_STATUS_MISSING_INIT_EXTRA_PARAM;
   if (conn_mgr_client_init(pibmv2::conn_mgr_state, dev_id, rpc_port_num))
     return PI_STATUS_TARGET_TRANSPORT_ERROR;
 
+  // the CPU port is opened last, so that it does not need to be closed if one
+  // of the steps above fails
+  if (cpu_iface != "") {
+    int rc = cpu_send_recv->add_device(cpu_iface, dev_id, cpu_iface_backend);
+    if (rc < 0) {
+      pibmv2::conn_mgr_client_close(pibmv2::conn_mgr_state, dev_id);
+      return PI_STATUS_INVALID_INIT_EXTRA_PARAM;
+    }
+  }
+
   if (bm_notifications_addr != "")
     pibmv2::start_learn_listener(bm_notifications_addr, rpc_port_num);
 
+  pibmv2::entry_handle_cache->clear(dev_id);
   d_info->p4info = p4info;
+  d_info->p4info_cache = std::make_shared<pibmv2::P4InfoCache>(p4info);
   d_info->assigned = 1;
   return PI_STATUS_SUCCESS;
 }
@@ -108,7 +136,10 @@ pi_status_t _pi_update_device_start(pi_dev_id_t dev_id,
     return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + iso.code);
   }
 
+  // the handles of the old config are not valid anymore
+  pibmv2::entry_handle_cache->clear(dev_id);
   d_info->p4info = p4info;
+  d_info->p4info_cache = std::make_shared<pibmv2::P4InfoCache>(p4info);
   return PI_STATUS_SUCCESS;
 }
 
@@ -131,14 +162,22 @@ pi_status_t _pi_remove_device(pi_dev_id_t dev_id) {
   assert(d_info->assigned);
   pibmv2::conn_mgr_client_close(pibmv2::conn_mgr_state, dev_id);
   cpu_send_recv->remove_device(dev_id);
+  pibmv2::entry_handle_cache->clear(dev_id);
+  d_info->p4info_cache.reset();
   d_info->assigned = 0;
   return PI_STATUS_SUCCESS;
 }
 
 pi_status_t _pi_destroy() {
+  // callbacks may read counters, so we complete them before closing the
+  // connections
+  delete pibmv2::hw_sync_pool;
+  pibmv2::hw_sync_pool = nullptr;
   pibmv2::conn_mgr_destroy(pibmv2::conn_mgr_state);
   pibmv2::stop_learn_listener();
   delete cpu_send_recv;
+  delete pibmv2::entry_handle_cache;
+  pibmv2::entry_handle_cache = nullptr;
   return PI_STATUS_SUCCESS;
 }
 
@@ -171,4 +210,12 @@ pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
   return PI_STATUS_SUCCESS;
 }
 
+pi_status_t _pi_packetout_send_batch(pi_dev_id_t dev_id,
+                                     const char *const *pkts,
+                                     const size_t *sizes, size_t num_pkts) {
+  if (cpu_send_recv->send_pkt_batch(dev_id, pkts, sizes, num_pkts) != 0)
+    return PI_STATUS_PACKETOUT_SEND_ERROR;
+  return PI_STATUS_SUCCESS;
+}
+
 }
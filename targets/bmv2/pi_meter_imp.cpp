@@ -29,6 +29,7 @@
 #include "common.h"
 #include "conn_mgr.h"
 #include "direct_res_spec.h"
+#include "p4info_cache.h"
 
 namespace pibmv2 {
 
@@ -64,13 +65,6 @@ convert_to_meter_spec(const pi_p4info_t *p4info, pi_p4_id_t m_id,
   conv(rates.at(1), &meter_spec->pir, &meter_spec->pburst);
 }
 
-std::string get_direct_t_name(const pi_p4info_t *p4info, pi_p4_id_t m_id) {
-  pi_p4_id_t t_id = pi_p4info_meter_get_direct(p4info, m_id);
-  // guaranteed by PI common code
-  assert(t_id != PI_INVALID_ID);
-  return std::string(pi_p4info_table_name_from_id(p4info, t_id));
-}
-
 }  // namespace
 
 extern "C" {
@@ -85,7 +79,7 @@ pi_status_t _pi_meter_read(pi_session_handle_t session_handle,
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
-  std::string m_name(pi_p4info_meter_name_from_id(p4info, meter_id));
+  const auto &m_name = d_info->p4info_cache->name(meter_id);
 
   std::vector<BmMeterRateConfig> rates;
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
@@ -113,8 +107,7 @@ pi_status_t _pi_meter_set(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string m_name(pi_p4info_meter_name_from_id(p4info, meter_id));
+  const auto &m_name = d_info->p4info_cache->name(meter_id);
 
   auto rates = pibmv2::convert_from_meter_spec(meter_spec);
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
@@ -140,7 +133,7 @@ pi_status_t _pi_meter_read_direct(pi_session_handle_t session_handle,
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
-  std::string t_name = get_direct_t_name(p4info, meter_id);
+  const auto &t_name = d_info->p4info_cache->name(meter_id);
 
   std::vector<BmMeterRateConfig> rates;
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
@@ -167,8 +160,7 @@ pi_status_t _pi_meter_set_direct(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-  std::string t_name = get_direct_t_name(p4info, meter_id);
+  const auto &t_name = d_info->p4info_cache->name(meter_id);
 
   auto rates = pibmv2::convert_from_meter_spec(meter_spec);
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
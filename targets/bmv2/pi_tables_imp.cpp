@@ -35,6 +35,8 @@
 #include "common.h"
 #include "conn_mgr.h"
 #include "direct_res_spec.h"
+#include "entry_handle_cache.h"
+#include "p4info_cache.h"
 
 namespace pibmv2 {
 
@@ -68,108 +70,64 @@ class PriorityInverter {
   }
 };
 
-std::vector<BmMatchParam> build_key(pi_p4_id_t table_id,
-                                    const pi_match_key_t *match_key,
-                                    const pi_p4info_t *p4info,
-                                    bool *requires_priority) {
-  std::vector<BmMatchParam> key;
-  *requires_priority = false;
+// the key template already has the correct type for each field, which saves
+// us from querying the P4Info for each field
+void build_key_and_options(const pibmv2::P4InfoCache::Table &table,
+                           const pi_match_key_t *match_key,
+                           BmMatchParams *mkey, BmAddEntryOptions *options) {
+  *mkey = table.key_template;
 
   const char *mk_data = match_key->data;
 
-  BmMatchParam param;
-  BmMatchParamValid param_valid;
-  BmMatchParamExact param_exact;
-  BmMatchParamLPM param_lpm;
-  BmMatchParamTernary param_ternary;
-  BmMatchParamRange param_range;
-
-  size_t num_match_fields = pi_p4info_table_num_match_fields(p4info, table_id);
-  for (size_t i = 0; i < num_match_fields; i++) {
-    auto finfo = pi_p4info_table_match_field_info(p4info, table_id, i);
-    size_t f_bw = finfo->bitwidth;
-    size_t nbytes = (f_bw + 7) / 8;
+  for (size_t i = 0; i < mkey->size(); i++) {
+    auto &param = (*mkey)[i];
+    size_t nbytes = table.field_nbytes[i];
     uint32_t pLen;
 
-    switch (finfo->match_type) {
-      case PI_P4INFO_MATCH_TYPE_VALID:
-        param_valid.key = (*mk_data != 0);
+    switch (param.type) {
+      case BmMatchParamType::type::VALID:
+        param.valid.key = (*mk_data != 0);
         mk_data++;
-        param = BmMatchParam();
-        param.type = BmMatchParamType::type::VALID;
-        param.__set_valid(param_valid);  // does a copy of param_valid
-        key.push_back(std::move(param));
         break;
-      case PI_P4INFO_MATCH_TYPE_EXACT:
-        param_exact.key = std::string(mk_data, nbytes);
+      case BmMatchParamType::type::EXACT:
+        param.exact.key.assign(mk_data, nbytes);
         mk_data += nbytes;
-        param = BmMatchParam();
-        param.type = BmMatchParamType::type::EXACT;
-        param.__set_exact(param_exact);  // does a copy of param_exact
-        key.push_back(std::move(param));
         break;
-      case PI_P4INFO_MATCH_TYPE_LPM:
-        param_lpm.key = std::string(mk_data, nbytes);
+      case BmMatchParamType::type::LPM:
+        param.lpm.key.assign(mk_data, nbytes);
         mk_data += nbytes;
         mk_data += retrieve_uint32(mk_data, &pLen);
-        param_lpm.prefix_length = static_cast<int32_t>(pLen);
-        param = BmMatchParam();
-        param.type = BmMatchParamType::type::LPM;
-        param.__set_lpm(param_lpm);  // does a copy of param_lpm
-        key.push_back(std::move(param));
+        param.lpm.prefix_length = static_cast<int32_t>(pLen);
         break;
-      case PI_P4INFO_MATCH_TYPE_TERNARY:
-        param_ternary.key = std::string(mk_data, nbytes);
+      case BmMatchParamType::type::TERNARY:
+        param.ternary.key.assign(mk_data, nbytes);
         mk_data += nbytes;
-        param_ternary.mask = std::string(mk_data, nbytes);
+        param.ternary.mask.assign(mk_data, nbytes);
         mk_data += nbytes;
-        param = BmMatchParam();
-        param.type = BmMatchParamType::type::TERNARY;
-        param.__set_ternary(param_ternary);  // does a copy of param_ternary
-        key.push_back(std::move(param));
-
-        *requires_priority = true;
         break;
-      case PI_P4INFO_MATCH_TYPE_RANGE:
-        param_range.start = std::string(mk_data, nbytes);
+      case BmMatchParamType::type::RANGE:
+        param.range.start.assign(mk_data, nbytes);
         mk_data += nbytes;
-        param_range.end_ = std::string(mk_data, nbytes);
+        param.range.end_.assign(mk_data, nbytes);
         mk_data += nbytes;
-        param = BmMatchParam();
-        param.type = BmMatchParamType::type::RANGE;
-        param.__set_range(param_range);  // does a copy of param_range
-        key.push_back(std::move(param));
-
-        *requires_priority = true;
         break;
-      default:
-        assert(0);
     }
   }
 
-  return key;
-}
-
-void build_key_and_options(pi_p4_id_t table_id,
-                           const pi_match_key_t *match_key,
-                           const pi_p4info_t *p4info,
-                           BmMatchParams *mkey, BmAddEntryOptions *options) {
-  bool requires_priority = false;
-  *mkey = build_key(table_id, match_key, p4info, &requires_priority);
-  if (requires_priority)
+  if (table.requires_priority)
     options->__set_priority(PriorityInverter::pi_to_bm(match_key->priority));
 }
 
 
 pi_entry_handle_t add_entry(const pi_p4info_t *p4info,
+                            const pibmv2::P4InfoCache &p4info_cache,
                             pi_dev_tgt_t dev_tgt,
                             const std::string &t_name,
                             const BmMatchParams &mkey,
                             const pi_action_data_t *adata,
                             const BmAddEntryOptions &options) {
   auto action_data = pibmv2::build_action_data(adata, p4info);
-  pi_p4_id_t action_id = adata->action_id;
-  std::string a_name(pi_p4info_action_name_from_id(p4info, action_id));
+  const auto &a_name = p4info_cache.name(adata->action_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
 
@@ -198,12 +156,12 @@ pi_entry_handle_t add_indirect_entry(const pi_p4info_t *p4info,
 }
 
 void set_default_entry(const pi_p4info_t *p4info,
+                       const pibmv2::P4InfoCache &p4info_cache,
                        pi_dev_tgt_t dev_tgt,
                        const std::string &t_name,
                        const pi_action_data_t *adata) {
   auto action_data = pibmv2::build_action_data(adata, p4info);
-  pi_p4_id_t action_id = adata->action_id;
-  std::string a_name(pi_p4info_action_name_from_id(p4info, action_id));
+  const auto &a_name = p4info_cache.name(adata->action_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
 
@@ -227,13 +185,13 @@ void set_default_indirect_entry(const pi_p4info_t *p4info,
 }
 
 void modify_entry(const pi_p4info_t *p4info,
+                  const pibmv2::P4InfoCache &p4info_cache,
                   pi_dev_id_t dev_id,
                   const std::string &t_name,
                   pi_entry_handle_t entry_handle,
                   const pi_action_data_t *adata) {
   auto action_data = pibmv2::build_action_data(adata, p4info);
-  pi_p4_id_t action_id = adata->action_id;
-  std::string a_name(pi_p4info_action_name_from_id(p4info, action_id));
+  const auto &a_name = p4info_cache.name(adata->action_id);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
 
@@ -260,15 +218,17 @@ void modify_indirect_entry(const pi_p4info_t *p4info,
   }
 }
 
-void retrieve_entry(const pi_p4info_t *p4info, const std::string &a_name,
+void retrieve_entry(const pi_p4info_t *p4info,
+                    const pibmv2::P4InfoCache &p4info_cache,
+                    const std::string &a_name,
                     const BmActionData &action_data,
                     pi_table_entry_t *table_entry) {
-  const pi_p4_id_t action_id = pi_p4info_action_id_from_name(
-      p4info, a_name.c_str());
+  const auto &action = p4info_cache.action_from_name(a_name);
+  const pi_p4_id_t action_id = action.id;
 
   table_entry->entry_type = PI_ACTION_ENTRY_TYPE_DATA;
 
-  const size_t adata_size = pi_p4info_action_data_size(p4info, action_id);
+  const size_t adata_size = action.s;
 
   // no alignment issue with new[]
   char *data_ = new char[sizeof(pi_action_data_t) + adata_size];
@@ -334,15 +294,14 @@ pi_status_t retrieve_entry_wkey(pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                 BmMtEntry *entry) {
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
+  const auto &table = d_info->p4info_cache->table(table_id);
+  const auto &t_name = table.name;
 
   if (match_key->priority > BM_MAX_PRIORITY)
     return PI_STATUS_UNSUPPORTED_ENTRY_PRIORITY;
   BmMatchParams mkey;
   BmAddEntryOptions options;
-  build_key_and_options(table_id, match_key, p4info, &mkey, &options);
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
+  build_key_and_options(table, match_key, &mkey, &options);
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
 
@@ -358,6 +317,206 @@ pi_status_t retrieve_entry_wkey(pi_dev_id_t dev_id, pi_p4_id_t table_id,
   return PI_STATUS_SUCCESS;
 }
 
+// bmv2 only lets us retrieve all the entries of a table in one RPC
+pi_status_t retrieve_entries(pi_dev_id_t dev_id, const std::string &t_name,
+                             std::vector<BmMtEntry> *entries) {
+  try {
+    conn_mgr_client(pibmv2::conn_mgr_state, dev_id).c->bm_mt_get_entries(
+        *entries, 0, t_name);
+  } catch (InvalidTableOperation &ito) {
+    const char *what =
+        _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
+    std::cout << "Invalid table (" << t_name << ") operation ("
+              << ito.code << "): " << what << std::endl;
+    return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
+  }
+  return PI_STATUS_SUCCESS;
+}
+
+// serializes entries in [first, last) into res->entries
+template <typename It>
+void serialize_entries(const pi_p4info_t *p4info,
+                       const pibmv2::P4InfoCache &p4info_cache,
+                       pi_p4_id_t table_id, It first, It last,
+                       pi_table_fetch_res_t *res) {
+  res->num_entries = std::distance(first, last);
+
+  size_t data_size = 0u;
+
+  data_size += res->num_entries * sizeof(s_pi_entry_handle_t);
+  // TODO(antonin): really needed of table type is enough?
+  data_size += res->num_entries * sizeof(s_pi_action_entry_type_t);
+  data_size += res->num_entries * sizeof(uint32_t);  // for priority
+  data_size += res->num_entries * sizeof(uint32_t);  // for properties
+  data_size += res->num_entries * sizeof(uint32_t);  // for direct resources
+
+  res->mkey_nbytes = pi_p4info_table_match_key_size(p4info, table_id);
+  data_size += res->num_entries * res->mkey_nbytes;
+
+  for (auto it = first; it != last; ++it) {
+    const auto &e = *it;
+    switch (e.action_entry.action_type) {
+      case BmActionEntryType::NONE:
+        break;
+      case BmActionEntryType::ACTION_DATA:
+        data_size +=
+            p4info_cache.action_from_name(e.action_entry.action_name).s;
+        data_size += sizeof(s_pi_p4_id_t);  // action id
+        data_size += sizeof(uint32_t);  // action data nbytes
+        break;
+      case BmActionEntryType::MBR_HANDLE:
+      case BmActionEntryType::GRP_HANDLE:
+        data_size += sizeof(s_pi_indirect_handle_t);
+        break;
+    }
+  }
+
+  char *data = new char[data_size];
+  // in some cases, we do not use the whole buffer
+  std::fill(data, data + data_size, 0);
+  res->entries_size = data_size;
+  res->entries = data;
+
+  for (auto it = first; it != last; ++it) {
+    const auto &e = *it;
+    data += emit_entry_handle(data, e.entry_handle);
+    const auto &options = e.options;
+    // TODO(antonin): temporary hack; for match types which do not require a
+    // priority, bmv2 actually returns -1 instead of not setting the field, but
+    // the PI tends to expect 0, which is a problem for looking up entry state
+    // in the PI software. A more robust solution may be to ignore this value in
+    // the PI based on the key match type.
+    if (options.__isset.priority && options.priority != -1) {
+      data += emit_uint32(data, PriorityInverter::bm_to_pi(options.priority));
+    } else {
+      data += emit_uint32(data, 0);
+    }
+    for (const auto &p : e.match_key) {
+      switch (p.type) {
+        case BmMatchParamType::type::EXACT:
+          std::memcpy(data, p.exact.key.data(), p.exact.key.size());
+          data += p.exact.key.size();
+          break;
+        case BmMatchParamType::type::LPM:
+          std::memcpy(data, p.lpm.key.data(), p.lpm.key.size());
+          data += p.lpm.key.size();
+          data += emit_uint32(data, p.lpm.prefix_length);
+          break;
+        case BmMatchParamType::type::TERNARY:
+          std::memcpy(data, p.ternary.key.data(), p.ternary.key.size());
+          data += p.ternary.key.size();
+          std::memcpy(data, p.ternary.mask.data(), p.ternary.mask.size());
+          data += p.ternary.mask.size();
+          break;
+        case BmMatchParamType::type::VALID:
+          *data = p.valid.key;
+          data++;
+          break;
+        case BmMatchParamType::type::RANGE:
+          std::memcpy(data, p.range.start.data(), p.range.start.size());
+          data += p.range.start.size();
+          std::memcpy(data, p.range.end_.data(), p.range.end_.size());
+          data += p.range.end_.size();
+          break;
+      }
+    }
+
+    const auto &action_entry = e.action_entry;
+
+    switch (action_entry.action_type) {
+      case BmActionEntryType::NONE:
+        data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_NONE);
+        break;
+      case BmActionEntryType::ACTION_DATA:
+        {
+          data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_DATA);
+          const auto &adata_size =
+              p4info_cache.action_from_name(action_entry.action_name);
+          data += emit_p4_id(data, adata_size.id);
+          data += emit_uint32(data, adata_size.s);
+          data = pibmv2::dump_action_data(p4info, data, adata_size.id,
+                                          action_entry.action_data);
+        }
+        break;
+      case BmActionEntryType::MBR_HANDLE:
+        {
+          data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_INDIRECT);
+          auto indirect_handle =
+              static_cast<pi_indirect_handle_t>(action_entry.mbr_handle);
+          data += emit_indirect_handle(data, indirect_handle);
+        }
+        break;
+      case BmActionEntryType::GRP_HANDLE:
+        {
+          data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_INDIRECT);
+          auto indirect_handle =
+              static_cast<pi_indirect_handle_t>(action_entry.mbr_handle);
+          indirect_handle = pibmv2::IndirectHMgr::make_grp_h(indirect_handle);
+          data += emit_indirect_handle(data, indirect_handle);
+        }
+        break;
+    }
+
+    data += emit_uint32(data, 0);  // properties
+    data += emit_uint32(data, 0);  // TODO(antonin): direct resources
+  }
+
+}
+
+// bmv2 reports these errors when an entry handle no longer designates an entry
+bool is_stale_handle_error(const InvalidTableOperation &ito) {
+  return ito.code == TableOperationErrorCode::INVALID_HANDLE ||
+      ito.code == TableOperationErrorCode::EXPIRED_HANDLE;
+}
+
+pi_status_t table_operation_error(const std::string &t_name,
+                                  const InvalidTableOperation &ito) {
+  const char *what =
+      _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
+  std::cout << "Invalid table (" << t_name << ") operation ("
+            << ito.code << "): " << what << std::endl;
+  return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
+}
+
+// delete_entry and modify_entry_wh throw InvalidTableOperation, which lets the
+// _wkey functions decide whether to retry with a handle retrieved from bmv2
+
+void delete_entry(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                  pi_entry_handle_t entry_handle) {
+  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
+  assert(d_info->assigned);
+  const auto &table = d_info->p4info_cache->table(table_id);
+
+  auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
+  if (!table.indirect)
+    client.c->bm_mt_delete_entry(0, table.name, entry_handle);
+  else
+    client.c->bm_mt_indirect_delete_entry(0, table.name, entry_handle);
+  pibmv2::entry_handle_cache->remove(dev_id, table_id, entry_handle);
+}
+
+void modify_entry_wh(pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                     pi_entry_handle_t entry_handle,
+                     const pi_table_entry_t *table_entry) {
+  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
+  assert(d_info->assigned);
+  const pi_p4info_t *p4info = d_info->p4info;
+  const auto &p4info_cache = *d_info->p4info_cache;
+  const auto &t_name = p4info_cache.table(table_id).name;
+
+  if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_DATA) {
+    modify_entry(p4info, p4info_cache, dev_id, t_name, entry_handle,
+                 table_entry->entry.action_data);
+  } else if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_INDIRECT) {
+    modify_indirect_entry(p4info, dev_id, t_name, entry_handle,
+                          table_entry->entry.indirect_handle);
+  } else {
+    assert(0);
+  }
+  set_direct_resources(p4info, dev_id, t_name, entry_handle,
+                       table_entry->direct_res_config);
+}
+
 }  // namespace
 
 
@@ -376,20 +535,21 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
+  const auto &p4info_cache = *d_info->p4info_cache;
+  const auto &table = p4info_cache.table(table_id);
+  const auto &t_name = table.name;
 
   if (match_key->priority > BM_MAX_PRIORITY)
     return PI_STATUS_UNSUPPORTED_ENTRY_PRIORITY;
   BmMatchParams mkey;
   BmAddEntryOptions options;
-  build_key_and_options(table_id, match_key, p4info, &mkey, &options);
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
+  build_key_and_options(table, match_key, &mkey, &options);
 
   // TODO(antonin): entry timeout
   try {
     switch (table_entry->entry_type) {
       case PI_ACTION_ENTRY_TYPE_DATA:
-        *entry_handle = add_entry(p4info, dev_tgt, t_name, mkey,
+        *entry_handle = add_entry(p4info, p4info_cache, dev_tgt, t_name, mkey,
                                   table_entry->entry.action_data, options);
         break;
       case PI_ACTION_ENTRY_TYPE_INDIRECT:
@@ -411,6 +571,8 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
     return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
   }
 
+  pibmv2::entry_handle_cache->add(
+      dev_tgt.dev_id, table_id, match_key, *entry_handle);
   return PI_STATUS_SUCCESS;
 }
 
@@ -423,8 +585,9 @@ pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle,
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
+  const auto &p4info_cache = *d_info->p4info_cache;
+  const auto &table = p4info_cache.table(table_id);
+  const auto &t_name = table.name;
 
   try {
     if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_DATA) {
@@ -442,7 +605,7 @@ pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle,
           return PI_STATUS_CONST_DEFAULT_ACTION_NON_MUTABLE_PARAMS;
       }
 
-      set_default_entry(p4info, dev_tgt, t_name, adata);
+      set_default_entry(p4info, p4info_cache, dev_tgt, t_name, adata);
     } else if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_INDIRECT) {
       set_default_indirect_entry(p4info, dev_tgt, t_name,
                                  table_entry->entry.indirect_handle);
@@ -467,15 +630,14 @@ pi_status_t _pi_table_default_action_reset(pi_session_handle_t session_handle,
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_tgt.dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
-  auto ap_id = pi_p4info_table_get_implementation(p4info, table_id);
+  const auto &p4info_cache = *d_info->p4info_cache;
+  const auto &table = p4info_cache.table(table_id);
+  const auto &t_name = table.name;
 
   auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_tgt.dev_id);
 
   try {
-    if (ap_id == PI_INVALID_ID)
+    if (!table.indirect)
       client.c->bm_mt_reset_default_entry(0, t_name);
     else
       client.c->bm_mt_indirect_reset_default_entry(0, t_name);
@@ -499,8 +661,9 @@ pi_status_t _pi_table_default_action_get(pi_session_handle_t session_handle,
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
   const pi_p4info_t *p4info = d_info->p4info;
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
+  const auto &p4info_cache = *d_info->p4info_cache;
+  const auto &table = p4info_cache.table(table_id);
+  const auto &t_name = table.name;
 
   BmActionEntry entry;
   try {
@@ -519,7 +682,8 @@ pi_status_t _pi_table_default_action_get(pi_session_handle_t session_handle,
       table_entry->entry_type = PI_ACTION_ENTRY_TYPE_NONE;
       break;
     case BmActionEntryType::ACTION_DATA:
-      retrieve_entry(p4info, entry.action_name, entry.action_data, table_entry);
+      retrieve_entry(p4info, p4info_cache, entry.action_name,
+                     entry.action_data, table_entry);
       break;
     case BmActionEntryType::MBR_HANDLE:
       retrieve_indirect_entry(p4info, entry.mbr_handle, false, table_entry);
@@ -550,38 +714,48 @@ pi_status_t _pi_table_entry_delete(pi_session_handle_t session_handle,
                                    pi_entry_handle_t entry_handle) {
   (void) session_handle;
 
-  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
-  assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
-  auto ap_id = pi_p4info_table_get_implementation(p4info, table_id);
-
-  auto client = conn_mgr_client(pibmv2::conn_mgr_state, dev_id);
-
   try {
-    if (ap_id == PI_INVALID_ID)
-      client.c->bm_mt_delete_entry(0, t_name, entry_handle);
-    else
-      client.c->bm_mt_indirect_delete_entry(0, t_name, entry_handle);
+    delete_entry(dev_id, table_id, entry_handle);
   } catch (InvalidTableOperation &ito) {
-    const char *what =
-        _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
-    std::cout << "Invalid table (" << t_name << ") operation ("
-              << ito.code << "): " << what << std::endl;
-    return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
+    // the handle may have been cached for an entry deleted with the bmv2 CLI
+    pibmv2::entry_handle_cache->remove(dev_id, table_id, entry_handle);
+    const auto *d_info = pibmv2::get_device_info(dev_id);
+    return table_operation_error(d_info->p4info_cache->table(table_id).name,
+                                 ito);
   }
 
   return PI_STATUS_SUCCESS;
 }
 
 // for the _wkey functions (delete and modify), we first retrieve the handle,
-// then call the "usual" method. We release the Thrift session lock in between
-// the 2, which may not be ideal. This can be improved later if needed.
+// then call the "usual" method. The handle is taken from the cache when
+// possible; otherwise (or if bmv2 reports the cached handle as invalid, e.g.
+// because the entry was deleted with the bmv2 CLI) it is retrieved with an
+// extra RPC. Any other error is returned as is. The priority is checked first,
+// so that an unsupported priority is rejected whether or not the key is
+// cached. We release the Thrift session lock in between the 2, which may not be
+// ideal. This can be improved later if needed.
 
 pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle,
                                         pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                         const pi_match_key_t *match_key) {
+  if (match_key->priority > BM_MAX_PRIORITY)
+    return PI_STATUS_UNSUPPORTED_ENTRY_PRIORITY;
+  pi_entry_handle_t entry_handle;
+  if (pibmv2::entry_handle_cache->get(
+          dev_id, table_id, match_key, &entry_handle)) {
+    try {
+      delete_entry(dev_id, table_id, entry_handle);
+      return PI_STATUS_SUCCESS;
+    } catch (InvalidTableOperation &ito) {
+      if (!is_stale_handle_error(ito)) {
+        const auto *d_info = pibmv2::get_device_info(dev_id);
+        return table_operation_error(
+            d_info->p4info_cache->table(table_id).name, ito);
+      }
+      pibmv2::entry_handle_cache->remove(dev_id, table_id, entry_handle);
+    }
+  }
   BmMtEntry entry;
   pi_status_t status = retrieve_entry_wkey(dev_id, table_id, match_key, &entry);
   if (status != PI_STATUS_SUCCESS) return status;
@@ -596,30 +770,12 @@ pi_status_t _pi_table_entry_modify(pi_session_handle_t session_handle,
                                    const pi_table_entry_t *table_entry) {
   (void) session_handle;
 
-  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
-  assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
-
   try {
-    if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_DATA) {
-      modify_entry(p4info, dev_id, t_name, entry_handle,
-                   table_entry->entry.action_data);
-    } else if (table_entry->entry_type == PI_ACTION_ENTRY_TYPE_INDIRECT) {
-      modify_indirect_entry(p4info, dev_id, t_name, entry_handle,
-                            table_entry->entry.indirect_handle);
-    } else {
-      assert(0);
-    }
-    set_direct_resources(p4info, dev_id, t_name, entry_handle,
-                         table_entry->direct_res_config);
+    modify_entry_wh(dev_id, table_id, entry_handle, table_entry);
   } catch (InvalidTableOperation &ito) {
-    const char *what =
-        _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
-    std::cout << "Invalid table (" << t_name << ") operation ("
-              << ito.code << "): " << what << std::endl;
-    return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
+    const auto *d_info = pibmv2::get_device_info(dev_id);
+    return table_operation_error(d_info->p4info_cache->table(table_id).name,
+                                 ito);
   }
 
   return PI_STATUS_SUCCESS;
@@ -629,29 +785,53 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
                                         pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                         const pi_match_key_t *match_key,
                                         const pi_table_entry_t *table_entry) {
+  if (match_key->priority > BM_MAX_PRIORITY)
+    return PI_STATUS_UNSUPPORTED_ENTRY_PRIORITY;
+  pi_entry_handle_t entry_handle;
+  if (pibmv2::entry_handle_cache->get(
+          dev_id, table_id, match_key, &entry_handle)) {
+    try {
+      modify_entry_wh(dev_id, table_id, entry_handle, table_entry);
+      return PI_STATUS_SUCCESS;
+    } catch (InvalidTableOperation &ito) {
+      if (!is_stale_handle_error(ito)) {
+        const auto *d_info = pibmv2::get_device_info(dev_id);
+        return table_operation_error(
+            d_info->p4info_cache->table(table_id).name, ito);
+      }
+      pibmv2::entry_handle_cache->remove(dev_id, table_id, entry_handle);
+    }
+  }
   BmMtEntry entry;
   pi_status_t status = retrieve_entry_wkey(dev_id, table_id, match_key, &entry);
   if (status != PI_STATUS_SUCCESS) return status;
+  pibmv2::entry_handle_cache->add(
+      dev_id, table_id, match_key, entry.entry_handle);
   return _pi_table_entry_modify(session_handle, dev_id, table_id,
                                 entry.entry_handle, table_entry);
 }
 
-pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
+pi_status_t _pi_table_entry_handles_stable(pi_dev_id_t dev_id, bool *stable) {
+  (void) dev_id;
+  // bmv2 handles include a version number and are never reused for another
+  // entry while they are valid
+  *stable = true;
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_table_entries_clear(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id,
-                                    pi_p4_id_t table_id,
-                                    pi_table_fetch_res_t *res) {
+                                    pi_p4_id_t table_id) {
   (void) session_handle;
 
   pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
   assert(d_info->assigned);
-  const pi_p4info_t *p4info = d_info->p4info;
-
-  std::string t_name(pi_p4info_table_name_from_id(p4info, table_id));
+  const auto &t_name = d_info->p4info_cache->table(table_id).name;
 
-  std::vector<BmMtEntry> entries;
   try {
-    conn_mgr_client(pibmv2::conn_mgr_state, dev_id).c->bm_mt_get_entries(
-        entries, 0, t_name);
+    // same call for direct and indirect tables; the default entry is kept
+    conn_mgr_client(pibmv2::conn_mgr_state, dev_id).c->bm_mt_clear_entries(
+        0, t_name, false);
   } catch (InvalidTableOperation &ito) {
     const char *what =
         _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
@@ -660,137 +840,104 @@ pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
     return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
   }
 
-  res->num_entries = entries.size();
-
-  size_t data_size = 0u;
+  pibmv2::entry_handle_cache->clear(dev_id, table_id);
+  return PI_STATUS_SUCCESS;
+}
 
-  data_size += entries.size() * sizeof(s_pi_entry_handle_t);
-  // TODO(antonin): really needed of table type is enough?
-  data_size += entries.size() * sizeof(s_pi_action_entry_type_t);
-  data_size += entries.size() * sizeof(uint32_t);  // for priority
-  data_size += entries.size() * sizeof(uint32_t);  // for properties
-  data_size += entries.size() * sizeof(uint32_t);  // for direct resources
+pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
+                                    pi_dev_id_t dev_id,
+                                    pi_p4_id_t table_id,
+                                    pi_table_fetch_res_t *res) {
+  (void) session_handle;
 
-  res->mkey_nbytes = pi_p4info_table_match_key_size(p4info, table_id);
-  data_size += entries.size() * res->mkey_nbytes;
+  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
+  assert(d_info->assigned);
+  const auto &p4info_cache = *d_info->p4info_cache;
 
-  size_t num_actions;
-  auto action_ids = pi_p4info_table_get_actions(p4info, table_id, &num_actions);
-  auto action_map = pibmv2::ADataSize::compute_action_sizes(p4info, action_ids,
-                                                            num_actions);
+  std::vector<BmMtEntry> entries;
+  auto status = retrieve_entries(
+      dev_id, p4info_cache.table(table_id).name, &entries);
+  if (status != PI_STATUS_SUCCESS) return status;
 
-  for (const auto &e : entries) {
-    switch (e.action_entry.action_type) {
-      case BmActionEntryType::NONE:
-        break;
-      case BmActionEntryType::ACTION_DATA:
-        data_size += action_map.at(e.action_entry.action_name).s;
-        data_size += sizeof(s_pi_p4_id_t);  // action id
-        data_size += sizeof(uint32_t);  // action data nbytes
-        break;
-      case BmActionEntryType::MBR_HANDLE:
-      case BmActionEntryType::GRP_HANDLE:
-        data_size += sizeof(s_pi_indirect_handle_t);
-        break;
-    }
-  }
+  serialize_entries(d_info->p4info, p4info_cache, table_id,
+                    entries.cbegin(), entries.cend(), res);
+  return PI_STATUS_SUCCESS;
+}
 
-  char *data = new char[data_size];
-  // in some cases, we do not use the whole buffer
-  std::fill(data, data + data_size, 0);
-  res->entries_size = data_size;
-  res->entries = data;
+pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
+                                         pi_table_fetch_res_t *res) {
+  (void) session_handle;
 
-  for (const auto &e : entries) {
-    data += emit_entry_handle(data, e.entry_handle);
-    const auto &options = e.options;
-    // TODO(antonin): temporary hack; for match types which do not require a
-    // priority, bmv2 actually returns -1 instead of not setting the field, but
-    // the PI tends to expect 0, which is a problem for looking up entry state
-    // in the PI software. A more robust solution may be to ignore this value in
-    // the PI based on the key match type.
-    if (options.__isset.priority && options.priority != -1) {
-      data += emit_uint32(data, PriorityInverter::bm_to_pi(options.priority));
-    } else {
-      data += emit_uint32(data, 0);
-    }
-    for (const auto &p : e.match_key) {
-      switch (p.type) {
-        case BmMatchParamType::type::EXACT:
-          std::memcpy(data, p.exact.key.data(), p.exact.key.size());
-          data += p.exact.key.size();
-          break;
-        case BmMatchParamType::type::LPM:
-          std::memcpy(data, p.lpm.key.data(), p.lpm.key.size());
-          data += p.lpm.key.size();
-          data += emit_uint32(data, p.lpm.prefix_length);
-          break;
-        case BmMatchParamType::type::TERNARY:
-          std::memcpy(data, p.ternary.key.data(), p.ternary.key.size());
-          data += p.ternary.key.size();
-          std::memcpy(data, p.ternary.mask.data(), p.ternary.mask.size());
-          data += p.ternary.mask.size();
-          break;
-        case BmMatchParamType::type::VALID:
-          *data = p.valid.key;
-          data++;
-          break;
-        case BmMatchParamType::type::RANGE:
-          std::memcpy(data, p.range.start.data(), p.range.start.size());
-          data += p.range.start.size();
-          std::memcpy(data, p.range.end_.data(), p.range.end_.size());
-          data += p.range.end_.size();
-          break;
-      }
-    }
+  delete[] res->entries;
+  return PI_STATUS_SUCCESS;
+}
 
-    const auto &action_entry = e.action_entry;
+pi_status_t _pi_table_entries_fetch_chunk(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          pi_table_fetch_res_t *res) {
+  (void) session_handle;
 
-    switch (action_entry.action_type) {
-      case BmActionEntryType::NONE:
-        data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_NONE);
-        break;
-      case BmActionEntryType::ACTION_DATA:
-        {
-          data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_DATA);
-          const auto &adata_size = action_map.at(action_entry.action_name);
-          data += emit_p4_id(data, adata_size.id);
-          data += emit_uint32(data, adata_size.s);
-          data = pibmv2::dump_action_data(p4info, data, adata_size.id,
-                                          action_entry.action_data);
-        }
-        break;
-      case BmActionEntryType::MBR_HANDLE:
-        {
-          data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_INDIRECT);
-          auto indirect_handle =
-              static_cast<pi_indirect_handle_t>(action_entry.mbr_handle);
-          data += emit_indirect_handle(data, indirect_handle);
-        }
-        break;
-      case BmActionEntryType::GRP_HANDLE:
-        {
-          data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_INDIRECT);
-          auto indirect_handle =
-              static_cast<pi_indirect_handle_t>(action_entry.mbr_handle);
-          indirect_handle = pibmv2::IndirectHMgr::make_grp_h(indirect_handle);
-          data += emit_indirect_handle(data, indirect_handle);
-        }
-        break;
+  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
+  assert(d_info->assigned);
+  const auto &p4info_cache = *d_info->p4info_cache;
+
+  // the Thrift entries are retrieved with the first chunk and kept until the
+  // last one, but only one chunk at a time is serialized
+  auto *entries = static_cast<std::vector<BmMtEntry> *>(res->cursor_state);
+  if (entries == nullptr) {
+    entries = new std::vector<BmMtEntry>();
+    auto status = retrieve_entries(
+        dev_id, p4info_cache.table(table_id).name, entries);
+    if (status != PI_STATUS_SUCCESS) {
+      delete entries;
+      return status;
     }
+    res->cursor_state = entries;
+  }
 
-    data += emit_uint32(data, 0);  // properties
-    data += emit_uint32(data, 0);  // TODO(antonin): direct resources
+  size_t first = res->cursor;
+  size_t last = std::min(first + res->chunk_size, entries->size());
+  serialize_entries(d_info->p4info, p4info_cache, table_id,
+                    entries->cbegin() + first, entries->cbegin() + last, res);
+  res->cursor = last;
+  if (last == entries->size()) {
+    res->done = true;
+    delete entries;
+    res->cursor_state = nullptr;
   }
+  return PI_STATUS_SUCCESS;
+}
 
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                        pi_table_fetch_res_t *res) {
+  (void) session_handle;
+
+  delete static_cast<std::vector<BmMtEntry> *>(res->cursor_state);
+  res->cursor_state = nullptr;
   return PI_STATUS_SUCCESS;
 }
 
-pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
-                                         pi_table_fetch_res_t *res) {
+pi_status_t _pi_table_get_num_entries(pi_session_handle_t session_handle,
+                                      pi_dev_id_t dev_id,
+                                      pi_p4_id_t table_id,
+                                      size_t *num_entries) {
   (void) session_handle;
 
-  delete[] res->entries;
+  pibmv2::device_info_t *d_info = pibmv2::get_device_info(dev_id);
+  assert(d_info->assigned);
+  const auto &t_name = d_info->p4info_cache->table(table_id).name;
+
+  try {
+    *num_entries = conn_mgr_client(pibmv2::conn_mgr_state, dev_id).c->
+        bm_mt_get_num_entries(0, t_name);
+  } catch (InvalidTableOperation &ito) {
+    const char *what =
+        _TableOperationErrorCode_VALUES_TO_NAMES.find(ito.code)->second;
+    std::cout << "Invalid table (" << t_name << ") operation ("
+              << ito.code << "): " << what << std::endl;
+    return static_cast<pi_status_t>(PI_STATUS_TARGET_ERROR + ito.code);
+  }
   return PI_STATUS_SUCCESS;
 }
 
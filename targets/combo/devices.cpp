@@ -1,9 +1,11 @@
 #include "devices.hpp"
+#include "tablecache.hpp"
 
 const int MAX_DEVICES = 2;
 
 DeviceArray devices(MAX_DEVICES);
 DeviceInfo infos = { NULL, NULL };
+DeviceTableCaches tableCaches(MAX_DEVICES);
 std::vector<bool> reserved = { false, false };
 
 std::size_t DeviceManager::getDeviceCount() {
@@ -21,5 +23,8 @@ bool DeviceManager::reserveDevice(std::size_t index) {
 bool DeviceManager::freeDevice(std::size_t index) {
 	reserved[index] = false;
 	infos[index] = NULL;
+	tableCaches[index].clear();
 	p4device_free(&(devices[index]));
+
+	return true;
 }
\ No newline at end of file
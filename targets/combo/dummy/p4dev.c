@@ -0,0 +1,301 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "p4dev.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *copy_string(const char *str) {
+	if (str == NULL) return NULL;
+	size_t len = strlen(str) + 1;
+	char *copy = malloc(len);
+	if (copy != NULL) memcpy(copy, str, len);
+	return copy;
+}
+
+void p4dev_err_stderr(uint32_t code) {
+	static const char *const messages[] = {
+		"Success",
+		"Generic error",
+		"Memory allocation failed",
+		"Operation not implemented",
+		"Rule with the same key already exists",
+		"Rule not found",
+		"Rule index out of range",
+	};
+
+	if (code < sizeof(messages) / sizeof(messages[0])) {
+		fprintf(stderr, "p4dev: %s\n", messages[code]);
+	}
+	else {
+		fprintf(stderr, "p4dev: Unknown error %u\n", code);
+	}
+}
+
+/* Key elements, parameters and rules */
+
+static p4key_elem_t *key_create(const char *name, uint32_t size, uint8_t *value) {
+	p4key_elem_t *key = calloc(1, sizeof(*key));
+	if (key == NULL) return NULL;
+	key->name = copy_string(name);
+	if (key->name == NULL) {
+		free(key);
+		return NULL;
+	}
+	key->value_size = size;
+	key->value = value;
+	return key;
+}
+
+p4key_elem_t *p4key_exact_create(const char *name, uint32_t size, uint8_t *value) {
+	return key_create(name, size, value);
+}
+
+p4key_elem_t *p4key_lpm_create(const char *name, uint32_t size, uint8_t *value, uint32_t prefix_len) {
+	p4key_elem_t *key = key_create(name, size, value);
+	if (key != NULL) key->opt.prefix_len = prefix_len;
+	return key;
+}
+
+p4key_elem_t *p4key_ternary_create(const char *name, uint32_t size, uint8_t *value, uint8_t *mask) {
+	p4key_elem_t *key = key_create(name, size, value);
+	if (key != NULL) key->opt.mask = mask;
+	return key;
+}
+
+void p4key_free(p4key_elem_t *key) {
+	while (key != NULL) {
+		p4key_elem_t *next = key->next;
+		free(key->name);
+		free(key->value);
+		free(key->opt.mask);
+		free(key);
+		key = next;
+	}
+}
+
+static bool key_equal(const p4key_elem_t *a, const p4key_elem_t *b) {
+	for (; a != NULL && b != NULL; a = a->next, b = b->next) {
+		if (a->value_size != b->value_size) return false;
+		if (memcmp(a->value, b->value, a->value_size) != 0) return false;
+		if (a->opt.prefix_len != b->opt.prefix_len) return false;
+		if ((a->opt.mask == NULL) != (b->opt.mask == NULL)) return false;
+		if (a->opt.mask != NULL && memcmp(a->opt.mask, b->opt.mask, a->value_size) != 0) return false;
+	}
+	return a == NULL && b == NULL;
+}
+
+p4param_t *p4param_create(const char *name, uint32_t size, uint8_t *value) {
+	p4param_t *param = calloc(1, sizeof(*param));
+	if (param == NULL) return NULL;
+	param->name = copy_string(name);
+	if (param->name == NULL) {
+		free(param);
+		return NULL;
+	}
+	param->value_size = size;
+	param->value = value;
+	return param;
+}
+
+void p4param_free(p4param_t *param) {
+	while (param != NULL) {
+		p4param_t *next = param->next;
+		free(param->name);
+		free(param->value);
+		free(param);
+		param = next;
+	}
+}
+
+p4rule_t *p4rule_create(const char *table_name, p4engine_type_t engine) {
+	p4rule_t *rule = calloc(1, sizeof(*rule));
+	if (rule == NULL) return NULL;
+	rule->table_name = copy_string(table_name);
+	if (rule->table_name == NULL) {
+		free(rule);
+		return NULL;
+	}
+	rule->engine = engine;
+	return rule;
+}
+
+void p4rule_free(p4rule_t *rule) {
+	if (rule == NULL) return;
+	p4key_free(rule->key);
+	p4param_free(rule->params);
+	free(rule->action);
+	free(rule->table_name);
+	free(rule);
+}
+
+uint32_t p4rule_add_key_element(p4rule_t *rule, p4key_elem_t *key) {
+	if (rule == NULL || key == NULL) return P4DEV_ERROR;
+	p4key_elem_t **last = &rule->key;
+	while (*last != NULL) last = &(*last)->next;
+	*last = key;
+	return P4DEV_OK;
+}
+
+uint32_t p4rule_add_action(p4rule_t *rule, const char *action) {
+	if (rule == NULL || action == NULL) return P4DEV_ERROR;
+	// Rules are often reused with the same action, no need to copy the name again
+	if (rule->action != NULL && strcmp(rule->action, action) == 0) return P4DEV_OK;
+	char *copy = copy_string(action);
+	if (copy == NULL) return P4DEV_ALLOCATE_ERROR;
+	free(rule->action);
+	rule->action = copy;
+	return P4DEV_OK;
+}
+
+void p4rule_mark_default(p4rule_t *rule) {
+	rule->def = true;
+}
+
+/* Tables and devices */
+
+uint32_t p4device_init(p4device_t *device, const char *name, uint32_t id, uint32_t component) {
+	(void)name;
+	(void)component;
+	device->id = id;
+	device->tables = NULL;
+	return P4DEV_OK;
+}
+
+static void table_clear(p4table_t *table) {
+	for (uint32_t i = 0; i < table->size; i++) p4rule_free(table->rules[i]);
+	table->size = 0;
+	p4rule_free(table->default_rule);
+	table->default_rule = NULL;
+}
+
+uint32_t p4device_reset(p4device_t *device) {
+	for (p4table_t *table = device->tables; table != NULL; table = table->next) table_clear(table);
+	return P4DEV_OK;
+}
+
+void p4device_free(p4device_t *device) {
+	p4table_t *table = device->tables;
+	while (table != NULL) {
+		p4table_t *next = table->next;
+		table_clear(table);
+		free(table->rules);
+		free(table->name);
+		free(table);
+		table = next;
+	}
+	device->tables = NULL;
+}
+
+p4table_t *p4device_get_table(p4device_t *device, const char *name) {
+	for (p4table_t *table = device->tables; table != NULL; table = table->next) {
+		if (strcmp(table->name, name) == 0) return table;
+	}
+
+	p4table_t *table = calloc(1, sizeof(*table));
+	if (table == NULL) return NULL;
+	table->name = copy_string(name);
+	if (table->name == NULL) {
+		free(table);
+		return NULL;
+	}
+	table->next = device->tables;
+	device->tables = table;
+	return table;
+}
+
+uint32_t p4table_insert_rule(p4table_t *table, p4rule_t *rule, uint32_t *index, bool overwrite) {
+	uint32_t existing;
+	if (p4table_find_rule(table, rule->key, &existing) == P4DEV_OK) {
+		if (!overwrite) return P4DEV_RULE_EXISTS;
+		p4rule_free(table->rules[existing]);
+		table->rules[existing] = rule;
+		*index = existing;
+		return P4DEV_OK;
+	}
+
+	if (table->size == table->capacity) {
+		uint32_t capacity = (table->capacity == 0) ? 16 : 2 * table->capacity;
+		p4rule_t **rules = realloc(table->rules, capacity * sizeof(*rules));
+		if (rules == NULL) return P4DEV_ALLOCATE_ERROR;
+		table->rules = rules;
+		table->capacity = capacity;
+	}
+
+	table->rules[table->size] = rule;
+	*index = table->size++;
+	return P4DEV_OK;
+}
+
+p4rule_t *p4table_get_rule_template(p4table_t *table) {
+	return p4rule_create(table->name, P4ENGINE_UNKNOWN);
+}
+
+uint32_t p4table_insert_default_rule(p4table_t *table, p4rule_t *rule) {
+	rule->def = true;
+	p4rule_free(table->default_rule);
+	table->default_rule = rule;
+	return P4DEV_OK;
+}
+
+uint32_t p4table_reset_default_rule(p4table_t *table) {
+	p4rule_free(table->default_rule);
+	table->default_rule = NULL;
+	return P4DEV_OK;
+}
+
+p4rule_t *p4table_get_default_rule(p4table_t *table) {
+	return table->default_rule;
+}
+
+uint32_t p4table_delete_rule(p4table_t *table, uint32_t index) {
+	if (index >= table->size) return P4DEV_BAD_INDEX;
+	p4rule_free(table->rules[index]);
+	memmove(&table->rules[index], &table->rules[index + 1], (table->size - index - 1) * sizeof(*table->rules));
+	table->size--;
+	return P4DEV_OK;
+}
+
+uint32_t p4table_find_rule(p4table_t *table, const p4key_elem_t *key, uint32_t *index) {
+	for (uint32_t i = 0; i < table->size; i++) {
+		if (key_equal(table->rules[i]->key, key)) {
+			*index = i;
+			return P4DEV_OK;
+		}
+	}
+	return P4DEV_RULE_NOT_FOUND;
+}
+
+uint32_t p4table_modify_rule(p4table_t *table, uint32_t index, const char *action, p4param_t *params) {
+	if (index >= table->size) return P4DEV_BAD_INDEX;
+	p4rule_t *rule = table->rules[index];
+
+	uint32_t status = p4rule_add_action(rule, action);
+	if (status != P4DEV_OK) return status;
+
+	p4param_free(rule->params);
+	rule->params = params;
+	return P4DEV_OK;
+}
+
+uint32_t p4table_get_size(p4table_t *table) {
+	return table->size;
+}
+
+p4rule_t *p4table_get_rule(p4table_t *table, uint32_t index) {
+	return (index < table->size) ? table->rules[index] : NULL;
+}
@@ -0,0 +1,202 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *  \file p4dev.h
+ *  \brief Software stand-in for the subset of libp4dev used by the combo target
+ *
+ *  \details Tables live in host memory and are created the first time they are
+ *  looked up, so the combo target can be tested and benchmarked without an FPGA.
+ *  Rules are addressed by their position in the table: deleting a rule moves
+ *  every following rule one index down.
+ *
+ *  Like libp4dev, the table takes ownership of the rules passed to
+ *  p4table_insert_rule() and p4table_insert_default_rule() and of the parameters
+ *  passed to p4table_modify_rule() when the call succeeds, so callers must
+ *  allocate new ones for each call. The key passed to p4table_find_rule() is
+ *  only read. Key and parameter constructors take ownership of the value and
+ *  mask buffers, which must be allocated with malloc().
+ */
+
+#ifndef P4DEV_H_
+#define P4DEV_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define P4DEV_OK 0
+#define P4DEV_ERROR 1
+#define P4DEV_ALLOCATE_ERROR 2
+#define P4DEV_NOT_IMPLEMENTED 3
+#define P4DEV_RULE_EXISTS 4
+#define P4DEV_RULE_NOT_FOUND 5
+#define P4DEV_BAD_INDEX 6
+
+#define P4DEVICE_DEFAULT_COMPONENT 0
+
+typedef enum {
+	P4ENGINE_EXACT,
+	P4ENGINE_LPM,
+	P4ENGINE_TERNARY,
+	P4ENGINE_UNKNOWN
+} p4engine_type_t;
+
+typedef struct p4key_elem {
+	char *name;
+	uint32_t value_size;
+	uint8_t *value;
+	struct {
+		uint8_t *mask;       ///< Ternary keys only
+		uint32_t prefix_len; ///< LPM keys only
+	} opt;
+	struct p4key_elem *next;
+} p4key_elem_t;
+
+typedef struct p4param {
+	char *name;
+	uint32_t value_size;
+	uint8_t *value;
+	struct p4param *next;
+} p4param_t;
+
+typedef struct p4rule {
+	char *table_name;
+	p4engine_type_t engine;
+	bool def;
+	p4key_elem_t *key;
+	char *action;
+	p4param_t *params;
+} p4rule_t;
+
+typedef struct p4table {
+	char *name;
+	p4rule_t **rules;
+	uint32_t size;
+	uint32_t capacity;
+	p4rule_t *default_rule;
+	struct p4table *next;
+} p4table_t;
+
+typedef struct p4device {
+	uint32_t id;
+	p4table_t *tables;
+} p4device_t;
+
+/**
+ *  \brief Print a human readable description of a status code to stderr
+ */
+void p4dev_err_stderr(uint32_t code);
+
+uint32_t p4device_init(p4device_t *device, const char *name, uint32_t id, uint32_t component);
+
+/**
+ *  \brief Remove every rule, including default rules, from all tables
+ */
+uint32_t p4device_reset(p4device_t *device);
+
+void p4device_free(p4device_t *device);
+
+/**
+ *  \return Table with the given name, created empty if needed, or NULL on allocation failure
+ */
+p4table_t *p4device_get_table(p4device_t *device, const char *name);
+
+p4rule_t *p4rule_create(const char *table_name, p4engine_type_t engine);
+
+/**
+ *  \brief Free a rule together with its key and parameter chains
+ */
+void p4rule_free(p4rule_t *rule);
+
+/**
+ *  \brief Append a chain of key elements to the rule, which takes ownership of them
+ */
+uint32_t p4rule_add_key_element(p4rule_t *rule, p4key_elem_t *key);
+
+uint32_t p4rule_add_action(p4rule_t *rule, const char *action);
+
+void p4rule_mark_default(p4rule_t *rule);
+
+p4key_elem_t *p4key_exact_create(const char *name, uint32_t size, uint8_t *value);
+p4key_elem_t *p4key_lpm_create(const char *name, uint32_t size, uint8_t *value, uint32_t prefix_len);
+p4key_elem_t *p4key_ternary_create(const char *name, uint32_t size, uint8_t *value, uint8_t *mask);
+
+/**
+ *  \brief Free a whole chain of key elements
+ */
+void p4key_free(p4key_elem_t *key);
+
+p4param_t *p4param_create(const char *name, uint32_t size, uint8_t *value);
+
+/**
+ *  \brief Free a whole chain of parameters
+ */
+void p4param_free(p4param_t *param);
+
+/**
+ *  \brief Append the rule, or replace the rule with the same key if \p overwrite is set
+ *
+ *  \details The table takes ownership of the rule on success.
+ *
+ *  \param [out] index Position of the rule in the table
+ */
+uint32_t p4table_insert_rule(p4table_t *table, p4rule_t *rule, uint32_t *index, bool overwrite);
+
+/**
+ *  \return New empty rule for the table, to be released with p4rule_free()
+ */
+p4rule_t *p4table_get_rule_template(p4table_t *table);
+
+/**
+ *  \brief Replace the default rule, the table takes ownership of the rule
+ */
+uint32_t p4table_insert_default_rule(p4table_t *table, p4rule_t *rule);
+uint32_t p4table_reset_default_rule(p4table_t *table);
+
+/**
+ *  \return Default rule of the table or NULL if none is set
+ */
+p4rule_t *p4table_get_default_rule(p4table_t *table);
+
+uint32_t p4table_delete_rule(p4table_t *table, uint32_t index);
+
+/**
+ *  \brief Find the position of the rule whose key equals \p key
+ */
+uint32_t p4table_find_rule(p4table_t *table, const p4key_elem_t *key, uint32_t *index);
+
+/**
+ *  \brief Replace the action and the parameters of a rule
+ *
+ *  \details The rule takes ownership of \p params on success.
+ */
+uint32_t p4table_modify_rule(p4table_t *table, uint32_t index, const char *action, p4param_t *params);
+
+uint32_t p4table_get_size(p4table_t *table);
+
+/**
+ *  \return Rule at the given position or NULL if it is out of range
+ */
+p4rule_t *p4table_get_rule(p4table_t *table, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,11 +26,11 @@ char *dumpActionData(const pi_p4info_t *info, char *data, pi_p4_id_t actionId, c
 
 		assert(bytewidth >= param->value_size);
 
-		flipEndianness(param->value, param->value_size); // Flip everything that is uint8_t array on I/O communication with libp4dev
-		
 		size_t offset = bytewidth - param->value_size;
 		std::memset(data, 0, offset);
 		std::memcpy(data + offset, param->value, param->value_size);
+		// Flip everything that is uint8_t array on I/O communication with libp4dev, the rule itself is left untouched
+		flipEndianness(reinterpret_cast<uint8_t*>(data + offset), param->value_size);
 		data += bytewidth;
 		i++;
 		param = param->next;
@@ -62,20 +62,6 @@ pi_status_t retrieveEntry(const pi_p4info_t *info, const char *actionName, const
 	return PI_STATUS_SUCCESS;
 }
 
-std::unordered_map<std::string, ActionProperties> computeActionSizes(const pi_p4info_t *info, const pi_p4_id_t * actionIds, size_t actionCount) {
-	std::unordered_map<std::string, ActionProperties> result;
-	result.reserve(actionCount);
-
-	for (size_t i = 0; i < actionCount; i++) {
-		result.emplace(
-			std::string(pi_p4info_action_name_from_id(info, actionIds[i])),
-			ActionProperties(pi_p4info_action_data_size(info, actionIds[i]), actionIds[i])
-		);
-	}
-
-	return result;
-}
-
 void flipEndianness(uint8_t *data, size_t dataSize) {
 	for (unsigned i = 0; i < dataSize / 2; i++) {
 		std::swap(data[i], data[dataSize - 1 - i]);
@@ -38,23 +38,6 @@ char *dumpActionData(const pi_p4info_t *info, char *data, pi_p4_id_t actionId, c
  */
 pi_status_t retrieveEntry(const pi_p4info_t *info, const char *actionName, const p4param_t *actionParams, pi_table_entry_t *table_entry);
 
-struct ActionProperties {
-	uint32_t size;
-	pi_p4_id_t id;
-
-	ActionProperties(uint32_t s, pi_p4_id_t i) : size(s), id(i) {}
-};
-
-/**
- *  \brief Compute memory requirements for serializing each action defined in P4 Into
- *  
- *  \param [in] info P4 Info for a device
- *  \param [in] action_ids Array of PI ids of actions
- *  \param [in] num_actions Number of ids in array 'action_ids'
- *  \return Hash table indexed by action name and containing information about how many bytes are needed to serialize that action.
- */
-std::unordered_map<std::string, ActionProperties> computeActionSizes(const pi_p4info_t *info, const pi_p4_id_t *action_ids, size_t num_actions);
-
 /**
  *  \brief Swap endianness of a uint8_t array
  *  
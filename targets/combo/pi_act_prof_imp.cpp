@@ -87,6 +87,13 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle, pi_d
 	return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
 }
 
+pi_status_t _pi_act_prof_clear(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t act_prof_id) {
+	COMBO_UNUSED(session_handle);
+	COMBO_UNUSED(dev_id);
+	COMBO_UNUSED(act_prof_id);
+	return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
 pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t act_prof_id, pi_act_prof_fetch_res_t *res) {
 	COMBO_UNUSED(session_handle);
 	COMBO_UNUSED(dev_id);
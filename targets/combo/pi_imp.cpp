@@ -25,6 +25,7 @@
 #include "devices.hpp"
 #include "logger.hpp"
 #include "helpers.hpp"
+#include "tablecache.hpp"
 
 extern "C" {
 
@@ -61,6 +62,7 @@ pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info, pi_
 	}
 	
 	infos[dev_id] = p4info;
+	tableCaches[dev_id].build(&(devices[dev_id]), p4info);
 	
 	return PI_STATUS_SUCCESS;
 }
@@ -77,6 +79,7 @@ pi_status_t _pi_update_device_start(pi_dev_id_t dev_id, const pi_p4info_t *p4inf
 	Logger::debug("Ignoring new device data\n");
 
 	infos[dev_id] = p4info;
+	tableCaches[dev_id].build(&(devices[dev_id]), p4info);
 
 	return PI_STATUS_SUCCESS;
 }
@@ -138,4 +141,15 @@ pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt, size_t size)
 	return PI_STATUS_SUCCESS;
 }
 
+pi_status_t _pi_packetout_send_batch(pi_dev_id_t dev_id,
+                                     const char *const *pkts,
+                                     const size_t *sizes, size_t num_pkts) {
+	(void)dev_id;
+	(void)pkts;
+	(void)sizes;
+	(void)num_pkts;
+	Logger::debug("PI_packetout_send_batch");
+	return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
 }
@@ -23,196 +23,192 @@
 #include <PI/p4info.h>
 #include <PI/pi.h>
 #include <p4dev.h>
+#include <algorithm>
 #include <cstring>
+#include <mutex>
+#include <vector>
 #include "devices.hpp"
 #include "helpers.hpp"
 #include "logger.hpp"
+#include "tablecache.hpp"
 
-p4rule_t *createRule(const char *tableName, const pi_p4info_t *info, pi_p4_id_t table_id) {
-	std::size_t matchFieldsSize = pi_p4info_table_num_match_fields(info, table_id);
-
-	// Determine engine of rule
-	p4engine_type_t engineType = P4ENGINE_UNKNOWN;
-	for (std::size_t i = 0; i < matchFieldsSize; i++) {
-		auto finfo = pi_p4info_table_match_field_info(info, table_id, i);
-		if (engineType == P4ENGINE_UNKNOWN) engineType = translateEngine(finfo->match_type);
-		else if (engineType != translateEngine(finfo->match_type)) return NULL;
+const TableLayout *getTableLayout(pi_dev_id_t devId, pi_p4_id_t tableId) {
+	const TableLayout *layout = tableCaches[devId].getTable(tableId);
+	if (layout == NULL) {
+		Logger::error("Unknown table id: " + std::to_string(tableId));
+		return NULL;
 	}
-	if (engineType == P4ENGINE_UNKNOWN) return NULL;
-
-	p4rule_t *result = p4rule_create(tableName, engineType);
-	return result;
+	if (layout->table == NULL) {
+		Logger::error("Cannot get table with name: " + std::string(layout->name));
+		return NULL;
+	}
+	return layout;
 }
 
-uint32_t createKeys(const pi_p4info_t *info, pi_p4_id_t table_id, const pi_match_key_t *match_key, p4key_elem_t **key) {
-	const char *data = match_key->data;
-
-	uint8_t *value;
-	uint8_t *mask;
-	uint32_t status;
+const ActionLayout *getActionLayout(pi_dev_id_t devId, pi_p4_id_t actionId) {
+	const ActionLayout *action = tableCaches[devId].getAction(actionId);
+	if (action == NULL) {
+		Logger::error("Unknown action id: " + std::to_string(actionId));
+	}
+	return action;
+}
 
-	p4key_elem_t *last = NULL;
+/**
+ *  \brief Write a PI match key into a key chain which follows the table layout
+ */
+uint32_t fillKeys(const TableLayout &layout, const pi_match_key_t *match_key, p4key_elem_t *elem) {
+	if (layout.lookupKey == NULL) return P4DEV_NOT_IMPLEMENTED;
 
-	size_t matchFieldsSize = pi_p4info_table_num_match_fields(info, table_id);
-	for (std::size_t i = 0; i < matchFieldsSize; i++) {
-		const pi_p4info_match_field_info_t *fieldInfo = pi_p4info_table_match_field_info(info, table_id, i);
-		size_t bitwidth = fieldInfo->bitwidth;
-		size_t bytewidth = (bitwidth + 7) / 8;
-		uint32_t prefixLen;
-		const char *keyName = pi_p4info_table_match_field_name_from_id(info, table_id, fieldInfo->mf_id);
+	const char *data = match_key->data;
 
-		switch (fieldInfo->match_type) {
-		case PI_P4INFO_MATCH_TYPE_VALID:
-			return P4DEV_NOT_IMPLEMENTED;
-			break;
+	for (const KeyFieldLayout &field : layout.keys) {
+		size_t bytewidth = field.bytewidth;
 
-		case PI_P4INFO_MATCH_TYPE_EXACT:
-			value = new uint8_t[bytewidth];
-			if (value == NULL) return P4DEV_ALLOCATE_ERROR;
-			memcpy(value, data, bytewidth);
-			data += bytewidth;
-			
-			/* NOTE:
-				P4 Runtime treats data as-is, meaning that IPv4 written as
-				1.2.3.4 will be saved in uint8_t array as [1,2,3,4]. But
-				lip4dev expects data to be ordered as [4,3,2,1]. That is
-				why we have to flip the endianness.
-			 */
-			flipEndianness(value, bytewidth);
-
-			if (last == NULL) {
-				(*key) = p4key_exact_create(keyName, bytewidth, value);
-				last = *key;
-			}
-			else {
-				last->next = p4key_exact_create(keyName, bytewidth, value);
-				last = last->next;
-			}
-			break;
+		/* NOTE:
+			P4 Runtime treats data as-is, meaning that IPv4 written as
+			1.2.3.4 will be saved in uint8_t array as [1,2,3,4]. But
+			lip4dev expects data to be ordered as [4,3,2,1]. That is
+			why we have to flip the endianness.
+		 */
+		memcpy(elem->value, data, bytewidth);
+		data += bytewidth;
+		flipEndianness(elem->value, bytewidth);
 
+		switch (field.matchType) {
 		case PI_P4INFO_MATCH_TYPE_LPM:
-			value = new uint8_t[bytewidth];
-			if (value == NULL) return P4DEV_ALLOCATE_ERROR;
-			memcpy(value, data, bytewidth);
-			data += bytewidth;
-			data += retrieve_uint32(data, &prefixLen);
-			flipEndianness(value, bytewidth);
-
-			if (last == NULL) {
-				(*key) = p4key_lpm_create(keyName, bytewidth, value, prefixLen);
-				last = *key;
-			}
-			else {
-				last->next = p4key_lpm_create(keyName, bytewidth, value, prefixLen);
-				last = last->next;
-			}
+			data += retrieve_uint32(data, &(elem->opt.prefix_len));
 			break;
 
 		case PI_P4INFO_MATCH_TYPE_TERNARY:
-			value = new uint8_t[bytewidth];
-			mask = new uint8_t[bytewidth];
-
-			if (value == NULL or mask == NULL) return P4DEV_ALLOCATE_ERROR;
-
-			memcpy(value, data, bytewidth);
+			memcpy(elem->opt.mask, data, bytewidth);
 			data += bytewidth;
-			flipEndianness(value, bytewidth);
-			memcpy(mask, data, bytewidth);
-			data += bytewidth;
-			flipEndianness(mask, bytewidth);
-
-			if (last == NULL) {
-				(*key) = p4key_ternary_create(keyName, bytewidth, value, mask);
-				last = *key;
-			}
-			else {
-				last->next = p4key_ternary_create(keyName, bytewidth, value, mask);
-				last = last->next;
-			}
-
-			//*requires_priority = true;
-			break;
-
-		case PI_P4INFO_MATCH_TYPE_RANGE:
-			return P4DEV_NOT_IMPLEMENTED;
+			flipEndianness(elem->opt.mask, bytewidth);
 			break;
 
 		default:
-			assert(0);
 			break;
 		}
+
+		elem = elem->next;
 	}
 
 	return P4DEV_OK;
 }
 
-uint32_t addKeys(const pi_p4info_t *info, pi_p4_id_t table_id, const pi_match_key_t *match_key, p4rule_t *rule) {
-	p4key_elem_t *key;
-	uint32_t status;
-	if ((status = createKeys(info, table_id, match_key, &key)) != P4DEV_OK) {
-		return status;
-	}
+/**
+ *  \brief Build the libp4dev parameter chain of PI action data
+ *
+ *  \param [out] params New chain, owned by the caller until handed to libp4dev
+ */
+uint32_t createActionParams(const ActionLayout &action, const char *actionData, p4param_t **params) {
+	assert(actionData != NULL);
 
-	if ((status = p4rule_add_key_element(rule, key)) != P4DEV_OK) return status;
+	uint32_t status = createParams(action, params);
+	if (status != P4DEV_OK) return status;
+
+	p4param_t *param = *params;
+	for (const ParamLayout &paramLayout : action.params) {
+		memcpy(param->value, actionData, paramLayout.bytewidth);
+		flipEndianness(param->value, paramLayout.bytewidth); // Everything that is a byte array has to be flipped
+		actionData += paramLayout.bytewidth;
+		param = param->next;
+	}
 
 	return P4DEV_OK;
 }
 
-uint32_t createParams(const pi_p4info_t *info, const pi_p4_id_t actionID, const char *actionData, p4param_t **param) {
+/**
+ *  \brief Serialize rules with indices [first, last) of a table into res->entries
+ */
+pi_status_t serializeRules(pi_dev_id_t devId, pi_p4_id_t tableId, p4table_t *table, uint32_t first, uint32_t last, pi_table_fetch_res_t *res) {
+	const pi_p4info_t *info = infos[devId];
 	assert(info != NULL);
-	assert(actionData != NULL);
-	assert(param != NULL);
-	assert(*param == NULL);
 
-	uint32_t status;
-	p4param_t *last = NULL;
-	size_t paramIdsSize;
-	const pi_p4_id_t *paramIds = pi_p4info_action_get_params(info, actionID, &paramIdsSize);
-	for (size_t i = 0; i < paramIdsSize; i++) {
-		size_t paramBitwidth = pi_p4info_action_param_bitwidth(info, actionID, paramIds[i]);
-		size_t paramBytewidth = (paramBitwidth + 7) / 8;
-
-		uint8_t *data = new uint8_t[paramBytewidth];
-		if (data == NULL) return P4DEV_ALLOCATE_ERROR;
-
-		memcpy(data, actionData, paramBytewidth);
-		flipEndianness(data, paramBytewidth); // Everything that is a byte array has to be flipped
-		const char *paramName = pi_p4info_action_param_name_from_id(info, actionID, paramIds[i]);
-
-		if (*param == NULL) {
-			*param = p4param_create(paramName, paramBytewidth, data);
-			if (*param == NULL) return P4DEV_ALLOCATE_ERROR;
-			last = *param;
-		}
-		else {
-			last->next = p4param_create(paramName, paramBytewidth, data);
-			if (last->next == NULL) return P4DEV_ALLOCATE_ERROR;
-			last = last->next;
-		}
+	res->num_entries = last - first;
+	size_t dataSize = 0U;
+
+	dataSize += res->num_entries * sizeof(s_pi_entry_handle_t);
+	dataSize += res->num_entries * sizeof(s_pi_action_entry_type_t);
+	dataSize += res->num_entries * sizeof(uint32_t);  // for priority
+	dataSize += res->num_entries * sizeof(uint32_t);  // for properties
+	dataSize += res->num_entries * sizeof(uint32_t);  // for direct resources
 
-		actionData += paramBytewidth;
+	res->mkey_nbytes = pi_p4info_table_match_key_size(info, tableId);
+	dataSize += res->num_entries * res->mkey_nbytes;
+
+	// Resolve rule actions once, both passes need them
+	std::vector<const ActionLayout*> ruleActions(res->num_entries);
+	for (uint32_t i = 0; i < res->num_entries; i++) {
+		auto *rule = p4table_get_rule(table, first + i);
+		ruleActions[i] = tableCaches[devId].getAction(rule->action);
+		if (ruleActions[i] == NULL) {
+			Logger::error("Unknown action: " + std::string(rule->action));
+			return PI_STATUS_TARGET_ERROR;
+		}
+		
+		dataSize += ruleActions[i]->dataSize;
+		dataSize += sizeof(s_pi_p4_id_t); // Action ID
+		dataSize += sizeof(uint32_t); // Action params bytewidth
 	}
 
-	return P4DEV_OK;
-}
+	char *data = new char[dataSize];
+	if (data == NULL) return PI_STATUS_ALLOC_ERROR;
 
-uint32_t addAction(const pi_p4info_t *info, const pi_action_data_t *action_data, p4rule_t *rule) {
-	assert(info);
-	assert(action_data);
+	// in some cases, we do not use the whole buffer
+	std::fill(data, data + dataSize, 0);
+	res->entries_size = dataSize;
+	res->entries = data;
 
-	pi_p4_id_t actionID = action_data->action_id;
-	const char *actionData = action_data->data;
-	const char *actionName = pi_p4info_action_name_from_id(info, actionID);
+	for (uint32_t i = 0; i < res->num_entries; i++) {
+		auto *rule = p4table_get_rule(table, first + i);
 
-	uint32_t status;
-	if ((status = p4rule_add_action(rule, actionName)) != P4DEV_OK) return status;
+		data += emit_entry_handle(data, first + i);
+		// We don't have priority yet
+		data += emit_uint32(data, 0); // priority
 
-	p4param_t *params = NULL;
-	if ((status = createParams(info, actionID, actionData, &params)) != P4DEV_OK) return status;
-	
-	rule->params = params;
+		p4key_elem_t *key = rule->key;
+		while (key != NULL) {
+			/* NOTE:
+				The endianness was flipped when the rule
+				was written into the device, now we have
+				to flip it back. The copy is flipped, the
+				rule itself belongs to libp4dev.
+			 */
+			std::memcpy(data, key->value, key->value_size);
+			flipEndianness(reinterpret_cast<uint8_t*>(data), key->value_size);
+			data += key->value_size;
 
-	return P4DEV_OK;
+			switch (rule->engine) {
+			case P4ENGINE_TERNARY:
+				std::memcpy(data, key->opt.mask, key->value_size);
+				flipEndianness(reinterpret_cast<uint8_t*>(data), key->value_size);
+				data += key->value_size;
+				break;
+
+			case P4ENGINE_LPM:
+				data += emit_uint32(data, key->opt.prefix_len);
+				break;
+
+			default:
+				break;
+			}
+
+			key = key->next;
+		}
+
+		// Our actions are always direct
+		data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_DATA);
+		const ActionLayout *action = ruleActions[i];
+
+		data += emit_p4_id(data, action->id);
+		data += emit_uint32(data, action->dataSize);
+		data = dumpActionData(info, data, action->id, rule->params);
+
+		data += emit_uint32(data, 0);  // properties
+		data += emit_uint32(data, 0);  // TODO(antonin): direct resources
+	}
+
+	return PI_STATUS_SUCCESS;
 }
 
 extern "C" {
@@ -223,37 +219,31 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle, pi_dev_tgt_t
 	COMBO_UNUSED(session_handle); ///< No support for sessions
 	Logger::debug("PI_table_entry_add");
 	
-	const pi_p4info_t *info = infos[dev_tgt.dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_tgt.dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_tgt.dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
+	const ActionLayout *action = getActionLayout(dev_tgt.dev_id, table_entry->entry.action_data->action_id);
+	if (action == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
 	
-	// Initialize rule object
-	p4rule_t *rule = createRule(tableName, info, table_id);
+	// Engine was determined when the cache was built, tables with mixed engines are not supported
+	p4rule_t *rule = (layout->engine == P4ENGINE_UNKNOWN) ? NULL : createRule(*layout);
 	if (rule == NULL) {
 		Logger::error("Cannot create rule\n");
 		return pi_status_t(PI_STATUS_TARGET_ERROR);
 	}
+
 	uint32_t status;
-	if ((status = addKeys(info, table_id, match_key, rule)) != P4DEV_OK) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
+	if ((status = fillKeys(*layout, match_key, rule->key)) == P4DEV_OK and
+	    (status = p4rule_add_action(rule, action->name)) == P4DEV_OK) {
+		status = createActionParams(*action, table_entry->entry.action_data->data, &(rule->params));
 	}
-	if ((status = addAction(info, table_entry->entry.action_data, rule)) != P4DEV_OK) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
-	}
-	
-	// Insert rule to table
+
+	// Insert rule to table, libp4dev takes ownership of the rule on success
 	uint32_t ruleIndex;
-	status = p4table_insert_rule(table, rule, &ruleIndex, overwrite);
+	if (status == P4DEV_OK) status = p4table_insert_rule(table, rule, &ruleIndex, overwrite);
 	if (status != P4DEV_OK) {
+		p4rule_free(rule);
 		p4dev_err_stderr(status);
 		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
 	}
@@ -269,16 +259,12 @@ pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle, pi_
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_default_action_set");
 	
-	const pi_p4info_t *info = infos[dev_tgt.dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_tgt.dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_tgt.dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
+	const ActionLayout *action = getActionLayout(dev_tgt.dev_id, table_entry->entry.action_data->action_id);
+	if (action == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
 
 	// Initialize rule object
 	p4rule_t *rule = p4table_get_rule_template(table); // There might not be match engine, no need to check it
@@ -287,15 +273,16 @@ pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle, pi_
 		return pi_status_t(PI_STATUS_TARGET_ERROR);
 	}
 	p4rule_mark_default(rule);
+
 	uint32_t status;
-	if ((status = addAction(info, table_entry->entry.action_data, rule)) != P4DEV_OK) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
+	if ((status = p4rule_add_action(rule, action->name)) == P4DEV_OK) {
+		status = createActionParams(*action, table_entry->entry.action_data->data, &(rule->params));
 	}
 
-	// Insert rule to table
-	status = p4table_insert_default_rule(table, rule);
+	// Insert rule to table, libp4dev takes ownership of the rule on success
+	if (status == P4DEV_OK) status = p4table_insert_default_rule(table, rule);
 	if (status != P4DEV_OK) {
+		p4rule_free(rule);
 		p4dev_err_stderr(status);
 		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
 	}
@@ -310,16 +297,10 @@ pi_status_t _pi_table_default_action_reset(pi_session_handle_t session_handle, p
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_default_action_reset");
 
-	const pi_p4info_t *info = infos[dev_tgt.dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_tgt.dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_tgt.dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
 
 	uint32_t status = p4table_reset_default_rule(table);
 	if (status != P4DEV_OK) {
@@ -335,17 +316,14 @@ pi_status_t _pi_table_default_action_get(pi_session_handle_t session_handle, pi_
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_default_action_get");
 
+	// Retrieve table handle
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
+
 	const pi_p4info_t *info = infos[dev_id];
 	assert(info != NULL);
 
-	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
-
 	p4rule_t *defaultRule = p4table_get_default_rule(table);
 	if (defaultRule == NULL) {
 		Logger::error("No default rule set");
@@ -375,16 +353,10 @@ pi_status_t _pi_table_entry_delete(pi_session_handle_t session_handle, pi_dev_id
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_entry_delete");
 
-	const pi_p4info_t *info = infos[dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
 
 	uint32_t status = p4table_delete_rule(table, entry_handle);
 	if (status != P4DEV_OK) {
@@ -401,25 +373,18 @@ pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle, pi_d
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_entry_delete_wkey");
 
-	const pi_p4info_t *info = infos[dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
 
-	p4key_elem_t *key;
 	uint32_t status, index;
-	if ((status = createKeys(info, table_id, match_key, &key))) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
+	{
+		std::lock_guard<std::mutex> lock(tableCaches[dev_id].lookupMutex());
+		if ((status = fillKeys(*layout, match_key, layout->lookupKey)) == P4DEV_OK) {
+			status = p4table_find_rule(table, layout->lookupKey, &index);
+		}
 	}
-
-	status = p4table_find_rule(table, key, &index);
 	if (status != P4DEV_OK) {
 		p4dev_err_stderr(status);
 		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
@@ -440,30 +405,20 @@ pi_status_t _pi_table_entry_modify(pi_session_handle_t session_handle, pi_dev_id
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_entry_modify");
 
-	const pi_p4info_t *info = infos[dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
 
-	pi_p4_id_t actionID = table_entry->entry.action_data->action_id;
-	const char *actionData = table_entry->entry.action_data->data;
-	const char *actionName = pi_p4info_action_name_from_id(info, actionID);
+	const ActionLayout *action = getActionLayout(dev_id, table_entry->entry.action_data->action_id);
+	if (action == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
 
+	// libp4dev takes ownership of the parameters on success
 	p4param_t *params = NULL;
-	uint32_t status;
-	if ((status = createParams(info, actionID, actionData, &params)) != P4DEV_OK) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
-	}
-
-	status = p4table_modify_rule(table, entry_handle, actionName, params);
+	uint32_t status = createActionParams(*action, table_entry->entry.action_data->data, &params);
+	if (status == P4DEV_OK) status = p4table_modify_rule(table, entry_handle, action->name, params);
 	if (status != P4DEV_OK)  {
+		p4param_free(params);
 		p4dev_err_stderr(status);
 		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
 	}
@@ -477,42 +432,31 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle, pi_d
 	COMBO_UNUSED(session_handle);
 	Logger::debug("PI_table_entry_modify_wkey");
 
-	const pi_p4info_t *info = infos[dev_id];
-	assert(info != NULL);
-
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
-	}
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
+	const ActionLayout *action = getActionLayout(dev_id, table_entry->entry.action_data->action_id);
+	if (action == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
 
 	uint32_t status, index;
-	p4key_elem_t *key;
-	if ((status = createKeys(info, table_id, match_key, &key)) != P4DEV_OK) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
+	{
+		std::lock_guard<std::mutex> lock(tableCaches[dev_id].lookupMutex());
+		if ((status = fillKeys(*layout, match_key, layout->lookupKey)) == P4DEV_OK) {
+			status = p4table_find_rule(table, layout->lookupKey, &index);
+		}
 	}
-
-	status = p4table_find_rule(table, key, &index);
 	if (status != P4DEV_OK) {
 		p4dev_err_stderr(status);
 		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
 	}
 
-	pi_p4_id_t actionID = table_entry->entry.action_data->action_id;
-	const char *actionData = table_entry->entry.action_data->data;
-	const char *actionName = pi_p4info_action_name_from_id(info, actionID);
-
+	// libp4dev takes ownership of the parameters on success
 	p4param_t *params = NULL;
-	if ((status = createParams(info, actionID, actionData, &params)) != P4DEV_OK) {
-		p4dev_err_stderr(status);
-		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
-	}
-
-	status = p4table_modify_rule(table, index, actionName, params);
+	status = createActionParams(*action, table_entry->entry.action_data->data, &params);
+	if (status == P4DEV_OK) status = p4table_modify_rule(table, index, action->name, params);
 	if (status != P4DEV_OK) {
+		p4param_free(params);
 		p4dev_err_stderr(status);
 		return pi_status_t(PI_STATUS_TARGET_ERROR + status);
 	}
@@ -520,109 +464,97 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle, pi_d
 	return PI_STATUS_SUCCESS;
 }
 
-//! Retrieve all entries in table as one big blob.
-pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id, pi_table_fetch_res_t *res) {
+//! Delete all entries from a table. The default entry is kept.
+pi_status_t _pi_table_entries_clear(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id) {
 	COMBO_UNUSED(session_handle);
-	Logger::debug("PI_table_entries_fetch");
-
-	const pi_p4info_t *info = infos[dev_id];
-	assert(info != NULL);
+	Logger::debug("PI_table_entries_clear");
 
 	// Retrieve table handle
-	const char *tableName = pi_p4info_table_name_from_id(info, table_id);
-	p4table_t *table = p4device_get_table(&(devices[dev_id]), tableName);
-	if (table == NULL) {
-		Logger::error("Cannot get table with name: " + std::string(tableName));
-		return PI_STATUS_NETV_INVALID_OBJ_ID;
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
+
+	// Rules are addressed by index, deleting from the back never moves the remaining ones
+	for (uint32_t index = p4table_get_size(table); index > 0; index--) {
+		uint32_t status = p4table_delete_rule(table, index - 1);
+		if (status != P4DEV_OK) {
+			p4dev_err_stderr(status);
+			return pi_status_t(PI_STATUS_TARGET_ERROR + status);
+		}
 	}
 
-	res->num_entries = p4table_get_size(table);
-	size_t dataSize = 0U;
-	res->p4info = info;
-	res->num_direct_resources = res->num_entries;
+	return PI_STATUS_SUCCESS;
+}
 
-	dataSize += res->num_entries * sizeof(s_pi_entry_handle_t);
-	dataSize += res->num_entries * sizeof(s_pi_action_entry_type_t);
-	dataSize += res->num_entries * sizeof(uint32_t);  // for priority
-	dataSize += res->num_entries * sizeof(uint32_t);  // for properties
-	dataSize += res->num_entries * sizeof(uint32_t);  // for direct resources
+//! Retrieve all entries in table as one big blob.
+pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id, pi_table_fetch_res_t *res) {
+	COMBO_UNUSED(session_handle);
+	Logger::debug("PI_table_entries_fetch");
 
-	res->mkey_nbytes = pi_p4info_table_match_key_size(info, table_id);
-	dataSize += res->num_entries * res->mkey_nbytes;
+	// Retrieve table handle
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
 
-	size_t num_actions;
-	auto actionIds = pi_p4info_table_get_actions(info, table_id, &num_actions);
-	auto actionMap = computeActionSizes(info, actionIds, num_actions);
+	res->p4info = infos[dev_id];
+	uint32_t size = p4table_get_size(table);
+	res->num_direct_resources = size;
 
-	for (uint32_t i = 0; i < res->num_entries; i++) {
-		auto *rule = p4table_get_rule(table, i);
-		
-		dataSize += actionMap.at(rule->action).size;
-		dataSize += sizeof(s_pi_p4_id_t); // Action ID
-		dataSize += sizeof(uint32_t); // Action params bytewidth
-	}
+	return serializeRules(dev_id, table_id, table, 0, size, res);
+}
 
-	char *data = new char[dataSize];
-	if (data == NULL) return PI_STATUS_ALLOC_ERROR;
+//! Retrieve at most res->chunk_size entries, starting with rule index res->cursor.
+pi_status_t _pi_table_entries_fetch_chunk(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id, pi_table_fetch_res_t *res) {
+	COMBO_UNUSED(session_handle);
+	Logger::debug("PI_table_entries_fetch_chunk");
 
-	// in some cases, we do not use the whole buffer
-	std::fill(data, data + dataSize, 0);
-	res->entries_size = dataSize;
-	res->entries = data;
+	// Retrieve table handle
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
+	p4table_t *table = layout->table;
 
-	for (uint32_t i = 0; i < res->num_entries; i++) {
-		auto *rule = p4table_get_rule(table, i);
+	// Rules are addressed by index, so no state is needed between chunks
+	uint32_t size = p4table_get_size(table);
+	uint32_t first = std::min<size_t>(res->cursor, size);
+	uint32_t last = std::min<size_t>(first + res->chunk_size, size);
 
-		data += emit_entry_handle(data, i);
-		// We don't have priority yet
-		data += emit_uint32(data, 0); // priority
+	pi_status_t status = serializeRules(dev_id, table_id, table, first, last, res);
+	if (status != PI_STATUS_SUCCESS) return status;
 
-		p4key_elem_t *key = rule->key;
-		while (key != NULL) {
+	res->cursor = last;
+	res->done = (last == size);
 
-			switch (rule->engine) {
-			case P4ENGINE_TERNARY:
-				/* NOTE:
-					The endianness was flipped when the rule
-					was written into the device, now we have
-					to flip it back.
-				 */
-				flipEndianness(key->value, key->value_size);
-				std::memcpy(data, key->value, key->value_size);
-				data += key->value_size;
-				flipEndianness(key->opt.mask, key->value_size);
-				std::memcpy(data, key->opt.mask, key->value_size);
-				data += key->value_size;
-				break;
+	return PI_STATUS_SUCCESS;
+}
 
-			case P4ENGINE_LPM:
-				flipEndianness(key->value, key->value_size);
-				std::memcpy(data, key->value, key->value_size);
-				data += key->value_size;
-				data += emit_uint32(data, key->opt.prefix_len);
-				break;
+//! Called once a chunked fetch is over.
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle, pi_table_fetch_res_t *res) {
+	COMBO_UNUSED(session_handle);
+	COMBO_UNUSED(res);
+	Logger::debug("PI_table_entries_fetch_end");
 
-			case P4ENGINE_EXACT:
-				flipEndianness(key->value, key->value_size);
-				std::memcpy(data, key->value, key->value_size);
-				data += key->value_size;
-				break;
-			}
+	return PI_STATUS_SUCCESS;
+}
 
-			key = key->next;
-		}
+//! Report whether entry handles stay valid until their entry is deleted. They
+//! do not: handles are rule indices, and deleting a rule shifts the following
+//! ones, so clients need to use the _wkey functions.
+pi_status_t _pi_table_entry_handles_stable(pi_dev_id_t dev_id, bool *stable) {
+	COMBO_UNUSED(dev_id);
+	*stable = false;
+	return PI_STATUS_SUCCESS;
+}
 
-		// Our actions are always direct
-		data += emit_action_entry_type(data, PI_ACTION_ENTRY_TYPE_DATA);
-		auto actionProperties = actionMap.at(rule->action);
+//! Retrieve the number of rules in a table without reading them.
+pi_status_t _pi_table_get_num_entries(pi_session_handle_t session_handle, pi_dev_id_t dev_id, pi_p4_id_t table_id, size_t *num_entries) {
+	COMBO_UNUSED(session_handle);
+	Logger::debug("PI_table_get_num_entries");
 
-		data += emit_p4_id(data, actionProperties.id);
-		data += emit_uint32(data, actionProperties.size);
-		data = dumpActionData(info, data, actionProperties.id, rule->params);
+	// Retrieve table handle
+	const TableLayout *layout = getTableLayout(dev_id, table_id);
+	if (layout == NULL) return PI_STATUS_NETV_INVALID_OBJ_ID;
 
-		data += emit_uint32(data, 0);  // properties
-		data += emit_uint32(data, 0);  // TODO(antonin): direct resources
-	}
+	*num_entries = p4table_get_size(layout->table);
 
 	return PI_STATUS_SUCCESS;
 }
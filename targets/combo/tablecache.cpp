@@ -0,0 +1,160 @@
+#include "tablecache.hpp"
+#include "helpers.hpp"
+#include "logger.hpp"
+#include <cstdlib>
+
+static uint8_t *allocateValue(std::size_t bytewidth) {
+	// libp4dev releases value buffers with free()
+	return static_cast<uint8_t*>(std::calloc(bytewidth, 1));
+}
+
+static p4key_elem_t *createKeyElem(const KeyFieldLayout &field) {
+	uint8_t *value = allocateValue(field.bytewidth);
+	if (value == NULL) return NULL;
+
+	p4key_elem_t *elem = NULL;
+	switch (field.matchType) {
+	case PI_P4INFO_MATCH_TYPE_EXACT:
+		elem = p4key_exact_create(field.name, field.bytewidth, value);
+		break;
+	case PI_P4INFO_MATCH_TYPE_LPM:
+		elem = p4key_lpm_create(field.name, field.bytewidth, value, 0);
+		break;
+	case PI_P4INFO_MATCH_TYPE_TERNARY: {
+		uint8_t *mask = allocateValue(field.bytewidth);
+		if (mask != NULL) elem = p4key_ternary_create(field.name, field.bytewidth, value, mask);
+		if (elem == NULL) std::free(mask);
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (elem == NULL) std::free(value);
+	return elem;
+}
+
+static p4key_elem_t *createKeys(const TableLayout &layout) {
+	p4key_elem_t *head = NULL;
+	p4key_elem_t **last = &head;
+	for (const KeyFieldLayout &field : layout.keys) {
+		*last = createKeyElem(field);
+		if (*last == NULL) {
+			p4key_free(head);
+			return NULL;
+		}
+		last = &((*last)->next);
+	}
+	return head;
+}
+
+p4rule_t *createRule(const TableLayout &layout) {
+	if (layout.lookupKey == NULL) return NULL;
+
+	p4rule_t *rule = p4rule_create(layout.name, layout.engine);
+	if (rule == NULL) return NULL;
+
+	p4key_elem_t *key = createKeys(layout);
+	if (key == NULL || p4rule_add_key_element(rule, key) != P4DEV_OK) {
+		p4key_free(key);
+		p4rule_free(rule);
+		return NULL;
+	}
+	return rule;
+}
+
+uint32_t createParams(const ActionLayout &action, p4param_t **params) {
+	p4param_t *head = NULL;
+	p4param_t **last = &head;
+	for (const ParamLayout &param : action.params) {
+		uint8_t *value = allocateValue(param.bytewidth);
+		*last = (value == NULL) ? NULL : p4param_create(param.name, param.bytewidth, value);
+		if (*last == NULL) {
+			std::free(value);
+			p4param_free(head);
+			return P4DEV_ALLOCATE_ERROR;
+		}
+		last = &((*last)->next);
+	}
+	*params = head;
+	return P4DEV_OK;
+}
+
+TableCache::~TableCache() {
+	clear();
+}
+
+void TableCache::build(p4device_t *device, const pi_p4info_t *info) {
+	clear();
+
+	// P4 ids are sparse, so they are hashed instead of used as indices
+	actions.reserve(pi_p4info_action_get_num(info));
+	for (pi_p4_id_t id = pi_p4info_action_begin(info); id != pi_p4info_action_end(info); id = pi_p4info_action_next(info, id)) {
+		ActionLayout &action = actions[id];
+		action.id = id;
+		action.name = pi_p4info_action_name_from_id(info, id);
+		action.dataSize = pi_p4info_action_data_size(info, id);
+
+		size_t paramCount;
+		const pi_p4_id_t *paramIds = pi_p4info_action_get_params(info, id, &paramCount);
+		action.params.reserve(paramCount);
+		for (size_t i = 0; i < paramCount; i++) {
+			size_t bitwidth = pi_p4info_action_param_bitwidth(info, id, paramIds[i]);
+			action.params.push_back({
+				pi_p4info_action_param_name_from_id(info, id, paramIds[i]),
+				(bitwidth + 7) / 8
+			});
+		}
+
+		actionsByName.emplace(std::string(action.name), &action);
+	}
+
+	for (pi_p4_id_t id = pi_p4info_table_begin(info); id != pi_p4info_table_end(info); id = pi_p4info_table_next(info, id)) {
+		TableLayout &layout = tables[id];
+		layout.name = pi_p4info_table_name_from_id(info, id);
+		layout.table = p4device_get_table(device, layout.name);
+		layout.engine = P4ENGINE_UNKNOWN;
+
+		bool mixedEngines = false;
+		size_t matchFieldsSize = pi_p4info_table_num_match_fields(info, id);
+		layout.keys.reserve(matchFieldsSize);
+		for (size_t i = 0; i < matchFieldsSize; i++) {
+			auto finfo = pi_p4info_table_match_field_info(info, id, i);
+			layout.keys.push_back({
+				pi_p4info_table_match_field_name_from_id(info, id, finfo->mf_id),
+				(finfo->bitwidth + 7) / 8,
+				finfo->match_type
+			});
+
+			p4engine_type_t engine = translateEngine(finfo->match_type);
+			if (layout.engine == P4ENGINE_UNKNOWN) layout.engine = engine;
+			else if (layout.engine != engine) mixedEngines = true;
+		}
+		if (mixedEngines) layout.engine = P4ENGINE_UNKNOWN;
+
+		// Valid and range matches have no libp4dev key element, such tables get no lookup key
+		layout.lookupKey = createKeys(layout);
+	}
+}
+
+void TableCache::clear() {
+	for (auto &entry : tables) p4key_free(entry.second.lookupKey);
+	tables.clear();
+	actionsByName.clear();
+	actions.clear();
+}
+
+const TableLayout *TableCache::getTable(pi_p4_id_t tableId) const {
+	auto it = tables.find(tableId);
+	return it == tables.end() ? NULL : &(it->second);
+}
+
+const ActionLayout *TableCache::getAction(pi_p4_id_t actionId) const {
+	auto it = actions.find(actionId);
+	return it == actions.end() ? NULL : &(it->second);
+}
+
+const ActionLayout *TableCache::getAction(const std::string &actionName) const {
+	auto it = actionsByName.find(actionName);
+	return it == actionsByName.end() ? NULL : it->second;
+}
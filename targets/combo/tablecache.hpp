@@ -0,0 +1,123 @@
+#ifndef TABLECACHE_HPP_
+#define TABLECACHE_HPP_
+
+#include <PI/pi.h>
+#include <PI/p4info.h>
+#include <p4dev.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ *  \brief Layout of a single match field, in match key order
+ */
+struct KeyFieldLayout {
+	const char *name; ///< Points into P4 Info, valid until the cache is rebuilt
+	std::size_t bytewidth;
+	pi_p4info_match_type_t matchType;
+};
+
+/**
+ *  \brief Layout of a single action parameter, in action data order
+ */
+struct ParamLayout {
+	const char *name; ///< Points into P4 Info, valid until the cache is rebuilt
+	std::size_t bytewidth;
+};
+
+struct ActionLayout {
+	pi_p4_id_t id;
+	const char *name;
+	uint32_t dataSize; ///< Bytes needed to serialize action data
+	std::vector<ParamLayout> params;
+};
+
+struct TableLayout {
+	p4table_t *table; ///< NULL if the device does not know the table
+	const char *name;
+	p4engine_type_t engine; ///< P4ENGINE_UNKNOWN if engines are mixed
+	std::vector<KeyFieldLayout> keys;
+	/**
+	 *  Preallocated key chain which follows keys, used to look rules up by match
+	 *  key. NULL if a match type is not supported.
+	 */
+	p4key_elem_t *lookupKey = NULL;
+};
+
+/**
+ *  \brief Allocate a rule whose key chain follows the layout of the table
+ *
+ *  \details Value buffers are zeroed. libp4dev takes ownership of the rule when
+ *  it is inserted, so a new one is needed for every insert.
+ *
+ *  \return New rule or NULL on allocation failure or unsupported match type
+ */
+p4rule_t *createRule(const TableLayout &layout);
+
+/**
+ *  \brief Allocate a parameter chain which follows the layout of the action
+ *
+ *  \details Value buffers are zeroed. libp4dev takes ownership of the chain on
+ *  insert and modify. Actions without parameters get an empty (NULL) chain.
+ *
+ *  \param [out] params New chain
+ *  \return P4DEV_OK or P4DEV_ALLOCATE_ERROR
+ */
+uint32_t createParams(const ActionLayout &action, p4param_t **params);
+
+/**
+ *  \brief Everything the table functions need to know about P4 objects of one device
+ *
+ *  \details Built once when the device is assigned or its P4 Info is updated, so
+ *  that the data path never has to resolve names or walk P4 Info.
+ *
+ *  Every table also owns a key chain used to find rules by match key, which
+ *  libp4dev only reads. Lookup keys are shared by all operations of a device and
+ *  must only be used while holding lookupMutex(). Rules and parameters handed to
+ *  libp4dev on insert and modify are owned by it and are allocated for each
+ *  operation.
+ */
+class TableCache {
+public:
+	~TableCache();
+
+	/**
+	 *  \brief Resolve table handles and precompute key and parameter layouts
+	 *
+	 *  \param [in] device Initialized libp4dev device
+	 *  \param [in] info P4 Info for the device
+	 */
+	void build(p4device_t *device, const pi_p4info_t *info);
+
+	void clear();
+
+	/**
+	 *  \return Layout of a table or NULL if the id is unknown
+	 */
+	const TableLayout *getTable(pi_p4_id_t tableId) const;
+
+	/**
+	 *  \return Layout of an action or NULL if the id is unknown
+	 */
+	const ActionLayout *getAction(pi_p4_id_t actionId) const;
+
+	/**
+	 *  \return Layout of an action or NULL if the name is unknown
+	 */
+	const ActionLayout *getAction(const std::string &actionName) const;
+
+	std::mutex &lookupMutex() { return lookupLock; }
+
+private:
+	std::unordered_map<pi_p4_id_t, TableLayout> tables;
+	std::unordered_map<pi_p4_id_t, ActionLayout> actions;
+	std::unordered_map<std::string, const ActionLayout*> actionsByName;
+	std::mutex lookupLock;
+};
+
+typedef std::vector<TableCache> DeviceTableCaches;
+
+extern DeviceTableCaches tableCaches; ///< Indexed the same way as devices
+
+#endif
@@ -22,11 +22,17 @@
 
 #include <Judy.h>
 
+#include <pthread.h>
 #include <stdio.h>
 
-typedef struct { Pvoid_t array; } func_counter_t;
+// the target can be called from several threads at once (e.g. the PI counter
+// sweeper thread)
+typedef struct {
+  Pvoid_t array;
+  pthread_mutex_t mutex;
+} func_counter_t;
 
-static func_counter_t func_counter;
+static func_counter_t func_counter = {.mutex = PTHREAD_MUTEX_INITIALIZER};
 
 void func_counter_init() { func_counter.array = (Pvoid_t)NULL; }
 
@@ -35,14 +41,19 @@ void func_counter_increment(const char *func_name) {
   printf("%s\n", func_name);
 #endif
   Word_t *PValue;
+  pthread_mutex_lock(&func_counter.mutex);
   JSLI(PValue, func_counter.array, (const uint8_t *)func_name);
   (*PValue)++;
+  pthread_mutex_unlock(&func_counter.mutex);
 }
 
 int func_counter_get(const char *func_name) {
   Word_t *PValue;
+  pthread_mutex_lock(&func_counter.mutex);
   JSLG(PValue, func_counter.array, (const uint8_t *)func_name);
-  return (PValue == NULL) ? -1 : (int)*PValue;
+  int count = (PValue == NULL) ? -1 : (int)*PValue;
+  pthread_mutex_unlock(&func_counter.mutex);
+  return count;
 }
 
 int func_counter_dump_to_file(const char *path) {
@@ -51,11 +62,13 @@ int func_counter_dump_to_file(const char *path) {
   Word_t *PValue;
   uint8_t index[128];  // max function name must be 128 bytes
   index[0] = 0;
+  pthread_mutex_lock(&func_counter.mutex);
   JSLF(PValue, func_counter.array, index);
   while (PValue != NULL) {
     fprintf(f, "%s : %d\n", (char *)index, (int)*PValue);
     JSLN(PValue, func_counter.array, index);
   }
+  pthread_mutex_unlock(&func_counter.mutex);
   fclose(f);
   return 0;
 }
@@ -113,6 +113,15 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
   return PI_STATUS_SUCCESS;
 }
 
+pi_status_t _pi_act_prof_clear(pi_session_handle_t session_handle,
+                               pi_dev_id_t dev_id, pi_p4_id_t act_prof_id) {
+  (void)session_handle;
+  (void)dev_id;
+  (void)act_prof_id;
+  func_counter_increment(__func__);
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
                                        pi_dev_id_t dev_id,
                                        pi_p4_id_t act_prof_id,
@@ -20,21 +20,58 @@
 
 #include <PI/target/pi_counter_imp.h>
 
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "func_counter.h"
 
+// The dummy target remembers the values written to a few indirect counter
+// entries, so that code reading counters (e.g. the PI counter sweeper) can be
+// tested; other entries read as 0.
+#define MAX_COUNTER_ENTRIES 64
+
+typedef struct {
+  pi_dev_id_t dev_id;
+  pi_p4_id_t counter_id;
+  size_t index;
+  pi_counter_data_t data;
+} counter_entry_t;
+
+static counter_entry_t counter_entries[MAX_COUNTER_ENTRIES];
+static size_t num_counter_entries = 0;
+static pthread_mutex_t counter_entries_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// counter_entries_mutex must be held
+static counter_entry_t *find_counter_entry(pi_dev_id_t dev_id,
+                                           pi_p4_id_t counter_id,
+                                           size_t index) {
+  for (size_t i = 0; i < num_counter_entries; i++) {
+    counter_entry_t *entry = &counter_entries[i];
+    if (entry->dev_id == dev_id && entry->counter_id == counter_id &&
+        entry->index == index)
+      return entry;
+  }
+  return NULL;
+}
+
 pi_status_t _pi_counter_read(pi_session_handle_t session_handle,
                              pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                              size_t index, int flags,
                              pi_counter_data_t *counter_data) {
   (void)session_handle;
-  (void)dev_tgt;
-  (void)counter_id;
-  (void)index;
   (void)flags;
-  (void)counter_data;
   func_counter_increment(__func__);
+  pthread_mutex_lock(&counter_entries_mutex);
+  counter_entry_t *entry =
+      find_counter_entry(dev_tgt.dev_id, counter_id, index);
+  if (entry) {
+    *counter_data = entry->data;
+  } else {
+    memset(counter_data, 0, sizeof(*counter_data));
+  }
+  counter_data->valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  pthread_mutex_unlock(&counter_entries_mutex);
   return PI_STATUS_SUCCESS;
 }
 
@@ -43,12 +80,28 @@ pi_status_t _pi_counter_write(pi_session_handle_t session_handle,
                               size_t index,
                               const pi_counter_data_t *counter_data) {
   (void)session_handle;
-  (void)dev_tgt;
-  (void)counter_id;
-  (void)index;
-  (void)counter_data;
   func_counter_increment(__func__);
-  return PI_STATUS_SUCCESS;
+  pi_status_t status = PI_STATUS_SUCCESS;
+  pthread_mutex_lock(&counter_entries_mutex);
+  counter_entry_t *entry =
+      find_counter_entry(dev_tgt.dev_id, counter_id, index);
+  if (!entry && num_counter_entries < MAX_COUNTER_ENTRIES) {
+    entry = &counter_entries[num_counter_entries++];
+    memset(entry, 0, sizeof(*entry));
+    entry->dev_id = dev_tgt.dev_id;
+    entry->counter_id = counter_id;
+    entry->index = index;
+  }
+  if (!entry) {
+    status = PI_STATUS_TARGET_ERROR;
+  } else {
+    if (counter_data->valid & PI_COUNTER_UNIT_PACKETS)
+      entry->data.packets = counter_data->packets;
+    if (counter_data->valid & PI_COUNTER_UNIT_BYTES)
+      entry->data.bytes = counter_data->bytes;
+  }
+  pthread_mutex_unlock(&counter_entries_mutex);
+  return status;
 }
 
 pi_status_t _pi_counter_read_direct(pi_session_handle_t session_handle,
@@ -83,10 +136,7 @@ pi_status_t _pi_counter_hw_sync(pi_session_handle_t session_handle,
                                 pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
                                 PICounterHwSyncCb cb, void *cb_cookie) {
   (void)session_handle;
-  (void)dev_tgt;
-  (void)counter_id;
-  (void)cb;
-  (void)cb_cookie;
   func_counter_increment(__func__);
+  if (cb) cb(dev_tgt.dev_id, counter_id, cb_cookie);
   return PI_STATUS_SUCCESS;
 }
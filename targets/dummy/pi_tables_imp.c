@@ -131,6 +131,15 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
   return PI_STATUS_SUCCESS;
 }
 
+pi_status_t _pi_table_entries_clear(pi_session_handle_t session_handle,
+                                    pi_dev_id_t dev_id, pi_p4_id_t table_id) {
+  (void)session_handle;
+  (void)dev_id;
+  (void)table_id;
+  func_counter_increment(__func__);
+  return PI_STATUS_SUCCESS;
+}
+
 pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res) {
@@ -149,3 +158,42 @@ pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
   func_counter_increment(__func__);
   return PI_STATUS_SUCCESS;
 }
+
+pi_status_t _pi_table_entries_fetch_chunk(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          pi_table_fetch_res_t *res) {
+  (void)session_handle;
+  (void)dev_id;
+  (void)table_id;
+  (void)res;
+  func_counter_increment(__func__);
+  // the table is retrieved in one go by _pi_table_entries_fetch instead
+  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                        pi_table_fetch_res_t *res) {
+  (void)session_handle;
+  (void)res;
+  func_counter_increment(__func__);
+  return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_table_entry_handles_stable(pi_dev_id_t dev_id, bool *stable) {
+  (void)dev_id;
+  (void)stable;
+  func_counter_increment(__func__);
+  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
+pi_status_t _pi_table_get_num_entries(pi_session_handle_t session_handle,
+                                      pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                      size_t *num_entries) {
+  (void)session_handle;
+  (void)dev_id;
+  (void)table_id;
+  *num_entries = 0;
+  func_counter_increment(__func__);
+  return PI_STATUS_SUCCESS;
+}
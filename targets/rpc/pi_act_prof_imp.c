@@ -239,6 +239,30 @@ pi_status_t _pi_act_prof_grp_remove_mbr(pi_session_handle_t session_handle,
                             mbr_handle, PI_RPC_ACT_PROF_GRP_REMOVE_MBR);
 }
 
+pi_status_t _pi_act_prof_clear(pi_session_handle_t session_handle,
+                               pi_dev_id_t dev_id, pi_p4_id_t act_prof_id) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_id_t dev_id;
+    s_pi_p4_id_t act_prof_id;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = state.req_id++;
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_ACT_PROF_CLEAR);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_p4_id(req_, act_prof_id);
+
+  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  return wait_for_status(req_id);
+}
+
 pi_status_t _pi_act_prof_entries_fetch(pi_session_handle_t session_handle,
                                        pi_dev_id_t dev_id,
                                        pi_p4_id_t act_prof_id,
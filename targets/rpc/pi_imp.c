@@ -414,3 +414,35 @@ pi_status_t _pi_packetout_send(pi_dev_id_t dev_id, const char *pkt,
 
   return wait_for_status(req_id);
 }
+
+// all the packets are sent in a single message, with one round-trip
+pi_status_t _pi_packetout_send_batch(pi_dev_id_t dev_id,
+                                     const char *const *pkts,
+                                     const size_t *sizes, size_t num_pkts) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  size_t s = 0;
+  s += sizeof(req_hdr_t);
+  s += sizeof(s_pi_dev_id_t);
+  s += sizeof(uint32_t);  // num_pkts
+  for (size_t i = 0; i < num_pkts; i++) s += sizeof(uint32_t) + sizes[i];
+
+  // unlike other requests, the size is driven by the caller and can be large
+  char *req = nn_allocmsg(s, 0);
+  if (req == NULL) return PI_STATUS_ALLOC_ERROR;
+  char *req_ = req;
+  pi_rpc_id_t req_id = state.req_id++;
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_PACKETOUT_SEND_BATCH);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_uint32(req_, num_pkts);
+  for (size_t i = 0; i < num_pkts; i++) {
+    req_ += emit_uint32(req_, sizes[i]);
+    memcpy(req_, pkts[i], sizes[i]);
+    req_ += sizes[i];
+  }
+
+  int rc = nn_send(state.s, &req, NN_MSG, 0);
+  if ((size_t)rc != s) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  return wait_for_status(req_id);
+}
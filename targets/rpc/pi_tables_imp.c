@@ -322,6 +322,30 @@ pi_status_t _pi_table_entry_modify_wkey(pi_session_handle_t session_handle,
   return wait_for_status(req_id);
 }
 
+pi_status_t _pi_table_entries_clear(pi_session_handle_t session_handle,
+                                    pi_dev_id_t dev_id, pi_p4_id_t table_id) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_id_t dev_id;
+    s_pi_p4_id_t table_id;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = state.req_id++;
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_ENTRIES_CLEAR);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_p4_id(req_, table_id);
+
+  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  return wait_for_status(req_id);
+}
+
 pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_id_t dev_id, pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res) {
@@ -377,3 +401,68 @@ pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle,
   free(res->entries);
   return PI_STATUS_SUCCESS;
 }
+
+// Not part of the RPC protocol (yet); the PI library falls back to
+// _pi_table_entries_fetch.
+pi_status_t _pi_table_entries_fetch_chunk(pi_session_handle_t session_handle,
+                                          pi_dev_id_t dev_id,
+                                          pi_p4_id_t table_id,
+                                          pi_table_fetch_res_t *res) {
+  (void)session_handle;
+  (void)dev_id;
+  (void)table_id;
+  (void)res;
+  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
+pi_status_t _pi_table_entries_fetch_end(pi_session_handle_t session_handle,
+                                        pi_table_fetch_res_t *res) {
+  (void)session_handle;
+  (void)res;
+  return PI_STATUS_SUCCESS;
+}
+
+// the handles are the ones of the target behind the RPC server, we do not know
+// how they behave so we conservatively report them as not stable
+pi_status_t _pi_table_entry_handles_stable(pi_dev_id_t dev_id, bool *stable) {
+  (void)dev_id;
+  (void)stable;
+  return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+}
+
+pi_status_t _pi_table_get_num_entries(pi_session_handle_t session_handle,
+                                      pi_dev_id_t dev_id, pi_p4_id_t table_id,
+                                      size_t *num_entries) {
+  if (!state.init) return PI_STATUS_RPC_NOT_INIT;
+
+  typedef struct __attribute__((packed)) {
+    req_hdr_t hdr;
+    s_pi_session_handle_t sess;
+    s_pi_dev_id_t dev_id;
+    s_pi_p4_id_t table_id;
+  } req_t;
+  req_t req;
+  char *req_ = (char *)&req;
+  pi_rpc_id_t req_id = state.req_id++;
+  req_ += emit_req_hdr(req_, req_id, PI_RPC_TABLE_GET_NUM_ENTRIES);
+  req_ += emit_session_handle(req_, session_handle);
+  req_ += emit_dev_id(req_, dev_id);
+  req_ += emit_p4_id(req_, table_id);
+
+  int rc = nn_send(state.s, &req, sizeof(req), 0);
+  if (rc != sizeof(req)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+
+  typedef struct __attribute__((packed)) {
+    rep_hdr_t hdr;
+    uint64_t num_entries;
+  } rep_t;
+  rep_t rep;
+  rc = nn_recv(state.s, &rep, sizeof(rep), 0);
+  if (rc != sizeof(rep)) return PI_STATUS_RPC_TRANSPORT_ERROR;
+  pi_status_t status = retrieve_rep_hdr((char *)&rep, req_id);
+  if (status != PI_STATUS_SUCCESS) return status;
+  uint64_t num_entries_;
+  retrieve_uint64((char *)&rep.num_entries, &num_entries_);
+  *num_entries = num_entries_;
+  return status;
+}
@@ -0,0 +1,153 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Antonin Bas (antonin@barefootnetworks.com)
+ *
+ */
+
+// Measures the time it takes to import a large bmv2 JSON config with
+// pi_add_config. The JSON is generated on the fly: it includes the given
+// number of actions and tables (10,000 by default), as well as one counter and
+// one meter for every 10 tables, half of them direct. Usage:
+//   bench_bmv2_json_reader [num_objects] [num_iterations]
+
+#include <PI/p4info.h>
+#include <PI/pi.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  char *data;
+  size_t size;
+  size_t capacity;
+} buffer_t;
+
+static void append(buffer_t *buf, const char *fmt, ...) {
+  while (1) {
+    va_list ap;
+    va_start(ap, fmt);
+    size_t available = buf->capacity - buf->size;
+    int n = vsnprintf(buf->data + buf->size, available, fmt, ap);
+    va_end(ap);
+    if (n < 0) exit(1);
+    if ((size_t)n < available) {
+      buf->size += n;
+      return;
+    }
+    buf->capacity = 2 * buf->capacity + n;
+    buf->data = realloc(buf->data, buf->capacity);
+  }
+}
+
+// objects are named in reverse order so that the reader has to sort them
+static char *make_config(size_t num_objects) {
+  buffer_t buf = {NULL, 0, 0};
+  append(&buf, "{\"__meta__\": {\"version\": [2, 5]},\n");
+  append(&buf,
+         "\"header_types\": [{\"name\": \"h_t\", \"fields\": "
+         "[[\"f1\", 32], [\"f2\", 16]]}],\n"
+         "\"headers\": [{\"name\": \"h\", \"header_type\": \"h_t\"}],\n");
+
+  append(&buf, "\"actions\": [\n");
+  for (size_t i = 0; i < num_objects; i++) {
+    append(&buf,
+           "%s{\"name\": \"action_%zu\", \"runtime_data\": "
+           "[{\"name\": \"p\", \"bitwidth\": 16}], \"pragmas\": []}\n",
+           (i == 0) ? "" : ",", num_objects - i);
+  }
+  append(&buf, "],\n");
+
+  append(&buf, "\"pipelines\": [{\"name\": \"ingress\",\n");
+  append(&buf, "\"action_profiles\": [],\n\"tables\": [\n");
+  for (size_t i = 0; i < num_objects; i++) {
+    size_t id = num_objects - i;
+    append(&buf,
+           "%s{\"name\": \"table_%zu\", \"type\": \"simple\", "
+           "\"max_size\": 1024, \"key\": [{\"match_type\": \"exact\", "
+           "\"target\": [\"h\", \"f1\"]}], "
+           "\"actions\": [\"action_%zu\", \"action_%zu\"]}\n",
+           (i == 0) ? "" : ",", id, id, (id % num_objects) + 1);
+  }
+  append(&buf, "]}],\n");
+
+  const char *arrays[] = {"counter_arrays", "meter_arrays"};
+  for (size_t a = 0; a < 2; a++) {
+    append(&buf, "\"%s\": [\n", arrays[a]);
+    for (size_t i = 0; i < num_objects / 10; i++) {
+      size_t id = num_objects - 10 * i;
+      int is_direct = (i % 2 == 0);
+      append(&buf,
+             "%s{\"name\": \"%s_%zu\", \"is_direct\": %s, \"size\": 1024, "
+             "\"type\": \"packets\", \"binding\": \"table_%zu\"}\n",
+             (i == 0) ? "" : ",", arrays[a], id, is_direct ? "true" : "false",
+             id);
+    }
+    append(&buf, "]%s\n", (a == 0) ? "," : "");
+  }
+
+  append(&buf, "}\n");
+  return buf.data;
+}
+
+static double elapsed_ms(const struct timespec *start,
+                         const struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1e3 +
+         (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  size_t num_objects = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+  int num_iterations = (argc > 2) ? atoi(argv[2]) : 5;
+  if (num_objects == 0 || num_iterations <= 0) {
+    fprintf(stderr, "Usage: %s [num_objects] [num_iterations]\n", argv[0]);
+    return 1;
+  }
+
+  char *config = make_config(num_objects);
+  printf("Generated bmv2 JSON with %zu actions and %zu tables (%zu bytes)\n",
+         num_objects, num_objects, strlen(config));
+
+  double total_ms = 0, best_ms = 0;
+  for (int i = 0; i < num_iterations; i++) {
+    pi_p4info_t *p4info;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pi_status_t status =
+        pi_add_config(config, PI_CONFIG_TYPE_BMV2_JSON, &p4info);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (status != PI_STATUS_SUCCESS) {
+      fprintf(stderr, "Error when importing config: %d\n", status);
+      return 1;
+    }
+    if (pi_p4info_action_get_num(p4info) != num_objects) {
+      fprintf(stderr, "Unexpected number of actions\n");
+      return 1;
+    }
+    pi_destroy_config(p4info);
+    double ms = elapsed_ms(&start, &end);
+    total_ms += ms;
+    if (i == 0 || ms < best_ms) best_ms = ms;
+  }
+  printf("Import time over %d iterations: average %.1f ms, best %.1f ms\n",
+         num_iterations, total_ms / num_iterations, best_ms);
+
+  free(config);
+  return 0;
+}
@@ -0,0 +1,180 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tests the entry handle cache of the bmv2 target, which does not depend on
+// bmv2
+
+#include "entry_handle_cache.h"
+
+#include <PI/int/pi_int.h>
+
+extern "C" {
+#include "unity/unity_fixture.h"
+}
+
+#include <string>
+
+namespace {
+
+using pibmv2::EntryHandleCache;
+
+const pi_dev_id_t dev_id = 0;
+const pi_p4_id_t t_id = 1;
+
+// the cache only looks at the priority and the key bytes
+struct MatchKey {
+  MatchKey(const std::string &bytes, pi_priority_t priority = 0)
+      : bytes(bytes) {
+    mk.p4info = nullptr;
+    mk.table_id = t_id;
+    mk.priority = priority;
+    mk.data_size = this->bytes.size();
+    mk.data = &this->bytes[0];
+  }
+
+  MatchKey(const MatchKey &) = delete;
+  MatchKey &operator=(const MatchKey &) = delete;
+
+  const pi_match_key_t *get() const { return &mk; }
+
+  std::string bytes;
+  pi_match_key_t mk;
+};
+
+EntryHandleCache *cache;
+
+bool get(const MatchKey &mk, pi_entry_handle_t *entry_handle,
+         pi_dev_id_t dev = dev_id, pi_p4_id_t table_id = t_id) {
+  return cache->get(dev, table_id, mk.get(), entry_handle);
+}
+
+}  // namespace
+
+TEST_GROUP(EntryHandleCache);
+
+TEST_SETUP(EntryHandleCache) { cache = new EntryHandleCache(); }
+
+TEST_TEAR_DOWN(EntryHandleCache) { delete cache; }
+
+TEST(EntryHandleCache, Hit) {
+  MatchKey mk1("\x0a\x01\x01\x01"), mk2("\x0a\x01\x01\x02");
+  pi_entry_handle_t h;
+  TEST_ASSERT_FALSE(get(mk1, &h));
+  cache->add(dev_id, t_id, mk1.get(), 11);
+  cache->add(dev_id, t_id, mk2.get(), 12);
+  TEST_ASSERT_TRUE(get(mk1, &h));
+  TEST_ASSERT_EQUAL_UINT64(11, h);
+  TEST_ASSERT_TRUE(get(mk2, &h));
+  TEST_ASSERT_EQUAL_UINT64(12, h);
+  // the key is looked up by value, not by address
+  MatchKey mk1_copy("\x0a\x01\x01\x01");
+  TEST_ASSERT_TRUE(get(mk1_copy, &h));
+  TEST_ASSERT_EQUAL_UINT64(11, h);
+  // other tables are not affected
+  TEST_ASSERT_FALSE(get(mk1, &h, dev_id, t_id + 1));
+}
+
+TEST(EntryHandleCache, PriorityIsPartOfKey) {
+  MatchKey mk1("\x0a", 1), mk2("\x0a", 2);
+  pi_entry_handle_t h;
+  cache->add(dev_id, t_id, mk1.get(), 11);
+  TEST_ASSERT_FALSE(get(mk2, &h));
+  cache->add(dev_id, t_id, mk2.get(), 12);
+  TEST_ASSERT_TRUE(get(mk1, &h));
+  TEST_ASSERT_EQUAL_UINT64(11, h);
+  TEST_ASSERT_TRUE(get(mk2, &h));
+  TEST_ASSERT_EQUAL_UINT64(12, h);
+}
+
+TEST(EntryHandleCache, Replace) {
+  MatchKey mk1("\x01"), mk2("\x02");
+  pi_entry_handle_t h;
+  // new handle for the same key (e.g. entry deleted and added again with the
+  // bmv2 CLI)
+  cache->add(dev_id, t_id, mk1.get(), 11);
+  cache->add(dev_id, t_id, mk1.get(), 21);
+  TEST_ASSERT_TRUE(get(mk1, &h));
+  TEST_ASSERT_EQUAL_UINT64(21, h);
+  // the old handle does not designate the key anymore
+  cache->remove(dev_id, t_id, 11);
+  TEST_ASSERT_TRUE(get(mk1, &h));
+  TEST_ASSERT_EQUAL_UINT64(21, h);
+  // same handle for a new key
+  cache->add(dev_id, t_id, mk2.get(), 21);
+  TEST_ASSERT_FALSE(get(mk1, &h));
+  TEST_ASSERT_TRUE(get(mk2, &h));
+  TEST_ASSERT_EQUAL_UINT64(21, h);
+}
+
+TEST(EntryHandleCache, InvalidateOnDelete) {
+  MatchKey mk1("\x01"), mk2("\x02");
+  pi_entry_handle_t h;
+  cache->add(dev_id, t_id, mk1.get(), 11);
+  cache->add(dev_id, t_id, mk2.get(), 12);
+  cache->remove(dev_id, t_id, 11);
+  TEST_ASSERT_FALSE(get(mk1, &h));
+  TEST_ASSERT_TRUE(get(mk2, &h));
+  // removing an unknown handle is a no-op
+  cache->remove(dev_id, t_id, 11);
+  cache->remove(dev_id, t_id + 1, 12);
+  TEST_ASSERT_TRUE(get(mk2, &h));
+  TEST_ASSERT_EQUAL_UINT64(12, h);
+  // the key can be cached again
+  cache->add(dev_id, t_id, mk1.get(), 13);
+  TEST_ASSERT_TRUE(get(mk1, &h));
+  TEST_ASSERT_EQUAL_UINT64(13, h);
+}
+
+TEST(EntryHandleCache, ClearTable) {
+  MatchKey mk("\x01");
+  pi_entry_handle_t h;
+  cache->add(dev_id, t_id, mk.get(), 11);
+  cache->add(dev_id, t_id + 1, mk.get(), 12);
+  cache->clear(dev_id, t_id);
+  TEST_ASSERT_FALSE(get(mk, &h));
+  TEST_ASSERT_TRUE(get(mk, &h, dev_id, t_id + 1));
+  TEST_ASSERT_EQUAL_UINT64(12, h);
+}
+
+// the target clears the device when it is assigned, updated or removed
+TEST(EntryHandleCache, ResetOnDeviceUpdate) {
+  MatchKey mk("\x01");
+  pi_entry_handle_t h;
+  cache->add(dev_id, t_id, mk.get(), 11);
+  cache->add(dev_id, t_id + 1, mk.get(), 12);
+  cache->add(dev_id + 1, t_id, mk.get(), 21);
+  cache->clear(dev_id);
+  TEST_ASSERT_FALSE(get(mk, &h));
+  TEST_ASSERT_FALSE(get(mk, &h, dev_id, t_id + 1));
+  TEST_ASSERT_TRUE(get(mk, &h, dev_id + 1, t_id));
+  TEST_ASSERT_EQUAL_UINT64(21, h);
+  // handles for the new config can be cached
+  cache->add(dev_id, t_id, mk.get(), 31);
+  TEST_ASSERT_TRUE(get(mk, &h));
+  TEST_ASSERT_EQUAL_UINT64(31, h);
+}
+
+TEST_GROUP_RUNNER(EntryHandleCache) {
+  RUN_TEST_CASE(EntryHandleCache, Hit);
+  RUN_TEST_CASE(EntryHandleCache, PriorityIsPartOfKey);
+  RUN_TEST_CASE(EntryHandleCache, Replace);
+  RUN_TEST_CASE(EntryHandleCache, InvalidateOnDelete);
+  RUN_TEST_CASE(EntryHandleCache, ClearTable);
+  RUN_TEST_CASE(EntryHandleCache, ResetOnDeviceUpdate);
+}
+
+extern "C" void test_entry_handle_cache() {
+  RUN_TEST_GROUP(EntryHandleCache);
+}
@@ -0,0 +1,289 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tests the HW sync pool of the bmv2 target, which does not depend on bmv2
+
+#include "hw_sync_pool.h"
+
+extern "C" {
+#include "unity/unity_fixture.h"
+}
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using pibmv2::HwSyncPool;
+
+const pi_dev_id_t dev_id = 0;
+// none of the tests below should take anywhere close to this
+const std::chrono::seconds timeout(5);
+
+// Target stand-in: counts the syncs and callbacks, and can hold the syncs until
+// released, to control what is queued in the pool. The first sync of
+// failing_counter_id fails.
+struct Target {
+  pi_status_t sync(pi_dev_id_t, pi_p4_id_t counter_id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    syncs_started++;
+    cv.notify_all();
+    cv.wait(lock, [this] { return !hold; });
+    // only the first sync of the failing counter fails
+    return (++syncs[counter_id] == 1 && counter_id == failing_counter_id)
+               ? PI_STATUS_TARGET_ERROR
+               : PI_STATUS_SUCCESS;
+  }
+
+  HwSyncPool::DoneFn done(pi_p4_id_t counter_id) {
+    return [this, counter_id](pi_status_t status) {
+      std::unique_lock<std::mutex> lock(mutex);
+      callbacks[counter_id]++;
+      if (status != PI_STATUS_SUCCESS) failed_callbacks[counter_id]++;
+      cv.notify_all();
+    };
+  }
+
+  HwSyncPool::SyncFn sync_fn() {
+    return [this](pi_dev_id_t dev_id, pi_p4_id_t counter_id) {
+      return sync(dev_id, counter_id);
+    };
+  }
+
+  void release() {
+    std::unique_lock<std::mutex> lock(mutex);
+    hold = false;
+    cv.notify_all();
+  }
+
+  bool wait_syncs_started(int n) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, timeout, [this, n] { return syncs_started >= n; });
+  }
+
+  bool wait_callbacks(pi_p4_id_t counter_id, int n) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, timeout, [this, counter_id, n] {
+      return callbacks[counter_id] >= n;
+    });
+  }
+
+  int num_syncs(pi_p4_id_t counter_id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return syncs[counter_id];
+  }
+
+  int num_callbacks(pi_p4_id_t counter_id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return callbacks[counter_id];
+  }
+
+  int num_failed_callbacks(pi_p4_id_t counter_id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return failed_callbacks[counter_id];
+  }
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  bool hold{false};
+  int syncs_started{0};
+  std::map<pi_p4_id_t, int> syncs{};
+  std::map<pi_p4_id_t, int> callbacks{};
+  std::map<pi_p4_id_t, int> failed_callbacks{};
+  pi_p4_id_t failing_counter_id{0};
+};
+
+Target *target;
+// a pool whose workers are stuck cannot be destroyed, so on failure the pool is
+// leaked rather than hanging the test
+HwSyncPool *pool;
+
+}  // namespace
+
+TEST_GROUP(HwSyncPool);
+
+TEST_SETUP(HwSyncPool) {
+  target = new Target();
+  pool = nullptr;
+}
+
+TEST_TEAR_DOWN(HwSyncPool) {}
+
+static void pool_destroy() {
+  delete pool;
+  delete target;
+}
+
+TEST(HwSyncPool, Callbacks) {
+  pool = new HwSyncPool(4, 16, target->sync_fn());
+  for (pi_p4_id_t c_id = 1; c_id <= 8; c_id++)
+    pool->submit(dev_id, c_id, target->done(c_id));
+  for (pi_p4_id_t c_id = 1; c_id <= 8; c_id++) {
+    TEST_ASSERT_TRUE(target->wait_callbacks(c_id, 1));
+    TEST_ASSERT_EQUAL(1, target->num_syncs(c_id));
+    TEST_ASSERT_EQUAL(0, target->num_failed_callbacks(c_id));
+  }
+  pool_destroy();
+}
+
+TEST(HwSyncPool, Merge) {
+  target->hold = true;
+  pool = new HwSyncPool(1, 16, target->sync_fn());
+  // the worker picks up the first request and waits in the target
+  pool->submit(dev_id, 1, target->done(1));
+  TEST_ASSERT_TRUE(target->wait_syncs_started(1));
+  // both of these are queued behind it, as a single sync
+  pool->submit(dev_id, 1, target->done(1));
+  pool->submit(dev_id, 1, target->done(1));
+  target->release();
+  TEST_ASSERT_TRUE(target->wait_callbacks(1, 3));
+  TEST_ASSERT_EQUAL(2, target->num_syncs(1));
+  pool_destroy();
+}
+
+TEST(HwSyncPool, Failure) {
+  target->hold = true;
+  target->failing_counter_id = 1;
+  pool = new HwSyncPool(1, 16, target->sync_fn());
+  pool->submit(dev_id, 2, target->done(2));
+  TEST_ASSERT_TRUE(target->wait_syncs_started(1));
+  // both requests are merged into the sync which fails
+  pool->submit(dev_id, 1, target->done(1));
+  pool->submit(dev_id, 1, target->done(1));
+  target->release();
+  TEST_ASSERT_TRUE(target->wait_callbacks(1, 2));
+  TEST_ASSERT_TRUE(target->wait_callbacks(2, 1));
+  TEST_ASSERT_EQUAL(2, target->num_failed_callbacks(1));
+  TEST_ASSERT_EQUAL(0, target->num_failed_callbacks(2));
+  // the next request is not affected by the failure
+  pool->submit(dev_id, 1, target->done(1));
+  TEST_ASSERT_TRUE(target->wait_callbacks(1, 3));
+  TEST_ASSERT_EQUAL(2, target->num_failed_callbacks(1));
+  TEST_ASSERT_EQUAL(2, target->num_syncs(1));
+  pool_destroy();
+}
+
+TEST(HwSyncPool, Stats) {
+  target->hold = true;
+  pool = new HwSyncPool(1, 16, target->sync_fn());
+  target->failing_counter_id = 3;
+  pool->submit(dev_id, 1, target->done(1));
+  TEST_ASSERT_TRUE(target->wait_syncs_started(1));
+  pool->submit(dev_id, 2, target->done(2));
+  pool->submit(dev_id, 3, target->done(3));
+  pool->submit(dev_id, 3, target->done(3));
+  auto stats = pool->get_stats();
+  TEST_ASSERT_EQUAL_UINT(2, stats.queue_depth);
+  TEST_ASSERT_EQUAL_UINT(2, stats.max_queue_depth);
+  TEST_ASSERT_EQUAL_UINT64(4, stats.requests);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.merged);
+  TEST_ASSERT_EQUAL_UINT64(0, stats.syncs);
+  // the held sync makes the latency of all the requests at least this long
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  target->release();
+  TEST_ASSERT_TRUE(target->wait_callbacks(3, 2));
+  // the stats of a sync are updated after its callbacks have been called
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while ((stats = pool->get_stats()).syncs < 3 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  TEST_ASSERT_EQUAL_UINT(0, stats.queue_depth);
+  TEST_ASSERT_EQUAL_UINT(2, stats.max_queue_depth);
+  TEST_ASSERT_EQUAL_UINT64(3, stats.syncs);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.failed_syncs);
+  TEST_ASSERT_TRUE(stats.max_latency >= std::chrono::milliseconds(10));
+  TEST_ASSERT_TRUE(stats.total_latency >= std::chrono::milliseconds(40));
+  pool_destroy();
+}
+
+TEST(HwSyncPool, SubmitBlocksWhenFull) {
+  target->hold = true;
+  pool = new HwSyncPool(1, 1, target->sync_fn());
+  pool->submit(dev_id, 1, target->done(1));
+  TEST_ASSERT_TRUE(target->wait_syncs_started(1));
+  // fills the queue
+  pool->submit(dev_id, 2, target->done(2));
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool submitted = false;
+  std::thread submitter([&mutex, &cv, &submitted] {
+    pool->submit(dev_id, 3, target->done(3));
+    std::unique_lock<std::mutex> lock(mutex);
+    submitted = true;
+    cv.notify_all();
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::milliseconds(100));
+    TEST_ASSERT_FALSE(submitted);
+  }
+  target->release();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    TEST_ASSERT_TRUE(
+        cv.wait_for(lock, timeout, [&submitted] { return submitted; }));
+  }
+  submitter.join();
+  TEST_ASSERT_TRUE(target->wait_callbacks(3, 1));
+  pool_destroy();
+}
+
+TEST(HwSyncPool, SubmitFromCallback) {
+  target->hold = true;
+  pool = new HwSyncPool(1, 1, target->sync_fn());
+  // submits a sync for counter 3 from the callback of the sync for counter 1
+  auto done_1 = target->done(1);
+  pool->submit(dev_id, 1, [done_1](pi_status_t status) {
+    done_1(status);
+    pool->submit(dev_id, 3, target->done(3));
+  });
+  TEST_ASSERT_TRUE(target->wait_syncs_started(1));
+  // the queue is full when the callback for counter 1 submits a new sync, the
+  // worker must not wait for itself to make room
+  pool->submit(dev_id, 2, target->done(2));
+  target->release();
+  TEST_ASSERT_TRUE(target->wait_callbacks(3, 1));
+  TEST_ASSERT_EQUAL(1, target->num_callbacks(2));
+  pool_destroy();
+}
+
+TEST(HwSyncPool, DestroyCompletesQueued) {
+  target->hold = true;
+  pool = new HwSyncPool(1, 16, target->sync_fn());
+  for (pi_p4_id_t c_id = 1; c_id <= 4; c_id++)
+    pool->submit(dev_id, c_id, target->done(c_id));
+  TEST_ASSERT_TRUE(target->wait_syncs_started(1));
+  target->release();
+  delete pool;
+  for (pi_p4_id_t c_id = 1; c_id <= 4; c_id++)
+    TEST_ASSERT_EQUAL(1, target->num_callbacks(c_id));
+  delete target;
+}
+
+TEST_GROUP_RUNNER(HwSyncPool) {
+  RUN_TEST_CASE(HwSyncPool, Callbacks);
+  RUN_TEST_CASE(HwSyncPool, Merge);
+  RUN_TEST_CASE(HwSyncPool, Failure);
+  RUN_TEST_CASE(HwSyncPool, Stats);
+  RUN_TEST_CASE(HwSyncPool, SubmitBlocksWhenFull);
+  RUN_TEST_CASE(HwSyncPool, SubmitFromCallback);
+  RUN_TEST_CASE(HwSyncPool, DestroyCompletesQueued);
+}
+
+extern "C" void test_hw_sync_pool() { RUN_TEST_GROUP(HwSyncPool); }
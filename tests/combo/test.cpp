@@ -0,0 +1,404 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the combo target against the libp4dev stand-in in targets/combo/dummy
+
+#include "PI/frontends/generic/pi.h"
+#include "PI/int/pi_int.h"
+#include "PI/p4info.h"
+#include "PI/pi.h"
+#include "PI/target/pi_imp.h"
+#include "PI/target/pi_tables_imp.h"
+
+#include "devices.hpp"
+#include "tablecache.hpp"
+
+extern "C" {
+#include "unity/unity_fixture.h"
+}
+
+#include <p4dev.h>
+
+#include <cstring>
+
+namespace {
+
+const pi_dev_id_t dev_id = 0;
+const pi_dev_tgt_t dev_tgt = {dev_id, 0xffff};
+pi_session_handle_t sess = 0;
+
+pi_p4info_t *p4info;
+pi_p4_id_t ipv4_lpm_id;
+pi_p4_id_t dst_addr_id;
+pi_p4_id_t set_nhop_id;
+pi_p4_id_t nhop_ipv4_id;
+pi_p4_id_t port_id;
+
+void load_config() {
+  pi_status_t rc = pi_add_config_from_file(TESTDATADIR "/simple_router.json",
+                                           PI_CONFIG_TYPE_BMV2_JSON, &p4info);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, rc);
+  ipv4_lpm_id = pi_p4info_table_id_from_name(p4info, "ipv4_lpm");
+  dst_addr_id = pi_p4info_table_match_field_id_from_name(p4info, ipv4_lpm_id,
+                                                         "ipv4.dstAddr");
+  set_nhop_id = pi_p4info_action_id_from_name(p4info, "set_nhop");
+  nhop_ipv4_id =
+      pi_p4info_action_param_id_from_name(p4info, set_nhop_id, "nhop_ipv4");
+  port_id = pi_p4info_action_param_id_from_name(p4info, set_nhop_id, "port");
+}
+
+// Wraps the generic frontend objects needed for one LPM entry of ipv4_lpm
+struct Entry {
+  Entry(uint32_t addr, uint32_t pLen, uint32_t nhop, uint16_t port) {
+    pi_netv_t fv;
+    pi_match_key_allocate(p4info, ipv4_lpm_id, &mk);
+    pi_getnetv_u32(p4info, ipv4_lpm_id, dst_addr_id, addr, &fv);
+    pi_match_key_lpm_set(mk, &fv, pLen);
+
+    pi_action_data_allocate(p4info, set_nhop_id, &adata);
+    setAction(nhop, port);
+
+    std::memset(&entry, 0, sizeof(entry));
+    entry.entry_type = PI_ACTION_ENTRY_TYPE_DATA;
+    entry.entry.action_data = adata;
+  }
+
+  ~Entry() {
+    pi_match_key_destroy(mk);
+    pi_action_data_destroy(adata);
+  }
+
+  void setAction(uint32_t nhop, uint16_t port) {
+    pi_netv_t fv;
+    pi_action_data_init(adata);
+    pi_getnetv_u32(p4info, set_nhop_id, nhop_ipv4_id, nhop, &fv);
+    pi_action_data_arg_set(adata, &fv);
+    pi_getnetv_u16(p4info, set_nhop_id, port_id, port, &fv);
+    pi_action_data_arg_set(adata, &fv);
+  }
+
+  pi_match_key_t *mk;
+  pi_action_data_t *adata;
+  pi_table_entry_t entry;
+};
+
+p4table_t *get_p4table() {
+  const TableLayout *layout = tableCaches[dev_id].getTable(ipv4_lpm_id);
+  TEST_ASSERT_NOT_NULL(layout);
+  return layout->table;
+}
+
+// libp4dev stores values with the least significant byte first
+uint32_t le32(const uint8_t *value) {
+  return value[0] | (value[1] << 8) | (value[2] << 16) |
+         (static_cast<uint32_t>(value[3]) << 24);
+}
+
+uint32_t rule_addr(const p4rule_t *rule) {
+  TEST_ASSERT_EQUAL_UINT(4, rule->key->value_size);
+  return le32(rule->key->value);
+}
+
+uint32_t rule_nhop(const p4rule_t *rule) {
+  TEST_ASSERT_NOT_NULL(rule->params);
+  TEST_ASSERT_EQUAL_UINT(4, rule->params->value_size);
+  return le32(rule->params->value);
+}
+
+}  // namespace
+
+TEST_GROUP(Combo_TableCache);
+
+TEST_SETUP(Combo_TableCache) {
+  load_config();
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_assign_device(dev_id, p4info, NULL));
+}
+
+TEST_TEAR_DOWN(Combo_TableCache) {
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, _pi_remove_device(dev_id));
+  pi_destroy_config(p4info);
+}
+
+TEST(Combo_TableCache, GetTable) {
+  const TableCache &cache = tableCaches[dev_id];
+  const TableLayout *layout = cache.getTable(ipv4_lpm_id);
+  TEST_ASSERT_NOT_NULL(layout);
+  TEST_ASSERT_NOT_NULL(layout->table);
+  TEST_ASSERT_EQUAL_STRING("ipv4_lpm", layout->name);
+  TEST_ASSERT_EQUAL(P4ENGINE_LPM, layout->engine);
+  TEST_ASSERT_EQUAL_UINT(1, layout->keys.size());
+  TEST_ASSERT_EQUAL_UINT(4, layout->keys[0].bytewidth);
+
+  // the lookup key chain mirrors the layout
+  const p4key_elem_t *key = layout->lookupKey;
+  TEST_ASSERT_NOT_NULL(key);
+  TEST_ASSERT_EQUAL_UINT(4, key->value_size);
+  TEST_ASSERT_NULL(key->next);
+
+  // so do the keys of new rules
+  p4rule_t *rule = createRule(*layout);
+  TEST_ASSERT_NOT_NULL(rule);
+  TEST_ASSERT_NOT_NULL(rule->key);
+  TEST_ASSERT_NOT_EQUAL(key, rule->key);
+  TEST_ASSERT_EQUAL_UINT(4, rule->key->value_size);
+  TEST_ASSERT_NULL(rule->key->next);
+  TEST_ASSERT_NULL(rule->params);
+  p4rule_free(rule);
+
+  TEST_ASSERT_NULL(cache.getTable(pi_p4info_action_id_from_name(
+      p4info, "set_nhop")));
+}
+
+TEST(Combo_TableCache, GetAction) {
+  const TableCache &cache = tableCaches[dev_id];
+  const ActionLayout *action = cache.getAction(set_nhop_id);
+  TEST_ASSERT_NOT_NULL(action);
+  TEST_ASSERT_EQUAL_UINT(set_nhop_id, action->id);
+  TEST_ASSERT_EQUAL_STRING("set_nhop", action->name);
+  TEST_ASSERT_EQUAL_UINT(6, action->dataSize);
+  TEST_ASSERT_EQUAL_UINT(2, action->params.size());
+  TEST_ASSERT_EQUAL_UINT(4, action->params[0].bytewidth);
+  TEST_ASSERT_EQUAL_UINT(2, action->params[1].bytewidth);
+
+  p4param_t *params = NULL;
+  TEST_ASSERT_EQUAL_UINT(P4DEV_OK, createParams(*action, &params));
+  TEST_ASSERT_NOT_NULL(params);
+  TEST_ASSERT_EQUAL_UINT(4, params->value_size);
+  TEST_ASSERT_NOT_NULL(params->next);
+  TEST_ASSERT_EQUAL_UINT(2, params->next->value_size);
+  TEST_ASSERT_NULL(params->next->next);
+  p4param_free(params);
+
+  TEST_ASSERT_EQUAL_PTR(action, cache.getAction(std::string("set_nhop")));
+  TEST_ASSERT_NULL(cache.getAction(std::string("not_an_action")));
+  TEST_ASSERT_NULL(cache.getAction(ipv4_lpm_id));
+}
+
+TEST_GROUP_RUNNER(Combo_TableCache) {
+  RUN_TEST_CASE(Combo_TableCache, GetTable);
+  RUN_TEST_CASE(Combo_TableCache, GetAction);
+}
+
+TEST_GROUP(Combo_Tables);
+
+TEST_SETUP(Combo_Tables) {
+  load_config();
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_assign_device(dev_id, p4info, NULL));
+}
+
+TEST_TEAR_DOWN(Combo_Tables) {
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, _pi_remove_device(dev_id));
+  pi_destroy_config(p4info);
+}
+
+TEST(Combo_Tables, Add) {
+  Entry e1(0x0a000001, 24, 0x0a000001, 1);
+  Entry e2(0x45000001, 24, 0x45000001, 42);
+  pi_entry_handle_t h1, h2;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk,
+                                        &e1.entry, 0, &h1));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e2.mk,
+                                        &e2.entry, 0, &h2));
+  TEST_ASSERT_EQUAL_UINT64(0, h1);
+  TEST_ASSERT_EQUAL_UINT64(1, h2);
+
+  // each rule was allocated for its insert and is now owned by the table
+  p4table_t *table = get_p4table();
+  TEST_ASSERT_EQUAL_UINT(2, p4table_get_size(table));
+  const p4rule_t *r1 = p4table_get_rule(table, 0);
+  const p4rule_t *r2 = p4table_get_rule(table, 1);
+  TEST_ASSERT_EQUAL_HEX32(0x0a000001, rule_addr(r1));
+  TEST_ASSERT_EQUAL_UINT(24, r1->key->opt.prefix_len);
+  TEST_ASSERT_EQUAL_STRING("set_nhop", r1->action);
+  TEST_ASSERT_EQUAL_HEX32(0x0a000001, rule_nhop(r1));
+  TEST_ASSERT_EQUAL_HEX32(0x45000001, rule_addr(r2));
+  TEST_ASSERT_EQUAL_HEX32(0x45000001, rule_nhop(r2));
+  TEST_ASSERT_EQUAL_UINT8(42, r2->params->next->value[0]);
+  TEST_ASSERT_NOT_EQUAL(r1->key, r2->key);
+  TEST_ASSERT_NOT_EQUAL(r1->params, r2->params);
+
+  // duplicate key
+  pi_entry_handle_t h;
+  TEST_ASSERT_NOT_EQUAL(PI_STATUS_SUCCESS,
+                        _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk,
+                                            &e1.entry, 0, &h));
+  TEST_ASSERT_EQUAL_UINT(2, p4table_get_size(table));
+
+  e1.setAction(0x0b0b0b0b, 7);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk,
+                                        &e1.entry, 1, &h));
+  TEST_ASSERT_EQUAL_UINT64(h1, h);
+  TEST_ASSERT_EQUAL_HEX32(0x0b0b0b0b, rule_nhop(p4table_get_rule(table, 0)));
+}
+
+TEST(Combo_Tables, Modify) {
+  Entry e1(0x0a000001, 24, 0x0a000001, 1);
+  Entry e2(0x45000001, 24, 0x45000001, 42);
+  pi_entry_handle_t h1, h2;
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk, &e1.entry, 0, &h1);
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e2.mk, &e2.entry, 0, &h2);
+  p4table_t *table = get_p4table();
+
+  e2.setAction(0x0b0b0b0b, 1);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_modify(sess, dev_id, ipv4_lpm_id, h2,
+                                           &e2.entry));
+  TEST_ASSERT_EQUAL_HEX32(0x0a000001, rule_nhop(p4table_get_rule(table, 0)));
+  TEST_ASSERT_EQUAL_HEX32(0x0b0b0b0b, rule_nhop(p4table_get_rule(table, 1)));
+
+  e1.setAction(0x0c0c0c0c, 3);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_modify_wkey(sess, dev_id, ipv4_lpm_id,
+                                                e1.mk, &e1.entry));
+  TEST_ASSERT_EQUAL_HEX32(0x0c0c0c0c, rule_nhop(p4table_get_rule(table, 0)));
+  TEST_ASSERT_EQUAL_HEX32(0x0b0b0b0b, rule_nhop(p4table_get_rule(table, 1)));
+
+  // unknown key and out of range handle
+  Entry e3(0x01010101, 32, 0, 0);
+  TEST_ASSERT_NOT_EQUAL(PI_STATUS_SUCCESS,
+                        _pi_table_entry_modify_wkey(sess, dev_id, ipv4_lpm_id,
+                                                    e3.mk, &e3.entry));
+  TEST_ASSERT_NOT_EQUAL(PI_STATUS_SUCCESS,
+                        _pi_table_entry_modify(sess, dev_id, ipv4_lpm_id, 2,
+                                               &e3.entry));
+}
+
+TEST(Combo_Tables, Delete) {
+  Entry e1(0x0a000001, 24, 0x0a000001, 1);
+  Entry e2(0x45000001, 24, 0x45000001, 42);
+  Entry e3(0xff000001, 24, 0xff000001, 3);
+  pi_entry_handle_t h1, h2, h3;
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk, &e1.entry, 0, &h1);
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e2.mk, &e2.entry, 0, &h2);
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e3.mk, &e3.entry, 0, &h3);
+  p4table_t *table = get_p4table();
+
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_delete_wkey(sess, dev_id, ipv4_lpm_id,
+                                                e2.mk));
+  TEST_ASSERT_EQUAL_UINT(2, p4table_get_size(table));
+  TEST_ASSERT_NOT_EQUAL(PI_STATUS_SUCCESS,
+                        _pi_table_entry_delete_wkey(sess, dev_id, ipv4_lpm_id,
+                                                    e2.mk));
+
+  // rules are positional, e3 moved down to e2's index
+  TEST_ASSERT_EQUAL_HEX32(0xff000001, rule_addr(p4table_get_rule(table, 1)));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_delete(sess, dev_id, ipv4_lpm_id, h2));
+  TEST_ASSERT_EQUAL_UINT(1, p4table_get_size(table));
+  TEST_ASSERT_EQUAL_HEX32(0x0a000001, rule_addr(p4table_get_rule(table, 0)));
+  TEST_ASSERT_NOT_EQUAL(PI_STATUS_SUCCESS,
+                        _pi_table_entry_delete(sess, dev_id, ipv4_lpm_id, h2));
+}
+
+TEST(Combo_Tables, DeleteMiddleThenModify) {
+  // handles are positional, so clients must use the match key after a delete
+  bool stable = true;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_handles_stable(dev_id, &stable));
+  TEST_ASSERT_FALSE(stable);
+
+  Entry e1(0x0a000001, 24, 0x0a000001, 1);
+  Entry e2(0x45000001, 24, 0x45000001, 42);
+  Entry e3(0xff000001, 24, 0xff000001, 3);
+  pi_entry_handle_t h1, h2, h3;
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk, &e1.entry, 0, &h1);
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e2.mk, &e2.entry, 0, &h2);
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e3.mk, &e3.entry, 0, &h3);
+  p4table_t *table = get_p4table();
+
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_delete_wkey(sess, dev_id, ipv4_lpm_id,
+                                                e2.mk));
+
+  // the handle returned for e3 is now out of range
+  e3.setAction(0x0d0d0d0d, 4);
+  TEST_ASSERT_NOT_EQUAL(PI_STATUS_SUCCESS,
+                        _pi_table_entry_modify(sess, dev_id, ipv4_lpm_id, h3,
+                                               &e3.entry));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entry_modify_wkey(sess, dev_id, ipv4_lpm_id,
+                                                e3.mk, &e3.entry));
+  TEST_ASSERT_EQUAL_UINT(2, p4table_get_size(table));
+  TEST_ASSERT_EQUAL_HEX32(0x0a000001, rule_nhop(p4table_get_rule(table, 0)));
+  TEST_ASSERT_EQUAL_HEX32(0xff000001, rule_addr(p4table_get_rule(table, 1)));
+  TEST_ASSERT_EQUAL_HEX32(0x0d0d0d0d, rule_nhop(p4table_get_rule(table, 1)));
+}
+
+TEST(Combo_Tables, DefaultAction) {
+  Entry e(0, 0, 0x08080808, 9);
+  p4table_t *table = get_p4table();
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_default_action_set(sess, dev_tgt, ipv4_lpm_id,
+                                                 &e.entry));
+  const p4rule_t *rule = p4table_get_default_rule(table);
+  TEST_ASSERT_NOT_NULL(rule);
+  TEST_ASSERT_TRUE(rule->def);
+  TEST_ASSERT_EQUAL_HEX32(0x08080808, rule_nhop(rule));
+
+  pi_table_entry_t default_entry;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_default_action_get(sess, dev_id, ipv4_lpm_id,
+                                                 &default_entry));
+  TEST_ASSERT_EQUAL_UINT(set_nhop_id,
+                         default_entry.entry.action_data->action_id);
+  TEST_ASSERT_EQUAL_MEMORY(e.adata->data,
+                           default_entry.entry.action_data->data, 6);
+  _pi_table_default_action_done(sess, &default_entry);
+
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_default_action_reset(sess, dev_tgt,
+                                                   ipv4_lpm_id));
+  TEST_ASSERT_NULL(p4table_get_default_rule(table));
+}
+
+TEST(Combo_Tables, FetchTwice) {
+  Entry e1(0x0a000001, 24, 0x0a000001, 1);
+  pi_entry_handle_t h1;
+  _pi_table_entry_add(sess, dev_tgt, ipv4_lpm_id, e1.mk, &e1.entry, 0, &h1);
+
+  // reading entries back must not change the rules stored in libp4dev
+  pi_table_fetch_res_t res1, res2;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entries_fetch(sess, dev_id, ipv4_lpm_id, &res1));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_table_entries_fetch(sess, dev_id, ipv4_lpm_id, &res2));
+  TEST_ASSERT_EQUAL_UINT(1, res1.num_entries);
+  TEST_ASSERT_EQUAL_UINT(res1.entries_size, res2.entries_size);
+  TEST_ASSERT_EQUAL_MEMORY(res1.entries, res2.entries, res1.entries_size);
+  TEST_ASSERT_EQUAL_HEX32(0x0a000001,
+                          rule_addr(p4table_get_rule(get_p4table(), 0)));
+  _pi_table_entries_fetch_done(sess, &res1);
+  _pi_table_entries_fetch_done(sess, &res2);
+}
+
+TEST_GROUP_RUNNER(Combo_Tables) {
+  RUN_TEST_CASE(Combo_Tables, Add);
+  RUN_TEST_CASE(Combo_Tables, Modify);
+  RUN_TEST_CASE(Combo_Tables, Delete);
+  RUN_TEST_CASE(Combo_Tables, DeleteMiddleThenModify);
+  RUN_TEST_CASE(Combo_Tables, DefaultAction);
+  RUN_TEST_CASE(Combo_Tables, FetchTwice);
+}
+
+extern "C" void test_combo() {
+  RUN_TEST_GROUP(Combo_TableCache);
+  RUN_TEST_GROUP(Combo_Tables);
+}
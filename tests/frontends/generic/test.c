@@ -244,9 +244,60 @@ TEST_GROUP_RUNNER(FrontendGeneric_Adata) {
   RUN_TEST_CASE(FrontendGeneric_Adata, U128);
 }
 
+TEST_GROUP(FrontendGeneric_Pool);
+
+TEST_SETUP(FrontendGeneric_Pool) {
+  num_fields = 1;
+  num_actions = 1;
+  num_tables = 1;
+}
+
+TEST_TEAR_DOWN(FrontendGeneric_Pool) {}
+
+TEST(FrontendGeneric_Pool, Reuse) {
+  p4info_init(16, PI_P4INFO_MATCH_TYPE_TERNARY);
+  pi_match_key_set_priority(mkey, 7);
+  pi_netv_t fv;
+  pi_getnetv_u16(p4info, tid, fid, 0xabcd, &fv);
+  pi_match_key_ternary_set(mkey, &fv, &fv);
+  pi_match_key_t *old_mkey = mkey;
+  pi_match_key_destroy(mkey);
+  pi_action_data_t *old_adata = adata;
+  pi_action_data_destroy(adata);
+
+  // destroyed objects are handed out again, in a clean state
+  pi_match_key_allocate(p4info, tid, &mkey);
+  TEST_ASSERT_EQUAL_PTR(old_mkey, mkey);
+  TEST_ASSERT_EQUAL_UINT32(0, pi_match_key_get_priority(mkey));
+  TEST_ASSERT_EQUAL_UINT32(tid, mkey->table_id);
+  TEST_ASSERT_EQUAL_UINT(pi_p4info_table_match_key_size(p4info, tid),
+                         mkey->data_size);
+  pi_action_data_allocate(p4info, aid, &adata);
+  TEST_ASSERT_EQUAL_PTR(old_adata, adata);
+  TEST_ASSERT_EQUAL_UINT32(aid, pi_action_data_action_id_get(adata));
+
+  // a second object for the same table needs a new allocation
+  pi_match_key_t *mkey_2;
+  pi_match_key_allocate(p4info, tid, &mkey_2);
+  TEST_ASSERT_TRUE(mkey_2 != mkey);
+  pi_getnetv_u16(p4info, tid, fid, 0x1234, &fv);
+  pi_match_key_ternary_set(mkey_2, &fv, &fv);
+  char expected_data[4] = {0x12, 0x34, 0x12, 0x34};
+  TEST_ASSERT_EQUAL_MEMORY(expected_data, mkey_2->data, sizeof(expected_data));
+  pi_match_key_destroy(mkey_2);
+
+  // cached objects are released with the P4Info
+  p4info_destroy();
+}
+
+TEST_GROUP_RUNNER(FrontendGeneric_Pool) {
+  RUN_TEST_CASE(FrontendGeneric_Pool, Reuse);
+}
+
 void test_frontends_generic() {
   RUN_TEST_GROUP(FrontendGeneric_OneExact);
   RUN_TEST_GROUP(FrontendGeneric_OneLPM);
   RUN_TEST_GROUP(FrontendGeneric_OneTernary);
   RUN_TEST_GROUP(FrontendGeneric_Adata);
+  RUN_TEST_GROUP(FrontendGeneric_Pool);
 }
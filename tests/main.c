@@ -28,6 +28,11 @@ extern void test_bmv2_json_reader();
 extern void test_getnetv();
 extern void test_p4info();
 extern void test_frontends_generic();
+extern void test_combo();
+extern void test_counter_sweeper();
+extern void test_hw_sync_pool();
+extern void test_entry_handle_cache();
+extern void test_pd();
 
 static void run() {
 #ifdef TEST_BMV2_JSON_READER
@@ -42,6 +47,21 @@ static void run() {
 #ifdef TEST_FRONTENDS_GENERIC
   test_frontends_generic();
 #endif
+#ifdef TEST_COMBO
+  test_combo();
+#endif
+#ifdef TEST_COUNTER_SWEEPER
+  test_counter_sweeper();
+#endif
+#ifdef TEST_HW_SYNC_POOL
+  test_hw_sync_pool();
+#endif
+#ifdef TEST_ENTRY_HANDLE_CACHE
+  test_entry_handle_cache();
+#endif
+#ifdef TEST_PD
+  test_pd();
+#endif
 }
 
 int main(int argc, const char *argv[]) {
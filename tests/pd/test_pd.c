@@ -0,0 +1,216 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that the match keys and action data built by the code generated by
+// the PD generator for testdata/pd_key.p4 are the same as the ones built with
+// the generic frontend (pi_match_key_*_set / pi_action_data_arg_set).
+
+// the generated code is included directly to test the static functions which
+// build the match keys and the action data
+#include "src/pd_tables.c"
+
+#include "PI/frontends/generic/pi.h"
+#include "PI/p4info.h"
+
+#include "unity/unity_fixture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ITERATIONS 128
+// to check that the generated code does not write past the end of the data
+#define GUARD_SIZE 8
+#define GUARD_BYTE 0xab
+
+static pi_p4info_t *p4info;
+
+static pi_p4_id_t get_fid(pi_p4_id_t t_id, const char *name) {
+  pi_p4_id_t fid = pi_p4info_table_match_field_id_from_name(p4info, t_id, name);
+  TEST_ASSERT_NOT_EQUAL(PI_INVALID_ID, fid);
+  return fid;
+}
+
+static void rand_bytes(uint8_t *v, size_t size) {
+  for (size_t i = 0; i < size; i++) v[i] = rand() % 256;
+}
+
+// the values have random bits above the bitwidth of the field, which must be
+// masked
+static uint16_t rand_u16() { return (uint16_t)rand(); }
+static uint32_t rand_u32() { return (uint32_t)rand() ^ ((uint32_t)rand() << 16); }
+
+static void check_data(const char *expected, size_t size, const char *data) {
+  TEST_ASSERT_EQUAL_MEMORY(expected, data, size);
+  for (size_t i = 0; i < GUARD_SIZE; i++)
+    TEST_ASSERT_EQUAL_HEX8(GUARD_BYTE, (uint8_t)data[size + i]);
+}
+
+TEST_GROUP(PdKey);
+
+TEST_SETUP(PdKey) {
+  pi_status_t rc = pi_add_config_from_file(TESTDATADIR "/pd_key.json",
+                                           PI_CONFIG_TYPE_BMV2_JSON, &p4info);
+  TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, rc);
+}
+
+TEST_TEAR_DOWN(PdKey) { pi_destroy_config(p4info); }
+
+// exact, LPM and valid match fields
+TEST(PdKey, LpmOne) {
+  pi_p4_id_t t_id = pi_p4info_table_id_from_name(p4info, "LpmOne");
+  pi_p4_id_t f9_id = get_fid(t_id, "header_test.f9");
+  pi_p4_id_t f20_id = get_fid(t_id, "header_test.f20");
+  pi_p4_id_t valid_id = get_fid(t_id, "header_test.$valid$");
+  pi_p4_id_t f64_id = get_fid(t_id, "header_test.f64");
+  pi_match_key_t *mk;
+  pi_match_key_allocate(p4info, t_id, &mk);
+  pi_netv_t netv;
+
+  for (int i = 0; i < NUM_ITERATIONS; i++) {
+    p4_pd_pd_key_LpmOne_match_spec_t match_spec;
+    match_spec.header_test_f9 = rand_u16();
+    match_spec.header_test_f20 = rand_u32();
+    match_spec.header_test_f20_prefix_length = rand() % 21;
+    // any non-zero value means valid
+    match_spec.header_test_valid = rand() % 3;
+    rand_bytes(match_spec.header_test_f64, sizeof(match_spec.header_test_f64));
+
+    pi_match_key_init(mk);
+    pi_getnetv_u16(p4info, t_id, f9_id, match_spec.header_test_f9, &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_match_key_exact_set(mk, &netv));
+    pi_getnetv_u32(p4info, t_id, f20_id, match_spec.header_test_f20, &netv);
+    TEST_ASSERT_EQUAL_INT(
+        PI_STATUS_SUCCESS,
+        pi_match_key_lpm_set(mk, &netv,
+                             match_spec.header_test_f20_prefix_length));
+    pi_getnetv_u8(p4info, t_id, valid_id, match_spec.header_test_valid != 0,
+                  &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_match_key_exact_set(mk, &netv));
+    pi_getnetv_ptr(p4info, t_id, f64_id,
+                   (const char *)match_spec.header_test_f64,
+                   sizeof(match_spec.header_test_f64), &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS, pi_match_key_exact_set(mk, &netv));
+
+    char data[64];
+    TEST_ASSERT_TRUE(mk->data_size + GUARD_SIZE <= sizeof(data));
+    memset(data, GUARD_BYTE, sizeof(data));
+    build_key_LpmOne(data, &match_spec);
+    check_data(mk->data, mk->data_size, data);
+  }
+
+  pi_match_key_destroy(mk);
+}
+
+// the mask of a ternary field (resp. the end of a range field) is different
+// from its value (resp. start), to check that each one is written at its own
+// offset in the key
+TEST(PdKey, TernaryRangeOne) {
+  pi_p4_id_t t_id = pi_p4info_table_id_from_name(p4info, "TernaryRangeOne");
+  pi_p4_id_t f9_id = get_fid(t_id, "header_test.f9");
+  pi_p4_id_t f12_id = get_fid(t_id, "header_test.f12");
+  pi_p4_id_t f48_id = get_fid(t_id, "header_test.f48");
+  pi_match_key_t *mk;
+  pi_match_key_allocate(p4info, t_id, &mk);
+  pi_netv_t netv_1, netv_2;
+
+  for (int i = 0; i < NUM_ITERATIONS; i++) {
+    p4_pd_pd_key_TernaryRangeOne_match_spec_t match_spec;
+    match_spec.header_test_f9 = rand_u16();
+    match_spec.header_test_f12 = rand_u16();
+    match_spec.header_test_f12_mask = ~match_spec.header_test_f12;
+    rand_bytes(match_spec.header_test_f48_start,
+               sizeof(match_spec.header_test_f48_start));
+    for (size_t j = 0; j < sizeof(match_spec.header_test_f48_end); j++) {
+      match_spec.header_test_f48_end[j] =
+          ~match_spec.header_test_f48_start[j];
+    }
+
+    pi_match_key_init(mk);
+    pi_getnetv_u16(p4info, t_id, f9_id, match_spec.header_test_f9, &netv_1);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_match_key_exact_set(mk, &netv_1));
+    pi_getnetv_u16(p4info, t_id, f12_id, match_spec.header_test_f12, &netv_1);
+    pi_getnetv_u16(p4info, t_id, f12_id, match_spec.header_test_f12_mask,
+                   &netv_2);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_match_key_ternary_set(mk, &netv_1, &netv_2));
+    pi_getnetv_ptr(p4info, t_id, f48_id,
+                   (const char *)match_spec.header_test_f48_start,
+                   sizeof(match_spec.header_test_f48_start), &netv_1);
+    pi_getnetv_ptr(p4info, t_id, f48_id,
+                   (const char *)match_spec.header_test_f48_end,
+                   sizeof(match_spec.header_test_f48_end), &netv_2);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_match_key_range_set(mk, &netv_1, &netv_2));
+
+    char data[64];
+    TEST_ASSERT_TRUE(mk->data_size + GUARD_SIZE <= sizeof(data));
+    memset(data, GUARD_BYTE, sizeof(data));
+    build_key_TernaryRangeOne(data, &match_spec);
+    check_data(mk->data, mk->data_size, data);
+  }
+
+  pi_match_key_destroy(mk);
+}
+
+TEST(PdKey, ActionData) {
+  pi_p4_id_t a_id = pi_p4info_action_id_from_name(p4info, "actionA");
+  pi_p4_id_t p3_id = pi_p4info_action_param_id_from_name(p4info, a_id, "p3");
+  pi_p4_id_t p17_id = pi_p4info_action_param_id_from_name(p4info, a_id, "p17");
+  pi_p4_id_t p48_id = pi_p4info_action_param_id_from_name(p4info, a_id, "p48");
+  pi_p4_id_t p7_id = pi_p4info_action_param_id_from_name(p4info, a_id, "p7");
+  pi_action_data_t *adata;
+  pi_action_data_allocate(p4info, a_id, &adata);
+  pi_netv_t netv;
+
+  for (int i = 0; i < NUM_ITERATIONS; i++) {
+    p4_pd_pd_key_actionA_action_spec_t action_spec;
+    action_spec.action_p3 = rand() % 256;
+    action_spec.action_p17 = rand_u32();
+    rand_bytes(action_spec.action_p48, sizeof(action_spec.action_p48));
+    action_spec.action_p7 = rand() % 256;
+
+    pi_action_data_init(adata);
+    pi_getnetv_u8(p4info, a_id, p3_id, action_spec.action_p3, &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_action_data_arg_set(adata, &netv));
+    pi_getnetv_u32(p4info, a_id, p17_id, action_spec.action_p17, &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_action_data_arg_set(adata, &netv));
+    pi_getnetv_ptr(p4info, a_id, p48_id, (const char *)action_spec.action_p48,
+                   sizeof(action_spec.action_p48), &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_action_data_arg_set(adata, &netv));
+    pi_getnetv_u8(p4info, a_id, p7_id, action_spec.action_p7, &netv);
+    TEST_ASSERT_EQUAL_INT(PI_STATUS_SUCCESS,
+                          pi_action_data_arg_set(adata, &netv));
+
+    char data[64];
+    TEST_ASSERT_TRUE(adata->data_size + GUARD_SIZE <= sizeof(data));
+    memset(data, GUARD_BYTE, sizeof(data));
+    build_action_data_actionA(data, &action_spec);
+    check_data(adata->data, adata->data_size, data);
+  }
+
+  pi_action_data_destroy(adata);
+}
+
+TEST_GROUP_RUNNER(PdKey) {
+  RUN_TEST_CASE(PdKey, LpmOne);
+  RUN_TEST_CASE(PdKey, TernaryRangeOne);
+  RUN_TEST_CASE(PdKey, ActionData);
+}
+
+void test_pd() { RUN_TEST_GROUP(PdKey); }
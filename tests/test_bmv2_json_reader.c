@@ -25,6 +25,7 @@
 #include "utils.h"
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "unity/unity_fixture.h"
@@ -218,9 +219,56 @@ TEST(IdAssignment, IdCollision) {
   free(config);
 }
 
+TEST(IdAssignment, SameName) {
+  // objects are sorted by name before ids are assigned, objects with the same
+  // name must be assigned ids in the order in which they appear in the JSON
+  // (action i has one parameter of bitwidth i + 1)
+  enum { num_actions = 64 };
+  char config[8192];
+  size_t size = 0;
+  size += snprintf(config + size, sizeof(config) - size,
+                   "{\"__meta__\": {\"version\": [2, 5]}, "
+                   "\"header_types\": [], \"headers\": [], \"actions\": [");
+  for (size_t i = 0; i < num_actions; i++) {
+    size += snprintf(config + size, sizeof(config) - size,
+                     "%s{\"name\": \"a\", \"runtime_data\": "
+                     "[{\"name\": \"p\", \"bitwidth\": %zu}]}",
+                     (i == 0) ? "" : ", ", i + 1);
+  }
+  size += snprintf(config + size, sizeof(config) - size,
+                   "], \"pipelines\": [], \"counter_arrays\": [], "
+                   "\"meter_arrays\": []}");
+  TEST_ASSERT_TRUE(size < sizeof(config));
+
+  pi_p4info_t *p4info;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config(config, PI_CONFIG_TYPE_BMV2_JSON, &p4info));
+  TEST_ASSERT_EQUAL_UINT(num_actions, pi_p4info_action_get_num(p4info));
+
+  // all the actions hash to the same id, so the collisions are resolved by
+  // taking the next id, in the order in which the actions are processed
+  pi_p4_id_t ids[num_actions];
+  for (size_t i = 0; i < num_actions; i++) ids[i] = PI_INVALID_ID;
+  for (pi_p4_id_t id = pi_p4info_action_begin(p4info);
+       id != pi_p4info_action_end(p4info);
+       id = pi_p4info_action_next(p4info, id)) {
+    size_t bitwidth = pi_p4info_action_param_bitwidth(p4info, id, 1);
+    TEST_ASSERT_TRUE(bitwidth >= 1 && bitwidth <= num_actions);
+    ids[bitwidth - 1] = id;
+  }
+  for (size_t i = 1; i < num_actions; i++) {
+    TEST_ASSERT_EQUAL_UINT((ids[i - 1] + 1) & 0xffff, ids[i] & 0xffff);
+  }
+  // the name refers to the first action
+  TEST_ASSERT_EQUAL_UINT(ids[0], pi_p4info_action_id_from_name(p4info, "a"));
+
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_destroy_config(p4info));
+}
+
 TEST_GROUP_RUNNER(IdAssignment) {
   RUN_TEST_CASE(IdAssignment, Pragmas);
   RUN_TEST_CASE(IdAssignment, IdCollision);
+  RUN_TEST_CASE(IdAssignment, SameName);
 }
 
 void test_bmv2_json_reader() {
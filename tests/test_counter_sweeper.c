@@ -0,0 +1,287 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PI/p4info.h"
+#include "PI/pi.h"
+#include "PI/pi_counter.h"
+#include "PI/target/pi_counter_imp.h"
+
+#include "func_counter.h"
+
+#include "unity/unity_fixture.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+// the sweeper runs in its own thread, so all the tests below have to wait for
+// it; none of them should take anywhere close to this
+#define WAIT_TIMEOUT_MS 5000
+
+static const pi_dev_id_t dev_id = 0;
+static pi_p4info_t *p4info;
+static pi_session_handle_t sess;
+static pi_dev_tgt_t dev_tgt;
+static pi_p4_id_t c_id;
+static pi_p4_id_t direct_c_id;
+
+// the dummy target remembers the values written to it, so we write directly to
+// the target to simulate packets being counted by the hardware
+static void set_hw(size_t index, uint64_t packets, uint64_t bytes) {
+  pi_counter_data_t data;
+  data.valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  data.packets = packets;
+  data.bytes = bytes;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    _pi_counter_write(sess, dev_tgt, c_id, index, &data));
+}
+
+static pi_counter_data_t read_shadow(size_t index) {
+  pi_counter_data_t data;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_counter_read(sess, dev_tgt, c_id, index,
+                                    PI_COUNTER_FLAGS_SW_SHADOW, &data));
+  return data;
+}
+
+static pi_counter_data_t read_delta(size_t index) {
+  pi_counter_data_t data;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_counter_read_delta(dev_tgt, c_id, index, &data));
+  return data;
+}
+
+static void sleep_ms(long ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+  nanosleep(&ts, NULL);
+}
+
+// calls pred until it returns true, or fails the test after WAIT_TIMEOUT_MS
+static void wait_for(bool (*pred)(void *), void *arg) {
+  for (long waited = 0; !pred(arg); waited++) {
+    if (waited >= WAIT_TIMEOUT_MS) TEST_FAIL_MESSAGE("timeout");
+    sleep_ms(1);
+  }
+}
+
+typedef struct {
+  size_t index;
+  uint64_t packets;
+  uint64_t bytes;
+} expected_t;
+
+static bool shadow_is(void *arg) {
+  const expected_t *expected = (const expected_t *)arg;
+  pi_counter_data_t data = read_shadow(expected->index);
+  return data.packets == expected->packets && data.bytes == expected->bytes;
+}
+
+static bool delta_is(void *arg) {
+  const expected_t *expected = (const expected_t *)arg;
+  pi_counter_data_t data = read_delta(expected->index);
+  return data.packets == expected->packets && data.bytes == expected->bytes;
+}
+
+static bool hw_sync_count_reached(void *arg) {
+  return func_counter_get("_pi_counter_hw_sync") >= *(int *)arg;
+}
+
+// the dummy target completes the HW sync (and the sweep) before returning, so
+// once the sweeper has started 2 sweeps, the first one is complete and the
+// shadow has been primed
+static void start_sweep(uint32_t interval_ms, uint32_t hw_width) {
+  int hw_syncs = func_counter_get("_pi_counter_hw_sync");
+  if (hw_syncs < 0) hw_syncs = 0;
+  pi_counter_sweep_config_t config = {interval_ms, hw_width};
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_counter_sweep_start(dev_tgt, c_id, &config));
+  hw_syncs += 2;
+  wait_for(hw_sync_count_reached, &hw_syncs);
+}
+
+TEST_GROUP(CounterSweeper);
+
+TEST_SETUP(CounterSweeper) {
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_init(256, NULL));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_add_config_from_file(TESTDATADIR "/stats.json",
+                                            PI_CONFIG_TYPE_BMV2_JSON, &p4info));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_assign_device(dev_id, p4info, NULL));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_session_init(&sess));
+  dev_tgt.dev_id = dev_id;
+  dev_tgt.dev_pipe_mask = 0xffff;
+  c_id = pi_p4info_counter_id_from_name(p4info, "CounterA");
+  direct_c_id = pi_p4info_counter_id_from_name(p4info, "ExactOne_counter");
+  // values are kept by the dummy target across tests
+  for (size_t index = 0; index < 4; index++) set_hw(index, 0, 0);
+}
+
+TEST_TEAR_DOWN(CounterSweeper) {
+  pi_session_cleanup(sess);
+  pi_remove_device(dev_id);
+  pi_destroy_config(p4info);
+  pi_destroy();
+}
+
+TEST(CounterSweeper, InvalidConfig) {
+  pi_counter_sweep_config_t config = {0, 0};
+  TEST_ASSERT_EQUAL(PI_STATUS_INVALID_COUNTER_SWEEP_CONFIG,
+                    pi_counter_sweep_start(dev_tgt, c_id, &config));
+  config.interval_ms = 10;
+  TEST_ASSERT_EQUAL(PI_STATUS_COUNTER_IS_DIRECT,
+                    pi_counter_sweep_start(dev_tgt, direct_c_id, &config));
+}
+
+TEST(CounterSweeper, NotSwept) {
+  pi_counter_data_t data;
+  TEST_ASSERT_EQUAL(PI_STATUS_COUNTER_NOT_SWEPT,
+                    pi_counter_read_delta(dev_tgt, c_id, 0, &data));
+  TEST_ASSERT_EQUAL(PI_STATUS_COUNTER_NOT_SWEPT,
+                    pi_counter_sweep_stop(dev_id, c_id));
+  start_sweep(10, 0);
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_counter_sweep_stop(dev_id, c_id));
+  TEST_ASSERT_EQUAL(PI_STATUS_COUNTER_NOT_SWEPT,
+                    pi_counter_sweep_stop(dev_id, c_id));
+  TEST_ASSERT_EQUAL(PI_STATUS_COUNTER_NOT_SWEPT,
+                    pi_counter_read_delta(dev_tgt, c_id, 0, &data));
+}
+
+TEST(CounterSweeper, OutOfBound) {
+  start_sweep(10, 0);
+  pi_counter_data_t data;
+  size_t size = pi_p4info_counter_get_size(p4info, c_id);
+  TEST_ASSERT_EQUAL(PI_STATUS_OUT_OF_BOUND_IDX,
+                    pi_counter_read_delta(dev_tgt, c_id, size, &data));
+}
+
+TEST(CounterSweeper, Sweep) {
+  set_hw(0, 10, 1000);
+  start_sweep(5, 0);
+  // first sweep: shadow is primed with the hardware value
+  pi_counter_data_t data = read_shadow(0);
+  TEST_ASSERT_EQUAL_UINT64(10, data.packets);
+  TEST_ASSERT_EQUAL_UINT64(1000, data.bytes);
+
+  set_hw(0, 25, 2500);
+  expected_t expected = {0, 25, 2500};
+  wait_for(shadow_is, &expected);
+  // nothing changed after that, so the delta eventually goes back to 0
+  expected.packets = 0;
+  expected.bytes = 0;
+  wait_for(delta_is, &expected);
+
+  // once the sweep is stopped, reads go to the target again
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_counter_sweep_stop(dev_id, c_id));
+  set_hw(0, 3, 300);
+  data = read_shadow(0);
+  TEST_ASSERT_EQUAL_UINT64(3, data.packets);
+  TEST_ASSERT_EQUAL_UINT64(300, data.bytes);
+}
+
+TEST(CounterSweeper, Delta) {
+  set_hw(1, 100, 200);
+  // long interval so that we can observe the delta of a single sweep
+  start_sweep(200, 0);
+  set_hw(1, 107, 250);
+  expected_t expected = {1, 7, 50};
+  wait_for(delta_is, &expected);
+  pi_counter_data_t data = read_shadow(1);
+  TEST_ASSERT_EQUAL_UINT64(107, data.packets);
+  TEST_ASSERT_EQUAL_UINT64(250, data.bytes);
+}
+
+TEST(CounterSweeper, WrapAround) {
+  set_hw(2, 250, 65530);
+  start_sweep(200, 8);
+  // an 8-bit hardware counter wraps around from 250 to 4 after 10 packets; the
+  // bytes are truncated to 8 bits as well (65530 & 0xff == 250)
+  set_hw(2, 4, 4);
+  expected_t expected = {2, 10, 10};
+  wait_for(delta_is, &expected);
+  pi_counter_data_t data = read_shadow(2);
+  TEST_ASSERT_EQUAL_UINT64(260, data.packets);
+  TEST_ASSERT_EQUAL_UINT64(65540, data.bytes);
+}
+
+TEST(CounterSweeper, Write) {
+  set_hw(3, 40, 4000);
+  start_sweep(5, 0);
+
+  // a write replaces the shadow, and increments are counted from the written
+  // value
+  pi_counter_data_t data;
+  data.valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  data.packets = 5;
+  data.bytes = 500;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_counter_write(sess, dev_tgt, c_id, 3, &data));
+  data = read_shadow(3);
+  TEST_ASSERT_EQUAL_UINT64(5, data.packets);
+  TEST_ASSERT_EQUAL_UINT64(500, data.bytes);
+  set_hw(3, 8, 800);
+  expected_t expected = {3, 8, 800};
+  wait_for(shadow_is, &expected);
+}
+
+// a sweep which reads the target before a write and completes after it must be
+// discarded, otherwise the stale value it read is accumulated on top of the
+// written value; with a narrow hardware counter, the shadow is then off by
+// 2^hw_width for good
+TEST(CounterSweeper, WriteDuringSweep) {
+  start_sweep(1, 16);
+  pi_counter_data_t data;
+  data.valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+  for (uint64_t v = 1; v <= 200; v++) {
+    // alternate between large and small values so that a stale sweep result
+    // would produce a wrapped delta
+    data.packets = (v % 2) ? v * 1000 : v;
+    data.bytes = data.packets * 100;
+    TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                      pi_counter_write(sess, dev_tgt, c_id, 0, &data));
+    // wait for any sweep in progress during the write to complete, followed by
+    // a full sweep
+    int hw_syncs = func_counter_get("_pi_counter_hw_sync") + 2;
+    wait_for(hw_sync_count_reached, &hw_syncs);
+    pi_counter_data_t shadow = read_shadow(0);
+    TEST_ASSERT_EQUAL_UINT64(data.packets, shadow.packets);
+    TEST_ASSERT_EQUAL_UINT64(data.bytes, shadow.bytes);
+  }
+}
+
+TEST(CounterSweeper, UpdateDeviceRemovesSweeps) {
+  start_sweep(10, 0);
+  pi_counter_data_t data;
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_counter_read_delta(dev_tgt, c_id, 0, &data));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS,
+                    pi_update_device_start(dev_id, p4info, NULL, 0));
+  TEST_ASSERT_EQUAL(PI_STATUS_SUCCESS, pi_update_device_end(dev_id));
+  TEST_ASSERT_EQUAL(PI_STATUS_COUNTER_NOT_SWEPT,
+                    pi_counter_read_delta(dev_tgt, c_id, 0, &data));
+}
+
+TEST_GROUP_RUNNER(CounterSweeper) {
+  RUN_TEST_CASE(CounterSweeper, InvalidConfig);
+  RUN_TEST_CASE(CounterSweeper, NotSwept);
+  RUN_TEST_CASE(CounterSweeper, OutOfBound);
+  RUN_TEST_CASE(CounterSweeper, Sweep);
+  RUN_TEST_CASE(CounterSweeper, Delta);
+  RUN_TEST_CASE(CounterSweeper, WrapAround);
+  RUN_TEST_CASE(CounterSweeper, Write);
+  RUN_TEST_CASE(CounterSweeper, WriteDuringSweep);
+  RUN_TEST_CASE(CounterSweeper, UpdateDeviceRemovesSweeps);
+}
+
+void test_counter_sweeper() { RUN_TEST_GROUP(CounterSweeper); }